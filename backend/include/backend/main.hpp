@@ -2,6 +2,7 @@
 
 #include <backend/process/process_store.hpp>
 #include <backend/session_manager.hpp>
+#include <backend/terminal_frame_exchange.hpp>
 #include <persistence/state_holder.hpp>
 #include <backend/password/password_prompter.hpp>
 #include <ssh/async/processing_thread.hpp>
@@ -34,6 +35,8 @@ class Main
   private:
     std::filesystem::path programDir_;
     Persistence::StateHolder stateHolder_;
+    // Must outlive the window, which serves its scheme:
+    TerminalFrameExchange terminalFrames_;
     Nui::Window window_;
     Nui::RpcHub hub_;
     ProcessStore processes_;
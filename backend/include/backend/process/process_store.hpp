@@ -2,6 +2,7 @@
 
 #include <backend/process/process.hpp>
 #include <backend/process/environment.hpp>
+#include <backend/terminal_frame_exchange.hpp>
 #include <persistence/state/termios.hpp>
 
 #include <nui/rpc.hpp>
@@ -18,7 +19,11 @@
 class ProcessStore
 {
   public:
-    ProcessStore(boost::asio::any_io_executor executor, Nui::Window& wnd, Nui::RpcHub& hub);
+    ProcessStore(
+        boost::asio::any_io_executor executor,
+        Nui::Window& wnd,
+        Nui::RpcHub& hub,
+        TerminalFrameExchange& terminalFrames);
     ~ProcessStore();
 
     void registerRpc(Nui::Window& wnd, Nui::RpcHub& hub);
@@ -45,9 +50,16 @@ class ProcessStore
     void pruneDeadProcesses();
 
   private:
+    /// Passes data the frontend wrote to the terminal of the process on.
+    void write(std::string const& id, std::string const& data);
+    /// Erases the process and closes its terminal receiver.
+    void erase(std::unordered_map<std::string, std::shared_ptr<Process>>::iterator iter);
+
     boost::asio::any_io_executor executor_;
     Nui::Window* wnd_;
     Nui::RpcHub* hub_;
+    TerminalFrameExchange* terminalFrames_;
     std::unordered_map<std::string, std::shared_ptr<Process>> processes_;
+    std::unordered_map<std::string, std::string> terminalReceivers_;
     boost::uuids::random_generator uuidGenerator_;
 };
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include <boost/asio/strand.hpp>
 #include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <traits/functions.hpp>
 #include <mplex/tuple/pop_front.hpp>
 
@@ -294,6 +297,40 @@ namespace RpcHelper
             return strand_->execute(std::forward<decltype(func)>(func));
         }
 
+        /**
+         * @brief Runs a coroutine on the strand to answer an rpc call. The strand is free for other work while the
+         * coroutine awaits something. If the coroutine throws, the exception is sent as the error reply.
+         *
+         * @param reply The reply of the rpc call.
+         * @param func Called with the reply, returns the boost::asio::awaitable<void> to run.
+         */
+        template <typename FunctionT>
+        void within_strand_spawn(RpcOnce&& reply, FunctionT&& func)
+        {
+            auto sharedReply = std::make_shared<RpcOnce>(std::move(reply));
+            boost::asio::co_spawn(
+                *strand_,
+                [sharedReply, func = std::forward<FunctionT>(func)]() mutable -> boost::asio::awaitable<void> {
+                    co_await func(*sharedReply);
+                },
+                [sharedReply](std::exception_ptr error) {
+                    if (!error)
+                        return;
+                    try
+                    {
+                        std::rethrow_exception(error);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        (*sharedReply)({{"error", e.what()}});
+                    }
+                    catch (...)
+                    {
+                        (*sharedReply)({{"error", "Unknown error"}});
+                    }
+                });
+        }
+
         void within_strand_do_delayed(auto&& func, std::chrono::steady_clock::duration delay)
         {
             timer_.expires_after(delay);
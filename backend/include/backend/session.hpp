@@ -5,12 +5,14 @@
 #include <ids/ids.hpp>
 #include <backend/sftp/operation_queue.hpp>
 #include <backend/rpc_helper.hpp>
+#include <backend/terminal_frame_exchange.hpp>
 #include <persistence/state_holder.hpp>
 
 #include <unordered_map>
 #include <memory>
 #include <atomic>
 #include <optional>
+#include <vector>
 
 /**
  * @brief This session is the implementation equivalent of one tab in the UI.
@@ -23,7 +25,6 @@ class Session
     , public std::enable_shared_from_this<Session>
 {
   public:
-    constexpr static auto futureTimeout = std::chrono::seconds{10};
     constexpr static auto queueStartThrottle = std::chrono::milliseconds{5};
     constexpr static auto queueMaxThrottle = std::chrono::seconds{3};
 
@@ -34,7 +35,9 @@ class Session
         std::shared_ptr<boost::asio::strand<boost::asio::any_io_executor>> strand,
         Nui::Window& wnd,
         Nui::RpcHub& hub,
-        Persistence::SftpOptions const& sftpOptions);
+        TerminalFrameExchange& terminalFrames,
+        Persistence::SftpOptions const& sftpOptions,
+        std::shared_ptr<TokenBucket> globalBandwidth);
 
     Session(const Session&) = delete;
     Session& operator=(const Session&) = delete;
@@ -45,6 +48,17 @@ class Session
     void start();
     void stop();
 
+    /**
+     * @brief Takes an additional connection to the same host, starts it and hands its sftp session to the operation
+     * queue. Transfers use the main connection until one arrives.
+     */
+    void addTransferSession(std::unique_ptr<SecureShell::Session> transferSession);
+
+    /**
+     * @brief Lets transfers waiting for the application wide bandwidth limit continue after it changed.
+     */
+    void globalBandwidthChanged();
+
   private:
     /**
      * Handles calls from the frontend to create a new channel with the following payload:
@@ -64,6 +78,7 @@ class Session
      * {
      *     channelId: string
      * }
+     * Output and input then travel through the TerminalFrameExchange with the receiver "ssh_<channelId>".
      */
     void registerRpcStartChannelRead();
 
@@ -75,15 +90,6 @@ class Session
      */
     void registerRpcChannelClose();
 
-    /**
-     * Handles calls from the frontend to write data to a channel with the following payload:
-     * {
-     *     channelId: string,
-     *     data: string (base64 encoded)
-     * }
-     */
-    void registerRpcChannelWrite();
-
     /**
      * Handles calls from the frontend to resize the pty of a channel with the following payload:
      * {
@@ -121,8 +127,15 @@ class Session
      */
     void registerRpcSftpCreateFile();
     void registerRpcSftpAddDownloadOperation();
+    void registerRpcSftpAddUploadOperation();
     void registerOperationQueuePauseUnpause();
 
+    /**
+     * Handles calls from the frontend to get the instrumentation of the ssh processing thread. No payload.
+     * Replies with SharedData::ProcessingMetrics.
+     */
+    void registerRpcProcessingMetrics();
+
     void removeChannel(Ids::ChannelId channelId);
 
     void removeSftpChannel(Ids::ChannelId channelId);
@@ -196,7 +209,10 @@ class Session
     bool queueThrottleTimerIsRunning_{false};
     int unthrottledLimitCounter_{0};
     std::unique_ptr<SecureShell::Session> session_{};
+    /// Additional connections to the same host only used by the operation queue. Outlive the queue.
+    std::vector<std::unique_ptr<SecureShell::Session>> transferSessions_{};
     std::unordered_map<Ids::ChannelId, std::weak_ptr<SecureShell::Channel>, Ids::IdHash> channels_{};
     std::unordered_map<Ids::ChannelId, std::weak_ptr<SecureShell::SftpSession>, Ids::IdHash> sftpChannels_{};
     std::shared_ptr<OperationQueue> operationQueue_;
+    TerminalFrameExchange* terminalFrames_;
 };
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <persistence/state/terminal_engine.hpp>
 #include <persistence/state_holder.hpp>
 #include <backend/rpc_helper.hpp>
+#include <backend/transfer_connector.hpp>
+#include <ssh/async/processing_thread_pool.hpp>
 
 #include <nui/rpc.hpp>
 #include <libssh/libsshpp.hpp>
@@ -27,7 +29,8 @@ class SessionManager
         boost::asio::any_io_executor executor,
         Persistence::StateHolder& stateHolder,
         Nui::Window& wnd,
-        Nui::RpcHub& hub);
+        Nui::RpcHub& hub,
+        TerminalFrameExchange& terminalFrames);
     ~SessionManager() = default;
     SessionManager(SessionManager const&) = delete;
     SessionManager& operator=(SessionManager const&) = delete;
@@ -37,6 +40,14 @@ class SessionManager
     void registerRpc();
 
     void addPasswordProvider(int priority, PasswordProvider* provider);
+
+    /**
+     * @brief Changes the bandwidth limit all transfers of all sessions share, including running ones.
+     *
+     * @param bytesPerSecond 0 does not limit.
+     */
+    void globalBandwidthLimit(std::uint64_t bytesPerSecond);
+
     void joinSessionAdder();
     void addSession(
         Persistence::SshTerminalEngine const& engine,
@@ -66,16 +77,34 @@ class SessionManager
      */
     void registerRpcSessionDisconnect();
 
+    /**
+     * Handles calls from the frontend to change the application wide bandwidth limit with the following payload:
+     * {
+     *     bytesPerSecond: number (0 does not limit)
+     * }
+     */
+    void registerRpcSetGlobalBandwidthLimit();
+
+    /// Opens the transfer connections of a session in the background, after the session is connected.
+    void connectTransferSessions(Persistence::SshTerminalEngine const& engine, std::shared_ptr<Session> const& session);
+
     /// Removes a session and closes all its channels. Safe to call from any thread.
     void removeSession(Ids::SessionId sessionId);
 
   private:
     Persistence::StateHolder* stateHolder_{};
+    TerminalFrameExchange* terminalFrames_{};
+    /// Runs the libssh work of all sessions, instead of one thread per session.
+    std::shared_ptr<SecureShell::ProcessingThreadPool> processingPool_{};
+    /// The bandwidth limit all sessions share, an application setting applied by globalBandwidthLimit.
+    std::shared_ptr<TokenBucket> globalBandwidth_{std::make_shared<TokenBucket>()};
     std::unordered_map<Ids::SessionId, std::shared_ptr<Session>, Ids::IdHash> sessions_{};
 
     std::map<int, PasswordProvider*> passwordProviders_{};
     std::unique_ptr<std::thread> addSessionThread_{};
     std::vector<SecureShell::PasswordCacheEntry> pwCache_{};
+    /// Waits for the connections still opening when destroyed.
+    TransferConnector<SecureShell::Session> transferConnector_{};
     std::atomic_bool updateDispatchRunning_{false};
 };
 
@@ -1,5 +1,6 @@
 #include <backend/sftp/operation.hpp>
 #include <backend/sftp/download_operation.hpp>
+#include <backend/sftp/upload_operation.hpp>
 #include <backend/sftp/scan_operation.hpp>
 #include <backend/sftp/bulk_download_operation.hpp>
 
@@ -13,6 +14,10 @@ auto Operation::visit(FunctionT&& func) const
         {
             return func(static_cast<DownloadOperation const&>(*this));
         }
+        case Upload:
+        {
+            return func(static_cast<UploadOperation const&>(*this));
+        }
         case Scan:
         {
             return func(static_cast<ScanOperation const&>(*this));
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Limits a transfer rate. Tokens refill at the rate up to a small burst, transfers take them. A transfer that
+ * takes more than is left puts the bucket into debt, which later transfers wait out, so the average stays at the rate
+ * whatever the size of the chunks.
+ */
+class TokenBucket
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param bytesPerSecond 0 does not limit.
+     * @param burst How long the rate may be exceeded after the bucket was idle.
+     */
+    explicit TokenBucket(std::uint64_t bytesPerSecond = 0, Clock::duration burst = std::chrono::milliseconds{100});
+
+    std::uint64_t rate() const;
+    void rate(std::uint64_t bytesPerSecond);
+
+    /**
+     * @brief The bytes that may be transferred now, 0 while in debt. Unlimited buckets allow any amount.
+     */
+    std::uint64_t allowance(Clock::time_point now = Clock::now());
+
+    void consume(std::uint64_t bytes, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief How long until the allowance is above 0 again.
+     */
+    Clock::duration delay(Clock::time_point now = Clock::now());
+
+  private:
+    // Assumes the mutex is locked.
+    void refill(Clock::time_point now);
+    double capacity() const;
+
+  private:
+    mutable std::mutex mutex_{};
+    std::uint64_t rate_;
+    Clock::duration burst_;
+    double tokens_;
+    Clock::time_point lastRefill_;
+};
+
+/**
+ * @brief The buckets a transfer is limited by, like its own, the one of its session and the application wide one.
+ * Copies share the buckets.
+ */
+class BandwidthLimiter
+{
+  public:
+    BandwidthLimiter() = default;
+    explicit BandwidthLimiter(std::vector<std::shared_ptr<TokenBucket>> buckets);
+
+    /**
+     * @brief The smallest allowance of all buckets.
+     */
+    std::uint64_t allowance() const;
+
+    /**
+     * @brief Takes the bytes from all buckets.
+     */
+    void consume(std::uint64_t bytes) const;
+
+    /**
+     * @brief How long until every bucket allows transfers again.
+     */
+    TokenBucket::Clock::duration delay() const;
+
+    /**
+     * @brief The lowest rate of the buckets that limit, 0 if none does.
+     */
+    std::uint64_t rate() const;
+
+  private:
+    std::vector<std::shared_ptr<TokenBucket>> buckets_{};
+};
@@ -1,15 +1,26 @@
 #pragma once
 
 #include <backend/sftp/operation.hpp>
+#include <ssh/channel_interface.hpp>
 #include <ssh/file_stream.hpp>
+#include <ssh/sftp_session_interface.hpp>
 #include <nui/utility/move_detector.hpp>
 #include <backend/sftp/download_operation.hpp>
+#include <backend/sftp/scan_operation.hpp>
+#include <backend/sftp/gzip_decoder.hpp>
+#include <backend/sftp/tar_extractor.hpp>
+#include <shared_data/directory_entry_store.hpp>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <list>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
-// TODO: concurrent downloads!
 class BulkDownloadOperation : public Operation
 {
   public:
@@ -28,13 +39,27 @@ class BulkDownloadOperation : public Operation
         std::filesystem::path remotePath{};
         std::filesystem::path localPath{};
         DownloadOperation::DownloadOperationOptions individualOptions = {};
+        // Streams the whole directory as one archive created by the remote tar, instead of a round trip series per
+        // file. Falls back to downloading file by file when the remote cannot run tar.
         bool asArchive{false};
         std::string archiveFormat{"tar"};
+        // "gz" if the remote has gzip, or "none".
         std::string compressionMethod{"gz"};
         int compressionLevel{5};
+        // Archive output received but not extracted yet, before the ssh window pushes back on the remote.
+        std::size_t archiveWindow{8 * 1024 * 1024};
+        // The entries to download, filled by the scan in front of this operation while it is downloading.
+        std::shared_ptr<ScanResult const> scanResult{};
+        // Files downloaded at the same time, which overlaps their reads. libssh opens and closes files with blocking
+        // calls though, which the processing thread of a session makes one after another. Those round trips only
+        // overlap between sessions, see fileSessions.
+        std::size_t concurrency{1};
+        // Further connections the files are spread over, the session of the operation is used along with them. Each
+        // has a processing thread of its own, so files on different sessions are opened and closed in parallel.
+        std::vector<std::weak_ptr<SecureShell::ISftpSession>> fileSessions{};
     };
 
-    BulkDownloadOperation(SecureShell::SftpSession& sftp, BulkDownloadOperationOptions options);
+    BulkDownloadOperation(SecureShell::ISftpSession& sftp, BulkDownloadOperationOptions options);
     ~BulkDownloadOperation() override;
     BulkDownloadOperation(BulkDownloadOperation const&) = delete;
     BulkDownloadOperation(BulkDownloadOperation&&) = delete;
@@ -45,34 +70,68 @@ class BulkDownloadOperation : public Operation
     SharedData::OperationType type() const override;
     std::expected<void, Error> cancel(bool adoptCancelState) override;
 
-    void setScanResult(std::vector<SharedData::DirectoryEntry>&& entries, std::uint64_t totalBytes);
-
     bool isBarrier() const noexcept override
     {
         return false;
     }
 
-    // TODO: can do more than 1.
-    int parallelWorkDoable(int) const noexcept override
+    int parallelWorkDoable(int parallel) const noexcept override
     {
-        return 1;
+        return std::min(parallel, static_cast<int>(concurrency_));
     }
 
     SecureShell::ProcessingStrand* strand() const override;
+    std::optional<std::chrono::microseconds> roundTripTime() const override;
 
   private:
+    struct FileDownload
+    {
+        SharedData::DirectoryEntryStore::Index index;
+        PendingResult<std::weak_ptr<SecureShell::IFileStream>> pendingOpen{};
+        std::unique_ptr<DownloadOperation> download{};
+        // Bytes of this file already counted in currentBytes_.
+        std::uint64_t bytes{0};
+    };
+
     std::expected<WorkStatus, Error> workNormal();
     std::expected<WorkStatus, Error> workAsArchive();
-    std::expected<WorkStatus, Error> workCurrentFile();
-    std::filesystem::path fullLocalPath(SharedData::DirectoryEntry const& entry) const;
+    std::expected<void, Error> startNextEntry();
+    std::expected<WorkStatus, Error> workFile(FileDownload& file);
+    SecureShell::ISftpSession& nextFileSession();
+    std::expected<WorkStatus, Error> extractArchive();
+    std::expected<WorkStatus, Error> finishArchive();
+    std::optional<int> takeArchiveStatus();
+    std::expected<WorkStatus, Error> fallBackToSftp(std::string_view reason);
+    std::expected<void, std::string> consumeArchive(std::string_view data);
+    std::expected<WorkStatus, Error> waitForBandwidth();
+    void reportArchiveProgress();
+    void closeArchiveChannel();
+    std::string archiveCommand() const;
+    std::filesystem::path fullLocalPath(SharedData::DirectoryEntryStore::Index index) const;
 
   private:
-    SecureShell::SftpSession* sftp_;
+    SecureShell::ISftpSession* sftp_;
     BulkDownloadOperationOptions options_;
-    std::unique_ptr<DownloadOperation> currentDownload_;
-    std::vector<SharedData::DirectoryEntry> entries_;
-    std::uint64_t totalBytes_{0};
+    // A list, because the progress callbacks of the downloads refer to their entry.
+    std::list<FileDownload> downloads_;
+    std::size_t concurrency_;
+    std::size_t nextSession_{0};
+    std::shared_ptr<ScanResult const> scan_;
     std::uint64_t currentIndex_{0};
     std::uint64_t currentBytes_{0};
     std::chrono::seconds futureTimeout_{5};
+
+    PendingResult<std::weak_ptr<SecureShell::IChannel>> pendingChannel_;
+    std::weak_ptr<SecureShell::IChannel> archiveChannel_;
+    PendingChunks archiveChunks_;
+    // Errors of the remote tar and its exit status, which it prints last.
+    PendingChunks archiveErrors_;
+    std::vector<std::string> receivedArchive_;
+    // Output before the marker line, which tells how the archive is compressed.
+    std::string archiveLead_;
+    std::optional<bool> archiveCompressed_;
+    std::unique_ptr<GzipDecoder> gzipDecoder_;
+    std::string decompressed_;
+    std::unique_ptr<TarExtractor> tarExtractor_;
+    bool archiveFallback_{false};
 };
\ No newline at end of file
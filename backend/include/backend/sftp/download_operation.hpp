@@ -1,12 +1,17 @@
 #pragma once
 
 #include <backend/sftp/operation.hpp>
+#include <backend/sftp/bandwidth_limiter.hpp>
+#include <backend/sftp/local_file_writer.hpp>
 #include <ssh/file_stream.hpp>
 #include <nui/utility/move_detector.hpp>
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 class DownloadOperation : public Operation
 {
@@ -25,6 +30,28 @@ class DownloadOperation : public Operation
         bool doCleanup{true};
         std::optional<std::filesystem::perms> permissions{std::nullopt};
         std::chrono::seconds futureTimeout{5};
+        // Read requests kept outstanding, each as large as the server allows.
+        std::size_t readsInFlight{32};
+        // Further streams of the same remote file. Files of at least segmentThreshold bytes are split into disjoint
+        // segments then, which all streams read in parallel into the preallocated temporary file.
+        std::vector<std::weak_ptr<SecureShell::IFileStream>> segmentStreams{};
+        std::uint64_t segmentThreshold{64ull * 1024 * 1024};
+        // Segments are not made smaller than this, small ones would spend their time ramping the pipeline up.
+        std::uint64_t minimumSegmentSize{4 * 1024 * 1024};
+        // Received data is collected into blocks of this size, which a separate thread writes to the disk.
+        std::size_t writeBlockSize{4 * 1024 * 1024};
+        // Blocks waiting to be written before reading from the network pauses.
+        std::size_t writeQueueBlocks{4};
+        // The threads blocks are written on, shared with other downloads. The writer makes its own if null.
+        std::shared_ptr<LocalFileWritePool> writePool{};
+        // Received data is only taken from the read as fast as these allow.
+        BandwidthLimiter bandwidthLimiter{};
+        // The size of the remote file if it is known already, like from a directory listing. Saves the stat round
+        // trip, the file is downloaded as large as it was then.
+        std::optional<std::uint64_t> fileSize{std::nullopt};
+        // Closes the remote file without waiting for the server, so the next download can start right away. The close
+        // still blocks the processing thread of the session for a round trip.
+        bool closeInBackground{false};
     };
 
     SecureShell::ProcessingStrand* strand() const override
@@ -34,6 +61,13 @@ class DownloadOperation : public Operation
         return nullptr;
     }
 
+    std::optional<std::chrono::microseconds> roundTripTime() const override
+    {
+        if (auto stream = fileStream_.lock(); stream)
+            return stream->roundTripTime();
+        return std::nullopt;
+    }
+
     DownloadOperation(std::weak_ptr<SecureShell::IFileStream> fileStream, DownloadOperationOptions options);
     ~DownloadOperation() override;
     DownloadOperation(DownloadOperation const&) = delete;
@@ -80,10 +114,60 @@ class DownloadOperation : public Operation
     std::expected<void, Error> finalize();
 
   private:
-    /// Returns true if there is more data to read, false if the operation is complete.
-    std::expected<bool, Error> readOnce();
+    static constexpr std::chrono::milliseconds limitedReadAhead{250};
+
+    enum class ReadStatus
+    {
+        MoreData,
+        // A read is in flight.
+        Waiting,
+        Complete
+    };
+
+    struct Segment
+    {
+        std::uint64_t begin;
+        std::uint64_t end;
+        // Bytes written from begin on.
+        std::uint64_t done;
+        bool assigned;
+    };
+
+    struct SegmentWorker
+    {
+        std::weak_ptr<SecureShell::IFileStream> stream;
+        std::optional<std::size_t> segment{std::nullopt};
+        PendingChunks pendingChunks{};
+        std::shared_ptr<SecureShell::ReadWindow> window{};
+    };
+
+    std::expected<ReadStatus, Error> readOnce();
+    std::expected<ReadStatus, Error> readSegmentsOnce();
+
+    /**
+     * @brief Sleeps until the bandwidth limit allows more, without blocking the thread.
+     */
+    ReadStatus waitForBandwidth();
 
     std::expected<void, Error> openOrAdoptFile(SecureShell::IFileStream& stream);
+    std::expected<void, Error> openSegmentedFile();
+
+    /**
+     * @brief The segments with what was written of them are kept next to the temporary file, so an interrupted
+     * segmented download continues where each segment stopped.
+     */
+    std::string segmentMapPath() const;
+
+    std::unique_ptr<LocalFileWriter> makeWriter(std::string const& path) const;
+    std::shared_ptr<SecureShell::ReadWindow> makeReadWindow(SecureShell::IFileStream& stream);
+
+    /**
+     * @brief Under a bandwidth limit, only lets requests for limitedReadAhead of the current rate be outstanding. So
+     * the limit already holds back the requests, instead of a full window of responses arriving at once.
+     */
+    void limitReadWindow(SecureShell::ReadWindow& window) const;
+    bool loadSegmentMap();
+    void saveSegmentMap();
 
     void cleanup();
 
@@ -100,7 +184,29 @@ class DownloadOperation : public Operation
     bool doCleanup_;
     std::optional<std::filesystem::perms> permissions_;
     std::ofstream localFile_;
+    std::optional<std::uint64_t> knownFileSize_;
     std::uint64_t fileSize_;
+    bool closeInBackground_;
     std::chrono::seconds futureTimeout_;
-    std::array<char, 8192> buffer_;
+    std::size_t readsInFlight_;
+    PendingChunks pendingChunks_;
+    // Reused between reads, so their capacity stays allocated.
+    std::vector<std::string> receivedChunks_;
+    std::vector<std::weak_ptr<SecureShell::IFileStream>> segmentStreams_;
+    std::uint64_t segmentThreshold_;
+    std::uint64_t minimumSegmentSize_;
+    // Empty unless the download is segmented.
+    std::vector<Segment> segments_;
+    std::vector<SegmentWorker> workers_;
+    std::uint64_t segmentProgress_;
+    std::uint64_t savedSegmentProgress_;
+    std::size_t writeBlockSize_;
+    std::size_t writeQueueBlocks_;
+    std::shared_ptr<LocalFileWritePool> writePool_;
+    // Writes on the write pool after prepare, localFile_ is only used while preparing.
+    std::unique_ptr<LocalFileWriter> writer_;
+    // Where the next received chunk goes, unless segmented.
+    std::uint64_t writeOffset_;
+    std::shared_ptr<SecureShell::ReadWindow> readWindow_;
+    BandwidthLimiter bandwidthLimiter_;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <shared_data/directory_entry.hpp>
+
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Parses what the remote find of command() prints, piece by piece as it arrives. That lists a whole tree with
+ * sizes, modes, owners and times in one go, where sftp costs round trips for every directory.
+ * Output before the marker line, like greetings of shell startup files, is skipped. After it, every entry and finally
+ * the exit status of find are terminated by NUL, so names with newlines come through unharmed.
+ */
+class FindListingParser
+{
+  public:
+    /**
+     * @brief The command listing root. It needs find with -printf, like GNU find. Without it, nothing is printed.
+     *
+     * @param prunedNames Globs of directory names that are neither printed nor walked.
+     */
+    static std::string command(std::filesystem::path const& root, std::vector<std::string> const& prunedNames = {});
+
+    /**
+     * @brief Parses the next piece of the output.
+     *
+     * @return The first error, which ends the parsing.
+     */
+    std::expected<void, std::string> feed(std::string_view data);
+
+    /**
+     * @brief Moves out the entries parsed since the last call. Their path is relative to the root and every
+     * directory comes before its content, in the order find walked the tree.
+     */
+    std::vector<SharedData::DirectoryEntry> takeEntries();
+
+    /**
+     * @brief Was the marker line seen, so the remote can list with find?
+     */
+    bool started() const
+    {
+        return started_;
+    }
+
+    /**
+     * @brief The exit status of find, once the listing is complete.
+     */
+    std::optional<int> exitStatus() const
+    {
+        return exitStatus_;
+    }
+
+  private:
+    std::expected<void, std::string> parseRecord(std::string_view record);
+
+  private:
+    bool started_{false};
+    std::optional<int> exitStatus_{std::nullopt};
+    // Output not parsed yet, which is at most a partial record or marker line after feed.
+    std::string pending_{};
+    std::vector<SharedData::DirectoryEntry> entries_{};
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+
+struct z_stream_s;
+
+/**
+ * @brief Decompresses a gzip stream piece by piece, as it arrives.
+ */
+class GzipDecoder
+{
+  public:
+    GzipDecoder();
+    ~GzipDecoder();
+    GzipDecoder(GzipDecoder const&) = delete;
+    GzipDecoder(GzipDecoder&&) = delete;
+    GzipDecoder& operator=(GzipDecoder const&) = delete;
+    GzipDecoder& operator=(GzipDecoder&&) = delete;
+
+    /**
+     * @brief Decompresses input and appends the result to output. Input after the end of the stream is ignored.
+     */
+    std::expected<void, std::string> decode(std::string_view input, std::string& output);
+
+    /**
+     * @brief Was the end of the stream decoded?
+     */
+    bool finished() const;
+
+  private:
+    std::unique_ptr<z_stream_s> stream_;
+    bool initialized_;
+    bool finished_;
+};
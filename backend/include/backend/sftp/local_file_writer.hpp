@@ -0,0 +1,151 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The threads LocalFileWriters write their blocks on. Shared by the downloads of a queue, so a download does
+ * not start a thread of its own.
+ */
+class LocalFileWritePool
+{
+  public:
+    explicit LocalFileWritePool(std::size_t threads = 1);
+    /**
+     * @brief Runs the jobs that are posted already, then joins the threads.
+     */
+    ~LocalFileWritePool();
+    LocalFileWritePool(LocalFileWritePool const&) = delete;
+    LocalFileWritePool(LocalFileWritePool&&) = delete;
+    LocalFileWritePool& operator=(LocalFileWritePool const&) = delete;
+    LocalFileWritePool& operator=(LocalFileWritePool&&) = delete;
+
+    /**
+     * @brief Runs job on one of the threads, jobs start in the order they were posted.
+     */
+    void post(std::function<void()> job);
+
+  private:
+    void run();
+
+  private:
+    std::mutex mutex_{};
+    std::condition_variable wake_{};
+    std::deque<std::function<void()>> jobs_{};
+    bool stopping_{false};
+    std::vector<std::thread> threads_{};
+};
+
+/**
+ * @brief Writes downloaded data to a local file on a LocalFileWritePool, so receiving from the network and writing to
+ * the disk overlap. Data is collected into large blocks at explicit offsets, which a bounded queue hands to the pool.
+ * One block is written per job, so writers sharing a pool take turns. Producing is never blocked, full() tells the
+ * producer to stop until onWritten is called.
+ */
+class LocalFileWriter
+{
+  public:
+    struct Options
+    {
+        std::size_t blockSize{4 * 1024 * 1024};
+        // Blocks handed to the pool and not written yet, before full() reports backpressure.
+        std::size_t maxQueuedBlocks{4};
+        // Blocks collected at the same time, for producers that write several regions, like segmented downloads.
+        std::size_t maxCollectingBlocks{8};
+        // The size the file ends up with, if known. Blocks are not allocated larger than what is left to write.
+        std::optional<std::uint64_t> fileSize{std::nullopt};
+        // Called on a pool thread after a block was written or writing failed.
+        std::function<void()> onWritten{};
+        // A pool of one thread is made for this writer if null.
+        std::shared_ptr<LocalFileWritePool> pool{};
+    };
+
+    /**
+     * @brief Opens an existing file for writing without truncating it.
+     */
+    LocalFileWriter(std::filesystem::path const& path, Options options);
+    ~LocalFileWriter();
+    LocalFileWriter(LocalFileWriter const&) = delete;
+    LocalFileWriter(LocalFileWriter&&) = delete;
+    LocalFileWriter& operator=(LocalFileWriter const&) = delete;
+    LocalFileWriter& operator=(LocalFileWriter&&) = delete;
+
+    bool isOpen() const;
+
+    /**
+     * @brief Copies data to be written at offset. Data continuing a collected block is appended to it, full blocks
+     * are queued.
+     */
+    void write(std::uint64_t offset, std::string_view data);
+
+    /**
+     * @brief Queues the collected blocks, even if they are not full.
+     */
+    void flush();
+
+    /**
+     * @brief Are as many blocks queued as allowed?
+     */
+    bool full() const;
+
+    /**
+     * @brief Flushes and waits until everything written so far reached the file.
+     *
+     * @return The first write error, if any.
+     */
+    std::expected<void, std::string> sync();
+
+    /**
+     * @brief Writes what is left and closes the file. Called by the destructor too.
+     *
+     * @return The first write error, if any.
+     */
+    std::expected<void, std::string> close();
+
+    /**
+     * @brief The first write error, if any.
+     */
+    std::optional<std::string> error() const;
+
+  private:
+    struct Block
+    {
+        std::uint64_t offset;
+        std::string data;
+    };
+
+    // Runs on the pool, writes the oldest queued block.
+    void writeNext();
+    // Assumes the mutex is locked.
+    void queue(Block&& block);
+    std::string takeBuffer(std::uint64_t offset);
+
+  private:
+    Options options_;
+    std::ofstream file_;
+    bool open_;
+    mutable std::mutex mutex_{};
+    std::condition_variable blockWritten_{};
+    // Only touched by the producer.
+    std::vector<Block> collecting_{};
+    std::deque<Block> queued_{};
+    // Buffers of written blocks, reused so their capacity stays allocated.
+    std::vector<std::string> spareBuffers_{};
+    // Includes the block being written.
+    std::size_t unwritten_{0};
+    // A job is posted to the pool or running.
+    bool writing_{false};
+    std::optional<std::string> error_{};
+};
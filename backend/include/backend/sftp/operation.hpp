@@ -11,8 +11,210 @@
 
 #include <ids/ids.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <optional>
 #include <expected>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Receives the result of an asynchronous sftp call, for a later call of Operation::work to pick up.
+ * The call completes on the processing thread, work() runs on the strand of the queue. The state is shared with the
+ * completion handler, so an operation may be destroyed while a call is in flight.
+ */
+template <typename T>
+class PendingResult
+{
+  public:
+    using ResultType = std::expected<T, SecureShell::SftpError>;
+
+    /**
+     * @brief Is a call in flight whose result was not taken yet?
+     */
+    bool inFlight() const noexcept
+    {
+        return state_ != nullptr;
+    }
+
+    /**
+     * @brief Starts waiting for a result.
+     *
+     * @param onArrival Called on the processing thread after the result arrived.
+     * @return A completion handler to pass to the asynchronous call.
+     */
+    auto expect(std::function<void()> onArrival)
+    {
+        state_ = std::make_shared<State>();
+        return [state = state_, onArrival = std::move(onArrival)](std::exception_ptr error, ResultType result) {
+            {
+                std::scoped_lock lock{state->mutex};
+                if (error)
+                    state->result = std::unexpected(dropped(error));
+                else
+                    state->result = std::move(result);
+            }
+            if (onArrival)
+                onArrival();
+        };
+    }
+
+    /**
+     * @brief Returns the result if it arrived and stops waiting then.
+     */
+    std::optional<ResultType> take()
+    {
+        if (!state_)
+            return std::nullopt;
+
+        std::optional<ResultType> result{};
+        {
+            std::scoped_lock lock{state_->mutex};
+            result = std::move(state_->result);
+        }
+        if (result)
+            state_.reset();
+        return result;
+    }
+
+  private:
+    static SecureShell::SftpError dropped(std::exception_ptr const& error)
+    {
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (std::exception const& exc)
+        {
+            return {.message = exc.what(), .wrapperError = SecureShell::WrapperErrors::OperationDropped};
+        }
+        catch (...)
+        {
+            return {.message = "Unknown error", .wrapperError = SecureShell::WrapperErrors::OperationDropped};
+        }
+    }
+
+    struct State
+    {
+        std::mutex mutex{};
+        std::optional<ResultType> result{};
+    };
+    std::shared_ptr<State> state_{};
+};
+
+/**
+ * @brief Receives the chunks of a pipelined read, for later calls of Operation::work to pick up. Like PendingResult,
+ * the state is shared with the callbacks, so an operation may be destroyed while the read is running.
+ */
+class PendingChunks
+{
+  public:
+    using ResultType = std::expected<std::size_t, SecureShell::SftpError>;
+
+    /**
+     * @brief Was a read started?
+     */
+    bool started() const noexcept
+    {
+        return state_ != nullptr;
+    }
+
+    /**
+     * @brief Starts receiving chunks.
+     *
+     * @param onArrival Called on the processing thread when chunks arrive after all previous ones were taken and when
+     * the read completed.
+     * @return The chunk and completion handlers to pass to IFileStream::readPipelined.
+     */
+    std::pair<std::function<bool(std::string_view)>, std::function<void(ResultType&&)>>
+    expect(std::function<void()> onArrival)
+    {
+        state_ = std::make_shared<State>();
+        return {
+            [state = state_, onArrival](std::string_view chunk) {
+                bool notify = false;
+                {
+                    std::scoped_lock lock{state->mutex};
+                    if (state->stopped)
+                        return false;
+                    notify = state->chunks.empty();
+                    state->chunks.emplace_back(chunk);
+                }
+                if (notify && onArrival)
+                    onArrival();
+                return true;
+            },
+            [state = state_, onArrival](ResultType&& result) {
+                {
+                    std::scoped_lock lock{state->mutex};
+                    state->result = std::move(result);
+                }
+                if (onArrival)
+                    onArrival();
+            },
+        };
+    }
+
+    /**
+     * @brief Makes the read stop at the next chunk.
+     */
+    void stop()
+    {
+        if (!state_)
+            return;
+        std::scoped_lock lock{state_->mutex};
+        state_->stopped = true;
+    }
+
+    /**
+     * @brief Moves the chunks that arrived so far into chunks, until maxBytes were moved. The chunk reaching maxBytes
+     * is moved whole.
+     *
+     * @return The result of the read once it completed and all its chunks were taken.
+     */
+    std::optional<ResultType>
+    take(std::vector<std::string>& chunks, std::uint64_t maxBytes = std::numeric_limits<std::uint64_t>::max())
+    {
+        if (!state_)
+            return std::nullopt;
+
+        std::scoped_lock lock{state_->mutex};
+        std::uint64_t taken = 0;
+        std::size_t count = 0;
+        for (; count < state_->chunks.size() && taken < maxBytes; ++count)
+            taken += state_->chunks[count].size();
+
+        if (count == state_->chunks.size())
+        {
+            std::swap(chunks, state_->chunks);
+            return state_->result;
+        }
+
+        const auto end = state_->chunks.begin() + static_cast<std::ptrdiff_t>(count);
+        chunks.insert(chunks.end(), std::make_move_iterator(state_->chunks.begin()), std::make_move_iterator(end));
+        state_->chunks.erase(state_->chunks.begin(), end);
+        return std::nullopt;
+    }
+
+  private:
+    struct State
+    {
+        std::mutex mutex{};
+        std::vector<std::string> chunks{};
+        std::optional<ResultType> result{};
+        bool stopped{false};
+    };
+    std::shared_ptr<State> state_{};
+};
 
 class Operation
 {
@@ -37,6 +239,14 @@ class Operation
 
     virtual SecureShell::ProcessingStrand* strand() const = 0;
 
+    /**
+     * @brief The measured round trip time of the sftp requests of a transferring operation.
+     */
+    virtual std::optional<std::chrono::microseconds> roundTripTime() const
+    {
+        return std::nullopt;
+    }
+
     template <typename FunctionT>
     bool perform(FunctionT&& func)
     {
@@ -80,9 +290,33 @@ class Operation
     enum class WorkStatus
     {
         MoreWork,
+        // Waits for an asynchronous call, the wakeup function is called when work() should be called again.
+        Waiting,
         Complete
     };
 
+    /**
+     * @brief Sets the function that is called when an asynchronous call of the operation completed.
+     * It is called on the processing thread, not on the strand of the queue.
+     *
+     * @param wakeup Usually lets the queue work again without delay.
+     */
+    virtual void onWakeup(std::function<void()> wakeup)
+    {
+        wakeup_ = std::move(wakeup);
+    }
+
+    /**
+     * @brief Sets the function that wakes the operation up after a delay, for operations that wait for time to pass
+     * instead of an asynchronous call, like a transfer over its bandwidth limit.
+     *
+     * @param delayedWakeup Usually lets the queue work again once the delay passed.
+     */
+    virtual void onDelayedWakeup(std::function<void(std::chrono::steady_clock::duration)> delayedWakeup)
+    {
+        delayedWakeup_ = std::move(delayedWakeup);
+    }
+
     /**
      * @brief Performs work for the operation depending on the operation type.
      *
@@ -120,6 +354,8 @@ class Operation
   protected:
     OperationState state_{OperationState::NotStarted};
     std::optional<Error> error_{std::nullopt};
+    std::function<void()> wakeup_{};
+    std::function<void(std::chrono::steady_clock::duration)> delayedWakeup_{};
 
   private:
     Ids::OperationId id_;
@@ -1,18 +1,32 @@
 #pragma once
 
 #include <backend/sftp/all_operations.hpp>
+#include <backend/sftp/bandwidth_limiter.hpp>
+#include <backend/sftp/pending_progress.hpp>
+#include <backend/sftp/transfer_meter.hpp>
 #include <persistence/state/state.hpp>
 #include <ssh/sftp_session.hpp>
 #include <nui/rpc.hpp>
 #include <ids/ids.hpp>
 #include <backend/rpc_helper.hpp>
 #include <shared_data/file_operations/operation_completed.hpp>
+#include <shared_data/file_operations/progress_batch.hpp>
+#include <shared_data/bandwidth_limits.hpp>
+#include <shared_data/transfer_filter.hpp>
+
+#include <boost/asio/steady_timer.hpp>
 
 #include <deque>
 #include <filesystem>
+#include <unordered_map>
+#include <variant>
 #include <memory>
 #include <utility>
+#include <vector>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
 
 class OperationQueue
     : public RpcHelper::StrandRpc
@@ -31,6 +45,7 @@ class OperationQueue
         Nui::RpcHub& hub,
         Persistence::SftpOptions sftpOpts,
         Ids::SessionId sessionId,
+        std::shared_ptr<TokenBucket> globalBandwidth,
         int parallelism = 1);
 
     void cancelAll();
@@ -44,19 +59,114 @@ class OperationQueue
      */
     bool work();
 
-    std::expected<void, Operation::Error> addDownloadOperation(
-        SecureShell::SftpSession& sftp,
+    /**
+     * @brief Sets the function called when a waiting operation can continue. Called on the processing thread.
+     */
+    void onWorkAvailable(std::function<void()> onWorkAvailable);
+
+    /**
+     * @brief Adds an sftp session of a dedicated transfer connection. Transfers added afterwards are spread over
+     * these instead of using the sftp session they were requested on.
+     */
+    void addTransferSession(std::weak_ptr<SecureShell::SftpSession> sftp);
+
+    /**
+     * @param channelSftp Used when there is no transfer connection.
+     * @param filter What a directory download skips.
+     */
+    boost::asio::awaitable<std::expected<void, Operation::Error>> addDownloadOperation(
+        SecureShell::SftpSession& channelSftp,
+        Ids::OperationId operationId,
+        std::filesystem::path const& localPath,
+        std::filesystem::path const& remotePath,
+        SharedData::TransferFilterOptions const& filter = {});
+
+    /**
+     * @param channelSftp Used when there is no transfer connection.
+     */
+    boost::asio::awaitable<std::expected<void, Operation::Error>> addUploadOperation(
+        SecureShell::SftpSession& channelSftp,
         Ids::OperationId operationId,
         std::filesystem::path const& localPath,
         std::filesystem::path const& remotePath);
 
     void registerRpc();
 
+    /**
+     * @brief Changes the bandwidth limits of running and later transfers.
+     */
+    void bandwidthLimits(SharedData::BandwidthLimits const& limits);
+
+    /**
+     * @brief Lets transfers waiting for the application wide limit continue after it changed. The limit belongs to
+     * the session manager, which changes it for all queues.
+     */
+    void globalBandwidthChanged();
+
     bool paused() const;
     void paused(bool pause);
 
   private:
     void completeOperation(OperationCompleted&& operationCompleted);
+    void enqueue(Ids::OperationId operationId, std::unique_ptr<Operation> operation);
+
+    /**
+     * @brief The transfer connections take turns, nullptr if there is none.
+     */
+    std::shared_ptr<SecureShell::SftpSession> nextTransferSession();
+
+    /**
+     * @brief Keeps the progress until the next batch is sent, replacing older progress of the same operation.
+     * Callable from any thread.
+     */
+    template <typename ProgressT>
+    void reportProgress(std::vector<ProgressT> SharedData::ProgressBatch::*list, ProgressT&& progress);
+
+    /**
+     * @brief Sends the progress taken from pendingProgress_ in one call, with the telemetry of the transfers.
+     * Transfers that did not report are repeated once per telemetryInterval, so their stalls show.
+     */
+    void sendProgressBatch(SharedData::ProgressBatch batch);
+
+    /**
+     * @brief Lets the timer send the next batch at due.
+     */
+    void armProgressTimer(std::chrono::steady_clock::time_point due);
+
+    /**
+     * @brief Samples the meter of each transfer in the list and sets its telemetry.
+     */
+    template <typename ProgressT>
+    void measure(std::vector<ProgressT>& list, std::chrono::steady_clock::time_point now);
+
+    SharedData::TransferTelemetry telemetry(
+        Ids::OperationId const& operationId,
+        TransferMeter const& meter,
+        std::chrono::steady_clock::time_point now) const;
+
+    /**
+     * @brief Each transfer gets its own bucket, limited along with the session and the whole application.
+     */
+    BandwidthLimiter makeBandwidthLimiter();
+
+    /**
+     * @brief Lets the queue work again after the delay, earlier wakeups win. Callable from any thread.
+     */
+    void scheduleWakeup(std::chrono::steady_clock::duration delay);
+
+  private:
+    // Operations report progress per chunk, the frontend gets at most one batch per interval.
+    static constexpr std::chrono::milliseconds progressInterval{100};
+    static constexpr std::chrono::seconds telemetryInterval{1};
+
+    struct MeteredTransfer
+    {
+        TransferMeter meter;
+        // The last progress sent, repeated while the transfer does not report.
+        std::variant<SharedData::DownloadProgress, SharedData::UploadProgress, SharedData::BulkDownloadProgress>
+            progress;
+        std::chrono::steady_clock::time_point lastSent;
+    };
 
   private:
     Persistence::SftpOptions sftpOpts_{};
@@ -64,4 +174,19 @@ class OperationQueue
     std::deque<std::pair<Ids::OperationId, std::unique_ptr<Operation>>> operations_{};
     std::atomic_bool paused_{true};
     int parallelism_{1};
+    std::shared_ptr<std::function<void()>> onWorkAvailable_{std::make_shared<std::function<void()>>()};
+    std::vector<std::weak_ptr<SecureShell::SftpSession>> transferSessions_{};
+    std::size_t nextTransferSession_{0};
+    PendingProgress pendingProgress_{};
+    std::chrono::steady_clock::time_point lastProgressBatch_{};
+    std::unordered_map<Ids::OperationId, MeteredTransfer, Ids::IdHash> meteredTransfers_{};
+    boost::asio::steady_timer progressTimer_;
+    std::uint64_t operationBandwidthLimit_{0};
+    std::vector<std::weak_ptr<TokenBucket>> operationBandwidth_{};
+    std::shared_ptr<TokenBucket> sessionBandwidth_;
+    std::shared_ptr<TokenBucket> globalBandwidth_;
+    // The thread all downloads of the queue write to the disk on.
+    std::shared_ptr<LocalFileWritePool> writePool_{std::make_shared<LocalFileWritePool>()};
+    bool wakeupScheduled_{false};
+    boost::asio::steady_timer wakeupTimer_;
 };
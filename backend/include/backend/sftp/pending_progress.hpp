@@ -0,0 +1,61 @@
+#pragma once
+
+#include <ids/ids.hpp>
+#include <shared_data/file_operations/progress_batch.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Collects the progress operations report between two batches, only the latest of an operation is kept.
+ * Progress of completed operations is dropped, it would arrive after their completion otherwise. Thread safe, progress
+ * is reported from the processing threads.
+ */
+class PendingProgress
+{
+  public:
+    /**
+     * @brief Keeps the progress, replacing older progress of the same operation.
+     *
+     * @return true If it is the first progress since the last take, so the next batch has to be scheduled.
+     */
+    template <typename ProgressT>
+    bool add(std::vector<ProgressT> SharedData::ProgressBatch::*list, ProgressT&& progress)
+    {
+        std::scoped_lock lock{mutex_};
+        if (completed_.contains(progress.operationId))
+            return false;
+
+        auto& pending = pending_.*list;
+        auto iter = std::find_if(pending.begin(), pending.end(), [&progress](auto const& other) {
+            return other.operationId == progress.operationId;
+        });
+        if (iter != pending.end())
+            *iter = std::forward<ProgressT>(progress);
+        else
+            pending.push_back(std::forward<ProgressT>(progress));
+
+        return !std::exchange(scheduled_, true);
+    }
+
+    /**
+     * @brief Takes the progress collected so far, the next add schedules a batch again.
+     */
+    SharedData::ProgressBatch take();
+
+    /**
+     * @brief Takes the progress collected so far, which has to be sent before the completion of the operation. What
+     * the operation reports afterwards is dropped.
+     */
+    SharedData::ProgressBatch complete(Ids::OperationId const& operationId);
+
+  private:
+    std::mutex mutex_{};
+    SharedData::ProgressBatch pending_{};
+    bool scheduled_{false};
+    // Operations report from other threads, so their progress can trail the completion.
+    std::unordered_set<Ids::OperationId, Ids::IdHash> completed_{};
+};
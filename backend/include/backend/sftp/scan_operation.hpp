@@ -1,15 +1,49 @@
 #pragma once
 
 #include <ssh/file_stream.hpp>
+#include <ssh/file_information.hpp>
+#include <ssh/sftp_directory_lister.hpp>
 #include <backend/sftp/operation.hpp>
+#include <backend/sftp/find_listing_parser.hpp>
 #include <nui/utility/move_detector.hpp>
-#include <utility/directory_traversal.hpp>
+#include <shared_data/directory_entry_store.hpp>
+#include <shared_data/transfer_filter.hpp>
 
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 #include <cstdint>
 
+namespace SecureShell
+{
+    class Channel;
+}
+
+/**
+ * @brief The entries a scan found so far. Shared with the bulk download behind the scan, which downloads them while the
+ * scan is still running. Both are only worked on the strand of the queue.
+ */
+struct ScanResult
+{
+    enum class State
+    {
+        Scanning,
+        Complete,
+        // Failed, canceled or removed before it completed.
+        Aborted
+    };
+
+    SharedData::DirectoryEntryStore entries{};
+    // The size of the regular files among the entries.
+    std::uint64_t totalBytes{0};
+    State state{State::Scanning};
+};
+
 class ScanOperation : public Operation
 {
   public:
@@ -19,6 +53,14 @@ class ScanOperation : public Operation
             progressCallback = [](auto, auto, auto) {};
         std::filesystem::path remotePath{};
         std::chrono::seconds futureTimeout{5};
+        // Directories listed at the same time over a channel of their own. 1 lists one directory after another over
+        // the sftp session, which costs several round trips per directory.
+        std::size_t concurrency{64};
+        // Lists the whole tree with one find command of the remote, instead of listing directory by directory. Falls
+        // back to sftp if the remote has no GNU find.
+        bool useFind{false};
+        // Entries left out of the result. Directories left out are not listed at all.
+        SharedData::TransferFilterOptions filter{};
     };
 
     SecureShell::ProcessingStrand* strand() const override;
@@ -37,9 +79,10 @@ class ScanOperation : public Operation
         return SharedData::OperationType::Scan;
     }
 
+    // The bulk download behind the scan is worked along with it.
     bool isBarrier() const noexcept override
     {
-        return true;
+        return false;
     }
 
     int parallelWorkDoable(int) const noexcept override
@@ -54,35 +97,67 @@ class ScanOperation : public Operation
 
     std::expected<void, Error> cancel(bool adoptCancelState) override;
 
-    auto withWalkerDo(auto&& fn)
+    /**
+     * @brief The entries found so far, they grow while the scan runs.
+     */
+    std::shared_ptr<ScanResult const> result() const
     {
-        auto scan = [this](std::filesystem::path const& path) {
-            return scanner(path);
-        };
-        using WalkerType = Utility::DeepDirectoryWalker<SharedData::DirectoryEntry, Error, decltype(scan), true>;
-        if (!walker_)
-            walker_ = std::make_unique<WalkerType>(remotePath_, std::move(scan));
-        return fn(static_cast<WalkerType&>(*walker_));
+        return result_;
     }
 
+  private:
     /**
-     * @brief Eject the scanned directory entries. Careful!: The internal list is moved out.
-     *
-     * @return std::vector<SharedData::DirectoryEntry>
+     * @brief Lists the next directory asynchronously and adds the listing to the entries once it arrived.
      */
-    std::vector<SharedData::DirectoryEntry> ejectEntries()
-    {
-        return withWalkerDo([](auto& walker) {
-            return std::move(walker).ejectEntries();
-        });
-    }
+    std::expected<WorkStatus, Error> walkOnce();
 
-    std::uint64_t totalBytes() const;
+    /**
+     * @brief Opens the channel for the concurrent listings.
+     */
+    std::expected<WorkStatus, Error> startConcurrentWalk();
 
-    std::expected<std::vector<SharedData::DirectoryEntry>, Error> scanner(std::filesystem::path const& path);
+    /**
+     * @brief Passes the output of the channel to the lister, adds the listings in the order of the entries and
+     * requests the next directories.
+     */
+    std::expected<WorkStatus, Error> walkConcurrently();
 
-  private:
-    std::expected<void, ScanOperation::Error> scanOnce(std::filesystem::path const& path);
+    /**
+     * @brief Continues with walkOnce from the first directory that was not added yet.
+     */
+    std::expected<WorkStatus, Error> fallBackToWalkOnce(std::string const& reason);
+
+    /**
+     * @brief Runs find on a channel of its own.
+     */
+    std::expected<WorkStatus, Error> startFind();
+
+    /**
+     * @brief Adds what find printed so far to the entries.
+     */
+    std::expected<WorkStatus, Error> listWithFind();
+
+    /**
+     * @brief Continues with listing over sftp, before find added any entry.
+     */
+    std::expected<WorkStatus, Error> fallBackFromFind(std::string const& reason);
+
+    /**
+     * @brief Adds entries found by find, whose paths are relative to the root.
+     */
+    std::expected<void, Error> addFoundEntries(std::vector<SharedData::DirectoryEntry>& found);
+
+    void closeChannel();
+
+    /**
+     * @brief Adds the listing of the directory at currentIndex_ and moves on to the next directory to list.
+     */
+    void addListing(std::vector<SecureShell::FileInformation> const& listing);
+
+    bool completed() const
+    {
+        return currentIndex_ >= result_->entries.size();
+    }
 
   private:
     SecureShell::SftpSession* sftp_;
@@ -90,5 +165,28 @@ class ScanOperation : public Operation
     std::function<void(std::uint64_t totalBytes, std::uint64_t currentIndex, std::uint64_t totalScanned)>
         progressCallback_;
     std::chrono::seconds futureTimeout_;
-    std::unique_ptr<Utility::BaseDirectoryWalker> walker_;
+    std::shared_ptr<ScanResult> result_;
+    // The directory listed next, entries before it are done.
+    std::size_t currentIndex_;
+    PendingResult<std::vector<SecureShell::FileInformation>> pendingListing_;
+
+    std::size_t concurrency_;
+    PendingResult<std::weak_ptr<SecureShell::Channel>> pendingChannel_;
+    std::weak_ptr<SecureShell::Channel> channel_;
+    PendingChunks channelOutput_;
+    std::vector<std::string> receivedOutput_;
+    std::optional<SecureShell::SftpDirectoryLister> lister_;
+    // Listings that arrived before the listings of the directories in front of them, keyed by entry index. They are
+    // added in order, so the entries come out the same as when listing one directory after another.
+    std::map<std::size_t, SecureShell::SftpDirectoryLister::Listing> arrivedListings_;
+    // The directory requested next, directories before it were requested already.
+    std::size_t nextRequestIndex_;
+
+    bool useFind_;
+    std::optional<FindListingParser> findParser_;
+    // The directory find is in and its parents, by relative path. Find lists a directory right before its content, so
+    // the parent of the next entry is always among them. Directories left out by the filter have no index.
+    std::vector<std::pair<std::string, std::optional<SharedData::DirectoryEntryStore::Index>>> findDirectories_;
+
+    SharedData::TransferFilter filter_;
 };
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Extracts a tar stream into a local directory piece by piece, as it arrives, without ever holding more than a
+ * header in memory. Understands ustar, GNU long names and pax extended headers, which covers what GNU, BSD and busybox
+ * tar produce. Entries that would end up outside the directory are refused.
+ */
+class TarExtractor
+{
+  public:
+    struct Options
+    {
+        bool mayOverwrite{false};
+        // Applies the permission bits of files from the archive.
+        bool keepPermissions{true};
+    };
+
+    TarExtractor(std::filesystem::path root, Options options);
+    ~TarExtractor();
+    TarExtractor(TarExtractor const&) = delete;
+    TarExtractor(TarExtractor&&) = delete;
+    TarExtractor& operator=(TarExtractor const&) = delete;
+    TarExtractor& operator=(TarExtractor&&) = delete;
+
+    /**
+     * @brief Extracts the next piece of the stream. Data after the end of the archive is ignored.
+     *
+     * @return The first error, which ends the extraction.
+     */
+    std::expected<void, std::string> feed(std::string_view data);
+
+    /**
+     * @brief Was the end of the archive reached?
+     */
+    bool finished() const
+    {
+        return finished_;
+    }
+
+    /**
+     * @brief File contents extracted so far.
+     */
+    std::uint64_t bytesExtracted() const
+    {
+        return bytesExtracted_;
+    }
+
+    /**
+     * @brief Entries extracted so far, including directories.
+     */
+    std::uint64_t entriesExtracted() const
+    {
+        return entriesExtracted_;
+    }
+
+    /**
+     * @brief The entry currently or last extracted.
+     */
+    std::filesystem::path const& currentPath() const
+    {
+        return currentPath_;
+    }
+
+    std::uint64_t currentFileBytes() const
+    {
+        return currentFileBytes_;
+    }
+
+    std::uint64_t currentFileSize() const
+    {
+        return currentFileSize_;
+    }
+
+  private:
+    static constexpr std::size_t blockSize{512};
+
+    enum class Target
+    {
+        File,
+        LongName,
+        LongLinkName,
+        PaxHeader,
+        Discard
+    };
+
+    std::expected<void, std::string> onHeader();
+    std::expected<void, std::string> onData(std::string_view data);
+    std::expected<void, std::string> onEntryEnd();
+    std::expected<std::filesystem::path, std::string> localPath(std::string const& name) const;
+    void parsePaxHeader();
+    void beginData(Target target, std::uint64_t size);
+
+  private:
+    std::filesystem::path root_;
+    Options options_;
+
+    std::array<char, blockSize> header_{};
+    std::size_t headerFill_{0};
+    std::size_t zeroBlocks_{0};
+    bool finished_{false};
+
+    Target target_{Target::Discard};
+    std::uint64_t remaining_{0};
+    std::uint64_t padding_{0};
+    std::string metadata_{};
+
+    // Overrides of the next header, from GNU long name entries and pax extended headers.
+    std::optional<std::string> nextName_{};
+    std::optional<std::string> nextLinkName_{};
+    std::optional<std::uint64_t> nextSize_{};
+
+    std::ofstream file_{};
+    std::optional<std::filesystem::perms> filePermissions_{};
+    std::filesystem::path currentPath_{};
+    std::uint64_t currentFileBytes_{0};
+    std::uint64_t currentFileSize_{0};
+    std::uint64_t bytesExtracted_{0};
+    std::uint64_t entriesExtracted_{0};
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief Derives the throughput, the remaining time and stalls of a transfer from samples of its progress.
+ * The throughput is an exponential moving average, so it follows changes within seconds without jumping around.
+ */
+class TransferMeter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // How far the average looks back, roughly.
+    static constexpr std::chrono::seconds averagingTime{5};
+    // A transfer without progress for this long is stalled.
+    static constexpr std::chrono::seconds stallTime{15};
+
+    explicit TransferMeter(Clock::time_point start = Clock::now());
+
+    /**
+     * @param current The bytes transferred so far.
+     * @param total The bytes to transfer.
+     */
+    void sample(std::uint64_t current, std::uint64_t total, Clock::time_point now = Clock::now());
+
+    double bytesPerSecond() const;
+
+    /**
+     * @brief The remaining time at the current throughput, nullopt while nothing moves.
+     */
+    std::optional<std::chrono::seconds> eta() const;
+
+    bool stalled(Clock::time_point now = Clock::now()) const;
+
+  private:
+    Clock::time_point lastSample_;
+    Clock::time_point lastProgress_;
+    std::uint64_t current_;
+    std::uint64_t total_;
+    double bytesPerSecond_;
+    bool sampled_;
+};
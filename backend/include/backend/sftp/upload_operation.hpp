@@ -0,0 +1,150 @@
+#pragma once
+
+#include <backend/sftp/operation.hpp>
+#include <backend/sftp/bandwidth_limiter.hpp>
+#include <ssh/file_stream.hpp>
+#include <ssh/pipelined_write_source.hpp>
+#include <ssh/sftp_session_interface.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+class UploadOperation : public Operation
+{
+  public:
+    struct UploadOperationOptions
+    {
+        std::function<void(std::uint64_t min, std::uint64_t max, std::uint64_t current)> progressCallback =
+            [](auto, auto, auto) {};
+        std::filesystem::path localPath{};
+        std::filesystem::path remotePath{};
+        std::string tempFileSuffix{".filepart"};
+        bool mayOverwrite{false};
+        bool tryContinue{false};
+        bool inheritPermissions{false};
+        bool doCleanup{true};
+        std::optional<std::filesystem::perms> permissions{std::nullopt};
+        // Write requests kept outstanding, each as large as the server allows.
+        std::size_t writesInFlight{32};
+        // The local file is read in blocks of this size, ahead of what the server confirmed.
+        std::size_t readBlockSize{1024 * 1024};
+        // The local file is only read as fast as these allow.
+        BandwidthLimiter bandwidthLimiter{};
+    };
+
+    SecureShell::ProcessingStrand* strand() const override;
+    std::optional<std::chrono::microseconds> roundTripTime() const override;
+
+    UploadOperation(SecureShell::ISftpSession& sftp, UploadOperationOptions options);
+    ~UploadOperation() override;
+    UploadOperation(UploadOperation const&) = delete;
+    UploadOperation(UploadOperation&&) = delete;
+    UploadOperation& operator=(UploadOperation const&) = delete;
+    UploadOperation& operator=(UploadOperation&&) = delete;
+
+    std::expected<WorkStatus, Error> work() override;
+
+    bool isBarrier() const noexcept override
+    {
+        return false;
+    }
+
+    int parallelWorkDoable(int) const noexcept override
+    {
+        return 1;
+    }
+
+    SharedData::OperationType type() const override
+    {
+        return SharedData::OperationType::Upload;
+    }
+
+    std::filesystem::path remotePath() const
+    {
+        return remotePath_;
+    }
+
+    std::filesystem::path localPath() const
+    {
+        return localPath_;
+    }
+
+    std::expected<void, Error> cancel(bool adoptCancelState) override;
+
+    /**
+     * @brief Checks the target and opens the temporary file. Each call advances as far as it can without waiting for
+     * the server.
+     *
+     * @return Waiting while a call is in flight, Complete once prepared.
+     */
+    std::expected<WorkStatus, Error> prepare();
+
+    /**
+     * @brief Moves the temporary file to the target and sets its permissions, like prepare without waiting.
+     *
+     * @return Waiting while a call is in flight, Complete once finalized.
+     */
+    std::expected<WorkStatus, Error> finalize();
+
+  private:
+    // The server calls of preparing and finalizing, in order.
+    enum class Step
+    {
+        CheckTarget,
+        CheckPart,
+        OpenPart,
+        SeekPart,
+        Prepared,
+        CheckTargetAgain,
+        Rename,
+        SetPermissions,
+        Finalized
+    };
+
+    enum class WriteStatus
+    {
+        MoreData,
+        // Waits for the server to confirm writes.
+        Waiting,
+        Complete
+    };
+
+    std::expected<WriteStatus, Error> writeOnce();
+
+    std::expected<void, Error> openLocalFile();
+
+    std::filesystem::path tempPath() const;
+
+    void cleanup();
+
+  private:
+    SecureShell::ISftpSession* sftp_;
+    std::weak_ptr<SecureShell::IFileStream> fileStream_;
+    std::filesystem::path localPath_;
+    std::filesystem::path remotePath_;
+    std::string tempFileSuffix_;
+    std::function<void(std::uint64_t min, std::uint64_t max, std::uint64_t current)> progressCallback_;
+    bool mayOverwrite_;
+    bool tryContinue_;
+    bool inheritPermissions_;
+    bool doCleanup_;
+    std::optional<std::filesystem::perms> permissions_;
+    std::ifstream localFile_;
+    std::uint64_t fileSize_;
+    // Where the upload started, past the end of a .filepart that was continued.
+    std::uint64_t startOffset_;
+    std::uint64_t readOffset_;
+    std::uint64_t reportedOffset_;
+    std::size_t writesInFlight_;
+    std::size_t readBlockSize_;
+    std::uint64_t readAhead_;
+    std::shared_ptr<SecureShell::PipelinedWriteSource> writeSource_;
+    PendingResult<std::size_t> pendingWrite_;
+    Step step_;
+    PendingResult<SecureShell::FileInformation> pendingStat_;
+    PendingResult<std::weak_ptr<SecureShell::IFileStream>> pendingOpen_;
+    PendingResult<void> pendingCall_;
+    BandwidthLimiter bandwidthLimiter_;
+};
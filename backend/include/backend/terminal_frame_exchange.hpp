@@ -0,0 +1,102 @@
+#pragma once
+
+#include <shared_data/terminal_frame.hpp>
+
+#include <nui/window.hpp>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Moves terminal I/O between the backend and the frontend as binary frames (see SharedData::TerminalStream)
+ * over a custom scheme, instead of base64 encoded json rpc calls per chunk.
+ *
+ * Output is buffered per receiver. When the buffer of a receiver becomes non empty, the receiver is notified once
+ * and the frontend fetches all buffered frames with a single request:
+ *   GET  terminal://app.example/frames/<receiver> takes all pending frames of the receiver.
+ *   POST terminal://app.example/write/<receiver> writes the request body to the receiver.
+ *   POST terminal://app.example/ack/<receiver> acknowledges the decimal amount of output bytes in the body as consumed.
+ */
+class TerminalFrameExchange
+{
+  public:
+    constexpr static std::string_view schemeName = "terminal";
+
+    TerminalFrameExchange() = default;
+    ~TerminalFrameExchange() = default;
+    TerminalFrameExchange(TerminalFrameExchange const&) = delete;
+    TerminalFrameExchange& operator=(TerminalFrameExchange const&) = delete;
+    TerminalFrameExchange(TerminalFrameExchange&&) = delete;
+    TerminalFrameExchange& operator=(TerminalFrameExchange&&) = delete;
+
+    /**
+     * @brief The custom scheme the frontend talks to. Must be passed to the window on construction.
+     */
+    Nui::CustomScheme customScheme();
+
+    /**
+     * @brief The rpc function the frontend registers to learn that frames are available for a receiver.
+     */
+    static std::string framesAvailableFunction(std::string const& receiver);
+
+    /**
+     * @brief Makes a receiver known.
+     *
+     * @param receiver Identifies the terminal, unique across ssh channels and processes.
+     * @param writer Called with data the frontend wrote to the terminal.
+     * @param onFramesAvailable Called when frames become available after all previous frames were taken. Called from
+     * the thread that pushed the frames.
+     * @param onAcknowledge Called with the amount of output bytes the frontend consumed, for flow control.
+     */
+    void open(
+        std::string const& receiver,
+        std::function<void(std::string&&)> writer,
+        std::function<void()> onFramesAvailable,
+        std::function<void(std::size_t)> onAcknowledge = {});
+
+    /**
+     * @brief Buffers output for the receiver. Thread safe.
+     */
+    void push(std::string const& receiver, SharedData::TerminalStream stream, std::string_view data);
+
+    /**
+     * @brief Takes all buffered frames of the receiver.
+     */
+    std::string take(std::string const& receiver);
+
+    /**
+     * @brief Passes data from the frontend to the writer of the receiver.
+     *
+     * @return false if the receiver does not exist or was closed.
+     */
+    bool write(std::string const& receiver, std::string&& data);
+
+    /**
+     * @brief Passes the amount of output bytes the frontend consumed on.
+     *
+     * @return false if the receiver does not exist or was closed.
+     */
+    bool acknowledge(std::string const& receiver, std::size_t bytes);
+
+    /**
+     * @brief Stops writing to the receiver. Frames that were not taken yet can still be taken, the receiver is gone
+     * afterwards.
+     */
+    void close(std::string const& receiver);
+
+  private:
+    struct Receiver
+    {
+        std::string frames{};
+        std::function<void(std::string&&)> writer{};
+        std::function<void()> onFramesAvailable{};
+        std::function<void(std::size_t)> onAcknowledge{};
+        bool closed{false};
+    };
+
+    std::mutex mutex_{};
+    std::unordered_map<std::string, Receiver> receivers_{};
+};
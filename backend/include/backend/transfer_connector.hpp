@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <expected>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Opens the transfer connections of a session in the background, each on a thread of its own. A slow
+ * connection holds up neither the session nor the other connections, and one that fails is left out. Until
+ * connections arrive, and without any, transfers use the main connection.
+ *
+ * Not thread safe, connect is called from one strand. The destructor waits for connections still opening.
+ */
+template <typename ConnectionT>
+class TransferConnector
+{
+  public:
+    using ConnectResult = std::expected<std::unique_ptr<ConnectionT>, std::string>;
+
+    TransferConnector() = default;
+    ~TransferConnector() = default;
+    TransferConnector(TransferConnector const&) = delete;
+    TransferConnector& operator=(TransferConnector const&) = delete;
+    TransferConnector(TransferConnector&&) = default;
+    TransferConnector& operator=(TransferConnector&&) = default;
+
+    /**
+     * @brief Calls connect count times in parallel and returns right away.
+     *
+     * @param onConnected Called on the connecting thread with each connection that opened.
+     * @param onFailed Called on the connecting thread with the error of each connection that did not.
+     */
+    void connect(
+        int count,
+        std::function<ConnectResult()> connect,
+        std::function<void(std::unique_ptr<ConnectionT>)> onConnected,
+        std::function<void(std::string const&)> onFailed)
+    {
+        std::erase_if(connecting_, [](auto const& connecting) {
+            return connecting.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+        });
+
+        for (int i = 0; i < count; ++i)
+        {
+            connecting_.push_back(std::async(std::launch::async, [connect, onConnected, onFailed]() {
+                auto connection = connect();
+                if (connection)
+                    onConnected(std::move(connection).value());
+                else
+                    onFailed(connection.error());
+            }));
+        }
+    }
+
+    /**
+     * @brief The number of connections that are still opening.
+     */
+    std::size_t connecting() const
+    {
+        return static_cast<std::size_t>(
+            std::count_if(connecting_.begin(), connecting_.end(), [](auto const& connecting) {
+                return connecting.wait_for(std::chrono::seconds{0}) != std::future_status::ready;
+            }));
+    }
+
+  private:
+    std::vector<std::future<void>> connecting_{};
+};
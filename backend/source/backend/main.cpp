@@ -148,27 +148,34 @@ namespace
 Main::Main(int const, char const* const* argv)
     : programDir_{std::filesystem::path{argv[0]}.parent_path()}
     , stateHolder_{}
+    , terminalFrames_{}
     , window_{
           Nui::WindowOptions{
               .title = "NuiScp"s,
               .debug = true,
-              .customSchemes = {createFolderMapping(programDir_, "nui")},
+              .customSchemes = {createFolderMapping(programDir_, "nui"), terminalFrames_.customScheme()},
           },
       }
     , hub_{window_}
-    , processes_{window_.getExecutor(), window_, hub_}
+    , processes_{window_.getExecutor(), window_, hub_, terminalFrames_}
     , prompter_{hub_}
-    , sshSessionManager_{std::make_shared<SessionManager>(window_.getExecutor(), stateHolder_, window_, hub_)}
+    , sshSessionManager_{std::make_shared<SessionManager>(
+          window_.getExecutor(),
+          stateHolder_,
+          window_,
+          hub_,
+          terminalFrames_)}
     , shuttingDown_{false}
     , childSignalTimer_{window_.getExecutor()}
 {
     sshSessionManager_->addPasswordProvider(-99, &prompter_);
 
-    stateHolder_.load([](bool success, Persistence::StateHolder& holder) {
+    stateHolder_.load([this](bool success, Persistence::StateHolder& holder) {
         if (!success)
             return;
 
         Log::setLevel(holder.stateCache().logLevel);
+        sshSessionManager_->globalBandwidthLimit(holder.stateCache().globalBandwidthLimit);
     });
 }
 Main::~Main()
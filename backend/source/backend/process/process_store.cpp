@@ -3,7 +3,6 @@
 #include <backend/process/boost_process.hpp>
 #include <csignal>
 #include <nlohmann/json.hpp>
-#include <roar/utility/base64.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <log/log.hpp>
 
@@ -30,11 +29,17 @@ namespace
     };
 }
 
-ProcessStore::ProcessStore(boost::asio::any_io_executor executor, Nui::Window& wnd, Nui::RpcHub& hub)
+ProcessStore::ProcessStore(
+    boost::asio::any_io_executor executor,
+    Nui::Window& wnd,
+    Nui::RpcHub& hub,
+    TerminalFrameExchange& terminalFrames)
     : executor_{std::move(executor)}
     , wnd_{&wnd}
     , hub_{&hub}
+    , terminalFrames_{&terminalFrames}
     , processes_{}
+    , terminalReceivers_{}
     , uuidGenerator_{}
 {}
 ProcessStore::~ProcessStore()
@@ -118,7 +123,9 @@ void ProcessStore::pruneDeadProcesses()
     {
         if (!iter->second->running())
         {
-            iter = processes_.erase(iter);
+            const auto next = std::next(iter);
+            erase(iter);
+            iter = next;
         }
         else
         {
@@ -137,25 +144,59 @@ void ProcessStore::notifyChildExit(Nui::RpcHub& hub, std::string const& id)
     }
 
     process->second->exit();
-    processes_.erase(process);
+    erase(process);
     hub.callRemote("SessionArea::processDied", nlohmann::json{{"id", id}});
 }
 
 void ProcessStore::notifyChildExit(Nui::RpcHub& hub, long long pid)
 {
-    for (auto& [id, process] : processes_)
+    for (auto iter = processes_.begin(); iter != processes_.end(); ++iter)
     {
-        if (process->pid() == pid)
+        if (iter->second->pid() == pid)
         {
-            process->exit();
-            const auto idCopy = id;
-            processes_.erase(id);
+            iter->second->exit();
+            const auto idCopy = iter->first;
+            erase(iter);
             hub.callRemote("SessionArea::processDied", nlohmann::json{{"id", idCopy}, {"pid", pid}});
             return;
         }
     }
 }
 
+void ProcessStore::erase(std::unordered_map<std::string, std::shared_ptr<Process>>::iterator iter)
+{
+    if (auto receiver = terminalReceivers_.find(iter->first); receiver != terminalReceivers_.end())
+    {
+        terminalFrames_->close(receiver->second);
+        terminalReceivers_.erase(receiver);
+    }
+    processes_.erase(iter);
+}
+
+void ProcessStore::write(std::string const& id, std::string const& data)
+{
+    auto process = processes_.find(id);
+    if (process == processes_.end())
+    {
+        Log::error("Cannot write to process '{}', process not found", id);
+        return;
+    }
+
+#ifdef _WIN32
+    using PtyType = ConPTY::PseudoConsole;
+#else
+    using PtyType = PTY::PseudoTerminal;
+#endif
+
+    if (process->second->getState<ProcessInfo>(ProcessAttachedState::ProcessInfo).isPty)
+    {
+        auto& pty = process->second->getState<PtyType>(ProcessAttachedState::PseudoConsole);
+        pty.write(data);
+    }
+    else
+        process->second->write(data + "\r");
+}
+
 void ProcessStore::registerRpc(Nui::Window& wnd, Nui::RpcHub& hub)
 {
     hub.registerFunction(
@@ -173,8 +214,7 @@ void ProcessStore::registerRpc(Nui::Window& wnd, Nui::RpcHub& hub)
                     std::chrono::seconds{parameters.at("defaultExitWaitTimeout").get<int>()};
 
                 const auto isPty = parameters.at("isPty").get<bool>();
-                const auto stdoutReceptacle = parameters.at("stdout").get<std::string>();
-                const auto stderrReceptacle = parameters.at("stderr").get<std::string>();
+                const auto terminalReceiver = parameters.at("terminalReceiver").get<std::string>();
 
                 Environment env;
 
@@ -201,11 +241,20 @@ void ProcessStore::registerRpc(Nui::Window& wnd, Nui::RpcHub& hub)
                     termios = parameters.at("termios").get<Persistence::Termios>();
 
                 env.merge(environment);
-                auto id = std::make_shared<std::string>();
                 const auto processId =
                     emplace(command, arguments, std::move(env), std::move(termios), isPty, defaultExitWaitTimeout);
 
-                *id = processId;
+                terminalReceivers_[processId] = terminalReceiver;
+                terminalFrames_->open(
+                    terminalReceiver,
+                    [this, processId](std::string&& data) {
+                        write(processId, data);
+                    },
+                    [wnd, hub, function = TerminalFrameExchange::framesAvailableFunction(terminalReceiver)]() {
+                        wnd->runInJavascriptThread([hub, function]() {
+                            hub->callRemote(function, nlohmann::json::object());
+                        });
+                    });
 
 #ifdef _WIN32
                 using PtyType = ConPTY::PseudoConsole;
@@ -220,35 +269,23 @@ void ProcessStore::registerRpc(Nui::Window& wnd, Nui::RpcHub& hub)
                     Log::info("Starting PTY reading");
                     auto& pty = processes_[processId]->getState<PtyType>(ProcessAttachedState::PseudoConsole);
                     pty.startReading(
-                        [wnd, hub, stdoutReceptacle, id](std::string_view message) {
-                            wnd->runInJavascriptThread([hub, stdoutReceptacle, id, msg = std::string{message}]() {
-                                hub->callRemote(
-                                    stdoutReceptacle, nlohmann::json{{"id", *id}, {"data", Roar::base64Encode(msg)}});
-                            });
+                        [terminalFrames = terminalFrames_, terminalReceiver](std::string_view message) {
+                            terminalFrames->push(terminalReceiver, SharedData::TerminalStream::Stdout, message);
                         },
-                        [wnd, hub, stderrReceptacle, id](std::string_view message) {
-                            wnd->runInJavascriptThread([hub, stderrReceptacle, id, msg = std::string{message}]() {
-                                hub->callRemote(
-                                    stderrReceptacle, nlohmann::json{{"id", *id}, {"data", Roar::base64Encode(msg)}});
-                            });
+                        [terminalFrames = terminalFrames_, terminalReceiver](std::string_view message) {
+                            terminalFrames->push(terminalReceiver, SharedData::TerminalStream::Stderr, message);
                         });
                 }
                 else
                 {
                     Log::info("Starting non-PTY reading");
                     processes_[processId]->startReading(
-                        [hub, stdoutReceptacle, id, wnd](std::string_view message) {
-                            wnd->runInJavascriptThread([hub, stdoutReceptacle, id, msg = std::string{message}]() {
-                                hub->callRemote(
-                                    stdoutReceptacle, nlohmann::json{{"id", *id}, {"data", Roar::base64Encode(msg)}});
-                            });
+                        [terminalFrames = terminalFrames_, terminalReceiver](std::string_view message) {
+                            terminalFrames->push(terminalReceiver, SharedData::TerminalStream::Stdout, message);
                             return true;
                         },
-                        [hub, stderrReceptacle, id, wnd](std::string_view message) {
-                            wnd->runInJavascriptThread([hub, stderrReceptacle, id, msg = std::string{message}]() {
-                                hub->callRemote(
-                                    stderrReceptacle, nlohmann::json{{"id", *id}, {"data", Roar::base64Encode(msg)}});
-                            });
+                        [terminalFrames = terminalFrames_, terminalReceiver](std::string_view message) {
+                            terminalFrames->push(terminalReceiver, SharedData::TerminalStream::Stderr, message);
                             return true;
                         });
                 }
@@ -276,7 +313,7 @@ void ProcessStore::registerRpc(Nui::Window& wnd, Nui::RpcHub& hub)
                 }
 
                 process->second->exit(0s);
-                processes_.erase(process);
+                erase(process);
                 hub->callRemote(responseId, nlohmann::json{{"success", true}});
             }
             catch (std::exception const& e)
@@ -299,42 +336,7 @@ void ProcessStore::registerRpc(Nui::Window& wnd, Nui::RpcHub& hub)
                 }
 
                 process->second->exit();
-                processes_.erase(process);
-                hub->callRemote(responseId, nlohmann::json{{"success", true}});
-            }
-            catch (std::exception const& e)
-            {
-                hub->callRemote(responseId, nlohmann::json{{"error", e.what()}});
-                return;
-            }
-        });
-
-    hub.registerFunction(
-        "ProcessStore::write",
-        [this, hub = &hub](std::string const& responseId, std::string const& id, std::string const& data) {
-            try
-            {
-                auto process = processes_.find(id);
-                if (process == processes_.end())
-                {
-                    hub->callRemote(responseId, nlohmann::json{{"error", "Process not found"}});
-                    return;
-                }
-
-#ifdef _WIN32
-                using PtyType = ConPTY::PseudoConsole;
-#else
-                using PtyType = PTY::PseudoTerminal;
-#endif
-
-                if (process->second->getState<ProcessInfo>(ProcessAttachedState::ProcessInfo).isPty)
-                {
-                    auto& pty = process->second->getState<PtyType>(ProcessAttachedState::PseudoConsole);
-                    pty.write(Roar::base64Decode(data));
-                }
-                else
-                    process->second->write(Roar::base64Decode(data) + "\r");
-
+                erase(process);
                 hub->callRemote(responseId, nlohmann::json{{"success", true}});
             }
             catch (std::exception const& e)
@@ -1,10 +1,52 @@
 #include <backend/session.hpp>
 
-#include <roar/utility/base64.hpp>
 #include <shared_data/error_or_success.hpp>
+#include <shared_data/processing_metrics.hpp>
+
+#include <boost/asio/detached.hpp>
 
 using namespace std::chrono_literals;
 
+namespace
+{
+    // Output the frontend has not consumed yet, before the channel stops reading and lets the ssh window fill up.
+    constexpr std::size_t terminalReadWindow = 4 * 1024 * 1024;
+
+    std::string terminalReceiver(Ids::ChannelId const& channelId)
+    {
+        return fmt::format("ssh_{}", channelId.value());
+    }
+
+    std::uint64_t toMicroseconds(std::chrono::nanoseconds duration)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+
+    SharedData::DurationHistogram toSharedData(SecureShell::DurationHistogram::Snapshot const& snapshot)
+    {
+        return SharedData::DurationHistogram{
+            .count = snapshot.count,
+            .totalMicroseconds = toMicroseconds(snapshot.total),
+            .maximumMicroseconds = toMicroseconds(snapshot.maximum),
+            .p50Microseconds = static_cast<std::uint64_t>(snapshot.percentile(50).count()),
+            .p99Microseconds = static_cast<std::uint64_t>(snapshot.percentile(99).count()),
+            .buckets = {snapshot.buckets.begin(), snapshot.buckets.end()},
+        };
+    }
+
+    SharedData::StrandMetrics
+    toSharedData(std::string kind, Ids::ChannelId const& channelId, SecureShell::StrandMetrics const& metrics)
+    {
+        return SharedData::StrandMetrics{
+            .kind = std::move(kind),
+            .channelId = channelId.value(),
+            .pendingTasks = metrics.pendingTasks,
+            .tasksRun = metrics.tasksRun,
+            .busyMicroseconds = toMicroseconds(metrics.busy),
+        };
+    }
+}
+
 Session::Session(
     Ids::SessionId id,
     std::unique_ptr<SecureShell::Session> session,
@@ -12,12 +54,22 @@ Session::Session(
     std::shared_ptr<boost::asio::strand<boost::asio::any_io_executor>> strand,
     Nui::Window& wnd,
     Nui::RpcHub& hub,
-    Persistence::SftpOptions const& sftpOptions)
+    TerminalFrameExchange& terminalFrames,
+    Persistence::SftpOptions const& sftpOptions,
+    std::shared_ptr<TokenBucket> globalBandwidth)
     : RpcHelper::StrandRpc{executor, std::move(strand), wnd, hub}
     , id_{std::move(id)}
     , session_{std::move(session)}
-    , operationQueue_{std::make_shared<
-          OperationQueue>(executor_, strand_, wnd, hub, sftpOptions, id_, sftpOptions.concurrency.value_or(1))}
+    , operationQueue_{std::make_shared<OperationQueue>(
+          executor_,
+          strand_,
+          wnd,
+          hub,
+          sftpOptions,
+          id_,
+          std::move(globalBandwidth),
+          sftpOptions.concurrency.value_or(1))}
+    , terminalFrames_{&terminalFrames}
 {}
 
 void Session::start()
@@ -34,16 +86,21 @@ void Session::start()
         }
 
         self->session_->start();
+        self->operationQueue_->onWorkAvailable([weak = self->weak_from_this()]() {
+            if (auto self = weak.lock(); self)
+                self->resetQueueThrottle();
+        });
         self->registerRpcCreateChannel();
         self->registerRpcStartChannelRead();
         self->registerRpcChannelClose();
-        self->registerRpcChannelWrite();
         self->registerRpcChannelPtyResize();
         self->registerRpcSftpListDirectory();
         self->registerRpcSftpCreateDirectory();
         self->registerRpcSftpCreateFile();
         self->registerRpcSftpAddDownloadOperation();
+        self->registerRpcSftpAddUploadOperation();
         self->registerOperationQueuePauseUnpause();
+        self->registerRpcProcessingMetrics();
         self->operationQueue_->registerRpc();
 
         Log::info("Session '{}' connected", self->id_.value());
@@ -53,6 +110,32 @@ void Session::start()
     });
 }
 
+void Session::addTransferSession(std::unique_ptr<SecureShell::Session> transferSession)
+{
+    within_strand_do([self = shared_from_this(), transferSession = std::move(transferSession)]() mutable {
+        transferSession->start();
+        auto* started = transferSession.get();
+        self->transferSessions_.push_back(std::move(transferSession));
+        boost::asio::co_spawn(
+            *self->strand_,
+            [self, started]() -> boost::asio::awaitable<void> {
+                auto sftp = co_await started->asyncCreateSftpSession(boost::asio::use_awaitable);
+                if (!sftp.has_value())
+                {
+                    Log::error("Failed to create sftp session on transfer connection: {}", sftp.error().toString());
+                    co_return;
+                }
+                self->operationQueue_->addTransferSession(std::move(sftp).value());
+            },
+            boost::asio::detached);
+    });
+}
+
+void Session::globalBandwidthChanged()
+{
+    operationQueue_->globalBandwidthChanged();
+}
+
 void Session::stop()
 {
     running_ = false;
@@ -126,6 +209,7 @@ void Session::removeChannel(Ids::ChannelId channelId)
                 locked->close();
 
             self->channels_.erase(iter);
+            self->terminalFrames_->close(terminalReceiver(channelId));
         }
         else
         {
@@ -177,47 +261,54 @@ void Session::registerRpcCreateChannel()
             {
                 Log::info("Creating pty channel for session '{}'", self->id_.value());
 
-                const auto sessionOptions =
-                    parameters["engine"]["sshSessionOptions"].get<Persistence::SshSessionOptions>();
-
-                const auto weakChannel =
-                    self->session_->createPtyChannel({.environment = sessionOptions.environment}).get();
-                if (!weakChannel.has_value())
-                {
-                    Log::error("Failed to create pty channel: {}", weakChannel.error());
-                    return reply({{"error", "Failed to create pty channel"}});
-                }
-
-                const auto channelId = Ids::generateChannelId();
-                self->channels_.emplace(channelId, std::move(weakChannel).value());
-
-                Log::info(
-                    "Created pty channel with id '{}', channel total is now '{}'.",
-                    channelId.value(),
-                    self->channels_.size());
-
-                return reply({{"id", channelId.value()}});
+                auto sessionOptions = parameters["engine"]["sshSessionOptions"].get<Persistence::SshSessionOptions>();
+
+                self->within_strand_spawn(
+                    std::move(reply),
+                    [self, environment = std::move(sessionOptions.environment)](
+                        RpcHelper::RpcOnce& reply) mutable -> boost::asio::awaitable<void> {
+                        auto weakChannel = co_await self->session_->asyncCreatePtyChannel(
+                            {.environment = std::move(environment)}, boost::asio::use_awaitable);
+                        if (!weakChannel.has_value())
+                        {
+                            Log::error("Failed to create pty channel: {}", weakChannel.error());
+                            co_return reply({{"error", "Failed to create pty channel"}});
+                        }
+
+                        const auto channelId = Ids::generateChannelId();
+                        self->channels_.emplace(channelId, std::move(weakChannel).value());
+
+                        Log::info(
+                            "Created pty channel with id '{}', channel total is now '{}'.",
+                            channelId.value(),
+                            self->channels_.size());
+
+                        reply({{"id", channelId.value()}});
+                    });
             }
             else
             {
                 Log::info("Creating sftp channel for session '{}'", self->id_.value());
 
-                const auto weakChannel = self->session_->createSftpSession().get();
-                if (!weakChannel.has_value())
-                {
-                    Log::error("Failed to create sftp channel: {}", weakChannel.error().toString());
-                    return reply({{"error", "Failed to create sftp channel"}});
-                }
-
-                const auto channelId = Ids::generateChannelId();
-                self->sftpChannels_.emplace(channelId, std::move(weakChannel).value());
-
-                Log::info(
-                    "Created sftp channel with id '{}', sftp channel total is now '{}'.",
-                    channelId.value(),
-                    self->sftpChannels_.size());
-
-                return reply({{"id", channelId.value()}});
+                self->within_strand_spawn(
+                    std::move(reply), [self](RpcHelper::RpcOnce& reply) -> boost::asio::awaitable<void> {
+                        auto weakChannel = co_await self->session_->asyncCreateSftpSession(boost::asio::use_awaitable);
+                        if (!weakChannel.has_value())
+                        {
+                            Log::error("Failed to create sftp channel: {}", weakChannel.error().toString());
+                            co_return reply({{"error", "Failed to create sftp channel"}});
+                        }
+
+                        const auto channelId = Ids::generateChannelId();
+                        self->sftpChannels_.emplace(channelId, std::move(weakChannel).value());
+
+                        Log::info(
+                            "Created sftp channel with id '{}', sftp channel total is now '{}'.",
+                            channelId.value(),
+                            self->sftpChannels_.size());
+
+                        reply({{"id", channelId.value()}});
+                    });
             }
         });
 }
@@ -245,40 +336,35 @@ void Session::registerRpcStartChannelRead()
                 return reply({{"error", "Failed to lock channel"}});
             }
 
+            const auto receiver = terminalReceiver(channelId);
+            self->terminalFrames_->open(
+                receiver,
+                [weakChannel = self->channels_[channelId]](std::string&& data) {
+                    if (auto channel = weakChannel.lock(); channel)
+                        channel->write(std::move(data));
+                },
+                [wnd = self->wnd_,
+                 hub = self->hub_,
+                 function = TerminalFrameExchange::framesAvailableFunction(receiver)]() {
+                    wnd->runInJavascriptThread([hub, function]() {
+                        hub->callRemote(function, nlohmann::json::object());
+                    });
+                },
+                [weakChannel = self->channels_[channelId]](std::size_t bytes) {
+                    if (auto channel = weakChannel.lock(); channel)
+                        channel->acknowledge(bytes);
+                });
+
             // Do not use this in these functions, because they are called from a different thread,
             // unless within_strand_do is used!
             locked->startReading(
                 // Stdout
-                [sessionId = self->id_,
-                 channelId,
-                 stdOut =
-                     RpcHelper::RpcInCorrectThread{
-                         *self->wnd_,
-                         *self->hub_,
-                         fmt::format("sshTerminalStdout_{}", channelId.value()),
-                     }](std::string const& msg) {
-                    stdOut(
-                        nlohmann::json{
-                            {"sessionId", sessionId.value()},
-                            {"channelId", channelId.value()},
-                            {"data", Roar::base64Encode(msg)},
-                        });
+                [terminalFrames = self->terminalFrames_, receiver](std::string const& data) {
+                    terminalFrames->push(receiver, SharedData::TerminalStream::Stdout, data);
                 },
                 // Stderr
-                [sessionId = self->id_,
-                 channelId,
-                 stdErr =
-                     RpcHelper::RpcInCorrectThread{
-                         *self->wnd_,
-                         *self->hub_,
-                         fmt::format("sshTerminalStderr_{}", channelId.value()),
-                     }](std::string const& data) {
-                    stdErr(
-                        nlohmann::json{
-                            {"sessionId", sessionId.value()},
-                            {"channelId", channelId.value()},
-                            {"data", Roar::base64Encode(data)},
-                        });
+                [terminalFrames = self->terminalFrames_, receiver](std::string const& data) {
+                    terminalFrames->push(receiver, SharedData::TerminalStream::Stderr, data);
                 },
                 // On channel exit:
                 [removeChannel =
@@ -296,7 +382,8 @@ void Session::registerRpcStartChannelRead()
                     Log::info("Channel for session '{}' lost with id: {}", sessionId.value(), channelId.value());
                     removeChannel();
                     onExit({{"sessionId", sessionId.value()}, {"channelId", channelId.value()}});
-                });
+                },
+                SecureShell::ChannelReadOptions{.window = terminalReadWindow});
 
             return reply({{"success", true}});
         });
@@ -315,25 +402,6 @@ void Session::registerRpcChannelClose()
         });
 }
 
-void Session::registerRpcChannelWrite()
-{
-    on(fmt::format("Session::{}::Channel::write", id_.value()))
-        .perform([weak = weak_from_this()](
-                     RpcHelper::RpcOnce&& reply, std::string const& channelIdString, std::string&& data) {
-            auto self = weak.lock();
-            if (!self)
-                return reply({{"error", "Session no longer exists"}});
-
-            self->withChannelDo(
-                Ids::makeChannelId(channelIdString),
-                [data = std::move(data)](RpcHelper::RpcOnce&& reply, auto&& channel) {
-                    channel->write(Roar::base64Decode(data));
-                    reply({{"success", true}});
-                },
-                std::move(reply));
-        });
-}
-
 void Session::registerRpcChannelPtyResize()
 {
     on(fmt::format("Session::{}::Channel::ptyResize", id_.value()))
@@ -364,17 +432,21 @@ void Session::registerRpcSftpListDirectory()
 
             self->withSftpChannelDo(
                 Ids::makeChannelId(channelIdString),
-                [path](RpcHelper::RpcOnce&& reply, auto&& channel) {
-                    auto fut = channel->listDirectory(path);
-                    if (fut.wait_for(futureTimeout) != std::future_status::ready)
-                        return reply({{"error", "Failed to list directory: timeout"}});
+                [weak = self->weak_from_this(), path](RpcHelper::RpcOnce&& reply, auto&& channel) {
+                    auto self = weak.lock();
+                    if (!self)
+                        return reply({{"error", "Session no longer exists"}});
 
-                    const auto result = fut.get();
-                    if (!result.has_value())
-                        return reply({{"error", result.error().message}});
+                    self->within_strand_spawn(
+                        std::move(reply),
+                        [path, channel](RpcHelper::RpcOnce& reply) -> boost::asio::awaitable<void> {
+                            const auto result = co_await channel->asyncListDirectory(path, boost::asio::use_awaitable);
+                            if (!result.has_value())
+                                co_return reply({{"error", result.error().message}});
 
-                    Log::info("Listed directory '{}', got {} entries", path, result->size());
-                    reply({{"entries", *result}});
+                            Log::info("Listed directory '{}', got {} entries", path, result->size());
+                            reply({{"entries", *result}});
+                        });
                 },
                 std::move(reply));
         });
@@ -391,17 +463,22 @@ void Session::registerRpcSftpCreateDirectory()
 
             self->withSftpChannelDo(
                 Ids::makeChannelId(channelIdString),
-                [path](RpcHelper::RpcOnce&& reply, auto&& channel) {
-                    auto fut = channel->createDirectory(path);
-                    if (fut.wait_for(futureTimeout) != std::future_status::ready)
-                        return reply({{"error", "Failed to create directory: timeout"}});
+                [weak = self->weak_from_this(), path](RpcHelper::RpcOnce&& reply, auto&& channel) {
+                    auto self = weak.lock();
+                    if (!self)
+                        return reply({{"error", "Session no longer exists"}});
 
-                    const auto result = fut.get();
-                    if (!result.has_value())
-                        return reply({{"error", result.error().message}});
+                    self->within_strand_spawn(
+                        std::move(reply),
+                        [path, channel](RpcHelper::RpcOnce& reply) -> boost::asio::awaitable<void> {
+                            const auto result = co_await channel->asyncCreateDirectory(
+                                path, std::filesystem::perms::owner_all, boost::asio::use_awaitable);
+                            if (!result.has_value())
+                                co_return reply({{"error", result.error().message}});
 
-                    Log::info("Created directory '{}'", path);
-                    reply({{"success", true}});
+                            Log::info("Created directory '{}'", path);
+                            reply({{"success", true}});
+                        });
                 },
                 std::move(reply));
         });
@@ -418,17 +495,24 @@ void Session::registerRpcSftpCreateFile()
 
             self->withSftpChannelDo(
                 Ids::makeChannelId(channelIdString),
-                [path](RpcHelper::RpcOnce&& reply, auto&& channel) {
-                    auto fut = channel->createFile(path);
-                    if (fut.wait_for(futureTimeout) != std::future_status::ready)
-                        return reply({{"error", "Failed to create file: timeout"}});
-
-                    const auto result = fut.get();
-                    if (!result.has_value())
-                        return reply({{"error", result.error().message}});
+                [weak = self->weak_from_this(), path](RpcHelper::RpcOnce&& reply, auto&& channel) {
+                    auto self = weak.lock();
+                    if (!self)
+                        return reply({{"error", "Session no longer exists"}});
 
-                    Log::info("Created file '{}'", path);
-                    reply({{"success", true}});
+                    self->within_strand_spawn(
+                        std::move(reply),
+                        [path, channel](RpcHelper::RpcOnce& reply) -> boost::asio::awaitable<void> {
+                            const auto result = co_await channel->asyncCreateFile(
+                                path,
+                                std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+                                boost::asio::use_awaitable);
+                            if (!result.has_value())
+                                co_return reply({{"error", result.error().message}});
+
+                            Log::info("Created file '{}'", path);
+                            reply({{"success", true}});
+                        });
                 },
                 std::move(reply));
         });
@@ -442,7 +526,60 @@ void Session::registerRpcSftpAddDownloadOperation()
                      std::string const& channelIdString,
                      std::string const& newOperationIdString,
                      std::string const& remotePath,
-                     std::string const& localPath) {
+                     std::string const& localPath,
+                     SharedData::TransferFilterOptions filter) {
+            auto self = weak.lock();
+            if (!self)
+                return reply({{"error", "Session no longer exists"}});
+
+            self->withSftpChannelDo(
+                Ids::makeChannelId(channelIdString),
+                [weak = self->weak_from_this(), newOperationIdString, localPath, remotePath, filter](
+                    RpcHelper::RpcOnce&& reply, auto&& channel) {
+                    auto self = weak.lock();
+                    if (!self)
+                        return reply({{"error", "Session no longer exists"}});
+
+                    self->within_strand_spawn(
+                        std::move(reply),
+                        [self, channel, newOperationIdString, localPath, remotePath, filter](
+                            RpcHelper::RpcOnce& reply) -> boost::asio::awaitable<void> {
+                            const auto result = co_await self->operationQueue_->addDownloadOperation(
+                                *channel, Ids::makeOperationId(newOperationIdString), localPath, remotePath, filter);
+
+                            if (!result.has_value())
+                            {
+                                Log::error(
+                                    "Failed to add download operation for file '{}' to '{}': {}",
+                                    remotePath,
+                                    localPath,
+                                    result.error().toString());
+                                co_return reply({{"error", result.error().toString()}});
+                            }
+
+                            Log::info(
+                                "Added download operation with id '{}' for file '{}' to '{}'",
+                                newOperationIdString,
+                                remotePath,
+                                localPath);
+
+                            self->resetQueueThrottle();
+                            reply({{"success", true}});
+                        });
+                },
+                std::move(reply));
+        });
+}
+
+void Session::registerRpcSftpAddUploadOperation()
+{
+    on(fmt::format("Session::{}::sftp::addUpload", id_.value()))
+        .perform([weak = weak_from_this()](
+                     RpcHelper::RpcOnce&& reply,
+                     std::string const& channelIdString,
+                     std::string const& newOperationIdString,
+                     std::string const& localPath,
+                     std::string const& remotePath) {
             auto self = weak.lock();
             if (!self)
                 return reply({{"error", "Session no longer exists"}});
@@ -455,27 +592,32 @@ void Session::registerRpcSftpAddDownloadOperation()
                     if (!self)
                         return reply({{"error", "Session no longer exists"}});
 
-                    const auto result = self->operationQueue_->addDownloadOperation(
-                        *channel, Ids::makeOperationId(newOperationIdString), localPath, remotePath);
-
-                    if (!result.has_value())
-                    {
-                        Log::error(
-                            "Failed to add download operation for file '{}' to '{}': {}",
-                            remotePath,
-                            localPath,
-                            result.error().toString());
-                        return reply({{"error", result.error().toString()}});
-                    }
-
-                    Log::info(
-                        "Added download operation with id '{}' for file '{}' to '{}'",
-                        newOperationIdString,
-                        remotePath,
-                        localPath);
-
-                    self->resetQueueThrottle();
-                    reply({{"success", true}});
+                    self->within_strand_spawn(
+                        std::move(reply),
+                        [self, channel, newOperationIdString, localPath, remotePath](
+                            RpcHelper::RpcOnce& reply) -> boost::asio::awaitable<void> {
+                            const auto result = co_await self->operationQueue_->addUploadOperation(
+                                *channel, Ids::makeOperationId(newOperationIdString), localPath, remotePath);
+
+                            if (!result.has_value())
+                            {
+                                Log::error(
+                                    "Failed to add upload operation for file '{}' to '{}': {}",
+                                    localPath,
+                                    remotePath,
+                                    result.error().toString());
+                                co_return reply({{"error", result.error().toString()}});
+                            }
+
+                            Log::info(
+                                "Added upload operation with id '{}' for file '{}' to '{}'",
+                                newOperationIdString,
+                                localPath,
+                                remotePath);
+
+                            self->resetQueueThrottle();
+                            reply({{"success", true}});
+                        });
                 },
                 std::move(reply));
         });
@@ -502,4 +644,46 @@ void Session::registerOperationQueuePauseUnpause()
             self->resetQueueThrottle();
             return reply(SharedData::success());
         });
+}
+
+void Session::registerRpcProcessingMetrics()
+{
+    on(fmt::format("Session::{}::processingMetrics", id_.value()))
+        .perform([weak = weak_from_this()](RpcHelper::RpcOnce&& reply) {
+            auto self = weak.lock();
+            if (!self)
+                return reply(SharedData::error("Session no longer exists"));
+
+            const auto metrics = self->session_->processingMetrics();
+            SharedData::ProcessingMetrics result{
+                .enqueueLatency = toSharedData(metrics.enqueueLatency),
+                .taskDuration = toSharedData(metrics.taskDuration),
+                .cycleDuration = toSharedData(metrics.cycleDuration),
+                .queueDepth = {metrics.queueDepth.begin(), metrics.queueDepth.end()},
+                .peakQueueDepth = metrics.peakQueueDepth,
+                .permanentTasks = {},
+                .strands = {},
+            };
+            for (auto const& permanentTask : metrics.permanentTasks)
+            {
+                result.permanentTasks.push_back(SharedData::PermanentTaskMetrics{
+                    .id = permanentTask.id,
+                    .calls = permanentTask.calls,
+                    .busyMicroseconds = toMicroseconds(permanentTask.busy),
+                    .longestMicroseconds = toMicroseconds(permanentTask.longest),
+                });
+            }
+            for (auto const& [channelId, weakChannel] : self->channels_)
+            {
+                if (auto channel = weakChannel.lock(); channel && channel->strand())
+                    result.strands.push_back(toSharedData("channel", channelId, channel->strand()->metrics()));
+            }
+            for (auto const& [channelId, weakChannel] : self->sftpChannels_)
+            {
+                if (auto channel = weakChannel.lock(); channel && channel->strand())
+                    result.strands.push_back(toSharedData("sftp", channelId, channel->strand()->metrics()));
+            }
+
+            return reply(SharedData::ErrorOrSuccess<SharedData::ProcessingMetrics>{std::move(result)});
+        });
 }
\ No newline at end of file
@@ -66,13 +66,24 @@ int askPassDefault(char const* prompt, char* buf, std::size_t length, int, int,
     return -1;
 }
 
+namespace
+{
+    int askPassDeclined(char const*, char*, std::size_t, int, int, void*)
+    {
+        return -1;
+    }
+}
+
 SessionManager::SessionManager(
     boost::asio::any_io_executor executor,
     Persistence::StateHolder& stateHolder,
     Nui::Window& wnd,
-    Nui::RpcHub& hub)
+    Nui::RpcHub& hub,
+    TerminalFrameExchange& terminalFrames)
     : RpcHelper::StrandRpc{executor, wnd, hub}
     , stateHolder_{&stateHolder}
+    , terminalFrames_{&terminalFrames}
+    , processingPool_{std::make_shared<SecureShell::ProcessingThreadPool>()}
 {}
 
 void SessionManager::addPasswordProvider(int priority, PasswordProvider* provider)
@@ -82,6 +93,17 @@ void SessionManager::addPasswordProvider(int priority, PasswordProvider* provide
     });
 }
 
+void SessionManager::globalBandwidthLimit(std::uint64_t bytesPerSecond)
+{
+    within_strand_do([this, bytesPerSecond]() {
+        globalBandwidth_->rate(bytesPerSecond);
+        Log::info("Global bandwidth limit: {} bytes/s.", bytesPerSecond);
+
+        for (auto const& [_, session] : sessions_)
+            session->globalBandwidthChanged();
+    });
+}
+
 void SessionManager::addSession(
     Persistence::SshTerminalEngine const& engine,
     std::function<void(std::optional<Ids::SessionId> const&)> onComplete)
@@ -89,11 +111,18 @@ void SessionManager::addSession(
     within_strand_do([this, engine, onComplete = std::move(onComplete)]() {
         std::pair<SessionManager*, std::string> askPassUserDataKeyPhrase{this, "Key phrase"};
         std::pair<SessionManager*, std::string> askPassUserDataPassword{this, "Password"};
-        auto maybeSshSession =
-            makeSession(engine, askPassDefault, &askPassUserDataKeyPhrase, &askPassUserDataPassword, &pwCache_);
+        auto maybeSshSession = makeSession(
+            engine,
+            askPassDefault,
+            &askPassUserDataKeyPhrase,
+            &askPassUserDataPassword,
+            &pwCache_,
+            processingPool_);
 
         if (maybeSshSession)
         {
+            const auto sftpOptions = engine.sshSessionOptions->sftpOptions.value();
+
             const auto sessionId = Ids::SessionId{Ids::generateId()};
             const auto session = std::make_shared<Session>(
                 sessionId,
@@ -102,7 +131,9 @@ void SessionManager::addSession(
                 strand_,
                 *wnd_,
                 *hub_,
-                engine.sshSessionOptions->sftpOptions.value());
+                *terminalFrames_,
+                sftpOptions,
+                globalBandwidth_);
             const auto emplaced = sessions_.emplace(sessionId, session);
             if (!emplaced.second)
             {
@@ -113,6 +144,7 @@ void SessionManager::addSession(
             Log::info("Created session with id '{}', total is now '{}'.", sessionId.value(), sessions_.size());
             session->start();
             onComplete(sessionId);
+            connectTransferSessions(engine, session);
         }
         else
         {
@@ -122,6 +154,32 @@ void SessionManager::addSession(
     });
 }
 
+void SessionManager::connectTransferSessions(
+    Persistence::SshTerminalEngine const& engine,
+    std::shared_ptr<Session> const& session)
+{
+    // Assumed in strand
+
+    const auto count = engine.sshSessionOptions->sftpOptions->transferConnections.value_or(0);
+    if (count <= 0)
+        return;
+
+    // Each connection authenticates with its own copy of the cache, the password entered for the main connection is
+    // in there now. Nothing is asked for off the strand, a connection that would need to ask is left out.
+    transferConnector_.connect(
+        count,
+        [engine, pwCache = pwCache_, pool = processingPool_]() mutable {
+            return makeSession(engine, askPassDeclined, nullptr, nullptr, &pwCache, pool);
+        },
+        [weak = std::weak_ptr<Session>{session}](std::unique_ptr<SecureShell::Session> transferSession) {
+            if (auto session = weak.lock(); session)
+                session->addTransferSession(std::move(transferSession));
+        },
+        [](std::string const& error) {
+            Log::error("Failed to open transfer connection, transfers use the main connection instead: {}", error);
+        });
+}
+
 void SessionManager::removeSession(Ids::SessionId sessionId)
 {
     within_strand_do([this, sessionId]() {
@@ -141,6 +199,7 @@ void SessionManager::registerRpc()
 {
     registerRpcSessionConnect();
     registerRpcSessionDisconnect();
+    registerRpcSetGlobalBandwidthLimit();
 }
 
 void SessionManager::registerRpcSessionConnect()
@@ -186,4 +245,27 @@ void SessionManager::registerRpcSessionDisconnect()
             return reply({{"error", e.what()}});
         }
     });
-}
\ No newline at end of file
+}
+
+void SessionManager::registerRpcSetGlobalBandwidthLimit()
+{
+    on("SessionManager::setGlobalBandwidthLimit")
+        .perform([this](RpcHelper::RpcOnce&& reply, nlohmann::json const& parameters) {
+            if (!RpcHelper::ParameterVerifyView{reply, "SessionManager::setGlobalBandwidthLimit", parameters}
+                     .hasValueDeep("bytesPerSecond"))
+            {
+                return;
+            }
+
+            try
+            {
+                globalBandwidthLimit(parameters["bytesPerSecond"].get<std::uint64_t>());
+                return reply({{"success", true}});
+            }
+            catch (std::exception const& e)
+            {
+                Log::error("Error setting the global bandwidth limit: {}", e.what());
+                return reply({{"error", e.what()}});
+            }
+        });
+}
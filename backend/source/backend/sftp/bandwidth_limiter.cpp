@@ -0,0 +1,114 @@
+#include <backend/sftp/bandwidth_limiter.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+TokenBucket::TokenBucket(std::uint64_t bytesPerSecond, Clock::duration burst)
+    : rate_{bytesPerSecond}
+    , burst_{burst}
+    , tokens_{0.0}
+    , lastRefill_{Clock::now()}
+{
+    tokens_ = capacity();
+}
+
+std::uint64_t TokenBucket::rate() const
+{
+    std::scoped_lock lock{mutex_};
+    return rate_;
+}
+
+void TokenBucket::rate(std::uint64_t bytesPerSecond)
+{
+    std::scoped_lock lock{mutex_};
+    refill(Clock::now());
+    rate_ = bytesPerSecond;
+    // Debt made at the old rate is forgiven, it would be waited out at the new one.
+    tokens_ = std::clamp(tokens_, 0.0, capacity());
+}
+
+double TokenBucket::capacity() const
+{
+    return std::max(static_cast<double>(rate_) * std::chrono::duration<double>(burst_).count(), 1.0);
+}
+
+void TokenBucket::refill(Clock::time_point now)
+{
+    if (now > lastRefill_)
+    {
+        tokens_ = std::min(
+            tokens_ + static_cast<double>(rate_) * std::chrono::duration<double>(now - lastRefill_).count(),
+            capacity());
+        lastRefill_ = now;
+    }
+}
+
+std::uint64_t TokenBucket::allowance(Clock::time_point now)
+{
+    std::scoped_lock lock{mutex_};
+    if (rate_ == 0)
+        return std::numeric_limits<std::uint64_t>::max();
+    refill(now);
+    return tokens_ >= 1.0 ? static_cast<std::uint64_t>(tokens_) : 0;
+}
+
+void TokenBucket::consume(std::uint64_t bytes, Clock::time_point now)
+{
+    std::scoped_lock lock{mutex_};
+    if (rate_ == 0)
+        return;
+    refill(now);
+    tokens_ -= static_cast<double>(bytes);
+}
+
+TokenBucket::Clock::duration TokenBucket::delay(Clock::time_point now)
+{
+    std::scoped_lock lock{mutex_};
+    if (rate_ == 0)
+        return Clock::duration::zero();
+    refill(now);
+    if (tokens_ >= 1.0)
+        return Clock::duration::zero();
+    return std::chrono::ceil<Clock::duration>(
+        std::chrono::duration<double>{(1.0 - tokens_) / static_cast<double>(rate_)});
+}
+
+BandwidthLimiter::BandwidthLimiter(std::vector<std::shared_ptr<TokenBucket>> buckets)
+    : buckets_{std::move(buckets)}
+{
+    std::erase(buckets_, nullptr);
+}
+
+std::uint64_t BandwidthLimiter::allowance() const
+{
+    auto allowance = std::numeric_limits<std::uint64_t>::max();
+    for (auto const& bucket : buckets_)
+        allowance = std::min(allowance, bucket->allowance());
+    return allowance;
+}
+
+void BandwidthLimiter::consume(std::uint64_t bytes) const
+{
+    for (auto const& bucket : buckets_)
+        bucket->consume(bytes);
+}
+
+TokenBucket::Clock::duration BandwidthLimiter::delay() const
+{
+    auto delay = TokenBucket::Clock::duration::zero();
+    for (auto const& bucket : buckets_)
+        delay = std::max(delay, bucket->delay());
+    return delay;
+}
+
+std::uint64_t BandwidthLimiter::rate() const
+{
+    std::uint64_t rate = 0;
+    for (auto const& bucket : buckets_)
+    {
+        if (const auto bucketRate = bucket->rate(); bucketRate != 0)
+            rate = rate == 0 ? bucketRate : std::min(rate, bucketRate);
+    }
+    return rate;
+}
@@ -1,32 +1,62 @@
 #include <backend/sftp/bulk_download_operation.hpp>
 #include <ssh/sftp_session.hpp>
 #include <log/log.hpp>
+#include <utility/shell_quote.hpp>
 
-BulkDownloadOperation::BulkDownloadOperation(SecureShell::SftpSession& sftp, BulkDownloadOperationOptions options)
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+
+namespace
+{
+    // Printed by the remote command before the archive, followed by the compression.
+    constexpr std::string_view archiveMarker{"nui-scp-tar "};
+    // Output allowed before the marker, like greetings of shell startup files.
+    constexpr std::size_t maxArchiveLead{64 * 1024};
+    // Printed on stderr after tar, followed by its exit status. The pipe into gzip would lose the status otherwise.
+    constexpr std::string_view archiveStatusMarker{"nui-scp-tar-status "};
+
+    // Lets the sftp session complete into a PendingResult, which wakes the operation up.
+    template <typename T>
+    std::function<void(std::expected<T, SecureShell::SftpError>&&)>
+    expectInto(PendingResult<T>& pending, std::function<void()> const& wakeup)
+    {
+        return [onComplete = pending.expect(wakeup)](std::expected<T, SecureShell::SftpError>&& result) {
+            onComplete(nullptr, std::move(result));
+        };
+    }
+}
+
+BulkDownloadOperation::BulkDownloadOperation(SecureShell::ISftpSession& sftp, BulkDownloadOperationOptions options)
     : Operation{}
     , sftp_{&sftp}
     , options_{std::move(options)}
-    , currentDownload_{nullptr}
-    , entries_{}
-    , totalBytes_{0}
+    , downloads_{}
+    , concurrency_{std::max(options_.concurrency, std::size_t{1})}
+    , scan_{
+          options_.scanResult ? options_.scanResult
+                              : std::make_shared<ScanResult const>(ScanResult{.state = ScanResult::State::Complete})}
     , currentIndex_{0}
     , currentBytes_{0}
     , futureTimeout_{options_.individualOptions.futureTimeout}
 {}
 
-BulkDownloadOperation::~BulkDownloadOperation() = default;
+BulkDownloadOperation::~BulkDownloadOperation()
+{
+    closeArchiveChannel();
+}
 
 std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> BulkDownloadOperation::work()
 {
-    if (options_.asArchive)
+    if (options_.asArchive && !archiveFallback_)
         return workAsArchive();
     else
         return workNormal();
 }
 
-std::filesystem::path BulkDownloadOperation::fullLocalPath(SharedData::DirectoryEntry const& entry) const
+std::filesystem::path BulkDownloadOperation::fullLocalPath(SharedData::DirectoryEntryStore::Index index) const
 {
-    return (options_.localPath / SharedData::fullPathRelative(entries_, entry)).lexically_normal();
+    return (options_.localPath / scan_->entries.relativePath(index)).lexically_normal();
 }
 
 std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> BulkDownloadOperation::workNormal()
@@ -37,14 +67,13 @@ std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> B
     {
         case (NotStarted):
         {
-            if (entries_.empty())
+            if (scan_->entries.empty())
             {
                 Log::info("BulkDownloadOperation: No entries to download.");
                 enterState(Completed);
                 return WorkStatus::Complete;
             }
-            auto const& entry = entries_[0];
-            if (entry.isDirectory())
+            if (scan_->entries.isDirectory(0))
             {
                 // Base directory of the download, everything after this will be relative to this:
                 const auto path = options_.localPath;
@@ -61,14 +90,15 @@ std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> B
             }
             else
             {
-                Log::error("BulkDownloadOperation: First entry is not a directory: {}.", entry.path.string());
+                Log::error(
+                    "BulkDownloadOperation: First entry is not a directory: {}.", scan_->entries.fullPath(0).string());
                 return enterErrorState<BulkDownloadOperation::WorkStatus>(
                     Error{.type = ErrorType::ImplementationError, .extraInfo = "First entry must be a directory."});
             }
             currentIndex_ = 1;
             enterState(Running);
             options_.overallProgressCallback(
-                options_.localPath, currentIndex_, entries_.size() - 1, 0, 0, 0, totalBytes_);
+                options_.localPath, currentIndex_, scan_->entries.size() - 1, 0, 0, 0, scan_->totalBytes);
             return WorkStatus::MoreWork;
         }
         case (Preparing):
@@ -77,13 +107,14 @@ std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> B
             [[fallthrough]];
         case (Running):
         {
-            if (currentIndex_ == entries_.size())
+            if (scan_->state == ScanResult::State::Aborted)
             {
-                Log::info("BulkDownloadOperation: Bulk download completed.");
-                enterState(Completed);
-                return WorkStatus::Complete;
+                Log::error("BulkDownloadOperation: The scan of the directory did not complete.");
+                return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
+                    .type = ErrorType::ScanIncomplete,
+                    .extraInfo = fmt::format("Scanning {}", options_.remotePath.generic_string())});
             }
-            if (currentIndex_ > entries_.size())
+            if (currentIndex_ > scan_->entries.size())
             {
                 Log::error("BulkDownloadOperation: Current index out of range.");
                 return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
@@ -91,106 +122,43 @@ std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> B
                     .extraInfo = "Bulk download index is beyond the item count, which should never occur."});
             }
 
-            auto const& entry = entries_[currentIndex_];
-            if (entry.isDirectory())
+            const auto previousIndex = currentIndex_;
+            while (downloads_.size() < concurrency_ && currentIndex_ < scan_->entries.size())
             {
-                // Create directory:
-                const auto path = fullLocalPath(entry);
-                std::error_code ec;
-                std::filesystem::create_directories(path, ec);
-                if (ec)
-                {
-                    Log::error(
-                        "BulkDownloadOperation: Failed to create local directory: {}: {}", path.string(), ec.message());
-                    return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
-                        .type = ErrorType::CannotCreateDirectory,
-                        .extraInfo = fmt::format("Creating local directory: {}: {}", path.string(), ec.message())});
-                }
-                ++currentIndex_;
-                options_.overallProgressCallback(
-                    path, currentIndex_, entries_.size() - 1, 0, 0, currentBytes_, totalBytes_);
+                auto result = startNextEntry();
+                if (!result)
+                    return enterErrorState<BulkDownloadOperation::WorkStatus>(result.error());
             }
-            else if (entry.isRegularFile())
+            bool progressed = currentIndex_ != previousIndex;
+
+            for (auto iter = downloads_.begin(); iter != downloads_.end();)
             {
-                if (!currentDownload_)
-                {
-                    const auto remoteFullPath = SharedData::fullPath(entries_, entry);
-
-                    auto fut = sftp_->openFile(
-                        remoteFullPath, SecureShell::SftpSession::OpenType::Read, std::filesystem::perms::unknown);
-
-                    if (fut.wait_for(futureTimeout_) != std::future_status::ready)
-                    {
-                        Log::error("BulkDownloadOperation: Failed to open remote sftp file: timeout.");
-                        return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
-                            .type = ErrorType::FutureTimeout,
-                            .extraInfo = fmt::format("Timeout opening remote file: {}", entry.path.string())});
-                    }
-
-                    const auto openResult = fut.get();
-                    if (!openResult.has_value())
-                    {
-                        Log::error(
-                            "BulkDownloadOperation: Failed to open remote sftp file: {}.", openResult.error().message);
-                        return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
-                            .type = ErrorType::SftpError,
-                            .sftpError = openResult.error(),
-                            .extraInfo = fmt::format("Opening remote file: {}", entry.path.string())});
-                    }
-
-                    auto downloadOptions = options_.individualOptions;
-                    downloadOptions.remotePath = remoteFullPath;
-                    downloadOptions.localPath = fullLocalPath(entry);
-
-                    downloadOptions.progressCallback =
-                        [this, operationId = this->id(), remoteFullPath](auto min, auto max, auto current) {
-                            // Update current bytes
-                            currentBytes_ += (current - min);
-
-                            // Call overall progress callback
-                            options_.overallProgressCallback(
-                                remoteFullPath,
-                                currentIndex_,
-                                entries_.size() - 1,
-                                current,
-                                max,
-                                currentBytes_,
-                                totalBytes_);
-                        };
-
-                    currentDownload_ =
-                        std::make_unique<DownloadOperation>(std::move(openResult).value(), downloadOptions);
-                }
-                else
+                auto result = workFile(*iter);
+                if (!result)
+                    return std::unexpected(result.error());
+
+                if (result.value() == WorkStatus::Complete)
                 {
-                    return workCurrentFile();
+                    iter = downloads_.erase(iter);
+                    progressed = true;
+                    continue;
                 }
+                if (result.value() == WorkStatus::MoreWork)
+                    progressed = true;
+                ++iter;
             }
-            else if (entry.isSymlink())
-            {
-                // TODO: handle symlink
-                Log::warn(
-                    "BulkDownloadOperation: Symlinks are not yet supported for entry: {}.",
-                    fullLocalPath(entry).string());
-
-                // Under linux:
-                // - symlinks that are within the downloaded structure shall be downloaded
-                //   as symlinks.
-                // - symlinks that are outside the downloaded structure shall be downloaded
-                //   as regular files? or not? or also as symlinks? => probably also as links
-                // Under windows we should ask the user earlier how they want to proceed with them (copies? ignore?
-                // windows links - yuck?).
-
-                ++currentIndex_;
-            }
-            else
+
+            if (downloads_.empty() && currentIndex_ == scan_->entries.size())
             {
-                Log::warn(
-                    "BulkDownloadOperation: Skipping unsupported file type for entry: {}.",
-                    fullLocalPath(entry).string());
-                ++currentIndex_;
+                // Caught up with the scan, which is worked along with this and adds the next listing later:
+                if (scan_->state == ScanResult::State::Scanning)
+                    return WorkStatus::Waiting;
+
+                Log::info("BulkDownloadOperation: Bulk download completed.");
+                enterState(Completed);
+                return WorkStatus::Complete;
             }
-            return WorkStatus::MoreWork;
+            return progressed ? WorkStatus::MoreWork : WorkStatus::Waiting;
         }
         case (Finalizing):
         {
@@ -217,46 +185,439 @@ std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> B
     }
 }
 
-std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> BulkDownloadOperation::workCurrentFile()
+SecureShell::ISftpSession& BulkDownloadOperation::nextFileSession()
+{
+    std::erase_if(options_.fileSessions, [](auto const& sftp) {
+        return sftp.expired();
+    });
+
+    nextSession_ = (nextSession_ + 1) % (options_.fileSessions.size() + 1);
+    if (nextSession_ == 0)
+        return *sftp_;
+    // It may have closed since it was checked above.
+    if (auto session = options_.fileSessions[nextSession_ - 1].lock(); session)
+        return *session;
+    return *sftp_;
+}
+
+std::expected<void, BulkDownloadOperation::Error> BulkDownloadOperation::startNextEntry()
+{
+    const auto index = currentIndex_++;
+
+    if (scan_->entries.isDirectory(index))
+    {
+        const auto path = fullLocalPath(index);
+        std::error_code ec;
+        std::filesystem::create_directories(path, ec);
+        if (ec)
+        {
+            Log::error("BulkDownloadOperation: Failed to create local directory: {}: {}", path.string(), ec.message());
+            return std::unexpected(Error{
+                .type = ErrorType::CannotCreateDirectory,
+                .extraInfo = fmt::format("Creating local directory: {}: {}", path.string(), ec.message())});
+        }
+        options_.overallProgressCallback(
+            path, currentIndex_, scan_->entries.size() - 1, 0, 0, currentBytes_, scan_->totalBytes);
+    }
+    else if (scan_->entries.isRegularFile(index))
+    {
+        auto& file = downloads_.emplace_back(FileDownload{.index = index});
+        nextFileSession().openFile(
+            scan_->entries.fullPath(index),
+            SecureShell::ISftpSession::OpenType::Read,
+            std::filesystem::perms::unknown,
+            expectInto(file.pendingOpen, wakeup_));
+    }
+    else if (scan_->entries.isSymlink(index))
+    {
+        // TODO: handle symlink
+        Log::warn(
+            "BulkDownloadOperation: Symlinks are not yet supported for entry: {}.", fullLocalPath(index).string());
+
+        // Under linux:
+        // - symlinks that are within the downloaded structure shall be downloaded
+        //   as symlinks.
+        // - symlinks that are outside the downloaded structure shall be downloaded
+        //   as regular files? or not? or also as symlinks? => probably also as links
+        // Under windows we should ask the user earlier how they want to proceed with them (copies? ignore?
+        // windows links - yuck?).
+    }
+    else
+    {
+        Log::warn(
+            "BulkDownloadOperation: Skipping unsupported file type for entry: {}.", fullLocalPath(index).string());
+    }
+    return {};
+}
+
+std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error>
+BulkDownloadOperation::workFile(FileDownload& file)
 {
-    auto result = currentDownload_->work();
+    if (!file.download)
+    {
+        auto openResult = file.pendingOpen.take();
+        if (!openResult)
+            return WorkStatus::Waiting;
+
+        const auto remoteFullPath = scan_->entries.fullPath(file.index);
+        if (!openResult->has_value())
+        {
+            Log::error("BulkDownloadOperation: Failed to open remote sftp file: {}.", openResult->error().message);
+            return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
+                .type = ErrorType::SftpError,
+                .sftpError = openResult->error(),
+                .extraInfo = fmt::format("Opening remote file: {}", remoteFullPath.string())});
+        }
+
+        auto downloadOptions = options_.individualOptions;
+        downloadOptions.remotePath = remoteFullPath;
+        downloadOptions.localPath = fullLocalPath(file.index);
+        // Known from the listing, which saves round trips per file:
+        downloadOptions.fileSize = scan_->entries.fileSize(file.index);
+        if (downloadOptions.inheritPermissions)
+        {
+            downloadOptions.inheritPermissions = false;
+            downloadOptions.permissions = scan_->entries.permissions(file.index);
+        }
+        downloadOptions.closeInBackground = true;
+
+        downloadOptions.progressCallback = [this, &file, remoteFullPath](auto, auto max, auto current) {
+            // Progress is reported as the offset within the file:
+            currentBytes_ += current - file.bytes;
+            file.bytes = current;
+
+            options_.overallProgressCallback(
+                remoteFullPath,
+                file.index,
+                scan_->entries.size() - 1,
+                current,
+                max,
+                currentBytes_,
+                scan_->totalBytes);
+        };
+
+        file.download = std::make_unique<DownloadOperation>(std::move(*openResult).value(), downloadOptions);
+        file.download->onWakeup(wakeup_);
+        file.download->onDelayedWakeup(delayedWakeup_);
+    }
+
+    auto result = file.download->work();
     if (!result)
     {
-        auto const& entry = entries_[currentIndex_];
         Log::error(
             "BulkDownloadOperation: Download failed for file: {}: {}",
-            fullLocalPath(entry).string(),
+            fullLocalPath(file.index).string(),
             result.error().toString());
         return enterErrorState<BulkDownloadOperation::WorkStatus>(result.error());
     }
-    else if (result.value() == WorkStatus::Complete)
+    return result.value();
+}
+
+std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> BulkDownloadOperation::workAsArchive()
+{
+    using enum OperationState;
+
+    switch (state())
     {
-        // Download finished
-        currentDownload_.reset();
-        ++currentIndex_;
+        case (NotStarted):
+        {
+            if (scan_->entries.empty())
+            {
+                Log::info("BulkDownloadOperation: No entries to download.");
+                enterState(Completed);
+                return WorkStatus::Complete;
+            }
+
+            const auto path = options_.localPath;
+            std::error_code ec;
+            std::filesystem::create_directories(path, ec);
+            if (ec)
+            {
+                Log::error(
+                    "BulkDownloadOperation: Failed to create local directory: {}: {}", path.string(), ec.message());
+                return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
+                    .type = ErrorType::CannotCreateDirectory,
+                    .extraInfo = fmt::format("Creating local directory: {}: {}", path.string(), ec.message())});
+            }
+
+            Log::info("BulkDownloadOperation: Downloading {} as archive.", options_.remotePath.generic_string());
+            sftp_->createExecChannel(archiveCommand(), expectInto(pendingChannel_, wakeup_));
+            enterState(Preparing);
+            return WorkStatus::Waiting;
+        }
+        case (Preparing):
+        {
+            auto channelResult = pendingChannel_.take();
+            if (!channelResult)
+                return WorkStatus::Waiting;
+            if (!channelResult->has_value())
+                return fallBackToSftp(fmt::format("Cannot run commands remotely: {}", channelResult->error().message));
+
+            archiveChannel_ = std::move(*channelResult).value();
+            auto channel = archiveChannel_.lock();
+            if (!channel)
+                return fallBackToSftp("The channel closed right away");
+
+            auto [onChunk, onComplete] = archiveChunks_.expect(wakeup_);
+            // The channel passes all of stderr on before it reports its end:
+            auto onError = archiveErrors_.expect({}).first;
+            channel->startReading(
+                [onChunk = std::move(onChunk)](std::string const& data) {
+                    onChunk(data);
+                },
+                [onError = std::move(onError)](std::string const& data) {
+                    onError(data);
+                },
+                // The channel keeps reporting its end until it is closed:
+                [onComplete = std::move(onComplete), ended = std::make_shared<std::atomic_bool>(false)]() {
+                    if (!ended->exchange(true))
+                        onComplete(std::size_t{0});
+                },
+                SecureShell::ChannelReadOptions{.maxChunkSize = 256 * 1024, .window = options_.archiveWindow});
+
+            enterState(Running);
+            return WorkStatus::MoreWork;
+        }
+        case (Prepared):
+            [[fallthrough]];
+        case (Running):
+            return extractArchive();
+        case (Finalizing):
+            [[fallthrough]];
+        case (Completed):
+            [[fallthrough]];
+        case (Failed):
+            [[fallthrough]];
+        case (Canceled):
+            return workNormal();
     }
+    return WorkStatus::Complete;
+}
+
+std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> BulkDownloadOperation::extractArchive()
+{
+    auto const& bandwidthLimiter = options_.individualOptions.bandwidthLimiter;
+    const auto allowance = bandwidthLimiter.allowance();
+    if (allowance == 0)
+        return waitForBandwidth();
+
+    const auto result = archiveChunks_.take(receivedArchive_, allowance);
+    if (receivedArchive_.empty())
+    {
+        if (!result)
+            return WorkStatus::Waiting;
+        return finishArchive();
+    }
+
+    std::size_t received = 0;
+    for (auto const& chunk : receivedArchive_)
+    {
+        received += chunk.size();
+        if (auto consumed = consumeArchive(chunk); !consumed)
+        {
+            if (!archiveCompressed_)
+                return fallBackToSftp(consumed.error());
+
+            Log::error("BulkDownloadOperation: Failed to extract archive: {}", consumed.error());
+            return enterErrorState<BulkDownloadOperation::WorkStatus>(
+                Error{.type = ErrorType::ArchiveStreamFailure, .extraInfo = consumed.error()});
+        }
+    }
+    receivedArchive_.clear();
+
+    bandwidthLimiter.consume(received);
+    if (auto channel = archiveChannel_.lock(); channel)
+        channel->acknowledge(received);
+
+    reportArchiveProgress();
     return WorkStatus::MoreWork;
 }
 
-std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> BulkDownloadOperation::workAsArchive()
+std::expected<void, std::string> BulkDownloadOperation::consumeArchive(std::string_view data)
+{
+    if (!archiveCompressed_)
+    {
+        archiveLead_.append(data);
+        auto marker = archiveLead_.find(archiveMarker);
+        while (marker != std::string::npos && marker != 0 && archiveLead_[marker - 1] != '\n')
+            marker = archiveLead_.find(archiveMarker, marker + 1);
+        const auto lineEnd = marker == std::string::npos ? marker : archiveLead_.find('\n', marker);
+        if (lineEnd == std::string::npos)
+        {
+            if (archiveLead_.size() > maxArchiveLead)
+                return std::unexpected(std::string{"The remote printed no archive"});
+            return {};
+        }
+
+        const auto compression = std::string_view{archiveLead_}.substr(
+            marker + archiveMarker.size(), lineEnd - marker - archiveMarker.size());
+        archiveCompressed_ = compression == "gz";
+        if (*archiveCompressed_)
+            gzipDecoder_ = std::make_unique<GzipDecoder>();
+        tarExtractor_ = std::make_unique<TarExtractor>(
+            options_.localPath, TarExtractor::Options{.mayOverwrite = options_.individualOptions.mayOverwrite});
+
+        const auto lead = std::move(archiveLead_);
+        archiveLead_.clear();
+        return consumeArchive(std::string_view{lead}.substr(lineEnd + 1));
+    }
+
+    if (!*archiveCompressed_)
+        return tarExtractor_->feed(data);
+
+    decompressed_.clear();
+    if (auto decoded = gzipDecoder_->decode(data, decompressed_); !decoded)
+        return decoded;
+    return tarExtractor_->feed(decompressed_);
+}
+
+std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error> BulkDownloadOperation::finishArchive()
 {
-    // TODO: implement archive download
+    closeArchiveChannel();
+
+    if (!archiveCompressed_)
+        return fallBackToSftp("The remote has no tar");
+
+    // Logs the errors of the remote tar as well:
+    const auto status = takeArchiveStatus();
+    if (!tarExtractor_->finished())
+    {
+        Log::error("BulkDownloadOperation: Archive stream ended early.");
+        return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
+            .type = ErrorType::ArchiveStreamFailure,
+            .extraInfo = "The archive stream ended before the archive did, see the log for errors of the remote tar."});
+    }
+
+    // tar writes a complete archive even if it could not read some of the files:
+    if (!status || *status != 0)
+    {
+        Log::error("BulkDownloadOperation: Remote tar failed with status {}.", status ? *status : -1);
+        return enterErrorState<BulkDownloadOperation::WorkStatus>(Error{
+            .type = ErrorType::ArchiveStreamFailure,
+            .extraInfo = status ? fmt::format(
+                                      "The remote tar failed with exit status {}, see the log for its errors.", *status)
+                                : std::string{"The remote tar did not report its exit status."}});
+    }
+
+    Log::info(
+        "BulkDownloadOperation: Archive download completed, {} entries with {} bytes.",
+        tarExtractor_->entriesExtracted(),
+        tarExtractor_->bytesExtracted());
+    reportArchiveProgress();
+    enterState(OperationState::Completed);
     return WorkStatus::Complete;
 }
 
-SharedData::OperationType BulkDownloadOperation::type() const
+std::optional<int> BulkDownloadOperation::takeArchiveStatus()
 {
-    return SharedData::OperationType::BulkDownload;
+    std::vector<std::string> chunks{};
+    archiveErrors_.take(chunks);
+    std::string errors{};
+    for (auto const& chunk : chunks)
+        errors += chunk;
+
+    std::optional<int> status{std::nullopt};
+    std::string_view rest{errors};
+    while (!rest.empty())
+    {
+        const auto lineEnd = std::min(rest.find('\n'), rest.size());
+        const auto line = rest.substr(0, lineEnd);
+        rest.remove_prefix(std::min(lineEnd + 1, rest.size()));
+
+        if (line.starts_with(archiveStatusMarker))
+        {
+            const auto number = line.substr(archiveStatusMarker.size());
+            int value = 0;
+            const auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+            status = error == std::errc{} && end == number.data() + number.size() ? std::optional<int>{value}
+                                                                                   : std::nullopt;
+        }
+        else if (!line.empty())
+            Log::warn("BulkDownloadOperation: Remote tar: {}", line);
+    }
+    return status;
+}
+
+std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error>
+BulkDownloadOperation::fallBackToSftp(std::string_view reason)
+{
+    Log::warn("BulkDownloadOperation: Cannot download as archive, downloading file by file: {}", reason);
+    closeArchiveChannel();
+    archiveFallback_ = true;
+    enterState(OperationState::NotStarted);
+    return WorkStatus::MoreWork;
+}
+
+std::expected<BulkDownloadOperation::WorkStatus, BulkDownloadOperation::Error>
+BulkDownloadOperation::waitForBandwidth()
+{
+    if (!delayedWakeup_)
+        return WorkStatus::MoreWork;
+    delayedWakeup_(options_.individualOptions.bandwidthLimiter.delay());
+    return WorkStatus::Waiting;
+}
+
+void BulkDownloadOperation::reportArchiveProgress()
+{
+    if (!tarExtractor_)
+        return;
+
+    options_.overallProgressCallback(
+        tarExtractor_->currentPath(),
+        tarExtractor_->entriesExtracted(),
+        scan_->entries.empty() ? 0 : scan_->entries.size() - 1,
+        tarExtractor_->currentFileBytes(),
+        tarExtractor_->currentFileSize(),
+        tarExtractor_->bytesExtracted(),
+        scan_->totalBytes);
+}
+
+void BulkDownloadOperation::closeArchiveChannel()
+{
+    archiveChunks_.stop();
+    archiveErrors_.stop();
+    if (auto channel = archiveChannel_.lock(); channel)
+        channel->close();
+    archiveChannel_.reset();
+}
+
+std::string BulkDownloadOperation::archiveCommand() const
+{
+    if (options_.archiveFormat != "tar")
+        Log::warn("BulkDownloadOperation: Archive format '{}' is not supported, using tar.", options_.archiveFormat);
+
+    const bool compress = !options_.compressionMethod.empty() && options_.compressionMethod != "none";
+    if (compress && options_.compressionMethod != "gz")
+    {
+        Log::warn(
+            "BulkDownloadOperation: Compression method '{}' is not supported, using gz.", options_.compressionMethod);
+    }
+
+    // Run by sh, whatever the login shell is. Without tar nothing is printed, which makes the download fall back to
+    // sftp. Otherwise the marker line tells whether gzip was found for compression. The exit status of tar follows
+    // its errors on stderr.
+    const auto script = fmt::format(
+        "cd -- {0} || exit 1; command -v tar >/dev/null 2>&1 || exit 0; "
+        "if {1}command -v gzip >/dev/null 2>&1; then echo '{2}gz'; "
+        "{{ tar -cf - .; echo \"{3}$?\" >&2; }} | gzip -c -{4}; "
+        "else echo '{2}none'; tar -cf - .; echo \"{3}$?\" >&2; fi",
+        Utility::shellQuote(options_.remotePath.generic_string()),
+        compress ? "" : "false && ",
+        archiveMarker,
+        archiveStatusMarker,
+        std::clamp(options_.compressionLevel, 1, 9));
+    return "sh -c " + Utility::shellQuote(script);
 }
 
-void BulkDownloadOperation::setScanResult(std::vector<SharedData::DirectoryEntry>&& entries, std::uint64_t totalBytes)
+SharedData::OperationType BulkDownloadOperation::type() const
 {
-    entries_ = std::move(entries);
-    totalBytes_ = totalBytes;
+    return SharedData::OperationType::BulkDownload;
 }
 
 std::expected<void, BulkDownloadOperation::Error> BulkDownloadOperation::cancel(bool adoptCancelState)
 {
+    closeArchiveChannel();
+    downloads_.clear();
     if (adoptCancelState)
         enterState(OperationState::Canceled);
     return {};
@@ -265,4 +626,14 @@ std::expected<void, BulkDownloadOperation::Error> BulkDownloadOperation::cancel(
 SecureShell::ProcessingStrand* BulkDownloadOperation::strand() const
 {
     return sftp_->strand();
+}
+
+std::optional<std::chrono::microseconds> BulkDownloadOperation::roundTripTime() const
+{
+    for (auto const& file : downloads_)
+    {
+        if (file.download)
+            return file.download->roundTripTime();
+    }
+    return std::nullopt;
 }
\ No newline at end of file
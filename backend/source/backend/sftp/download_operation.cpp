@@ -1,8 +1,20 @@
 #include <backend/sftp/download_operation.hpp>
 
 #include <log/log.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
 #include <tuple>
 
+namespace
+{
+    // Segments per stream, so streams that finish early take over segments of slower ones.
+    constexpr std::uint64_t segmentsPerStream = 4;
+    // The segment map is rewritten after this much progress.
+    constexpr std::uint64_t segmentMapInterval = 16 * 1024 * 1024;
+}
+
 DownloadOperation::DownloadOperation(
     std::weak_ptr<SecureShell::IFileStream> fileStream,
     DownloadOperationOptions options)
@@ -19,8 +31,27 @@ DownloadOperation::DownloadOperation(
     , doCleanup_{options.doCleanup}
     , permissions_{options.permissions}
     , localFile_{}
+    , knownFileSize_{options.fileSize}
     , fileSize_{0}
+    , closeInBackground_{options.closeInBackground}
     , futureTimeout_{options.futureTimeout}
+    , readsInFlight_{options.readsInFlight}
+    , pendingChunks_{}
+    , receivedChunks_{}
+    , segmentStreams_{std::move(options.segmentStreams)}
+    , segmentThreshold_{options.segmentThreshold}
+    , minimumSegmentSize_{std::max(options.minimumSegmentSize, std::uint64_t{1})}
+    , segments_{}
+    , workers_{}
+    , segmentProgress_{0}
+    , savedSegmentProgress_{0}
+    , writeBlockSize_{options.writeBlockSize}
+    , writeQueueBlocks_{options.writeQueueBlocks}
+    , writePool_{std::move(options.writePool)}
+    , writer_{}
+    , writeOffset_{0}
+    , readWindow_{}
+    , bandwidthLimiter_{std::move(options.bandwidthLimiter)}
 {
     if (tempFileSuffix_.empty())
         tempFileSuffix_ = ".filepart";
@@ -32,11 +63,19 @@ DownloadOperation::~DownloadOperation()
 {
     std::ignore = cancel(false);
 
-    if (auto stream = fileStream_.lock(); stream)
+    // The tasks of a completed read only hold shared state, waiting would only wait for the close.
+    const bool waitForTasks = !(closeInBackground_ && state_ == OperationState::Completed);
+    if (auto stream = fileStream_.lock(); stream && waitForTasks)
     {
-        // wait for all tasks of the operation to finish
+        // wait for all tasks of the operation to finish, the strand runs them in order. A running pipelined read ends
+        // by itself, cancel closed the stream:
         stream->strand()->pushPromiseTask([]() {}).get();
     }
+    for (auto const& weakStream : segmentStreams_)
+    {
+        if (auto stream = weakStream.lock(); stream)
+            stream->strand()->pushPromiseTask([]() {}).get();
+    }
 }
 
 std::expected<DownloadOperation::WorkStatus, DownloadOperation::Error> DownloadOperation::work()
@@ -68,13 +107,17 @@ std::expected<DownloadOperation::WorkStatus, DownloadOperation::Error> DownloadO
         }
         case (Running):
         {
-            const auto result = readOnce();
+            const auto result = segments_.empty() ? readOnce() : readSegmentsOnce();
             if (!result.has_value())
             {
                 Log::error("DownloadOperation: Failed to read file: {}", result.error().toString());
                 return enterErrorState<WorkStatus>(result.error());
             }
-            if (result.value())
+            if (result.value() == ReadStatus::Waiting)
+            {
+                return WorkStatus::Waiting;
+            }
+            if (result.value() == ReadStatus::MoreData)
             {
                 return WorkStatus::MoreWork;
             }
@@ -118,78 +161,216 @@ std::expected<DownloadOperation::WorkStatus, DownloadOperation::Error> DownloadO
     return enterErrorState<WorkStatus>({.type = ErrorType::UnknownWorkState});
 }
 
-std::expected<bool, DownloadOperation::Error> DownloadOperation::readOnce()
+std::expected<DownloadOperation::ReadStatus, DownloadOperation::Error> DownloadOperation::readOnce()
 {
     if (state_ < OperationState::Prepared)
     {
         Log::error("DownloadOperation: Operation not prepared.");
-        return enterErrorState<bool>({.type = ErrorType::OperationNotPrepared});
+        return enterErrorState<ReadStatus>({.type = ErrorType::OperationNotPrepared});
     }
 
-    if (!localFile_.is_open())
+    if (!writer_ || !writer_->isOpen())
     {
         Log::error("DownloadOperation: File is not open.");
-        return enterErrorState<bool>({.type = ErrorType::OpenFailure});
+        return enterErrorState<ReadStatus>({.type = ErrorType::OpenFailure});
+    }
+    if (const auto writeError = writer_->error(); writeError)
+    {
+        Log::error("DownloadOperation: Failed to write local file: {}", *writeError);
+        return enterErrorState<ReadStatus>({.type = ErrorType::TargetFileNotGood});
     }
 
     if (fileSize_ == 0)
     {
         Log::info("DownloadOperation: Remote file is empty, nothing to do.");
-        return false;
+        return ReadStatus::Complete;
     }
 
-    auto stream = fileStream_.lock();
-    if (!stream)
+    if (!pendingChunks_.started())
     {
-        Log::error("DownloadOperation: File stream expired.");
-        return enterErrorState<bool>({.type = ErrorType::FileStreamExpired});
-    }
+        auto stream = fileStream_.lock();
+        if (!stream)
+        {
+            Log::error("DownloadOperation: File stream expired.");
+            return enterErrorState<ReadStatus>({.type = ErrorType::FileStreamExpired});
+        }
 
-    auto future = stream->readSome(buffer_.data(), buffer_.size());
+        auto [onChunk, onComplete] = pendingChunks_.expect(wakeup_);
+        stream->readPipelined(readsInFlight_, std::move(onChunk), std::move(onComplete), makeReadWindow(*stream));
+    }
 
-    const auto futureStatus = future.wait_for(futureTimeout_);
+    // Chunks stay with the read while the writer is behind or the bandwidth limit is reached, the read window then
+    // stops the requests.
+    if (readWindow_)
+        limitReadWindow(*readWindow_);
+    if (writer_->full())
+        return ReadStatus::Waiting;
+    const auto allowance = bandwidthLimiter_.allowance();
+    if (allowance == 0)
+        return waitForBandwidth();
+
+    // Chunks of streams that deliver immediately are picked up right away:
+    const auto result = pendingChunks_.take(receivedChunks_, allowance);
+    if (result && !result->has_value())
+    {
+        Log::error("DownloadOperation: Failed to read from remote file: {}", result->error().message);
+        return enterErrorState<ReadStatus>({.type = ErrorType::SftpError, .sftpError = result->error()});
+    }
+    if (receivedChunks_.empty())
+    {
+        if (!result)
+            return ReadStatus::Waiting;
+        Log::info("DownloadOperation: Remote file read complete.");
+        return ReadStatus::Complete;
+    }
 
-    if (futureStatus != std::future_status::ready)
+    for (auto const& chunk : receivedChunks_)
     {
-        Log::error("DownloadOperation: Future timed out while reading.");
-        return enterErrorState<bool>({.type = ErrorType::FutureTimeout});
+        writer_->write(writeOffset_, chunk);
+        writeOffset_ += chunk.size();
+        bandwidthLimiter_.consume(chunk.size());
+        if (readWindow_)
+            readWindow_->release(chunk.size());
+        progressCallback_(0ull, fileSize_, writeOffset_);
     }
+    receivedChunks_.clear();
+    if (result || writeOffset_ >= fileSize_)
+    {
+        // The size from the stat is downloaded, a file growing meanwhile is not followed.
+        pendingChunks_.stop();
+        return ReadStatus::Complete;
+    }
+    return ReadStatus::MoreData;
+}
 
-    const auto result = future.get();
+std::expected<DownloadOperation::ReadStatus, DownloadOperation::Error> DownloadOperation::readSegmentsOnce()
+{
+    if (state_ < OperationState::Prepared)
+    {
+        Log::error("DownloadOperation: Operation not prepared.");
+        return enterErrorState<ReadStatus>({.type = ErrorType::OperationNotPrepared});
+    }
 
-    if (!result.has_value())
+    if (!writer_ || !writer_->isOpen())
     {
-        Log::error("DownloadOperation: Failed to read from remote file: {}", result.error().message);
-        return enterErrorState<bool>({.type = ErrorType::SftpError, .sftpError = result.error()});
+        Log::error("DownloadOperation: File is not open.");
+        return enterErrorState<ReadStatus>({.type = ErrorType::OpenFailure});
+    }
+    if (const auto writeError = writer_->error(); writeError)
+    {
+        Log::error("DownloadOperation: Failed to write local file: {}", *writeError);
+        return enterErrorState<ReadStatus>({.type = ErrorType::TargetFileNotGood});
     }
+    if (writer_->full())
+        return ReadStatus::Waiting;
+
+    bool progressed = false;
+    bool anyWorking = false;
+    bool throttled = false;
+    for (auto& worker : workers_)
+    {
+        const auto allowance = bandwidthLimiter_.allowance();
+        if (allowance == 0)
+        {
+            throttled = true;
+            break;
+        }
+
+        if (!worker.segment)
+        {
+            const auto next = std::find_if(segments_.begin(), segments_.end(), [](Segment const& segment) {
+                return !segment.assigned && segment.begin + segment.done < segment.end;
+            });
+            if (next == segments_.end())
+                continue;
+
+            auto stream = worker.stream.lock();
+            if (!stream)
+            {
+                // Other streams take over the segments of a lost one.
+                Log::warn("DownloadOperation: Segment stream expired.");
+                continue;
+            }
+
+            next->assigned = true;
+            worker.segment = static_cast<std::size_t>(std::distance(segments_.begin(), next));
+            if (!worker.window)
+                worker.window = makeReadWindow(*stream);
+            auto [onChunk, onComplete] = worker.pendingChunks.expect(wakeup_);
+            stream->readRangePipelined(
+                next->begin + next->done,
+                next->end - next->begin - next->done,
+                readsInFlight_,
+                std::move(onChunk),
+                std::move(onComplete),
+                worker.window);
+        }
+        anyWorking = true;
+        limitReadWindow(*worker.window);
+
+        auto& segment = segments_[*worker.segment];
+        const auto result = worker.pendingChunks.take(receivedChunks_, allowance);
+        if (result && !result->has_value())
+        {
+            Log::error("DownloadOperation: Failed to read segment from remote file: {}", result->error().message);
+            return enterErrorState<ReadStatus>({.type = ErrorType::SftpError, .sftpError = result->error()});
+        }
 
-    const auto readAmount = result.value();
+        for (auto const& chunk : receivedChunks_)
+        {
+            // Segments are written at their offset into the preallocated file:
+            writer_->write(segment.begin + segment.done, chunk);
+            bandwidthLimiter_.consume(chunk.size());
+            worker.window->release(chunk.size());
+            segment.done += chunk.size();
+            segmentProgress_ += chunk.size();
+            progressed = true;
+        }
+        receivedChunks_.clear();
+
+        if (result)
+        {
+            if (segment.begin + segment.done < segment.end)
+            {
+                // A gap would be left in the file otherwise.
+                Log::error("DownloadOperation: Remote file ended before segment end, did it shrink?");
+                return enterErrorState<ReadStatus>({.type = ErrorType::SourceFileNotGood});
+            }
+            worker.segment.reset();
+            worker.pendingChunks = {};
+            // The worker takes the next segment in the next cycle.
+            progressed = true;
+        }
+    }
 
-    if (readAmount == 0)
+    if (progressed)
     {
-        Log::info("DownloadOperation: Remote file read complete or error.");
-        return false;
+        progressCallback_(0ull, fileSize_, segmentProgress_);
+        if (segmentProgress_ - savedSegmentProgress_ >= segmentMapInterval)
+            saveSegmentMap();
     }
 
-    std::uint64_t tellp = 0;
-    std::uint64_t fileSize = 0;
-    bool good = true;
+    if (segmentProgress_ >= fileSize_)
     {
-        localFile_.write(buffer_.data(), static_cast<std::streamsize>(readAmount));
-        tellp = static_cast<uint64_t>(localFile_.tellp());
-        fileSize = fileSize_;
-        good = localFile_.good();
-        progressCallback_(0ull, fileSize, tellp);
+        Log::info("DownloadOperation: All segments of the remote file read.");
+        return ReadStatus::Complete;
     }
-    if (!good)
+    if (throttled && !progressed)
+        return waitForBandwidth();
+    if (!anyWorking && !progressed)
     {
-        Log::error("DownloadOperation read cycle stopped: localFile_.good() == false");
-        std::ignore = enterErrorState({
-            .type = SharedData::OperationErrorType::TargetFileNotGood,
-        });
-        return false;
+        Log::error("DownloadOperation: No stream left to read the remaining segments.");
+        return enterErrorState<ReadStatus>({.type = ErrorType::FileStreamExpired});
     }
-    return good && tellp < fileSize;
+    return progressed ? ReadStatus::MoreData : ReadStatus::Waiting;
+}
+
+DownloadOperation::ReadStatus DownloadOperation::waitForBandwidth()
+{
+    if (!delayedWakeup_)
+        return ReadStatus::MoreData;
+    delayedWakeup_(bandwidthLimiter_.delay());
+    return ReadStatus::Waiting;
 }
 
 std::expected<void, DownloadOperation::Error> DownloadOperation::openOrAdoptFile(SecureShell::IFileStream& stream)
@@ -244,6 +425,165 @@ std::expected<void, DownloadOperation::Error> DownloadOperation::openOrAdoptFile
     return {};
 }
 
+std::unique_ptr<LocalFileWriter> DownloadOperation::makeWriter(std::string const& path) const
+{
+    return std::make_unique<LocalFileWriter>(
+        path,
+        LocalFileWriter::Options{
+            .blockSize = writeBlockSize_,
+            .maxQueuedBlocks = writeQueueBlocks_,
+            .fileSize = fileSize_,
+            .onWritten = wakeup_,
+            .pool = writePool_,
+        });
+}
+
+std::shared_ptr<SecureShell::ReadWindow> DownloadOperation::makeReadWindow(SecureShell::IFileStream& stream)
+{
+    // Twice the requests in flight, so the read does not wait for chunks that are being handed to the writer.
+    auto window = std::make_shared<SecureShell::ReadWindow>(readsInFlight_ * stream.readLengthLimit() * 2);
+    limitReadWindow(*window);
+    if (segments_.empty())
+        readWindow_ = window;
+    return window;
+}
+
+void DownloadOperation::limitReadWindow(SecureShell::ReadWindow& window) const
+{
+    // Follows limit changes, the window itself caps it when unlimited.
+    const auto rate = bandwidthLimiter_.rate();
+    if (rate == 0)
+        return window.limit(std::numeric_limits<std::size_t>::max());
+    const auto readAhead = rate * static_cast<std::uint64_t>(limitedReadAhead.count()) / 1000;
+    window.limit(static_cast<std::size_t>(std::min<std::uint64_t>(readAhead, std::numeric_limits<std::size_t>::max())));
+}
+
+std::string DownloadOperation::segmentMapPath() const
+{
+    return localPath_.generic_string() + tempFileSuffix_ + ".segments";
+}
+
+bool DownloadOperation::loadSegmentMap()
+{
+    std::ifstream map{segmentMapPath()};
+    if (!map.is_open())
+        return false;
+
+    std::uint64_t fileSize = 0;
+    if (!(map >> fileSize) || fileSize != fileSize_)
+    {
+        Log::info("DownloadOperation: Segment map belongs to a file of different size, starting over.");
+        return false;
+    }
+
+    std::vector<Segment> segments{};
+    Segment segment{.begin = 0, .end = 0, .done = 0, .assigned = false};
+    while (map >> segment.begin >> segment.end >> segment.done)
+    {
+        const auto expectedBegin = segments.empty() ? 0 : segments.back().end;
+        if (segment.begin != expectedBegin || segment.end < segment.begin || segment.done > segment.end - segment.begin)
+        {
+            Log::info("DownloadOperation: Segment map is malformed, starting over.");
+            return false;
+        }
+        segments.push_back(segment);
+    }
+    if (segments.empty() || segments.back().end != fileSize_)
+    {
+        Log::info("DownloadOperation: Segment map does not cover the file, starting over.");
+        return false;
+    }
+
+    segments_ = std::move(segments);
+    return true;
+}
+
+void DownloadOperation::saveSegmentMap()
+{
+    // Written data must be in the file before the map claims it is.
+    if (writer_)
+    {
+        if (const auto synced = writer_->sync(); !synced)
+        {
+            Log::warn("DownloadOperation: Not saving segment map, writing failed: {}", synced.error());
+            return;
+        }
+    }
+
+    std::ofstream map{segmentMapPath(), std::ios::trunc};
+    map << fileSize_ << '\n';
+    for (auto const& segment : segments_)
+        map << segment.begin << ' ' << segment.end << ' ' << segment.done << '\n';
+    if (!map.good())
+        Log::warn("DownloadOperation: Failed to write segment map '{}'.", segmentMapPath());
+    savedSegmentProgress_ = segmentProgress_;
+}
+
+std::expected<void, DownloadOperation::Error> DownloadOperation::openSegmentedFile()
+{
+    const auto tempPath = localPath_.generic_string() + tempFileSuffix_;
+
+    if (tryContinue_ && std::filesystem::exists(tempPath) && loadSegmentMap())
+    {
+        Log::info("DownloadOperation: File '{}' is incomplete, continuing segmented download.", tempPath);
+    }
+    else
+    {
+        Log::info("DownloadOperation: Starting new segmented download to '{}'.", tempPath);
+        const auto streamCount = static_cast<std::uint64_t>(segmentStreams_.size() + 1);
+        const auto count =
+            std::clamp<std::uint64_t>(fileSize_ / minimumSegmentSize_, 1, streamCount * segmentsPerStream);
+        const auto segmentSize = fileSize_ / count;
+
+        segments_.clear();
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            segments_.push_back(Segment{
+                .begin = i * segmentSize,
+                .end = i + 1 == count ? fileSize_ : (i + 1) * segmentSize,
+                .done = 0,
+                .assigned = false,
+            });
+        }
+        // Truncates what was there before:
+        std::ofstream{tempPath, std::ios::binary | std::ios::trunc};
+    }
+
+    // Segments are written at their offsets, so the file has its full size from the start.
+    std::error_code ec{};
+    std::filesystem::resize_file(tempPath, fileSize_, ec);
+    if (ec)
+    {
+        Log::error("DownloadOperation: Failed to preallocate file '{}': {}", tempPath, ec.message());
+        return enterErrorState({.type = ErrorType::OpenFailure});
+    }
+
+    writer_ = makeWriter(tempPath);
+    if (!writer_->isOpen())
+    {
+        Log::error("DownloadOperation: Failed to open file: {}", tempPath);
+        return enterErrorState({.type = ErrorType::OpenFailure});
+    }
+
+    segmentProgress_ = std::accumulate(
+        segments_.begin(), segments_.end(), std::uint64_t{0}, [](std::uint64_t sum, Segment const& segment) {
+            return sum + segment.done;
+        });
+    savedSegmentProgress_ = segmentProgress_;
+
+    workers_.clear();
+    workers_.push_back(SegmentWorker{.stream = fileStream_});
+    for (auto const& stream : segmentStreams_)
+        workers_.push_back(SegmentWorker{.stream = stream});
+
+    Log::info(
+        "DownloadOperation: Downloading {} segments with {} streams, {} bytes already present.",
+        segments_.size(),
+        workers_.size(),
+        segmentProgress_);
+    return {};
+}
+
 std::expected<void, Operation::Error> DownloadOperation::prepare()
 {
     if (localPath_.empty())
@@ -270,23 +610,28 @@ std::expected<void, Operation::Error> DownloadOperation::prepare()
         return enterErrorState({.type = ErrorType::FileStreamExpired});
     }
 
-    const auto fileInfo = stream->stat().get();
-    if (!fileInfo.has_value())
+    if (knownFileSize_)
+        fileSize_ = *knownFileSize_;
+    else
     {
-        Log::error("DownloadOperation: Failed to stat file.");
-        return enterErrorState({.type = ErrorType::FileStatFailed, .sftpError = fileInfo.error()});
+        const auto fileInfo = stream->stat().get();
+        if (!fileInfo.has_value())
+        {
+            Log::error("DownloadOperation: Failed to stat file.");
+            return enterErrorState({.type = ErrorType::FileStatFailed, .sftpError = fileInfo.error()});
+        }
+        fileSize_ = fileInfo->size;
     }
 
-    fileSize_ = fileInfo->size;
-
-    auto openResult = openOrAdoptFile(*stream);
+    const bool segmented = !segmentStreams_.empty() && fileSize_ >= segmentThreshold_ && fileSize_ != 0;
+    auto openResult = segmented ? openSegmentedFile() : openOrAdoptFile(*stream);
     if (!openResult.has_value())
     {
         Log::error("DownloadOperation: Failed to open file.");
         return enterErrorState(std::move(openResult).error());
     }
 
-    if (reserveSpace_ && fileSize_ != 0)
+    if (!segmented && reserveSpace_ && fileSize_ != 0)
     {
         // Reserve space
         Log::info("DownloadOperation: Reserving space for file.");
@@ -301,6 +646,19 @@ std::expected<void, Operation::Error> DownloadOperation::prepare()
         localFile_.seekp(pos);
     }
 
+    if (!segmented && localFile_.is_open())
+    {
+        // From here on the writer thread owns the file.
+        writeOffset_ = static_cast<std::uint64_t>(localFile_.tellp());
+        localFile_.close();
+        writer_ = makeWriter(localPath_.generic_string() + tempFileSuffix_);
+        if (!writer_->isOpen())
+        {
+            Log::error("DownloadOperation: Failed to open file for writing.");
+            return enterErrorState({.type = ErrorType::OpenFailure});
+        }
+    }
+
     Log::info(
         "DownloadOperation: Prepared download of '{}' to '{}'.",
         remotePath_.generic_string(),
@@ -326,13 +684,37 @@ std::expected<void, DownloadOperation::Error> DownloadOperation::cancel(bool ado
 
 void DownloadOperation::cleanup()
 {
+    for (auto& worker : workers_)
+        worker.pendingChunks.stop();
+
+    if (writer_)
+    {
+        // What was received is written before the file is removed or kept for continuing.
+        if (const auto closed = writer_->close(); !closed)
+            Log::error("DownloadOperation: Failed to write local file: {}", closed.error());
+        if (!segments_.empty() && !doCleanup_)
+            saveSegmentMap();
+        writer_.reset();
+    }
     localFile_.close();
 
     if (doCleanup_ && std::filesystem::exists(localPath_.generic_string() + tempFileSuffix_))
         std::filesystem::remove(localPath_.generic_string() + tempFileSuffix_);
+    if (doCleanup_ && std::filesystem::exists(segmentMapPath()))
+        std::filesystem::remove(segmentMapPath());
 
     if (auto stream = fileStream_.lock(); stream)
-        stream->close(false);
+    {
+        if (closeInBackground_)
+            stream->closeInBackground();
+        else
+            stream->close(false);
+    }
+    for (auto const& weakStream : segmentStreams_)
+    {
+        if (auto stream = weakStream.lock(); stream)
+            stream->close(false);
+    }
 }
 
 std::expected<void, DownloadOperation::Error> DownloadOperation::finalize()
@@ -344,6 +726,16 @@ std::expected<void, DownloadOperation::Error> DownloadOperation::finalize()
     }
 
     localFile_.close();
+    if (writer_)
+    {
+        const auto closed = writer_->close();
+        writer_.reset();
+        if (!closed)
+        {
+            Log::error("DownloadOperation: Failed to write local file: {}", closed.error());
+            return std::unexpected(Error{.type = ErrorType::TargetFileNotGood});
+        }
+    }
 
     if (std::filesystem::exists(localPath_) && !mayOverwrite_)
     {
@@ -359,6 +751,8 @@ std::expected<void, DownloadOperation::Error> DownloadOperation::finalize()
         Log::error("DownloadOperation: Failed to rename file: {}", ec.message());
         return std::unexpected(Error{.type = ErrorType::RenameFailure});
     }
+    if (!segments_.empty())
+        std::filesystem::remove(segmentMapPath(), ec);
 
     if (inheritPermissions_)
     {
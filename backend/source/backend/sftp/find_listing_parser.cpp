@@ -0,0 +1,177 @@
+#include <backend/sftp/find_listing_parser.hpp>
+#include <utility/shell_quote.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <utility>
+
+namespace
+{
+    // Printed by the remote command before the listing.
+    constexpr std::string_view findMarker{"nui-scp-find"};
+    // Output allowed before the marker, like greetings of shell startup files.
+    constexpr std::size_t maxFindLead{64 * 1024};
+    // Follows the last entry, with the exit status of find.
+    constexpr std::string_view endRecord{"end "};
+    // Type, mode, size, mtime, uid, gid, owner and group, followed by the path which may contain anything.
+    constexpr std::size_t fieldCount{8};
+    // Ends each field before the path. Owner and group names may contain spaces, but never a colon, which separates
+    // the fields of the passwd and group databases.
+    constexpr char fieldSeparator{':'};
+
+    SharedData::FileType fileTypeOf(std::string_view type)
+    {
+        using enum SharedData::FileType;
+
+        if (type.size() != 1)
+            return Unknown;
+        switch (type[0])
+        {
+            case ('f'):
+                return Regular;
+            case ('d'):
+                return Directory;
+            case ('l'):
+                return Symlink;
+            case ('s'):
+                return Socket;
+            case ('p'):
+                return Fifo;
+            case ('c'):
+                return CharDevice;
+            case ('b'):
+                return BlockDevice;
+            case ('D'):
+                return Special;
+            default:
+                return Unknown;
+        }
+    }
+
+    template <typename T>
+    bool parseNumber(std::string_view text, T& value, int base = 10)
+    {
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+        return error == std::errc{} && end == text.data() + text.size();
+    }
+}
+
+std::string FindListingParser::command(std::filesystem::path const& root, std::vector<std::string> const& prunedNames)
+{
+    std::string prune{};
+    for (auto const& name : prunedNames)
+        prune += fmt::format("{}-name {} ", prune.empty() ? "" : "-o ", Utility::shellQuote(name));
+    if (!prune.empty())
+        prune = fmt::format("-type d \\( {}\\) -prune -o ", prune);
+
+    // Run by sh, whatever the login shell is. -H follows the root if it is a link, like listing it over sftp does.
+    // Busybox and BSD find have no -printf, they fail the probe and nothing is printed.
+    const auto quotedRoot = Utility::shellQuote(root.generic_string());
+    const auto script = fmt::format(
+        "find -H {0} -maxdepth 0 -printf '' >/dev/null 2>&1 || exit 0; echo '{1}'; "
+        "find -H {0} -mindepth 1 {3}-printf '%y:%m:%s:%T@:%U:%G:%u:%g:%P\\0'; printf '{2}%d\\0' \"$?\"",
+        quotedRoot,
+        findMarker,
+        endRecord,
+        prune);
+    return "sh -c " + Utility::shellQuote(script);
+}
+
+std::expected<void, std::string> FindListingParser::feed(std::string_view data)
+{
+    if (exitStatus_)
+        return {};
+
+    pending_.append(data);
+    std::size_t offset = 0;
+
+    if (!started_)
+    {
+        // The marker is a line of its own:
+        auto marker = pending_.find(findMarker);
+        while (marker != std::string::npos && marker + findMarker.size() < pending_.size() &&
+               ((marker != 0 && pending_[marker - 1] != '\n') || pending_[marker + findMarker.size()] != '\n'))
+        {
+            marker = pending_.find(findMarker, marker + 1);
+        }
+        if (marker == std::string::npos || marker + findMarker.size() >= pending_.size())
+        {
+            if (pending_.size() > maxFindLead)
+                return std::unexpected(std::string{"The remote printed no listing"});
+            return {};
+        }
+
+        started_ = true;
+        offset = marker + findMarker.size() + 1;
+    }
+
+    for (auto end = pending_.find('\0', offset); end != std::string::npos; end = pending_.find('\0', offset))
+    {
+        auto result = parseRecord(std::string_view{pending_}.substr(offset, end - offset));
+        offset = end + 1;
+        if (!result)
+            return result;
+        if (exitStatus_)
+        {
+            pending_.clear();
+            return {};
+        }
+    }
+    pending_.erase(0, offset);
+    return {};
+}
+
+std::expected<void, std::string> FindListingParser::parseRecord(std::string_view record)
+{
+    if (record.starts_with(endRecord))
+    {
+        int status = 0;
+        if (!parseNumber(record.substr(endRecord.size()), status))
+            return std::unexpected(fmt::format("Invalid exit status of find: {}", record));
+        exitStatus_ = status;
+        return {};
+    }
+
+    std::array<std::string_view, fieldCount> fields{};
+    std::string_view rest{record};
+    for (auto& field : fields)
+    {
+        const auto separator = rest.find(fieldSeparator);
+        if (separator == std::string_view::npos)
+            return std::unexpected(fmt::format("Incomplete entry from find: {}", record));
+        field = rest.substr(0, separator);
+        rest.remove_prefix(separator + 1);
+    }
+    const auto& [type, mode, size, mtime, uid, gid, owner, group] = fields;
+
+    SharedData::DirectoryEntry entry{
+        .path = std::filesystem::path{std::string{rest}},
+        .type = fileTypeOf(type),
+        .owner = std::string{owner},
+        .group = std::string{group},
+    };
+
+    std::uint32_t permissions = 0;
+    // Seconds with a fraction, the fraction is dropped. Times before 1970 are clamped.
+    const auto seconds = mtime.substr(0, mtime.find('.'));
+    std::int64_t modified = 0;
+    if (rest.empty() || !parseNumber(mode, permissions, 8) || !parseNumber(size, entry.size) ||
+        !parseNumber(seconds, modified) || !parseNumber(uid, entry.uid) || !parseNumber(gid, entry.gid))
+    {
+        return std::unexpected(fmt::format("Invalid entry from find: {}", record));
+    }
+    entry.permissions = static_cast<std::filesystem::perms>(permissions & 07777);
+    entry.mtime = static_cast<std::uint64_t>(std::max<std::int64_t>(modified, 0));
+
+    entries_.push_back(std::move(entry));
+    return {};
+}
+
+std::vector<SharedData::DirectoryEntry> FindListingParser::takeEntries()
+{
+    return std::exchange(entries_, {});
+}
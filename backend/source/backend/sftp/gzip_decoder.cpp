@@ -0,0 +1,69 @@
+#include <backend/sftp/gzip_decoder.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    constexpr std::size_t outputStep{256 * 1024};
+}
+
+GzipDecoder::GzipDecoder()
+    : stream_{std::make_unique<z_stream_s>()}
+    , initialized_{false}
+    , finished_{false}
+{
+    // 16 selects the gzip wrapper instead of zlib:
+    initialized_ = inflateInit2(stream_.get(), 16 + MAX_WBITS) == Z_OK;
+}
+
+GzipDecoder::~GzipDecoder()
+{
+    if (initialized_)
+        inflateEnd(stream_.get());
+}
+
+std::expected<void, std::string> GzipDecoder::decode(std::string_view input, std::string& output)
+{
+    if (!initialized_)
+        return std::unexpected(std::string{"Failed to initialize gzip decompression"});
+
+    while (!input.empty() && !finished_)
+    {
+        const auto inputSize = std::min(input.size(), static_cast<std::size_t>(std::numeric_limits<uInt>::max()));
+        stream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream_->avail_in = static_cast<uInt>(inputSize);
+
+        do
+        {
+            const auto offset = output.size();
+            output.resize(offset + outputStep);
+            stream_->next_out = reinterpret_cast<Bytef*>(output.data() + offset);
+            stream_->avail_out = static_cast<uInt>(outputStep);
+
+            const auto result = inflate(stream_.get(), Z_NO_FLUSH);
+            output.resize(offset + outputStep - stream_->avail_out);
+
+            if (result == Z_STREAM_END)
+            {
+                finished_ = true;
+                break;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                return std::unexpected(
+                    std::string{"Corrupt gzip stream: "} + (stream_->msg ? stream_->msg : "unknown error"));
+            }
+        } while (stream_->avail_out == 0 || stream_->avail_in > 0);
+
+        input.remove_prefix(inputSize - stream_->avail_in);
+    }
+    return {};
+}
+
+bool GzipDecoder::finished() const
+{
+    return finished_;
+}
@@ -0,0 +1,243 @@
+#include <backend/sftp/local_file_writer.hpp>
+
+#include <log/log.hpp>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+LocalFileWritePool::LocalFileWritePool(std::size_t threads)
+{
+    threads = std::max(threads, std::size_t{1});
+    for (std::size_t i = 0; i < threads; ++i)
+        threads_.emplace_back(&LocalFileWritePool::run, this);
+}
+
+LocalFileWritePool::~LocalFileWritePool()
+{
+    {
+        std::scoped_lock lock{mutex_};
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+void LocalFileWritePool::post(std::function<void()> job)
+{
+    {
+        std::scoped_lock lock{mutex_};
+        jobs_.push_back(std::move(job));
+    }
+    wake_.notify_one();
+}
+
+void LocalFileWritePool::run()
+{
+    std::unique_lock lock{mutex_};
+    while (true)
+    {
+        wake_.wait(lock, [this]() {
+            return stopping_ || !jobs_.empty();
+        });
+        if (jobs_.empty())
+            break;
+
+        auto job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+LocalFileWriter::LocalFileWriter(std::filesystem::path const& path, Options options)
+    : options_{std::move(options)}
+    , file_{path, std::ios::binary | std::ios::in | std::ios::out}
+    , open_{file_.is_open()}
+{
+    options_.blockSize = std::max(options_.blockSize, std::size_t{1});
+    options_.maxQueuedBlocks = std::max(options_.maxQueuedBlocks, std::size_t{1});
+    options_.maxCollectingBlocks = std::max(options_.maxCollectingBlocks, std::size_t{1});
+
+    if (open_ && !options_.pool)
+        options_.pool = std::make_shared<LocalFileWritePool>();
+}
+
+LocalFileWriter::~LocalFileWriter()
+{
+    std::ignore = close();
+}
+
+bool LocalFileWriter::isOpen() const
+{
+    return open_;
+}
+
+std::string LocalFileWriter::takeBuffer(std::uint64_t offset)
+{
+    {
+        std::scoped_lock lock{mutex_};
+        if (!spareBuffers_.empty())
+        {
+            auto buffer = std::move(spareBuffers_.back());
+            spareBuffers_.pop_back();
+            return buffer;
+        }
+    }
+    auto capacity = options_.blockSize;
+    if (options_.fileSize && *options_.fileSize > offset)
+        capacity = static_cast<std::size_t>(std::min<std::uint64_t>(capacity, *options_.fileSize - offset));
+    std::string buffer{};
+    buffer.reserve(capacity);
+    return buffer;
+}
+
+void LocalFileWriter::queue(Block&& block)
+{
+    ++unwritten_;
+    queued_.push_back(std::move(block));
+    if (!writing_)
+    {
+        writing_ = true;
+        options_.pool->post([this]() {
+            writeNext();
+        });
+    }
+}
+
+void LocalFileWriter::write(std::uint64_t offset, std::string_view data)
+{
+    while (!data.empty())
+    {
+        auto iter = std::find_if(collecting_.begin(), collecting_.end(), [offset](Block const& block) {
+            return block.offset + block.data.size() == offset;
+        });
+        if (iter == collecting_.end())
+        {
+            if (collecting_.size() >= options_.maxCollectingBlocks)
+            {
+                std::scoped_lock lock{mutex_};
+                queue(std::move(collecting_.front()));
+                collecting_.erase(collecting_.begin());
+            }
+            collecting_.push_back(Block{.offset = offset, .data = takeBuffer(offset)});
+            iter = std::prev(collecting_.end());
+        }
+
+        const auto part = data.substr(0, options_.blockSize - iter->data.size());
+        iter->data.append(part);
+        offset += part.size();
+        data.remove_prefix(part.size());
+
+        if (iter->data.size() >= options_.blockSize)
+        {
+            std::scoped_lock lock{mutex_};
+            queue(std::move(*iter));
+            collecting_.erase(iter);
+        }
+    }
+}
+
+void LocalFileWriter::flush()
+{
+    std::scoped_lock lock{mutex_};
+    for (auto& block : collecting_)
+        queue(std::move(block));
+    collecting_.clear();
+}
+
+bool LocalFileWriter::full() const
+{
+    std::scoped_lock lock{mutex_};
+    return unwritten_ >= options_.maxQueuedBlocks;
+}
+
+std::expected<void, std::string> LocalFileWriter::sync()
+{
+    flush();
+
+    std::unique_lock lock{mutex_};
+    blockWritten_.wait(lock, [this]() {
+        return unwritten_ == 0 || !open_;
+    });
+    if (error_)
+        return std::unexpected(*error_);
+    return {};
+}
+
+std::expected<void, std::string> LocalFileWriter::close()
+{
+    if (open_)
+    {
+        flush();
+        {
+            // The last job touches the writer until it is done:
+            std::unique_lock lock{mutex_};
+            blockWritten_.wait(lock, [this]() {
+                return unwritten_ == 0 && !writing_;
+            });
+        }
+        file_.close();
+        open_ = false;
+    }
+
+    std::scoped_lock lock{mutex_};
+    if (error_)
+        return std::unexpected(*error_);
+    return {};
+}
+
+std::optional<std::string> LocalFileWriter::error() const
+{
+    std::scoped_lock lock{mutex_};
+    return error_;
+}
+
+void LocalFileWriter::writeNext()
+{
+    std::unique_lock lock{mutex_};
+    auto block = std::move(queued_.front());
+    queued_.pop_front();
+
+    if (!error_)
+    {
+        lock.unlock();
+        // Only one job of a writer runs at a time, so seeking and writing is a positioned write.
+        file_.seekp(static_cast<std::streamoff>(block.offset));
+        file_.write(block.data.data(), static_cast<std::streamsize>(block.data.size()));
+        if (file_.good())
+            file_.flush();
+        const bool good = file_.good();
+        lock.lock();
+
+        if (!good)
+        {
+            Log::error("LocalFileWriter: Failed to write {} bytes at {}.", block.data.size(), block.offset);
+            error_ = "Failed to write to local file";
+        }
+    }
+
+    --unwritten_;
+    block.data.clear();
+    spareBuffers_.push_back(std::move(block.data));
+
+    if (options_.onWritten)
+    {
+        lock.unlock();
+        options_.onWritten();
+        lock.lock();
+    }
+
+    // Queued again instead of looping, so other writers on the pool get their turn in between.
+    if (queued_.empty())
+        writing_ = false;
+    else
+    {
+        options_.pool->post([this]() {
+            writeNext();
+        });
+    }
+    blockWritten_.notify_all();
+}
@@ -1,7 +1,5 @@
 #include <backend/sftp/operation_queue.hpp>
-#include <shared_data/file_operations/download_progress.hpp>
-#include <shared_data/file_operations/bulk_download_progress.hpp>
-#include <shared_data/file_operations/scan_progress.hpp>
+#include <shared_data/file_operations/progress_batch.hpp>
 #include <shared_data/file_operations/operation_added.hpp>
 #include <shared_data/file_operations/operation_completed.hpp>
 #include <shared_data/error_or_success.hpp>
@@ -10,8 +8,41 @@
 #include <log/log.hpp>
 #include <utility/overloaded.hpp>
 
+#include <boost/asio/bind_executor.hpp>
+
+#include <algorithm>
+
 namespace
 {
+    std::pair<std::uint64_t, std::uint64_t> transferredBytes(SharedData::DownloadProgress const& progress)
+    {
+        return {progress.current - progress.min, progress.max - progress.min};
+    }
+    std::pair<std::uint64_t, std::uint64_t> transferredBytes(SharedData::UploadProgress const& progress)
+    {
+        return {progress.current - progress.min, progress.max - progress.min};
+    }
+    std::pair<std::uint64_t, std::uint64_t> transferredBytes(SharedData::BulkDownloadProgress const& progress)
+    {
+        return {progress.bytesCurrent, progress.bytesTotal};
+    }
+
+    std::vector<SharedData::DownloadProgress>&
+    progressList(SharedData::ProgressBatch& batch, SharedData::DownloadProgress const&)
+    {
+        return batch.downloads;
+    }
+    std::vector<SharedData::UploadProgress>&
+    progressList(SharedData::ProgressBatch& batch, SharedData::UploadProgress const&)
+    {
+        return batch.uploads;
+    }
+    std::vector<SharedData::BulkDownloadProgress>&
+    progressList(SharedData::ProgressBatch& batch, SharedData::BulkDownloadProgress const&)
+    {
+        return batch.bulkDownloads;
+    }
+
     OperationQueue::OperationCompleted makeCompletedOperation(
         OperationQueue::CompletionReason reason,
         Ids::OperationId operationId,
@@ -30,6 +61,16 @@ namespace
                         .error = error,
                     };
                 },
+                [reason, operationId, error](UploadOperation const& op) {
+                    return OperationQueue::OperationCompleted{
+                        .reason = reason,
+                        .operationId = operationId,
+                        .completionTime = std::chrono::system_clock::now(),
+                        .localPath = op.localPath(),
+                        .remotePath = op.remotePath(),
+                        .error = error,
+                    };
+                },
                 [reason, operationId, error](ScanOperation const& op) {
                     return OperationQueue::OperationCompleted{
                         .reason = reason,
@@ -64,11 +105,17 @@ OperationQueue::OperationQueue(
     Nui::RpcHub& hub,
     Persistence::SftpOptions sftpOpts,
     Ids::SessionId sessionId,
+    std::shared_ptr<TokenBucket> globalBandwidth,
     int parallelism)
     : RpcHelper::StrandRpc{executor, strand, wnd, hub}
     , sftpOpts_{std::move(sftpOpts)}
     , sessionId_{std::move(sessionId)}
     , parallelism_{parallelism}
+    , progressTimer_{executor_}
+    , operationBandwidthLimit_{sftpOpts_.operationBandwidthLimit.value_or(0)}
+    , sessionBandwidth_{std::make_shared<TokenBucket>(sftpOpts_.sessionBandwidthLimit.value_or(0))}
+    , globalBandwidth_{std::move(globalBandwidth)}
+    , wakeupTimer_{executor_}
 {}
 
 void OperationQueue::cancelAll()
@@ -108,6 +155,10 @@ void OperationQueue::completeOperation(SharedData::OperationCompleted&& operatio
         if (operationCompleted.error)
             Log::error("Operation failed: {}", operationCompleted.error->toString());
 
+        // The final progress is not held back, it has to arrive before the completion. Nothing follows it.
+        self->sendProgressBatch(self->pendingProgress_.complete(operationCompleted.operationId));
+        self->meteredTransfers_.erase(operationCompleted.operationId);
+
         Log::info(
             "Operation completed: id={}, reason={}, localPath='{}', remotePath='{}'",
             operationCompleted.operationId.value(),
@@ -128,6 +179,139 @@ void OperationQueue::completeOperation(SharedData::OperationCompleted&& operatio
     });
 }
 
+template <typename ProgressT>
+void OperationQueue::reportProgress(std::vector<ProgressT> SharedData::ProgressBatch::*list, ProgressT&& progress)
+{
+    if (!pendingProgress_.add(list, std::move(progress)))
+        return;
+
+    within_strand_do([weak = weak_from_this()]() {
+        auto self = weak.lock();
+        if (!self)
+            return;
+
+        self->armProgressTimer(self->lastProgressBatch_ + progressInterval);
+    });
+}
+
+void OperationQueue::armProgressTimer(std::chrono::steady_clock::time_point due)
+{
+    // Assumed in strand
+
+    // Rearming cancels the wait that was armed before.
+    progressTimer_.expires_at(due);
+    progressTimer_.async_wait(
+        boost::asio::bind_executor(*strand_, [weak = weak_from_this()](boost::system::error_code const& ec) {
+            if (ec)
+                return;
+            auto self = weak.lock();
+            if (!self)
+                return;
+            self->sendProgressBatch(self->pendingProgress_.take());
+        }));
+}
+
+template <typename ProgressT>
+void OperationQueue::measure(std::vector<ProgressT>& list, std::chrono::steady_clock::time_point now)
+{
+    // Assumed in strand
+
+    for (auto& progress : list)
+    {
+        auto iter = meteredTransfers_.find(progress.operationId);
+        if (iter == meteredTransfers_.end())
+        {
+            iter = meteredTransfers_
+                       .emplace(
+                           progress.operationId,
+                           MeteredTransfer{.meter = TransferMeter{now}, .progress = progress, .lastSent = now})
+                       .first;
+        }
+
+        const auto [current, total] = transferredBytes(progress);
+        iter->second.meter.sample(current, total, now);
+        progress.telemetry = telemetry(progress.operationId, iter->second.meter, now);
+        iter->second.progress = progress;
+        iter->second.lastSent = now;
+    }
+}
+
+SharedData::TransferTelemetry OperationQueue::telemetry(
+    Ids::OperationId const& operationId,
+    TransferMeter const& meter,
+    std::chrono::steady_clock::time_point now) const
+{
+    // Assumed in strand
+
+    std::optional<std::uint64_t> roundTripMicroseconds{};
+    const auto operation = std::find_if(operations_.begin(), operations_.end(), [&operationId](auto const& entry) {
+        return entry.first == operationId;
+    });
+    if (operation != operations_.end())
+    {
+        if (const auto roundTrip = operation->second->roundTripTime(); roundTrip)
+            roundTripMicroseconds = static_cast<std::uint64_t>(roundTrip->count());
+    }
+
+    std::optional<std::uint64_t> etaSeconds{};
+    if (const auto eta = meter.eta(); eta)
+        etaSeconds = static_cast<std::uint64_t>(eta->count());
+
+    return SharedData::TransferTelemetry{
+        .bytesPerSecond = meter.bytesPerSecond(),
+        .etaSeconds = etaSeconds,
+        .roundTripMicroseconds = roundTripMicroseconds,
+        // A paused queue holds its transfers back on purpose.
+        .stalled = !paused_ && meter.stalled(now),
+    };
+}
+
+void OperationQueue::sendProgressBatch(SharedData::ProgressBatch batch)
+{
+    // Assumed in strand
+
+    const auto now = std::chrono::steady_clock::now();
+    lastProgressBatch_ = now;
+
+    // Completed and canceled transfers are no longer measured.
+    std::erase_if(meteredTransfers_, [this](auto const& metered) {
+        return std::none_of(operations_.begin(), operations_.end(), [&metered](auto const& entry) {
+            return entry.first == metered.first;
+        });
+    });
+
+    measure(batch.downloads, now);
+    measure(batch.uploads, now);
+    measure(batch.bulkDownloads, now);
+
+    // Transfers that stopped reporting are repeated with fresh telemetry, a stall would not show otherwise.
+    for (auto& entry : meteredTransfers_)
+    {
+        auto& metered = entry.second;
+        if (now - metered.lastSent < telemetryInterval)
+            continue;
+
+        std::visit(
+            [this, &entry, &metered, &batch, now](auto progress) {
+                const auto [current, total] = transferredBytes(progress);
+                metered.meter.sample(current, total, now);
+                progress.telemetry = telemetry(entry.first, metered.meter, now);
+                progressList(batch, progress).push_back(progress);
+                metered.progress = std::move(progress);
+                metered.lastSent = now;
+            },
+            metered.progress);
+    }
+
+    if (!meteredTransfers_.empty())
+        armProgressTimer(now + telemetryInterval);
+
+    if (batch.downloads.empty() && batch.uploads.empty() && batch.scans.empty() && batch.bulkDownloads.empty())
+        return;
+
+    hub_->callRemote(fmt::format("OperationQueue::{}::onProgress", sessionId_.value()), batch);
+}
+
 bool OperationQueue::work()
 {
     // Assumed in strand
@@ -135,7 +319,7 @@ bool OperationQueue::work()
     if (paused_)
         return false;
 
-    const auto updateCount = std::min(operations_.size(), static_cast<std::size_t>(parallelism_));
+    auto updateCount = std::min(operations_.size(), static_cast<std::size_t>(parallelism_));
 
     bool moreWork = false;
     if (updateCount == 0)
@@ -150,6 +334,13 @@ bool OperationQueue::work()
         auto& [id, operation] = operations_[i];
         previousWasBarrier = operation->isBarrier();
 
+        // A scan and the bulk download consuming its entries count as one, so they always run side by side:
+        if (operation->type() == SharedData::OperationType::Scan && i + 1 == updateCount &&
+            updateCount < operations_.size())
+        {
+            ++updateCount;
+        }
+
         const auto workResult = operation->work();
         if (!workResult.has_value())
         {
@@ -164,22 +355,9 @@ bool OperationQueue::work()
         if (workStatus == Operation::WorkStatus::Complete)
         {
             Log::info("Operation completed successfully: {}", id.value());
-            if (operation->type() == SharedData::OperationType::Scan)
-            {
-                auto* next = (i + 1 < operations_.size()) ? operations_[i + 1].second.get() : nullptr;
-                if (next && next->type() == SharedData::OperationType::BulkDownload)
-                {
-                    auto* scan = static_cast<ScanOperation*>(operation.get());
-                    static_cast<BulkDownloadOperation*>(next)->setScanResult(scan->ejectEntries(), scan->totalBytes());
-                }
-                else
-                {
-                    Log::error("Scan operation completed but no following BulkOperation to set results to.");
-                }
-            }
-
             completeOperation(makeCompletedOperation(OperationQueue::CompletionReason::Completed, id, *operation));
-            operations_.pop_front();
+            // Not necessarily the first, operations run side by side:
+            operations_.erase(operations_.begin() + static_cast<std::ptrdiff_t>(i));
             // Exit loop and avoid any offset math. Just do another update cycle.
             return true;
         }
@@ -188,6 +366,7 @@ bool OperationQueue::work()
             moreWork = true;
             continue;
         }
+        // Waiting: the operation wakes the queue up when its asynchronous call completes.
     }
     return moreWork;
 }
@@ -207,49 +386,208 @@ void OperationQueue::paused(bool pause)
     });
 }
 
-std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
-    SecureShell::SftpSession& sftp,
+void OperationQueue::onWorkAvailable(std::function<void()> onWorkAvailable)
+{
+    within_strand_do([weak = weak_from_this(), onWorkAvailable = std::move(onWorkAvailable)]() mutable {
+        auto self = weak.lock();
+        if (!self)
+            return;
+
+        // Operations hold on to the shared function, replacing it reaches all of them.
+        *self->onWorkAvailable_ = std::move(onWorkAvailable);
+    });
+}
+
+void OperationQueue::enqueue(Ids::OperationId operationId, std::unique_ptr<Operation> operation)
+{
+    // Assumed in strand
+
+    operation->onWakeup([onWorkAvailable = onWorkAvailable_]() {
+        if (*onWorkAvailable)
+            (*onWorkAvailable)();
+    });
+    operation->onDelayedWakeup([weak = weak_from_this()](std::chrono::steady_clock::duration delay) {
+        if (auto self = weak.lock(); self)
+            self->scheduleWakeup(delay);
+    });
+    operations_.emplace_back(std::move(operationId), std::move(operation));
+}
+
+void OperationQueue::scheduleWakeup(std::chrono::steady_clock::duration delay)
+{
+    within_strand_do([weak = weak_from_this(), due = std::chrono::steady_clock::now() + delay]() {
+        auto self = weak.lock();
+        if (!self)
+            return;
+
+        if (self->wakeupScheduled_ && self->wakeupTimer_.expiry() <= due)
+            return;
+
+        // Rearming cancels the later wakeup.
+        self->wakeupScheduled_ = true;
+        self->wakeupTimer_.expires_at(due);
+        self->wakeupTimer_.async_wait(
+            boost::asio::bind_executor(*self->strand_, [weak](boost::system::error_code const& ec) {
+                if (ec)
+                    return;
+                auto self = weak.lock();
+                if (!self)
+                    return;
+                self->wakeupScheduled_ = false;
+                if (*self->onWorkAvailable_)
+                    (*self->onWorkAvailable_)();
+            }));
+    });
+}
+
+BandwidthLimiter OperationQueue::makeBandwidthLimiter()
+{
+    // Assumed in strand
+
+    auto operationBandwidth = std::make_shared<TokenBucket>(operationBandwidthLimit_);
+    std::erase_if(operationBandwidth_, [](auto const& bucket) {
+        return bucket.expired();
+    });
+    operationBandwidth_.push_back(operationBandwidth);
+    return BandwidthLimiter{{std::move(operationBandwidth), sessionBandwidth_, globalBandwidth_}};
+}
+
+void OperationQueue::bandwidthLimits(SharedData::BandwidthLimits const& limits)
+{
+    within_strand_do([weak = weak_from_this(), limits]() {
+        auto self = weak.lock();
+        if (!self)
+            return;
+
+        if (limits.operation)
+        {
+            self->operationBandwidthLimit_ = *limits.operation;
+            for (auto const& weakBucket : self->operationBandwidth_)
+            {
+                if (auto bucket = weakBucket.lock(); bucket)
+                    bucket->rate(*limits.operation);
+            }
+        }
+        if (limits.session)
+            self->sessionBandwidth_->rate(*limits.session);
+
+        Log::info(
+            "Bandwidth limits: operation={}, session={}, global={} bytes/s.",
+            self->operationBandwidthLimit_,
+            self->sessionBandwidth_->rate(),
+            self->globalBandwidth_->rate());
+
+        // Transfers waiting for the old limit continue right away.
+        if (*self->onWorkAvailable_)
+            (*self->onWorkAvailable_)();
+    });
+}
+
+void OperationQueue::globalBandwidthChanged()
+{
+    within_strand_do([weak = weak_from_this()]() {
+        auto self = weak.lock();
+        if (!self)
+            return;
+
+        // Transfers waiting for the old limit continue right away.
+        if (*self->onWorkAvailable_)
+            (*self->onWorkAvailable_)();
+    });
+}
+
+void OperationQueue::addTransferSession(std::weak_ptr<SecureShell::SftpSession> sftp)
+{
+    within_strand_do([weak = weak_from_this(), sftp = std::move(sftp)]() {
+        auto self = weak.lock();
+        if (!self)
+            return;
+
+        self->transferSessions_.push_back(sftp);
+        Log::info("Operation queue has {} transfer connections.", self->transferSessions_.size());
+    });
+}
+
+std::shared_ptr<SecureShell::SftpSession> OperationQueue::nextTransferSession()
+{
+    // Assumed in strand
+
+    std::erase_if(transferSessions_, [](auto const& sftp) {
+        return sftp.expired();
+    });
+    if (transferSessions_.empty())
+        return nullptr;
+
+    nextTransferSession_ = (nextTransferSession_ + 1) % transferSessions_.size();
+    return transferSessions_[nextTransferSession_].lock();
+}
+
+boost::asio::awaitable<std::expected<void, Operation::Error>> OperationQueue::addDownloadOperation(
+    SecureShell::SftpSession& channelSftp,
     Ids::OperationId operationId,
     std::filesystem::path const& localPath,
-    std::filesystem::path const& remotePath)
+    std::filesystem::path const& remotePath,
+    SharedData::TransferFilterOptions const& filter)
 {
     // Assumed in strand
 
-    auto fut = sftp.stat(remotePath);
-    if (fut.wait_for(sftpOpts_.operationTimeout) != std::future_status::ready)
-    {
-        Log::error("Failed to stat remote sftp file: timeout");
-        return std::unexpected(Operation::Error{.type = Operation::ErrorType::FutureTimeout});
-    }
+    const auto transferSession = nextTransferSession();
+    auto& sftp = transferSession ? *transferSession : channelSftp;
 
-    const auto result = fut.get();
+    const auto result = co_await sftp.asyncStat(remotePath, boost::asio::use_awaitable);
     if (!result.has_value())
     {
         Log::error("Failed to stat remote sftp file: {}", result.error().message);
-        return std::unexpected(Operation::Error{.type = Operation::ErrorType::SftpError, .sftpError = result.error()});
+        co_return std::unexpected(
+            Operation::Error{.type = Operation::ErrorType::SftpError, .sftpError = result.error()});
     }
 
     if (result->isRegularFile())
     {
         const auto fileSize = result->size;
 
-        auto fut = sftp.openFile(remotePath, SecureShell::SftpSession::OpenType::Read, std::filesystem::perms::unknown);
-        if (fut.wait_for(std::chrono::seconds{5}) != std::future_status::ready)
-        {
-            Log::error("Failed to open remote sftp file: timeout");
-            return std::unexpected(Operation::Error{.type = Operation::ErrorType::OpenFailure});
-        }
-
-        const auto openResult = fut.get();
+        auto openResult = co_await sftp.asyncOpenFile(
+            remotePath,
+            SecureShell::SftpSession::OpenType::Read,
+            std::filesystem::perms::unknown,
+            boost::asio::use_awaitable);
         if (!openResult.has_value())
         {
             Log::error("Failed to open remote sftp file: {}", openResult.error().message);
-            return std::unexpected(
+            co_return std::unexpected(
                 Operation::Error{.type = Operation::ErrorType::SftpError, .sftpError = openResult.error()});
         }
 
         const auto transferOptions = sftpOpts_.downloadOptions.value_or(Persistence::TransferOptions{});
         const auto defaultOptions = DownloadOperation::DownloadOperationOptions{};
+        const auto segmentThreshold = transferOptions.segmentThreshold.value_or(defaultOptions.segmentThreshold);
+
+        // Large files are read by several streams of the same file in parallel segments.
+        std::vector<std::weak_ptr<SecureShell::IFileStream>> segmentStreams{};
+        const auto segments = transferOptions.segments.value_or(1);
+        if (segments > 1 && fileSize >= segmentThreshold)
+        {
+            for (std::size_t i = 1; i < segments; ++i)
+            {
+                // Segments are spread over the transfer connections, each has its own socket and cipher state.
+                const auto segmentSession = nextTransferSession();
+                auto& segmentSftp = segmentSession ? *segmentSession : sftp;
+                auto segmentStream = co_await segmentSftp.asyncOpenFile(
+                    remotePath,
+                    SecureShell::SftpSession::OpenType::Read,
+                    std::filesystem::perms::unknown,
+                    boost::asio::use_awaitable);
+                if (!segmentStream.has_value())
+                {
+                    Log::warn(
+                        "Failed to open segment stream, downloading with {} streams: {}",
+                        i,
+                        segmentStream.error().message);
+                    break;
+                }
+                segmentStreams.push_back(std::move(segmentStream).value());
+            }
+        }
 
         auto operation = std::make_unique<DownloadOperation>(
             std::move(openResult).value(),
@@ -260,20 +598,14 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                         if (!self)
                             return;
 
-                        self->hub_->callRemote(
-                            fmt::format("OperationQueue::{}::onDownloadProgress", self->sessionId_.value()),
+                        self->reportProgress(
+                            &SharedData::ProgressBatch::downloads,
                             SharedData::DownloadProgress{
                                 .operationId = operationId,
                                 .min = min,
                                 .max = max,
                                 .current = current,
                             });
-
-                        Log::debug(
-                            "Downloaded {} / {} bytes ({}%)",
-                            current - min,
-                            max - min,
-                            (current - min) * 100 / (max - min));
                     },
                 .remotePath = remotePath,
                 .localPath = localPath,
@@ -285,9 +617,14 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                 .doCleanup = transferOptions.doCleanup.value_or(defaultOptions.doCleanup),
                 .permissions =
                     transferOptions.customPermissions ? transferOptions.customPermissions : defaultOptions.permissions,
+                .readsInFlight = transferOptions.readsInFlight.value_or(defaultOptions.readsInFlight),
+                .segmentStreams = std::move(segmentStreams),
+                .segmentThreshold = segmentThreshold,
+                .writePool = writePool_,
+                .bandwidthLimiter = makeBandwidthLimiter(),
             });
 
-        operations_.emplace_back(operationId, std::move(operation));
+        enqueue(operationId, std::move(operation));
 
         Log::info("Calling OperationQueue::{}::onOperationAdded", sessionId_.value());
         hub_->callRemote(
@@ -299,7 +636,7 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                 .localPath = localPath,
                 .remotePath = remotePath});
 
-        return {};
+        co_return std::expected<void, Operation::Error>{};
     }
     else if (result->isDirectory())
     {
@@ -312,8 +649,8 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                         if (!self)
                             return;
 
-                        self->hub_->callRemote(
-                            fmt::format("OperationQueue::{}::onScanProgress", self->sessionId_.value()),
+                        self->reportProgress(
+                            &SharedData::ProgressBatch::scans,
                             SharedData::ScanProgress{
                                 .operationId = operationId,
                                 .totalBytes = totalBytes,
@@ -323,10 +660,19 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                     },
                 .remotePath = remotePath,
                 .futureTimeout = std::chrono::seconds{5},
+                .concurrency = sftpOpts_.scanConcurrency.value_or(ScanOperation::ScanOperationOptions{}.concurrency),
+                .useFind = sftpOpts_.scanWithFind.value_or(false),
+                .filter = filter,
             });
 
         // Cant use same ID for scan and bulk download
         const auto bulkId = Ids::generateOperationId();
+        std::vector<std::weak_ptr<SecureShell::ISftpSession>> fileSessions{};
+        for (auto const& weak : transferSessions_)
+        {
+            if (auto session = weak.lock(); session && session.get() != &sftp)
+                fileSessions.push_back(session);
+        }
         auto bulk = std::make_unique<BulkDownloadOperation>(
             sftp,
             BulkDownloadOperation::BulkDownloadOperationOptions{
@@ -352,8 +698,8 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                         //     bytesCurrent,
                         //     bytesTotal);
 
-                        self->hub_->callRemote(
-                            fmt::format("OperationQueue::{}::onBulkDownloadProgress", self->sessionId_.value()),
+                        self->reportProgress(
+                            &SharedData::ProgressBatch::bulkDownloads,
                             SharedData::BulkDownloadProgress{
                                 .operationId = bulkId,
                                 .currentFile = currentFile.string(),
@@ -370,11 +716,18 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                 .individualOptions =
                     DownloadOperation::DownloadOperationOptions{
                         // TODO: Not just defaults.
+                        .writePool = writePool_,
+                        .bandwidthLimiter = makeBandwidthLimiter(),
                     },
+                // The archive would contain the whole tree, not just what the filter left in the scan:
+                .asArchive = sftpOpts_.archiveDirectoryDownloads.value_or(false) && filter.empty(),
+                .scanResult = scan->result(),
+                .concurrency = static_cast<std::size_t>(std::max(sftpOpts_.concurrency.value_or(1), 1)),
+                .fileSessions = fileSessions,
             });
 
-        operations_.emplace_back(operationId, std::move(scan));
-        operations_.emplace_back(bulkId, std::move(bulk));
+        enqueue(operationId, std::move(scan));
+        enqueue(bulkId, std::move(bulk));
 
         hub_->callRemote(
             fmt::format("OperationQueue::{}::{}", sessionId_.value(), "onOperationAdded"),
@@ -392,13 +745,85 @@ std::expected<void, Operation::Error> OperationQueue::addDownloadOperation(
                 .remotePath = remotePath,
             });
 
-        return {};
+        co_return std::expected<void, Operation::Error>{};
     }
     else
     {
         Log::error("Remote path is neither a file nor a directory: {}.", static_cast<std::uint8_t>(result->type));
-        return std::unexpected(Operation::Error{.type = Operation::ErrorType::OperationNotPossibleOnFileType});
+        co_return std::unexpected(Operation::Error{.type = Operation::ErrorType::OperationNotPossibleOnFileType});
+    }
+}
+
+boost::asio::awaitable<std::expected<void, Operation::Error>> OperationQueue::addUploadOperation(
+    SecureShell::SftpSession& channelSftp,
+    Ids::OperationId operationId,
+    std::filesystem::path const& localPath,
+    std::filesystem::path const& remotePath)
+{
+    // Assumed in strand
+
+    const auto transferSession = nextTransferSession();
+    auto& sftp = transferSession ? *transferSession : channelSftp;
+
+    std::error_code ec{};
+    if (!std::filesystem::is_regular_file(localPath, ec))
+    {
+        Log::error("Local path is not a file: {}.", localPath.generic_string());
+        co_return std::unexpected(Operation::Error{.type = Operation::ErrorType::OperationNotPossibleOnFileType});
     }
+    const auto fileSize = std::filesystem::file_size(localPath, ec);
+    if (ec)
+    {
+        Log::error("Failed to stat local file: {}", ec.message());
+        co_return std::unexpected(Operation::Error{.type = Operation::ErrorType::FileStatFailed});
+    }
+
+    const auto transferOptions = sftpOpts_.uploadOptions.value_or(Persistence::TransferOptions{});
+    const auto defaultOptions = UploadOperation::UploadOperationOptions{};
+
+    auto operation = std::make_unique<UploadOperation>(
+        sftp,
+        UploadOperation::UploadOperationOptions{
+            .progressCallback =
+                [weak = weak_from_this(), operationId](auto min, auto max, auto current) {
+                    auto self = weak.lock();
+                    if (!self)
+                        return;
+
+                    self->reportProgress(
+                        &SharedData::ProgressBatch::uploads,
+                        SharedData::UploadProgress{
+                            .operationId = operationId,
+                            .min = min,
+                            .max = max,
+                            .current = current,
+                        });
+                },
+            .localPath = localPath,
+            .remotePath = remotePath,
+            .tempFileSuffix = transferOptions.tempFileSuffix.value_or(defaultOptions.tempFileSuffix),
+            .mayOverwrite = transferOptions.mayOverwrite.value_or(defaultOptions.mayOverwrite),
+            .tryContinue = transferOptions.tryContinue.value_or(defaultOptions.tryContinue),
+            .inheritPermissions = transferOptions.inheritPermissions.value_or(defaultOptions.inheritPermissions),
+            .doCleanup = transferOptions.doCleanup.value_or(defaultOptions.doCleanup),
+            .permissions =
+                transferOptions.customPermissions ? transferOptions.customPermissions : defaultOptions.permissions,
+            .writesInFlight = transferOptions.writesInFlight.value_or(defaultOptions.writesInFlight),
+            .bandwidthLimiter = makeBandwidthLimiter(),
+        });
+
+    enqueue(operationId, std::move(operation));
+
+    hub_->callRemote(
+        fmt::format("OperationQueue::{}::onOperationAdded", sessionId_.value()),
+        SharedData::OperationAdded{
+            .operationId = operationId,
+            .type = SharedData::OperationType::Upload,
+            .totalBytes = fileSize,
+            .localPath = localPath,
+            .remotePath = remotePath});
+
+    co_return std::expected<void, Operation::Error>{};
 }
 
 void OperationQueue::registerRpc()
@@ -415,6 +840,16 @@ void OperationQueue::registerRpc()
                 }});
         });
 
+    on(fmt::format("OperationQueue::{}::setBandwidthLimits", sessionId_.value()))
+        .perform([weak = weak_from_this()](RpcHelper::RpcOnce&& reply, SharedData::BandwidthLimits limits) {
+            auto self = weak.lock();
+            if (!self)
+                return reply(SharedData::error("OperationQueue no longer exists"));
+
+            self->bandwidthLimits(limits);
+            return reply(SharedData::success());
+        });
+
     on(fmt::format("OperationQueue::{}::cancel", sessionId_.value()))
         .perform([weak = weak_from_this()](RpcHelper::RpcOnce&& reply, Ids::OperationId operationId) {
             auto self = weak.lock();
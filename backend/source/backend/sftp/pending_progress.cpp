@@ -0,0 +1,16 @@
+#include <backend/sftp/pending_progress.hpp>
+
+SharedData::ProgressBatch PendingProgress::take()
+{
+    std::scoped_lock lock{mutex_};
+    scheduled_ = false;
+    return std::exchange(pending_, SharedData::ProgressBatch{});
+}
+
+SharedData::ProgressBatch PendingProgress::complete(Ids::OperationId const& operationId)
+{
+    std::scoped_lock lock{mutex_};
+    completed_.insert(operationId);
+    scheduled_ = false;
+    return std::exchange(pending_, SharedData::ProgressBatch{});
+}
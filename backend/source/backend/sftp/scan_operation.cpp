@@ -1,36 +1,292 @@
 #include <backend/sftp/scan_operation.hpp>
 #include <log/log.hpp>
 
+#include <ssh/channel.hpp>
+#include <ssh/session.hpp>
 #include <ssh/sftp_session.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string_view>
+
 ScanOperation::ScanOperation(SecureShell::SftpSession& sftp, ScanOperationOptions options)
     : sftp_(&sftp)
     , remotePath_{std::move(options.remotePath)}
     , progressCallback_{std::move(options.progressCallback)}
     , futureTimeout_{options.futureTimeout}
+    , result_{std::make_shared<ScanResult>(ScanResult{.entries = SharedData::DirectoryEntryStore{remotePath_}})}
+    , currentIndex_{0}
+    , concurrency_{std::max(options.concurrency, std::size_t{1})}
+    , nextRequestIndex_{0}
+    , useFind_{options.useFind}
+    , findParser_{std::nullopt}
+    , findDirectories_{}
+    , filter_{
+          options.filter,
+          static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                         std::chrono::system_clock::now().time_since_epoch())
+                                         .count())}
 {}
 
-ScanOperation::~ScanOperation() = default;
+ScanOperation::~ScanOperation()
+{
+    closeChannel();
+    if (result_->state == ScanResult::State::Scanning)
+        result_->state = ScanResult::State::Aborted;
+}
+
+std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::walkOnce()
+{
+    if (!pendingListing_.inFlight())
+        sftp_->asyncListDirectory(result_->entries.fullPath(currentIndex_), pendingListing_.expect(wakeup_));
+
+    auto listing = pendingListing_.take();
+    if (!listing)
+        return WorkStatus::Waiting;
+
+    if (!listing->has_value())
+    {
+        Log::error("ScanOperation: Failed to scan directory: {}", listing->error().message);
+        return enterErrorState<WorkStatus>({.type = ErrorType::SftpError, .sftpError = listing->error()});
+    }
+
+    addListing(listing->value());
+    // -1, because the entries include the base/root dir of the search:
+    progressCallback_(result_->totalBytes, currentIndex_, result_->entries.size() - 1);
+    return WorkStatus::MoreWork;
+}
+
+std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::startConcurrentWalk()
+{
+    // The sftp session of libssh waits for every reply, so the listings get a channel of their own:
+    sftp_->session().asyncCreateSubsystemChannel("sftp", pendingChannel_.expect(wakeup_));
+    state_ = OperationState::Preparing;
+    return WorkStatus::Waiting;
+}
+
+std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::walkConcurrently()
+{
+    const auto channelEnded = channelOutput_.take(receivedOutput_).has_value();
+    for (auto const& output : receivedOutput_)
+    {
+        if (auto result = lister_->receive(output); !result)
+            return fallBackToWalkOnce(result.error().message);
+    }
+    receivedOutput_.clear();
+
+    for (auto& [index, listing] : lister_->takeListings())
+        arrivedListings_.emplace(static_cast<std::size_t>(index), std::move(listing));
+
+    bool added = false;
+    for (auto iter = arrivedListings_.find(currentIndex_); iter != arrivedListings_.end();
+         iter = arrivedListings_.find(currentIndex_))
+    {
+        if (!iter->second.has_value())
+        {
+            Log::error(
+                "ScanOperation: Failed to scan directory '{}': {}",
+                result_->entries.fullPath(currentIndex_).generic_string(),
+                iter->second.error().message);
+            return enterErrorState<WorkStatus>({.type = ErrorType::SftpError, .sftpError = iter->second.error()});
+        }
+
+        const auto listing = std::move(iter->second).value();
+        arrivedListings_.erase(iter);
+        addListing(listing);
+        added = true;
+    }
+    if (added)
+        progressCallback_(result_->totalBytes, currentIndex_, result_->entries.size() - 1);
+
+    if (completed())
+        return WorkStatus::MoreWork;
+    if (channelEnded)
+        return fallBackToWalkOnce("The channel closed");
+
+    // Listings that arrived out of order count too, so a slow directory does not make them pile up:
+    auto const& entries = result_->entries;
+    nextRequestIndex_ = std::max(nextRequestIndex_, currentIndex_);
+    for (; nextRequestIndex_ < entries.size() && lister_->pending() + arrivedListings_.size() < concurrency_;
+         ++nextRequestIndex_)
+    {
+        if (entries.isDirectory(nextRequestIndex_))
+            lister_->list(nextRequestIndex_, entries.fullPath(nextRequestIndex_).generic_string());
+    }
+
+    return added ? WorkStatus::MoreWork : WorkStatus::Waiting;
+}
+
+std::expected<ScanOperation::WorkStatus, ScanOperation::Error>
+ScanOperation::fallBackToWalkOnce(std::string const& reason)
+{
+    Log::warn("ScanOperation: Cannot list directories concurrently, listing one after another: {}", reason);
+    closeChannel();
+    lister_.reset();
+    arrivedListings_.clear();
+    state_ = OperationState::Running;
+    return WorkStatus::MoreWork;
+}
+
+std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::startFind()
+{
+    findParser_.emplace();
+    findDirectories_ = {{std::string{}, 0}};
+    // Excluded directories are not even walked by find, where that is certain from their name alone:
+    sftp_->session().asyncCreateExecChannel(
+        FindListingParser::command(remotePath_, filter_.excludedDirectoryNames()), pendingChannel_.expect(wakeup_));
+    state_ = OperationState::Preparing;
+    return WorkStatus::Waiting;
+}
+
+std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::listWithFind()
+{
+    const auto channelEnded = channelOutput_.take(receivedOutput_).has_value();
+    for (auto const& output : receivedOutput_)
+    {
+        if (auto fed = findParser_->feed(output); !fed)
+        {
+            if (!findParser_->started())
+                return fallBackFromFind(fed.error());
+
+            Log::error("ScanOperation: Failed to read the output of find: {}", fed.error());
+            return enterErrorState<WorkStatus>({.type = ErrorType::RemoteCommandFailed, .extraInfo = fed.error()});
+        }
+    }
+    receivedOutput_.clear();
+
+    auto found = findParser_->takeEntries();
+    if (auto added = addFoundEntries(found); !added)
+        return enterErrorState<WorkStatus>(added.error());
+    if (!found.empty())
+        progressCallback_(result_->totalBytes, result_->entries.size() - 1, result_->entries.size() - 1);
 
-std::expected<std::vector<SharedData::DirectoryEntry>, ScanOperation::Error>
-ScanOperation::scanner(std::filesystem::path const& path)
+    if (const auto status = findParser_->exitStatus(); status)
+    {
+        closeChannel();
+        if (*status != 0)
+        {
+            // Like listing over sftp, a directory that cannot be read fails the scan:
+            Log::error("ScanOperation: Find failed with exit status {}.", *status);
+            return enterErrorState<WorkStatus>(
+                {.type = ErrorType::RemoteCommandFailed,
+                 .extraInfo = fmt::format("Find exited with status {}", *status)});
+        }
+        // Everything is listed, no directory is left to walk:
+        currentIndex_ = result_->entries.size();
+        return WorkStatus::MoreWork;
+    }
+
+    if (channelEnded)
+    {
+        if (!findParser_->started())
+            return fallBackFromFind("The remote has no GNU find");
+
+        Log::error("ScanOperation: The output of find ended early.");
+        return enterErrorState<WorkStatus>(
+            {.type = ErrorType::RemoteCommandFailed, .extraInfo = "The output of find ended early"});
+    }
+    return found.empty() ? WorkStatus::Waiting : WorkStatus::MoreWork;
+}
+
+std::expected<ScanOperation::WorkStatus, ScanOperation::Error>
+ScanOperation::fallBackFromFind(std::string const& reason)
 {
-    auto fut = sftp_->listDirectory(path);
-    fut.wait_for(futureTimeout_);
-    if (fut.wait_for(futureTimeout_) != std::future_status::ready)
-        return enterErrorState<std::vector<SharedData::DirectoryEntry>>({.type = ErrorType::FutureTimeout});
+    Log::warn("ScanOperation: Cannot list the tree with find, listing over sftp: {}", reason);
+    closeChannel();
+    findParser_.reset();
+    findDirectories_.clear();
+    if (concurrency_ > 1)
+        return startConcurrentWalk();
+    state_ = OperationState::Running;
+    return WorkStatus::MoreWork;
+}
 
-    auto result = fut.get();
-    if (!result.has_value())
-        return enterErrorState<std::vector<SharedData::DirectoryEntry>>(
-            {.type = ErrorType::SftpError, .sftpError = result.error()});
+std::expected<void, ScanOperation::Error>
+ScanOperation::addFoundEntries(std::vector<SharedData::DirectoryEntry>& found)
+{
+    auto& entries = result_->entries;
+    for (auto& entry : found)
+    {
+        auto relativePath = entry.path.generic_string();
+        const auto slash = relativePath.rfind('/');
+        const auto parentPath =
+            slash == std::string::npos ? std::string_view{} : std::string_view{relativePath}.substr(0, slash);
+
+        while (!findDirectories_.empty() && findDirectories_.back().first != parentPath)
+            findDirectories_.pop_back();
+        if (findDirectories_.empty())
+        {
+            Log::error("ScanOperation: Find listed '{}' apart from its directory.", relativePath);
+            return std::unexpected(Error{
+                .type = ErrorType::RemoteCommandFailed,
+                .extraInfo = fmt::format("Find listed '{}' apart from its directory", relativePath)});
+        }
 
-    return {std::move(result).value()};
+        // What is inside an excluded directory is excluded too:
+        const auto parent = findDirectories_.back().second;
+        if (!parent || filter_.excludes(relativePath, entry))
+        {
+            if (entry.isDirectory())
+                findDirectories_.emplace_back(std::move(relativePath), std::nullopt);
+            continue;
+        }
+
+        // The store keeps names, the path follows from the parent:
+        entry.path = relativePath.substr(slash + 1);
+        const auto index = entries.add(entry, *parent);
+        if (entry.isDirectory())
+            findDirectories_.emplace_back(std::move(relativePath), index);
+        else if (entry.isRegularFile())
+            result_->totalBytes += entry.size;
+    }
+    return {};
 }
 
-std::uint64_t ScanOperation::totalBytes() const
+void ScanOperation::closeChannel()
 {
-    return walker_->totalBytes();
+    channelOutput_.stop();
+    if (auto channel = channel_.lock(); channel)
+        channel->close();
+    channel_.reset();
+}
+
+void ScanOperation::addListing(std::vector<SecureShell::FileInformation> const& listing)
+{
+    auto& entries = result_->entries;
+
+    // The relative path of the entries is only built for the filter:
+    std::string path{};
+    if (!filter_.empty())
+    {
+        path = entries.relativePath(currentIndex_);
+        if (!path.empty())
+            path += '/';
+    }
+    const auto prefixLength = path.size();
+
+    for (auto const& entry : listing)
+    {
+        if (entry.path == "." || entry.path == "..")
+            continue;
+        if (!filter_.empty())
+        {
+            path.resize(prefixLength);
+            path += entry.path.generic_string();
+            // Excluded directories are never added, so they are not listed either:
+            if (filter_.excludes(path, entry))
+                continue;
+        }
+        entries.add(entry, currentIndex_);
+        // Counted right away, so the download behind the scan sees the total grow with every listing:
+        if (entry.isRegularFile())
+            result_->totalBytes += entry.size;
+    }
+
+    // Only directories are listed, everything in between is done with:
+    ++currentIndex_;
+    while (currentIndex_ < entries.size() && !entries.isDirectory(currentIndex_))
+        ++currentIndex_;
 }
 
 std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::work()
@@ -44,31 +300,78 @@ std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::wo
             state_ = Running;
             Log::info("ScanOperation: Starting scan of '{}'.", remotePath_.generic_string());
             progressCallback_(0, 0, 0);
+            if (useFind_)
+                return startFind();
+            if (concurrency_ > 1)
+                return startConcurrentWalk();
             return WorkStatus::MoreWork;
         }
-        case (Running):
+        case (Preparing):
         {
-            return withWalkerDo([this](auto& walker) -> std::expected<ScanOperation::WorkStatus, ScanOperation::Error> {
-                if (walker.completed())
-                {
-                    Log::info("ScanOperation: Scan of '{}' completed.", remotePath_.generic_string());
-                    state_ = Completed;
-                    return WorkStatus::Complete;
-                }
-
-                auto result = walker.walk();
-                if (!result.has_value())
-                {
-                    Log::error("ScanOperation: Failed to scan directory: {}", result.error().toString());
-                    return enterErrorState<WorkStatus>(result.error());
-                }
-                // -1, because the walker includes the base/root dir of the search:
-                progressCallback_(walker.totalBytes(), walker.currentIndex(), walker.totalEntries() - 1);
-                return WorkStatus::MoreWork;
+            auto channelResult = pendingChannel_.take();
+            if (!channelResult)
+                return WorkStatus::Waiting;
+            if (!channelResult->has_value())
+            {
+                return findParser_ ? fallBackFromFind(channelResult->error().message)
+                                   : fallBackToWalkOnce(channelResult->error().message);
+            }
+
+            channel_ = std::move(*channelResult).value();
+            auto channel = channel_.lock();
+            if (!channel)
+            {
+                return findParser_ ? fallBackFromFind("The channel closed right away")
+                                   : fallBackToWalkOnce("The channel closed right away");
+            }
+
+            auto [onChunk, onComplete] = channelOutput_.expect(wakeup_);
+            channel->startReading(
+                [onChunk = std::move(onChunk)](std::string const& data) {
+                    onChunk(data);
+                },
+                [remote = findParser_ ? "find" : "sftp server"](std::string const& data) {
+                    Log::warn("ScanOperation: Remote {}: {}", remote, data);
+                },
+                // The channel keeps reporting its end until it is closed:
+                [onComplete = std::move(onComplete), ended = std::make_shared<std::atomic_bool>(false)]() {
+                    if (!ended->exchange(true))
+                        onComplete(std::size_t{0});
+                });
+
+            state_ = Running;
+            if (findParser_)
+                return listWithFind();
+
+            lister_.emplace([weakChannel = channel_](std::string data) {
+                if (auto channel = weakChannel.lock(); channel)
+                    channel->write(std::move(data));
             });
+            lister_->start();
+            return walkConcurrently();
+        }
+        case (Running):
+        {
+            if (completed())
+            {
+                closeChannel();
+                Log::info(
+                    "ScanOperation: Scan of '{}' completed, {} entries, {} bytes of memory.",
+                    remotePath_.generic_string(),
+                    result_->entries.size(),
+                    result_->entries.memoryUsage());
+                state_ = Completed;
+                result_->state = ScanResult::State::Complete;
+                return WorkStatus::Complete;
+            }
+
+            if (findParser_)
+                return listWithFind();
+            if (lister_)
+                return walkConcurrently();
+            return walkOnce();
         }
         case (Prepared):
-        case (Preparing):
         case (Finalizing):
             Log::error("ScanOperation: Invalid state: {}", static_cast<int>(state_));
             return enterErrorState<WorkStatus>({.type = ErrorType::InvalidOperationState});
@@ -95,6 +398,9 @@ std::expected<ScanOperation::WorkStatus, ScanOperation::Error> ScanOperation::wo
 
 std::expected<void, ScanOperation::Error> ScanOperation::cancel(bool adoptCancelState)
 {
+    closeChannel();
+    if (result_->state == ScanResult::State::Scanning)
+        result_->state = ScanResult::State::Aborted;
     if (adoptCancelState)
     {
         Log::info("ScanOperation: Scan of '{}' canceled.", remotePath_.generic_string());
@@ -0,0 +1,398 @@
+#include <backend/sftp/tar_extractor.hpp>
+
+#include <log/log.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <charconv>
+#include <system_error>
+#include <utility>
+
+namespace
+{
+    constexpr std::size_t maxMetadataSize{1024 * 1024};
+
+    std::string field(char const* data, std::size_t length)
+    {
+        return std::string{data, std::find(data, data + length, '\0')};
+    }
+
+    std::optional<std::uint64_t> number(char const* data, std::size_t length)
+    {
+        // GNU tar stores sizes beyond the octal range as big endian binary, flagged by the highest bit:
+        if (static_cast<unsigned char>(data[0]) & 0x80)
+        {
+            std::uint64_t value = static_cast<unsigned char>(data[0]) & 0x7f;
+            for (std::size_t i = 1; i < length; ++i)
+                value = (value << 8) | static_cast<unsigned char>(data[i]);
+            return value;
+        }
+
+        auto const* begin = data;
+        auto const* end = data + length;
+        while (begin != end && *begin == ' ')
+            ++begin;
+        end = std::find_if(begin, end, [](char c) {
+            return c == '\0' || c == ' ';
+        });
+        if (begin == end)
+            return 0;
+
+        std::uint64_t value = 0;
+        const auto [ptr, ec] = std::from_chars(begin, end, value, 8);
+        if (ec != std::errc{} || ptr != end)
+            return std::nullopt;
+        return value;
+    }
+
+    bool checksumMatches(std::array<char, 512> const& header)
+    {
+        const auto expected = number(header.data() + 148, 8);
+        if (!expected)
+            return false;
+
+        // The checksum is computed with its own field filled with spaces. Old implementations summed signed chars.
+        std::uint64_t unsignedSum = 0;
+        std::int64_t signedSum = 0;
+        for (std::size_t i = 0; i < header.size(); ++i)
+        {
+            const bool inChecksum = i >= 148 && i < 156;
+            unsignedSum += inChecksum ? ' ' : static_cast<unsigned char>(header[i]);
+            signedSum += inChecksum ? ' ' : static_cast<signed char>(header[i]);
+        }
+        return *expected == unsignedSum || static_cast<std::int64_t>(*expected) == signedSum;
+    }
+}
+
+TarExtractor::TarExtractor(std::filesystem::path root, Options options)
+    : root_{std::move(root)}
+    , options_{options}
+{}
+
+TarExtractor::~TarExtractor() = default;
+
+std::expected<void, std::string> TarExtractor::feed(std::string_view data)
+{
+    while (!data.empty() && !finished_)
+    {
+        if (remaining_ > 0)
+        {
+            const auto part = data.substr(0, static_cast<std::size_t>(std::min<std::uint64_t>(remaining_, data.size())));
+            data.remove_prefix(part.size());
+            remaining_ -= part.size();
+            if (auto result = onData(part); !result)
+                return result;
+            if (remaining_ == 0)
+            {
+                if (auto result = onEntryEnd(); !result)
+                    return result;
+            }
+            continue;
+        }
+
+        if (padding_ > 0)
+        {
+            const auto skipped = static_cast<std::size_t>(std::min<std::uint64_t>(padding_, data.size()));
+            data.remove_prefix(skipped);
+            padding_ -= skipped;
+            continue;
+        }
+
+        const auto part = std::min(blockSize - headerFill_, data.size());
+        std::copy_n(data.data(), part, header_.data() + headerFill_);
+        data.remove_prefix(part);
+        headerFill_ += part;
+        if (headerFill_ == blockSize)
+        {
+            headerFill_ = 0;
+            if (auto result = onHeader(); !result)
+                return result;
+        }
+    }
+    return {};
+}
+
+std::expected<void, std::string> TarExtractor::onHeader()
+{
+    if (std::all_of(header_.begin(), header_.end(), [](char c) {
+            return c == '\0';
+        }))
+    {
+        // The archive ends with two zero blocks:
+        if (++zeroBlocks_ == 2)
+            finished_ = true;
+        return {};
+    }
+    zeroBlocks_ = 0;
+
+    if (!checksumMatches(header_))
+        return std::unexpected(std::string{"Corrupt tar header, the checksum does not match"});
+
+    const char typeFlag = header_[156];
+
+    std::string name{};
+    if (nextName_)
+        name = *std::exchange(nextName_, std::nullopt);
+    else
+    {
+        name = field(header_.data(), 100);
+        // Only POSIX ustar and pax headers have a prefix, GNU headers ("ustar  \0") keep times there:
+        const bool ustar = std::string_view{header_.data() + 257, 6} == std::string_view{"ustar\0", 6};
+        if (ustar)
+        {
+            const auto prefix = field(header_.data() + 345, 155);
+            if (!prefix.empty())
+                name = prefix + "/" + name;
+        }
+    }
+
+    std::string linkName{};
+    if (nextLinkName_)
+        linkName = *std::exchange(nextLinkName_, std::nullopt);
+    else
+        linkName = field(header_.data() + 157, 100);
+
+    std::optional<std::uint64_t> size{};
+    if (nextSize_)
+        size = std::exchange(nextSize_, std::nullopt);
+    else
+        size = number(header_.data() + 124, 12);
+    const auto mode = number(header_.data() + 100, 8);
+    if (!size || !mode)
+        return std::unexpected(fmt::format("Corrupt tar header of '{}'", name));
+
+    switch (typeFlag)
+    {
+        case 'L':
+            beginData(Target::LongName, *size);
+            break;
+        case 'K':
+            beginData(Target::LongLinkName, *size);
+            break;
+        case 'x':
+            beginData(Target::PaxHeader, *size);
+            break;
+        case 'g':
+            // Global pax headers carry nothing needed here.
+            beginData(Target::Discard, *size);
+            break;
+        case '0':
+        case '\0':
+        case '7':
+        case '5':
+        {
+            auto path = localPath(name);
+            if (!path)
+                return std::unexpected(path.error());
+
+            currentPath_ = *path;
+            if (typeFlag == '5' || name.ends_with('/'))
+            {
+                std::error_code ec;
+                std::filesystem::create_directories(*path, ec);
+                if (ec)
+                    return std::unexpected(fmt::format("Creating local directory '{}': {}", path->string(), ec.message()));
+                ++entriesExtracted_;
+                beginData(Target::Discard, *size);
+                break;
+            }
+
+            if (!options_.mayOverwrite && std::filesystem::exists(*path))
+                return std::unexpected(fmt::format("Local file already exists: '{}'", path->string()));
+
+            std::error_code ec;
+            std::filesystem::create_directories(path->parent_path(), ec);
+            if (ec)
+            {
+                return std::unexpected(
+                    fmt::format("Creating local directory '{}': {}", path->parent_path().string(), ec.message()));
+            }
+
+            file_.open(*path, std::ios::binary | std::ios::trunc);
+            if (!file_.is_open())
+                return std::unexpected(fmt::format("Failed to open local file '{}'", path->string()));
+
+            currentFileBytes_ = 0;
+            currentFileSize_ = *size;
+            filePermissions_ = std::nullopt;
+            if (options_.keepPermissions)
+                filePermissions_ = static_cast<std::filesystem::perms>(*mode) & std::filesystem::perms::all;
+            beginData(Target::File, *size);
+            break;
+        }
+        case '1':
+        {
+            // A hard link to a file earlier in the archive, extracted as a copy of it.
+            auto path = localPath(name);
+            if (!path)
+                return std::unexpected(path.error());
+            auto target = localPath(linkName);
+            if (!target)
+                return std::unexpected(target.error());
+
+            if (!options_.mayOverwrite && std::filesystem::exists(*path))
+                return std::unexpected(fmt::format("Local file already exists: '{}'", path->string()));
+
+            std::error_code ec;
+            std::filesystem::copy_file(*target, *path, std::filesystem::copy_options::overwrite_existing, ec);
+            if (ec)
+                return std::unexpected(fmt::format("Copying hard link '{}': {}", path->string(), ec.message()));
+            currentPath_ = *path;
+            ++entriesExtracted_;
+            beginData(Target::Discard, *size);
+            break;
+        }
+        case '2':
+        {
+            Log::warn("TarExtractor: Symlinks are not yet supported, skipping: {}.", name);
+            beginData(Target::Discard, *size);
+            break;
+        }
+        default:
+        {
+            Log::warn("TarExtractor: Skipping unsupported entry type '{}' of: {}.", typeFlag, name);
+            beginData(Target::Discard, *size);
+            break;
+        }
+    }
+
+    if (remaining_ == 0)
+        return onEntryEnd();
+    return {};
+}
+
+void TarExtractor::beginData(Target target, std::uint64_t size)
+{
+    target_ = target;
+    remaining_ = size;
+    padding_ = (blockSize - size % blockSize) % blockSize;
+    metadata_.clear();
+}
+
+std::expected<void, std::string> TarExtractor::onData(std::string_view data)
+{
+    switch (target_)
+    {
+        case Target::File:
+        {
+            file_.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!file_.good())
+                return std::unexpected(fmt::format("Failed to write to local file '{}'", currentPath_.string()));
+            currentFileBytes_ += data.size();
+            bytesExtracted_ += data.size();
+            return {};
+        }
+        case Target::LongName:
+        case Target::LongLinkName:
+        case Target::PaxHeader:
+        {
+            if (metadata_.size() + data.size() > maxMetadataSize)
+                return std::unexpected(std::string{"Tar metadata entry is unreasonably large"});
+            metadata_.append(data);
+            return {};
+        }
+        case Target::Discard:
+            return {};
+    }
+    return {};
+}
+
+std::expected<void, std::string> TarExtractor::onEntryEnd()
+{
+    switch (target_)
+    {
+        case Target::File:
+        {
+            file_.close();
+            if (file_.fail())
+                return std::unexpected(fmt::format("Failed to write to local file '{}'", currentPath_.string()));
+            if (filePermissions_)
+            {
+                std::error_code ec;
+                std::filesystem::permissions(currentPath_, *filePermissions_, ec);
+                if (ec)
+                    Log::warn("TarExtractor: Failed to set permissions of '{}': {}", currentPath_.string(), ec.message());
+            }
+            ++entriesExtracted_;
+            break;
+        }
+        case Target::LongName:
+            nextName_ = field(metadata_.data(), metadata_.size());
+            break;
+        case Target::LongLinkName:
+            nextLinkName_ = field(metadata_.data(), metadata_.size());
+            break;
+        case Target::PaxHeader:
+            parsePaxHeader();
+            break;
+        case Target::Discard:
+            break;
+    }
+    target_ = Target::Discard;
+    return {};
+}
+
+void TarExtractor::parsePaxHeader()
+{
+    // Records look like "<length> <key>=<value>\n", the length counting the whole record.
+    std::string_view records{metadata_};
+    while (!records.empty())
+    {
+        std::size_t length = 0;
+        const auto [ptr, ec] = std::from_chars(records.data(), records.data() + records.size(), length);
+        const auto digits = static_cast<std::size_t>(ptr - records.data());
+        if (ec != std::errc{} || length <= digits + 1 || length > records.size() || *ptr != ' ')
+        {
+            Log::warn("TarExtractor: Ignoring malformed pax header.");
+            return;
+        }
+
+        auto record = records.substr(digits + 1, length - digits - 1);
+        records.remove_prefix(length);
+        if (record.ends_with('\n'))
+            record.remove_suffix(1);
+
+        const auto equals = record.find('=');
+        if (equals == std::string_view::npos)
+            continue;
+        const auto key = record.substr(0, equals);
+        const auto value = record.substr(equals + 1);
+
+        if (key == "path")
+            nextName_ = std::string{value};
+        else if (key == "linkpath")
+            nextLinkName_ = std::string{value};
+        else if (key == "size")
+        {
+            std::uint64_t size = 0;
+            if (std::from_chars(value.data(), value.data() + value.size(), size).ec == std::errc{})
+                nextSize_ = size;
+        }
+    }
+}
+
+std::expected<std::filesystem::path, std::string> TarExtractor::localPath(std::string const& name) const
+{
+    std::filesystem::path relative{};
+    std::string_view rest{name};
+    while (!rest.empty())
+    {
+        const auto slash = rest.find('/');
+        const auto component = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view{} : rest.substr(slash + 1);
+        if (component.empty() || component == ".")
+            continue;
+
+        // Parsed again, because a component may hold what the local platform takes for a separator or a drive:
+        const std::filesystem::path part{component};
+        if (part.has_root_path() || std::any_of(part.begin(), part.end(), [](auto const& element) {
+                return element == "..";
+            }))
+        {
+            return std::unexpected(fmt::format("Refusing tar entry outside the target directory: '{}'", name));
+        }
+        relative /= part;
+    }
+    return root_ / relative;
+}
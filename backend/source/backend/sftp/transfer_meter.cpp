@@ -0,0 +1,61 @@
+#include <backend/sftp/transfer_meter.hpp>
+
+#include <cmath>
+
+TransferMeter::TransferMeter(Clock::time_point start)
+    : lastSample_{start}
+    , lastProgress_{start}
+    , current_{0}
+    , total_{0}
+    , bytesPerSecond_{0.0}
+    , sampled_{false}
+{}
+
+void TransferMeter::sample(std::uint64_t current, std::uint64_t total, Clock::time_point now)
+{
+    total_ = total;
+    if (!sampled_ || current < current_)
+    {
+        // The first sample only sets the start, a continued transfer did not transfer what it continues from. Going
+        // back is a restart, like a download that discarded its temporary file.
+        sampled_ = true;
+        current_ = current;
+        lastSample_ = now;
+        return;
+    }
+
+    const auto elapsed = std::chrono::duration<double>(now - lastSample_).count();
+    if (elapsed <= 0.0)
+        return;
+
+    const auto instant = static_cast<double>(current - current_) / elapsed;
+    // The weight of a sample grows with the time it covers, so irregular samples average correctly.
+    const auto weight = 1.0 - std::exp(-elapsed / std::chrono::duration<double>(averagingTime).count());
+    bytesPerSecond_ += weight * (instant - bytesPerSecond_);
+
+    if (current > current_)
+        lastProgress_ = now;
+    current_ = current;
+    lastSample_ = now;
+}
+
+double TransferMeter::bytesPerSecond() const
+{
+    return bytesPerSecond_;
+}
+
+std::optional<std::chrono::seconds> TransferMeter::eta() const
+{
+    if (current_ >= total_)
+        return std::chrono::seconds{0};
+    // Below a byte per second the estimate is meaningless.
+    if (bytesPerSecond_ < 1.0)
+        return std::nullopt;
+    const auto remaining = static_cast<double>(total_ - current_) / bytesPerSecond_;
+    return std::chrono::seconds{static_cast<std::int64_t>(std::ceil(remaining))};
+}
+
+bool TransferMeter::stalled(Clock::time_point now) const
+{
+    return current_ < total_ && now - lastProgress_ >= stallTime;
+}
@@ -0,0 +1,574 @@
+#include <backend/sftp/upload_operation.hpp>
+
+#include <log/log.hpp>
+
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+    // Lets the sftp session complete into a PendingResult, which wakes the operation up.
+    template <typename T>
+    std::function<void(std::expected<T, SecureShell::SftpError>&&)>
+    expectInto(PendingResult<T>& pending, std::function<void()> const& wakeup)
+    {
+        return [onComplete = pending.expect(wakeup)](std::expected<T, SecureShell::SftpError>&& result) {
+            onComplete(nullptr, std::move(result));
+        };
+    }
+}
+
+UploadOperation::UploadOperation(SecureShell::ISftpSession& sftp, UploadOperationOptions options)
+    : Operation{}
+    , sftp_{&sftp}
+    , fileStream_{}
+    , localPath_{std::move(options.localPath)}
+    , remotePath_{std::move(options.remotePath)}
+    , tempFileSuffix_{std::move(options.tempFileSuffix)}
+    , progressCallback_{std::move(options.progressCallback)}
+    , mayOverwrite_{options.mayOverwrite}
+    , tryContinue_{options.tryContinue}
+    , inheritPermissions_{options.inheritPermissions}
+    , doCleanup_{options.doCleanup}
+    , permissions_{options.permissions}
+    , localFile_{}
+    , fileSize_{0}
+    , startOffset_{0}
+    , readOffset_{0}
+    , reportedOffset_{0}
+    , writesInFlight_{options.writesInFlight}
+    , readBlockSize_{std::max(options.readBlockSize, std::size_t{1})}
+    , readAhead_{0}
+    , writeSource_{}
+    , pendingWrite_{}
+    , step_{Step::CheckTarget}
+    , pendingStat_{}
+    , pendingOpen_{}
+    , pendingCall_{}
+    , bandwidthLimiter_{std::move(options.bandwidthLimiter)}
+{
+    if (tempFileSuffix_.empty() || tempFileSuffix_.find('/') != std::string::npos)
+        tempFileSuffix_ = ".filepart";
+}
+
+UploadOperation::~UploadOperation()
+{
+    // The pipelined write ends by itself once its source is stopped and only shares state with the operation that
+    // outlives it.
+    std::ignore = cancel(false);
+}
+
+SecureShell::ProcessingStrand* UploadOperation::strand() const
+{
+    return sftp_->strand();
+}
+
+std::optional<std::chrono::microseconds> UploadOperation::roundTripTime() const
+{
+    if (auto stream = fileStream_.lock(); stream)
+        return stream->roundTripTime();
+    return std::nullopt;
+}
+
+std::filesystem::path UploadOperation::tempPath() const
+{
+    return remotePath_.generic_string() + tempFileSuffix_;
+}
+
+std::expected<UploadOperation::WorkStatus, UploadOperation::Error> UploadOperation::work()
+{
+    using enum OperationState;
+
+    switch (state_)
+    {
+        case (NotStarted):
+        {
+            state_ = Preparing;
+            [[fallthrough]];
+        }
+        case (Preparing):
+        {
+            const auto prepareResult = prepare();
+            if (!prepareResult.has_value())
+            {
+                Log::error("UploadOperation: Failed to prepare operation: {}", prepareResult.error().toString());
+                return enterErrorState<WorkStatus>(prepareResult.error());
+            }
+            if (prepareResult.value() != WorkStatus::Complete)
+                return prepareResult.value();
+            state_ = Prepared;
+            [[fallthrough]];
+        }
+        case (Prepared):
+        {
+            state_ = Running;
+            [[fallthrough]];
+        }
+        case (Running):
+        {
+            const auto result = writeOnce();
+            if (!result.has_value())
+            {
+                Log::error("UploadOperation: Failed to write file: {}", result.error().toString());
+                return enterErrorState<WorkStatus>(result.error());
+            }
+            if (result.value() == WriteStatus::Waiting)
+                return WorkStatus::Waiting;
+            if (result.value() == WriteStatus::MoreData)
+                return WorkStatus::MoreWork;
+
+            Log::info("UploadOperation: Data writing completed.");
+            state_ = Finalizing;
+            [[fallthrough]];
+        }
+        case (Finalizing):
+        {
+            const auto finalizeResult = finalize();
+            if (!finalizeResult.has_value())
+            {
+                Log::error("UploadOperation: Failed to finalize operation: {}", finalizeResult.error().toString());
+                return enterErrorState<WorkStatus>(finalizeResult.error());
+            }
+            if (finalizeResult.value() != WorkStatus::Complete)
+                return finalizeResult.value();
+            state_ = Completed;
+            Log::info("UploadOperation: Operation completed successfully.");
+            return WorkStatus::Complete;
+        }
+        case (Completed):
+        {
+            Log::warn("UploadOperation: Operation already completed.");
+            // Dont enter error state here, it would overwrite the success state.
+            return std::unexpected(Error{.type = ErrorType::CannotWorkCompletedOperation});
+        }
+        case (Failed):
+        {
+            Log::warn("UploadOperation: Operation already failed.");
+            // Do not enter error state here, it would overwrite the error state.
+            return std::unexpected(Error{.type = ErrorType::CannotWorkFailedOperation});
+        }
+        case (Canceled):
+        {
+            Log::warn("UploadOperation: Cannot work on canceled operation.");
+            return std::unexpected(Error{.type = ErrorType::CannotWorkCanceledOperation});
+        }
+    }
+    Log::error("UploadOperation: Unknown operation state: {}", static_cast<int>(state_));
+    return enterErrorState<WorkStatus>({.type = ErrorType::UnknownWorkState});
+}
+
+std::expected<UploadOperation::WriteStatus, UploadOperation::Error> UploadOperation::writeOnce()
+{
+    if (state_ < OperationState::Prepared)
+    {
+        Log::error("UploadOperation: Operation not prepared.");
+        return enterErrorState<WriteStatus>({.type = ErrorType::OperationNotPrepared});
+    }
+
+    if (!localFile_.is_open())
+    {
+        Log::error("UploadOperation: File is not open.");
+        return enterErrorState<WriteStatus>({.type = ErrorType::OpenFailure});
+    }
+
+    if (!writeSource_)
+    {
+        auto stream = fileStream_.lock();
+        if (!stream)
+        {
+            Log::error("UploadOperation: File stream expired.");
+            return enterErrorState<WriteStatus>({.type = ErrorType::FileStreamExpired});
+        }
+
+        // Reads ahead far enough to keep every write request busy while the next blocks are read.
+        readAhead_ = std::max<std::uint64_t>(
+            static_cast<std::uint64_t>(writesInFlight_) * stream->writeLengthLimit(),
+            2 * static_cast<std::uint64_t>(readBlockSize_));
+
+        // Confirmations make room for reading ahead, so they wake the queue like the completion does.
+        writeSource_ = std::make_shared<SecureShell::PipelinedWriteSource>(wakeup_);
+        if (readOffset_ == fileSize_)
+            writeSource_->finish();
+        stream->writePipelined(
+            writesInFlight_,
+            writeSource_,
+            [onComplete = pendingWrite_.expect(wakeup_)](std::expected<std::size_t, SecureShell::SftpError>&& result) {
+                onComplete(nullptr, std::move(result));
+            });
+    }
+
+    if (const auto result = pendingWrite_.take(); result)
+    {
+        if (!result->has_value())
+        {
+            Log::error("UploadOperation: Failed to write to remote file: {}", result->error().message);
+            return enterErrorState<WriteStatus>({.type = ErrorType::SftpError, .sftpError = result->error()});
+        }
+        if (startOffset_ + result->value() != fileSize_)
+        {
+            Log::error("UploadOperation: Wrote {} of {} bytes.", startOffset_ + result->value(), fileSize_);
+            return enterErrorState<WriteStatus>({.type = ErrorType::TargetFileNotGood});
+        }
+        progressCallback_(0ull, fileSize_, fileSize_);
+        Log::info("UploadOperation: Remote file write complete.");
+        return WriteStatus::Complete;
+    }
+
+    const std::uint64_t confirmed = writeSource_->confirmed();
+    if (startOffset_ + confirmed != reportedOffset_)
+    {
+        reportedOffset_ = startOffset_ + confirmed;
+        progressCallback_(0ull, fileSize_, reportedOffset_);
+    }
+
+    if (readOffset_ == fileSize_ || writeSource_->pushed() - confirmed >= readAhead_)
+        return WriteStatus::Waiting;
+
+    // Whole blocks are pushed while the limit allows any bytes, the bucket goes into debt for the rest of the block.
+    // Shrinking the blocks to the allowance would send a write request for every few bytes the bucket refills.
+    if (bandwidthLimiter_.allowance() == 0)
+    {
+        if (!delayedWakeup_)
+            return WriteStatus::MoreData;
+        delayedWakeup_(bandwidthLimiter_.delay());
+        return WriteStatus::Waiting;
+    }
+
+    const auto blockSize = std::min(static_cast<std::uint64_t>(readBlockSize_), fileSize_ - readOffset_);
+    std::string block(static_cast<std::size_t>(blockSize), '\0');
+    localFile_.read(block.data(), static_cast<std::streamsize>(block.size()));
+    if (static_cast<std::size_t>(localFile_.gcount()) != block.size())
+    {
+        Log::error("UploadOperation read cycle stopped: local file ended or failed early.");
+        writeSource_->stop();
+        return enterErrorState<WriteStatus>({.type = ErrorType::SourceFileNotGood});
+    }
+    readOffset_ += block.size();
+    bandwidthLimiter_.consume(block.size());
+    writeSource_->push(std::move(block));
+
+    // The size from the stat is uploaded, a file growing meanwhile is not followed.
+    if (readOffset_ == fileSize_)
+        writeSource_->finish();
+    return WriteStatus::MoreData;
+}
+
+std::expected<void, UploadOperation::Error> UploadOperation::openLocalFile()
+{
+    localFile_.open(localPath_, std::ios::binary);
+    if (!localFile_.is_open())
+    {
+        Log::error("UploadOperation: Failed to open file: {}", localPath_.generic_string());
+        return enterErrorState({.type = ErrorType::OpenFailure});
+    }
+    localFile_.seekg(static_cast<std::streamoff>(startOffset_));
+    readOffset_ = startOffset_;
+    reportedOffset_ = startOffset_;
+    return {};
+}
+
+std::expected<UploadOperation::WorkStatus, UploadOperation::Error> UploadOperation::prepare()
+{
+    using OpenType = SecureShell::ISftpSession::OpenType;
+
+    switch (step_)
+    {
+        case (Step::CheckTarget):
+        {
+            if (!pendingStat_.inFlight())
+            {
+                if (localPath_.empty() || remotePath_.empty())
+                {
+                    Log::error("UploadOperation: Invalid path.");
+                    return enterErrorState<WorkStatus>({.type = ErrorType::InvalidPath});
+                }
+
+                std::error_code ec{};
+                if (!std::filesystem::is_regular_file(localPath_, ec))
+                {
+                    Log::error(
+                        "UploadOperation: File '{}' does not exist or is not a file.", localPath_.generic_string());
+                    return enterErrorState<WorkStatus>({.type = ErrorType::FileNotFound});
+                }
+                fileSize_ = std::filesystem::file_size(localPath_, ec);
+                if (ec)
+                {
+                    Log::error("UploadOperation: Failed to stat file: {}", ec.message());
+                    return enterErrorState<WorkStatus>({.type = ErrorType::FileStatFailed});
+                }
+            }
+
+            // Initial check. Check again later before rename
+            if (!mayOverwrite_)
+            {
+                if (!pendingStat_.inFlight())
+                {
+                    sftp_->stat(remotePath_, expectInto(pendingStat_, wakeup_));
+                    return WorkStatus::Waiting;
+                }
+                const auto target = pendingStat_.take();
+                if (!target)
+                    return WorkStatus::Waiting;
+                if (target->has_value())
+                {
+                    Log::error(
+                        "UploadOperation: File '{}' already exists and may not be overwritten.",
+                        remotePath_.generic_string());
+                    return enterErrorState<WorkStatus>({.type = ErrorType::FileExists});
+                }
+            }
+            step_ = Step::CheckPart;
+            [[fallthrough]];
+        }
+        case (Step::CheckPart):
+        {
+            if (tryContinue_)
+            {
+                if (!pendingStat_.inFlight())
+                {
+                    sftp_->stat(tempPath(), expectInto(pendingStat_, wakeup_));
+                    return WorkStatus::Waiting;
+                }
+                const auto partInfo = pendingStat_.take();
+                if (!partInfo)
+                    return WorkStatus::Waiting;
+                if (partInfo->has_value() && (*partInfo)->isRegularFile())
+                {
+                    // File is larger than expected? discard it and start over.
+                    if ((*partInfo)->size > fileSize_)
+                    {
+                        Log::info(
+                            "UploadOperation: File '{}' is larger than expected, discarding and starting over.",
+                            tempPath().generic_string());
+                    }
+                    else
+                    {
+                        Log::info(
+                            "UploadOperation: File '{}' is incomplete, continuing upload at {} bytes.",
+                            tempPath().generic_string(),
+                            (*partInfo)->size);
+                        startOffset_ = (*partInfo)->size;
+                    }
+                }
+            }
+            step_ = Step::OpenPart;
+            [[fallthrough]];
+        }
+        case (Step::OpenPart):
+        {
+            if (!pendingOpen_.inFlight())
+            {
+                const auto openType = startOffset_ == 0 ? OpenType::Write | OpenType::Create | OpenType::Truncate
+                                                        : OpenType::Write | OpenType::Create;
+                sftp_->openFile(
+                    tempPath(),
+                    openType,
+                    std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+                    expectInto(pendingOpen_, wakeup_));
+                return WorkStatus::Waiting;
+            }
+            auto openResult = pendingOpen_.take();
+            if (!openResult)
+                return WorkStatus::Waiting;
+            if (!openResult->has_value())
+            {
+                Log::error("UploadOperation: Failed to open remote file '{}'.", tempPath().generic_string());
+                return enterErrorState<WorkStatus>({.type = ErrorType::OpenFailure, .sftpError = openResult->error()});
+            }
+            fileStream_ = std::move(*openResult).value();
+            step_ = Step::SeekPart;
+            [[fallthrough]];
+        }
+        case (Step::SeekPart):
+        {
+            if (startOffset_ != 0)
+            {
+                auto stream = fileStream_.lock();
+                if (!stream)
+                {
+                    Log::error("UploadOperation: File stream expired.");
+                    return enterErrorState<WorkStatus>({.type = ErrorType::FileStreamExpired});
+                }
+                if (!pendingCall_.inFlight())
+                {
+                    stream->seek(startOffset_, expectInto(pendingCall_, wakeup_));
+                    return WorkStatus::Waiting;
+                }
+                const auto seekResult = pendingCall_.take();
+                if (!seekResult)
+                    return WorkStatus::Waiting;
+                if (!seekResult->has_value())
+                {
+                    return enterErrorState<WorkStatus>(
+                        {.type = ErrorType::FileStatFailed, .sftpError = seekResult->error()});
+                }
+            }
+
+            if (auto openResult = openLocalFile(); !openResult.has_value())
+                return std::unexpected(std::move(openResult).error());
+
+            step_ = Step::Prepared;
+            Log::info(
+                "UploadOperation: Prepared upload of '{}' to '{}'.",
+                localPath_.generic_string(),
+                remotePath_.generic_string());
+            return WorkStatus::Complete;
+        }
+        case (Step::Prepared):
+        case (Step::CheckTargetAgain):
+        case (Step::Rename):
+        case (Step::SetPermissions):
+        case (Step::Finalized):
+            return WorkStatus::Complete;
+    }
+    return WorkStatus::Complete;
+}
+
+std::expected<void, UploadOperation::Error> UploadOperation::cancel(bool adoptCancelState)
+{
+    if (adoptCancelState)
+    {
+        Log::info(
+            "UploadOperation: Upload of '{}' to '{}' canceled.",
+            localPath_.generic_string(),
+            remotePath_.generic_string());
+        state_ = OperationState::Canceled;
+    }
+
+    cleanup();
+    return {};
+}
+
+void UploadOperation::cleanup()
+{
+    localFile_.close();
+
+    if (writeSource_)
+        writeSource_->stop();
+
+    if (auto stream = fileStream_.lock(); stream)
+    {
+        stream->closeInBackground();
+        // Only a part that was opened by this operation is removed, the result is not waited for.
+        if (doCleanup_ && state_ != OperationState::Completed)
+            sftp_->removeFile(tempPath(), [](auto&&) {});
+    }
+}
+
+std::expected<UploadOperation::WorkStatus, UploadOperation::Error> UploadOperation::finalize()
+{
+    if (state_ == OperationState::Running)
+    {
+        Log::error("UploadOperation: Cannot finalize while writing.");
+        return std::unexpected(Error{.type = ErrorType::CannotFinalizeDuringRead});
+    }
+
+    switch (step_)
+    {
+        case (Step::CheckTarget):
+        case (Step::CheckPart):
+        case (Step::OpenPart):
+        case (Step::SeekPart):
+        case (Step::Prepared):
+        {
+            localFile_.close();
+            // The strand keeps the order, so the calls below find the file closed without waiting for it here.
+            if (auto stream = fileStream_.lock(); stream)
+                stream->closeInBackground();
+            step_ = Step::CheckTargetAgain;
+            [[fallthrough]];
+        }
+        case (Step::CheckTargetAgain):
+        {
+            if (!mayOverwrite_)
+            {
+                if (!pendingStat_.inFlight())
+                {
+                    sftp_->stat(remotePath_, expectInto(pendingStat_, wakeup_));
+                    return WorkStatus::Waiting;
+                }
+                const auto target = pendingStat_.take();
+                if (!target)
+                    return WorkStatus::Waiting;
+                if (target->has_value())
+                {
+                    Log::error(
+                        "UploadOperation: File '{}' already exists and may not be overwritten.",
+                        remotePath_.generic_string());
+                    return std::unexpected(Error{.type = ErrorType::FileExists});
+                }
+            }
+            step_ = Step::Rename;
+            [[fallthrough]];
+        }
+        case (Step::Rename):
+        {
+            if (!pendingCall_.inFlight())
+            {
+                // An existing target is replaced in one step where the server can, it is never missing then:
+                if (mayOverwrite_)
+                    sftp_->renameReplacing(tempPath(), remotePath_, expectInto(pendingCall_, wakeup_));
+                else
+                    sftp_->rename(tempPath(), remotePath_, expectInto(pendingCall_, wakeup_));
+                return WorkStatus::Waiting;
+            }
+            const auto renameResult = pendingCall_.take();
+            if (!renameResult)
+                return WorkStatus::Waiting;
+            if (!renameResult->has_value())
+            {
+                Log::error("UploadOperation: Failed to rename file: {}", renameResult->error().message);
+                return std::unexpected(Error{.type = ErrorType::RenameFailure, .sftpError = renameResult->error()});
+            }
+            step_ = Step::SetPermissions;
+            [[fallthrough]];
+        }
+        case (Step::SetPermissions):
+        {
+            if (!pendingCall_.inFlight())
+            {
+                std::optional<std::filesystem::perms> permissions = permissions_;
+                if (inheritPermissions_)
+                {
+                    Log::info("UploadOperation: Inheriting permissions from local file.");
+                    std::error_code ec{};
+                    const auto status = std::filesystem::status(localPath_, ec);
+                    if (ec)
+                    {
+                        Log::error("UploadOperation: Failed to stat file: {}", ec.message());
+                        return std::unexpected(Error{.type = ErrorType::FileStatFailed});
+                    }
+                    permissions = status.permissions();
+                }
+
+                if (permissions)
+                {
+                    sftp_->chmod(remotePath_, *permissions, expectInto(pendingCall_, wakeup_));
+                    return WorkStatus::Waiting;
+                }
+            }
+            else
+            {
+                const auto chmodResult = pendingCall_.take();
+                if (!chmodResult)
+                    return WorkStatus::Waiting;
+                if (!chmodResult->has_value())
+                {
+                    Log::error("UploadOperation: Failed to set permissions: {}", chmodResult->error().message);
+                    return std::unexpected(
+                        Error{.type = ErrorType::CannotSetFilePermissions, .sftpError = chmodResult->error()});
+                }
+            }
+
+            step_ = Step::Finalized;
+            Log::info(
+                "UploadOperation: Finalized upload of '{}' to '{}'.",
+                localPath_.generic_string(),
+                remotePath_.generic_string());
+            [[fallthrough]];
+        }
+        case (Step::Finalized):
+            return WorkStatus::Complete;
+    }
+    return WorkStatus::Complete;
+}
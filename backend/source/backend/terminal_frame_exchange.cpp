@@ -0,0 +1,178 @@
+#include <backend/terminal_frame_exchange.hpp>
+
+#include <log/log.hpp>
+
+#include <fmt/format.h>
+
+#include <charconv>
+#include <string>
+#include <system_error>
+#include <utility>
+
+using namespace std::string_literals;
+
+namespace
+{
+    Nui::CustomSchemeResponse makeResponse(int code, std::string const& reason, std::string body)
+    {
+        std::unordered_multimap<std::string, std::string> headers = {
+            {"Content-Type"s, "application/octet-stream"s},
+            // Do not forget to allow CORS
+            {"Access-Control-Allow-Origin"s, "*"s},
+        };
+        headers.emplace("Content-Length"s, std::to_string(body.size()));
+
+        return Nui::CustomSchemeResponse{
+            .statusCode = code,
+            .reasonPhrase = reason,
+            .headers = std::move(headers),
+            .body = std::move(body),
+        };
+    }
+
+    constexpr std::string_view framesPrefix = "/frames/";
+    constexpr std::string_view writePrefix = "/write/";
+    constexpr std::string_view ackPrefix = "/ack/";
+}
+
+Nui::CustomScheme TerminalFrameExchange::customScheme()
+{
+    return Nui::CustomScheme{
+        .scheme = std::string{schemeName},
+        .allowedOrigins = {"*"s},
+        .onRequest =
+            [this](Nui::CustomSchemeRequest const& request) {
+                const auto url = request.parseUrl();
+                if (!url)
+                {
+                    Log::error("Failed to parse terminal frame url: '{}'", request.uri);
+                    return makeResponse(400, "Bad Request", "");
+                }
+
+                const auto path = url->pathAsString();
+                if (path.starts_with(framesPrefix))
+                {
+                    auto frames = take(path.substr(framesPrefix.size()));
+                    const auto code = frames.empty() ? 204 : 200;
+                    return makeResponse(code, "OK", std::move(frames));
+                }
+                if (path.starts_with(writePrefix) && request.method == "POST")
+                {
+                    auto data = request.getContent();
+                    if (!write(path.substr(writePrefix.size()), std::move(data)))
+                        return makeResponse(404, "Not Found", "");
+                    return makeResponse(204, "OK", "");
+                }
+                if (path.starts_with(ackPrefix) && request.method == "POST")
+                {
+                    auto const& body = request.getContent();
+                    std::size_t bytes = 0;
+                    const auto [end, error] = std::from_chars(body.data(), body.data() + body.size(), bytes);
+                    if (error != std::errc{})
+                        return makeResponse(400, "Bad Request", "");
+                    if (!acknowledge(path.substr(ackPrefix.size()), bytes))
+                        return makeResponse(404, "Not Found", "");
+                    return makeResponse(204, "OK", "");
+                }
+
+                Log::error("Unknown terminal frame request: {} '{}'", request.method, path);
+                return makeResponse(404, "Not Found", "");
+            },
+        .treatAsSecure = true,
+        .hasAuthorityComponent = true,
+    };
+}
+
+std::string TerminalFrameExchange::framesAvailableFunction(std::string const& receiver)
+{
+    return fmt::format("terminalFramesAvailable_{}", receiver);
+}
+
+void TerminalFrameExchange::open(
+    std::string const& receiver,
+    std::function<void(std::string&&)> writer,
+    std::function<void()> onFramesAvailable,
+    std::function<void(std::size_t)> onAcknowledge)
+{
+    std::scoped_lock lock{mutex_};
+    receivers_[receiver] = Receiver{
+        .frames = {},
+        .writer = std::move(writer),
+        .onFramesAvailable = std::move(onFramesAvailable),
+        .onAcknowledge = std::move(onAcknowledge),
+        .closed = false,
+    };
+}
+
+void TerminalFrameExchange::push(std::string const& receiver, SharedData::TerminalStream stream, std::string_view data)
+{
+    std::function<void()> notify{};
+    {
+        std::scoped_lock lock{mutex_};
+        auto iter = receivers_.find(receiver);
+        if (iter == receivers_.end() || iter->second.closed)
+            return;
+
+        // Only the first push after a take notifies, the fetch that follows picks up everything pushed until then.
+        if (iter->second.frames.empty())
+            notify = iter->second.onFramesAvailable;
+        SharedData::appendTerminalFrame(iter->second.frames, stream, data);
+    }
+    if (notify)
+        notify();
+}
+
+std::string TerminalFrameExchange::take(std::string const& receiver)
+{
+    std::scoped_lock lock{mutex_};
+    auto iter = receivers_.find(receiver);
+    if (iter == receivers_.end())
+        return {};
+
+    auto frames = std::exchange(iter->second.frames, std::string{});
+    if (iter->second.closed)
+        receivers_.erase(iter);
+    return frames;
+}
+
+bool TerminalFrameExchange::write(std::string const& receiver, std::string&& data)
+{
+    std::function<void(std::string&&)> writer{};
+    {
+        std::scoped_lock lock{mutex_};
+        auto iter = receivers_.find(receiver);
+        if (iter == receivers_.end() || iter->second.closed || !iter->second.writer)
+            return false;
+        writer = iter->second.writer;
+    }
+    writer(std::move(data));
+    return true;
+}
+
+bool TerminalFrameExchange::acknowledge(std::string const& receiver, std::size_t bytes)
+{
+    std::function<void(std::size_t)> onAcknowledge{};
+    {
+        std::scoped_lock lock{mutex_};
+        auto iter = receivers_.find(receiver);
+        if (iter == receivers_.end() || iter->second.closed)
+            return false;
+        onAcknowledge = iter->second.onAcknowledge;
+    }
+    if (onAcknowledge)
+        onAcknowledge(bytes);
+    return true;
+}
+
+void TerminalFrameExchange::close(std::string const& receiver)
+{
+    std::scoped_lock lock{mutex_};
+    auto iter = receivers_.find(receiver);
+    if (iter == receivers_.end())
+        return;
+
+    if (iter->second.frames.empty())
+        receivers_.erase(iter);
+    else
+        iter->second.closed = true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <backend/terminal_frame_exchange.hpp>
+#include <shared_data/terminal_frame.hpp>
+
+#include <roar/utility/base64.hpp>
+#include <nlohmann/json.hpp>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace Test
+{
+    /**
+     * Compares the backend side cost of the binary terminal frames with the base64 in json messages they replaced.
+     * Disabled by default, run it with
+     * --gtest_also_run_disabled_tests --gtest_filter=TerminalFrameBenchmark.*
+     */
+    class TerminalFrameBenchmark : public ::testing::Test
+    {
+      protected:
+        template <typename FunctionT>
+        void measure(std::string const& name, FunctionT&& func)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const auto bytesOnTheWire = func();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            const auto seconds = std::chrono::duration<double>(elapsed).count();
+            std::cout << "[ BENCHMARK ] " << name << ": " << static_cast<double>(totalBytes) / seconds / 1e6
+                      << " MB/s, " << bytesOnTheWire << " bytes on the wire for " << totalBytes << " bytes\n";
+        }
+
+        constexpr static std::size_t chunkSize = 64 * 1024;
+        constexpr static std::size_t chunks = 1'600;
+        constexpr static std::size_t totalBytes = chunkSize * chunks;
+        std::string chunk_ = std::string(chunkSize, 'x');
+    };
+
+    TEST_F(TerminalFrameBenchmark, DISABLED_OutputThroughput)
+    {
+        measure("base64 in json per chunk", [this]() {
+            std::size_t wire = 0;
+            for (std::size_t i = 0; i != chunks; ++i)
+            {
+                const auto message = nlohmann::json{
+                    {"sessionId", "session"},
+                    {"channelId", "channel"},
+                    {"data", Roar::base64Encode(chunk_)},
+                }.dump();
+                // What the frontend did with it:
+                const auto parsed = nlohmann::json::parse(message);
+                EXPECT_EQ(Roar::base64Decode(parsed["data"].get<std::string>()).size(), chunkSize);
+                wire += message.size();
+            }
+            return wire;
+        });
+
+        measure("binary frames through the exchange", [this]() {
+            TerminalFrameExchange exchange;
+            exchange.open("receiver", {}, {});
+            std::size_t wire = 0;
+            for (std::size_t i = 0; i != chunks; ++i)
+            {
+                exchange.push("receiver", SharedData::TerminalStream::Stdout, chunk_);
+                const auto frames = exchange.take("receiver");
+                SharedData::forEachTerminalFrame(frames, [](auto, std::string_view payload) {
+                    EXPECT_EQ(payload.size(), chunkSize);
+                });
+                wire += frames.size();
+            }
+            return wire;
+        });
+    }
+}
@@ -1,4 +1,15 @@
+#include "test_bandwidth_limiter.hpp"
+#include "test_bulk_download_operation.hpp"
 #include "test_download_operation.hpp"
+#include "test_find_listing_parser.hpp"
+#include "test_local_file_writer.hpp"
+#include "test_pending_progress.hpp"
+#include "test_tar_extractor.hpp"
+#include "test_terminal_frame_exchange.hpp"
+#include "test_transfer_connector.hpp"
+#include "test_transfer_meter.hpp"
+#include "test_upload_operation.hpp"
+#include "benchmark_terminal_frames.hpp"
 
 #include <log/log.hpp>
 
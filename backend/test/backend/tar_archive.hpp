@@ -0,0 +1,72 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <string_view>
+
+namespace Test::TarArchive
+{
+    constexpr std::string_view ustarMagic{"ustar\0" "00", 8};
+    constexpr std::string_view gnuMagic{"ustar  \0", 8};
+
+    /**
+     * @brief A header followed by content, padded to whole blocks.
+     *
+     * @param prefix Written from byte 345 on, where ustar keeps the name prefix and GNU tar the access and change time.
+     */
+    inline std::string entry(
+        std::string const& name,
+        char type,
+        std::string const& content = {},
+        std::string_view magic = ustarMagic,
+        std::string_view prefix = {})
+    {
+        std::string header(512, '\0');
+        std::copy_n(name.data(), std::min<std::size_t>(name.size(), 100), header.data());
+        std::copy_n("0000644", 7, header.data() + 100);
+        const auto size = fmt::format("{:011o}", content.size());
+        std::copy_n(size.data(), size.size(), header.data() + 124);
+        header[156] = type;
+        std::copy_n(magic.data(), magic.size(), header.data() + 257);
+        std::copy_n(prefix.data(), std::min<std::size_t>(prefix.size(), 155), header.data() + 345);
+
+        std::fill_n(header.data() + 148, 8, ' ');
+        const auto sum = std::accumulate(header.begin(), header.end(), 0u, [](unsigned sum, char c) {
+            return sum + static_cast<unsigned char>(c);
+        });
+        const auto checksum = fmt::format("{:06o}", sum);
+        std::copy_n(checksum.data(), checksum.size(), header.data() + 148);
+        header[154] = '\0';
+
+        auto data = header + content;
+        data.resize((data.size() + 511) / 512 * 512, '\0');
+        return data;
+    }
+
+    /**
+     * @brief The two zero blocks that end an archive.
+     */
+    inline std::string end()
+    {
+        return std::string(1024, '\0');
+    }
+
+    inline std::string gzip(std::string const& data)
+    {
+        z_stream stream{};
+        deflateInit2(&stream, 5, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+        stream.avail_out = static_cast<uInt>(compressed.size());
+        deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        return compressed;
+    }
+}
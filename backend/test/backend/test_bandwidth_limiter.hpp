@@ -0,0 +1,94 @@
+#pragma once
+
+#include <backend/sftp/bandwidth_limiter.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <limits>
+#include <memory>
+
+namespace Test
+{
+    class BandwidthLimiterTests : public ::testing::Test
+    {
+      protected:
+        using Clock = TokenBucket::Clock;
+    };
+
+    TEST_F(BandwidthLimiterTests, UnlimitedBucketAllowsEverything)
+    {
+        TokenBucket bucket{};
+        bucket.consume(1'000'000'000);
+        EXPECT_EQ(bucket.allowance(), std::numeric_limits<std::uint64_t>::max());
+        EXPECT_EQ(bucket.delay(), Clock::duration::zero());
+    }
+
+    TEST_F(BandwidthLimiterTests, AllowanceIsLimitedToTheBurst)
+    {
+        TokenBucket bucket{1000, std::chrono::milliseconds{100}};
+        const auto later = Clock::now() + std::chrono::seconds{10};
+        EXPECT_EQ(bucket.allowance(later), 100);
+    }
+
+    TEST_F(BandwidthLimiterTests, DebtIsWaitedOutAtTheRate)
+    {
+        const auto start = Clock::now();
+        TokenBucket bucket{1000, std::chrono::milliseconds{100}};
+        bucket.consume(600, start);
+
+        EXPECT_EQ(bucket.allowance(start), 0);
+        const auto delay = bucket.delay(start);
+        EXPECT_GE(delay, std::chrono::milliseconds{500});
+        EXPECT_LE(delay, std::chrono::milliseconds{510});
+
+        EXPECT_EQ(bucket.allowance(start + std::chrono::milliseconds{400}), 0);
+        EXPECT_GT(bucket.allowance(start + std::chrono::milliseconds{520}), 0);
+    }
+
+    TEST_F(BandwidthLimiterTests, RateChangeForgivesDebt)
+    {
+        TokenBucket bucket{1000, std::chrono::milliseconds{100}};
+        bucket.consume(10'000);
+        EXPECT_EQ(bucket.allowance(), 0);
+
+        bucket.rate(0);
+        EXPECT_EQ(bucket.allowance(), std::numeric_limits<std::uint64_t>::max());
+        bucket.rate(1000);
+        EXPECT_LE(bucket.delay(), std::chrono::milliseconds{1});
+    }
+
+    TEST_F(BandwidthLimiterTests, LimiterFollowsTheStrictestBucket)
+    {
+        auto fast = std::make_shared<TokenBucket>(1'000'000);
+        auto slow = std::make_shared<TokenBucket>(1000);
+        const BandwidthLimiter limiter{{fast, slow, nullptr}};
+
+        EXPECT_LE(limiter.allowance(), 101);
+        limiter.consume(1000);
+        EXPECT_EQ(limiter.allowance(), 0);
+        EXPECT_GT(limiter.delay(), std::chrono::milliseconds{800});
+        EXPECT_GT(fast->allowance(), 0);
+    }
+
+    TEST_F(BandwidthLimiterTests, DefaultLimiterDoesNotLimit)
+    {
+        const BandwidthLimiter limiter{};
+        limiter.consume(1'000'000);
+        EXPECT_EQ(limiter.allowance(), std::numeric_limits<std::uint64_t>::max());
+        EXPECT_EQ(limiter.delay(), Clock::duration::zero());
+        EXPECT_EQ(limiter.rate(), 0);
+    }
+
+    TEST_F(BandwidthLimiterTests, LimiterRateIsTheLowestLimitingRate)
+    {
+        auto unlimited = std::make_shared<TokenBucket>(0);
+        auto fast = std::make_shared<TokenBucket>(1'000'000);
+        auto slow = std::make_shared<TokenBucket>(1000);
+        const BandwidthLimiter limiter{{unlimited, fast, slow}};
+        EXPECT_EQ(limiter.rate(), 1000);
+
+        slow->rate(0);
+        EXPECT_EQ(limiter.rate(), 1'000'000);
+    }
+}
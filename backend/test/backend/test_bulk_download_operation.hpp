@@ -0,0 +1,345 @@
+#pragma once
+
+#include <backend/sftp/bulk_download_operation.hpp>
+#include <ssh/mocks/channel_mock.hpp>
+#include <ssh/mocks/file_stream_mock.hpp>
+#include <ssh/mocks/sftp_session_mock.hpp>
+#include <utility/temporary_directory.hpp>
+
+#include "tar_archive.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+extern std::filesystem::path programDirectory;
+
+namespace Test
+{
+    class BulkDownloadOperationTests : public ::testing::Test
+    {
+      protected:
+        using OpenCallback =
+            std::function<void(std::expected<std::weak_ptr<SecureShell::IFileStream>, SecureShell::SftpError>&&)>;
+        using ChannelCallback =
+            std::function<void(std::expected<std::weak_ptr<SecureShell::IChannel>, SecureShell::SftpError>&&)>;
+        using SessionMock = ::testing::NiceMock<SecureShell::Test::SftpSessionMock>;
+
+        struct PendingOpen
+        {
+            std::filesystem::path path;
+            OpenCallback onComplete;
+        };
+
+        void SetUp() override
+        {
+            processingThread_.start(5ms);
+            giveSessionOpens(*sftp_, sftpOpens_);
+        }
+
+        void TearDown() override
+        {
+            processingThread_.stop();
+        }
+
+        // Keeps the opens until the test lets them arrive, like a server that did not answer yet.
+        void giveSessionOpens(SessionMock& session, std::vector<PendingOpen>& opens)
+        {
+            ON_CALL(session, strand()).WillByDefault([this]() {
+                return strand_.get();
+            });
+            ON_CALL(session, openFile(testing::_, testing::_, testing::_, testing::_))
+                .WillByDefault([&opens](
+                                   std::filesystem::path const& path,
+                                   SecureShell::ISftpSession::OpenType,
+                                   std::filesystem::perms,
+                                   OpenCallback onComplete) {
+                    opens.push_back(PendingOpen{.path = path, .onComplete = std::move(onComplete)});
+                });
+        }
+
+        void openAll(std::vector<PendingOpen>& opens)
+        {
+            for (auto& open : opens)
+            {
+                auto stream = std::make_shared<::testing::NiceMock<SecureShell::Test::FileStreamMock>>();
+                ON_CALL(*stream, strand()).WillByDefault([this]() {
+                    return strand_.get();
+                });
+                streams_.push_back(stream);
+                open.onComplete(std::weak_ptr<SecureShell::IFileStream>{stream});
+            }
+            opens.clear();
+        }
+
+        // Runs the archive command on channel_, whose output the test passes to the captured callbacks.
+        void giveSessionChannel()
+        {
+            ON_CALL(*sftp_, createExecChannel(testing::_, testing::_))
+                .WillByDefault([this](std::string const& command, ChannelCallback onComplete) {
+                    command_ = command;
+                    onComplete(std::weak_ptr<SecureShell::IChannel>{channel_});
+                });
+            ON_CALL(*channel_, startReading(testing::_, testing::_, testing::_, testing::_))
+                .WillByDefault([this](
+                                   std::function<void(std::string const&)> onStdout,
+                                   std::function<void(std::string const&)> onStderr,
+                                   std::function<void()> onExit,
+                                   SecureShell::ChannelReadOptions) {
+                    onStdout_ = std::move(onStdout);
+                    onStderr_ = std::move(onStderr);
+                    onExit_ = std::move(onExit);
+                });
+        }
+
+        // Works the operation up to reading the output of the archive command.
+        void startArchive(BulkDownloadOperation& operation)
+        {
+            auto result = workWhileMoreWork(operation);
+            ASSERT_TRUE(result.has_value());
+            result = workWhileMoreWork(operation);
+            ASSERT_TRUE(result.has_value());
+            EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+            ASSERT_TRUE(onExit_);
+        }
+
+        std::string readFile(std::filesystem::path const& path)
+        {
+            std::ifstream file{path, std::ios::binary};
+            return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        }
+
+        // The files are empty, so they are finished as soon as they are open.
+        void addFile(std::string const& name)
+        {
+            scan_->entries.add(
+                SharedData::DirectoryEntry{
+                    .path = name,
+                    .type = SharedData::FileType::Regular,
+                    .size = 0,
+                    .permissions = std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+                },
+                0);
+        }
+
+        BulkDownloadOperation::BulkDownloadOperationOptions makeOptions()
+        {
+            return BulkDownloadOperation::BulkDownloadOperationOptions{
+                .remotePath = "/remote",
+                .localPath = isolateDirectory_.path() / "download",
+                .scanResult = scan_,
+            };
+        }
+
+        std::expected<Operation::WorkStatus, Operation::Error> workWhileMoreWork(BulkDownloadOperation& operation)
+        {
+            auto result = operation.work();
+            for (int i = 0; i < 20 && result.has_value() && result.value() == Operation::WorkStatus::MoreWork; ++i)
+                result = operation.work();
+            return result;
+        }
+
+      protected:
+        Utility::TemporaryDirectory isolateDirectory_{programDirectory / "temp", true};
+        SecureShell::ProcessingThread processingThread_{};
+        std::unique_ptr<SecureShell::ProcessingStrand> strand_{processingThread_.createStrand()};
+        std::shared_ptr<SessionMock> sftp_{std::make_shared<SessionMock>()};
+        std::vector<PendingOpen> sftpOpens_{};
+        std::vector<std::shared_ptr<SecureShell::IFileStream>> streams_{};
+        std::shared_ptr<::testing::NiceMock<SecureShell::Test::ChannelMock>> channel_{
+            std::make_shared<::testing::NiceMock<SecureShell::Test::ChannelMock>>()};
+        std::string command_{};
+        std::function<void(std::string const&)> onStdout_{};
+        std::function<void(std::string const&)> onStderr_{};
+        std::function<void()> onExit_{};
+        std::shared_ptr<ScanResult> scan_{std::make_shared<ScanResult>(
+            ScanResult{.entries = SharedData::DirectoryEntryStore{"/remote"}, .state = ScanResult::State::Scanning})};
+    };
+
+    TEST_F(BulkDownloadOperationTests, DownloadsEntriesWhileTheScanIsStillRunning)
+    {
+        addFile("a.txt");
+
+        BulkDownloadOperation operation{*sftp_, makeOptions()};
+        auto result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+        ASSERT_EQ(sftpOpens_.size(), 1);
+        EXPECT_EQ(sftpOpens_.front().path.generic_string(), "/remote/a.txt");
+
+        openAll(sftpOpens_);
+        result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        // Caught up with the scan, which has not completed yet:
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+        EXPECT_TRUE(std::filesystem::exists(isolateDirectory_.path() / "download" / "a.txt"));
+
+        // The scan lists more entries:
+        addFile("b.txt");
+        result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(sftpOpens_.size(), 1);
+        EXPECT_EQ(sftpOpens_.front().path.generic_string(), "/remote/b.txt");
+
+        openAll(sftpOpens_);
+        result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+        EXPECT_TRUE(std::filesystem::exists(isolateDirectory_.path() / "download" / "b.txt"));
+
+        scan_->state = ScanResult::State::Complete;
+        result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Complete);
+    }
+
+    TEST_F(BulkDownloadOperationTests, ConcurrentFilesAreOpenedOnAllSessionsAtTheSameTime)
+    {
+        addFile("a.txt");
+        addFile("b.txt");
+        addFile("c.txt");
+        scan_->state = ScanResult::State::Complete;
+
+        auto fileSession = std::make_shared<SessionMock>();
+        std::vector<PendingOpen> fileSessionOpens{};
+        giveSessionOpens(*fileSession, fileSessionOpens);
+
+        auto options = makeOptions();
+        options.concurrency = 2;
+        options.fileSessions = {fileSession};
+        BulkDownloadOperation operation{*sftp_, options};
+
+        auto result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+        // Two files are in flight, one on each session, the third waits for one of them:
+        EXPECT_EQ(sftpOpens_.size(), 1);
+        EXPECT_EQ(fileSessionOpens.size(), 1);
+
+        openAll(sftpOpens_);
+        openAll(fileSessionOpens);
+        result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+        EXPECT_EQ(sftpOpens_.size() + fileSessionOpens.size(), 1);
+
+        openAll(sftpOpens_);
+        openAll(fileSessionOpens);
+        result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Complete);
+        for (auto const* name : {"a.txt", "b.txt", "c.txt"})
+            EXPECT_TRUE(std::filesystem::exists(isolateDirectory_.path() / "download" / name)) << name;
+    }
+
+    TEST_F(BulkDownloadOperationTests, FailsWhenTheScanIsAborted)
+    {
+        addFile("a.txt");
+
+        BulkDownloadOperation operation{*sftp_, makeOptions()};
+        auto result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+
+        scan_->state = ScanResult::State::Aborted;
+        result = workWhileMoreWork(operation);
+        ASSERT_FALSE(result.has_value());
+        EXPECT_EQ(result.error().type, Operation::ErrorType::ScanIncomplete);
+    }
+
+    TEST_F(BulkDownloadOperationTests, ArchiveIsExtractedAfterTheMarkerLine)
+    {
+        addFile("a.txt");
+        scan_->state = ScanResult::State::Complete;
+        giveSessionChannel();
+
+        auto options = makeOptions();
+        options.asArchive = true;
+        options.compressionMethod = "none";
+        BulkDownloadOperation operation{*sftp_, options};
+        startArchive(operation);
+        EXPECT_NE(command_.find("tar -cf - ."), std::string::npos);
+
+        onStdout_("Welcome!\nnui-scp-tar none\n" + TarArchive::entry("./a.txt", '0', "hello") + TarArchive::end());
+        onStderr_("nui-scp-tar-status 0\n");
+        onExit_();
+
+        const auto result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Complete);
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "download" / "a.txt"), "hello");
+        EXPECT_TRUE(sftpOpens_.empty());
+    }
+
+    TEST_F(BulkDownloadOperationTests, ArchiveFallsBackToSftpWithoutRemoteTar)
+    {
+        addFile("a.txt");
+        scan_->state = ScanResult::State::Complete;
+        giveSessionChannel();
+
+        auto options = makeOptions();
+        options.asArchive = true;
+        BulkDownloadOperation operation{*sftp_, options};
+        startArchive(operation);
+
+        // The command prints nothing if there is no tar:
+        onExit_();
+
+        auto result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(sftpOpens_.size(), 1);
+        EXPECT_EQ(sftpOpens_.front().path.generic_string(), "/remote/a.txt");
+
+        openAll(sftpOpens_);
+        result = workWhileMoreWork(operation);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Complete);
+    }
+
+    TEST_F(BulkDownloadOperationTests, ArchiveFailsWhenTheRemoteTarFails)
+    {
+        addFile("a.txt");
+        scan_->state = ScanResult::State::Complete;
+        giveSessionChannel();
+
+        auto options = makeOptions();
+        options.asArchive = true;
+        BulkDownloadOperation operation{*sftp_, options};
+        startArchive(operation);
+
+        // tar completes the archive without the files it could not read:
+        onStdout_("nui-scp-tar gz\n" + TarArchive::gzip(TarArchive::entry("./b.txt", '0', "b") + TarArchive::end()));
+        onStderr_("tar: ./a.txt: Cannot open: Permission denied\nnui-scp-tar-status 2\n");
+        onExit_();
+
+        const auto result = workWhileMoreWork(operation);
+        ASSERT_FALSE(result.has_value());
+        EXPECT_EQ(result.error().type, Operation::ErrorType::ArchiveStreamFailure);
+    }
+
+    TEST_F(BulkDownloadOperationTests, ArchiveFailsWithoutTheStatusOfTheRemoteTar)
+    {
+        addFile("a.txt");
+        scan_->state = ScanResult::State::Complete;
+        giveSessionChannel();
+
+        auto options = makeOptions();
+        options.asArchive = true;
+        options.compressionMethod = "none";
+        BulkDownloadOperation operation{*sftp_, options};
+        startArchive(operation);
+
+        onStdout_("nui-scp-tar none\n" + TarArchive::entry("./a.txt", '0', "hello") + TarArchive::end());
+        onExit_();
+
+        const auto result = workWhileMoreWork(operation);
+        ASSERT_FALSE(result.has_value());
+        EXPECT_EQ(result.error().type, Operation::ErrorType::ArchiveStreamFailure);
+    }
+}
@@ -8,9 +8,11 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <queue>
 #include <string>
 #include <memory>
+#include <vector>
 
 using namespace std::chrono_literals;
 using namespace std::string_literals;
@@ -69,50 +71,94 @@ namespace Test
 
         void giveMockExpectedRead(std::shared_ptr<::testing::NiceMock<SecureShell::Test::FileStreamMock>> const& mock)
         {
-            EXPECT_CALL(*mock, readAll(testing::_))
-                .WillRepeatedly(
-                    [this](std::function<bool(std::string_view data)> cb)
-                        -> std::future<std::expected<std::size_t, SecureShell::SftpError>> {
-                        onRead_ = std::move(cb);
-                        readPromise_ = {};
-                        if (!readCycleQueue_.empty())
-                        {
-                            readCycleQueue_.front()();
-                            readCycleQueue_.pop();
-                        }
-                        return readPromise_.get_future();
-                    });
+            using ReadCallback = std::function<void(std::expected<std::size_t, SecureShell::SftpError>&&)>;
+            using ChunkCallback = std::function<bool(std::string_view)>;
+            EXPECT_CALL(*mock, readPipelined(testing::_, testing::_, testing::_, testing::_))
+                .WillRepeatedly([this](
+                                    std::size_t,
+                                    ChunkCallback onChunk,
+                                    ReadCallback onComplete,
+                                    std::shared_ptr<SecureShell::ReadWindow> const&) {
+                    if (readCycleQueue_.empty())
+                        throw std::runtime_error("No read cycle enqueued.");
+
+                    // Plays all enqueued cycles at once, like a pipeline whose responses all arrived:
+                    std::string buffer(fakeFileContent_.size(), '\0');
+                    std::size_t total = 0;
+                    while (!readCycleQueue_.empty())
+                    {
+                        std::optional<std::expected<std::size_t, SecureShell::SftpError>> result{};
+                        readCycleQueue_.front()(
+                            buffer.data(),
+                            buffer.size(),
+                            [&result](std::expected<std::size_t, SecureShell::SftpError>&& cycleResult) {
+                                result = std::move(cycleResult);
+                            });
+                        readCycleQueue_.pop();
+
+                        if (!result->has_value())
+                            return onComplete(std::unexpected(result->error()));
+                        if (result->value() == 0)
+                            return onComplete(total);
+
+                        total += result->value();
+                        if (!onChunk({buffer.data(), result->value()}))
+                            return onComplete(total);
+                    }
+                });
+        }
+
+        // Serves ranges of fakeFileContent_ right away, in small chunks.
+        void giveMockRangeRead(
+            std::shared_ptr<::testing::NiceMock<SecureShell::Test::FileStreamMock>> const& mock,
+            std::vector<std::uint64_t>* requestedOffsets = nullptr)
+        {
+            using ReadCallback = std::function<void(std::expected<std::size_t, SecureShell::SftpError>&&)>;
+            using ChunkCallback = std::function<bool(std::string_view)>;
+            EXPECT_CALL(
+                *mock, readRangePipelined(testing::_, testing::_, testing::_, testing::_, testing::_, testing::_))
+                .WillRepeatedly([this, requestedOffsets](
+                                    std::uint64_t offset,
+                                    std::uint64_t length,
+                                    std::size_t,
+                                    ChunkCallback onChunk,
+                                    ReadCallback onComplete,
+                                    std::shared_ptr<SecureShell::ReadWindow> const&) {
+                    if (requestedOffsets)
+                        requestedOffsets->push_back(offset);
+
+                    const auto range = std::string_view{fakeFileContent_}.substr(offset, length);
+                    std::size_t total = 0;
+                    while (total < range.size())
+                    {
+                        const auto chunk = range.substr(total, 7);
+                        total += chunk.size();
+                        if (!onChunk(chunk))
+                            break;
+                    }
+                    onComplete(total);
+                });
         }
 
         void enqueueFakeReadCycle(std::optional<std::size_t> chunkSizeOpt = std::nullopt)
         {
-            readCycleQueue_.push([this, chunkSizeOpt]() {
+            readCycleQueue_.push([this, chunkSizeOpt](
+                                     char* buffer,
+                                     std::size_t bufferSize,
+                                     std::function<void(std::expected<std::size_t, SecureShell::SftpError>&&)>
+                                         onComplete) {
                 auto chunkSize = fakeFileContent_.size();
                 if (chunkSizeOpt)
                     chunkSize = chunkSizeOpt.value();
 
                 if (readOffset_ + chunkSize > fakeFileContent_.size())
                     chunkSize = fakeFileContent_.size() - readOffset_;
+                chunkSize = std::min(chunkSize, bufferSize);
 
-                // EOF:
-                if (chunkSize == 0)
-                {
-                    readPromise_.set_value(readOffset_);
-                    onReadResult_ = onRead_({});
-                    return;
-                }
-
-                if (onRead_)
-                {
-                    onReadResult_ = onRead_(std::string_view{fakeFileContent_}.substr(readOffset_, chunkSize));
-                    readOffset_ += chunkSize;
-                    readPromise_.set_value(readOffset_);
-                    return;
-                }
-                else
-                {
-                    throw std::runtime_error("No read callback set.");
-                }
+                std::copy_n(fakeFileContent_.data() + readOffset_, chunkSize, buffer);
+                readOffset_ += chunkSize;
+                // A chunk size of 0 is EOF:
+                onComplete(chunkSize);
             });
         }
 
@@ -127,11 +173,12 @@ namespace Test
         Utility::TemporaryDirectory isolateDirectory_{programDirectory / "temp", true};
         SecureShell::ProcessingThread processingThread_{};
         std::unique_ptr<SecureShell::ProcessingStrand> strand_{processingThread_.createStrand()};
-        std::promise<std::expected<std::size_t, SecureShell::SftpError>> readPromise_{};
-        std::function<bool(std::string_view data)> onRead_{};
         std::size_t readOffset_{0};
-        std::queue<std::function<void()>> readCycleQueue_{};
-        bool onReadResult_{true};
+        std::queue<std::function<void(
+            char*,
+            std::size_t,
+            std::function<void(std::expected<std::size_t, SecureShell::SftpError>&&)>)>>
+            readCycleQueue_{};
     };
 
     TEST_F(DownloadOperationTests, CanCreateDownloadOperation)
@@ -425,6 +472,30 @@ namespace Test
         EXPECT_TRUE(result.has_value());
     }
 
+    TEST_F(DownloadOperationTests, KnownFileSizeSkipsStatAndFileIsClosedInBackground)
+    {
+        using namespace SecureShell;
+
+        auto fileStream = makeFileStreamMock();
+        EXPECT_CALL(*fileStream, stat()).Times(0);
+        EXPECT_CALL(*fileStream, close(testing::_)).Times(0);
+        EXPECT_CALL(*fileStream, closeInBackground()).Times(1);
+
+        auto options = DownloadOperation::DownloadOperationOptions{
+            .localPath = isolateDirectory_.path() / "file.txt",
+            .fileSize = 0,
+            .closeInBackground = true,
+        };
+        DownloadOperation operation{fileStream, options};
+
+        std::expected<Operation::WorkStatus, Operation::Error> result{Operation::WorkStatus::MoreWork};
+        for (int i = 0; i < 10 && result.has_value() && result.value() != Operation::WorkStatus::Complete; ++i)
+            result = operation.work();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Complete);
+        EXPECT_TRUE(std::filesystem::exists(options.localPath));
+    }
+
     TEST_F(DownloadOperationTests, WorkFailsWithExpiredFileStream)
     {
         using namespace SecureShell;
@@ -447,7 +518,7 @@ namespace Test
         EXPECT_EQ(workResult.error().type, DownloadOperation::ErrorType::FileStreamExpired);
     }
 
-    TEST_F(DownloadOperationTests, WorkCallsReadOnFileStream)
+    TEST_F(DownloadOperationTests, WorkStartsPipelinedReadOnFileStream)
     {
         using namespace SecureShell;
 
@@ -466,6 +537,48 @@ namespace Test
         EXPECT_TRUE(result.has_value());
     }
 
+    TEST_F(DownloadOperationTests, BandwidthLimitHoldsBackReadRequests)
+    {
+        using namespace SecureShell;
+        using ReadCallback = std::function<void(std::expected<std::size_t, SftpError>&&)>;
+        using ChunkCallback = std::function<bool(std::string_view)>;
+
+        auto fileStream = makeFileStreamMock();
+        giveMockDefaultStat(fileStream, 1'000'000);
+        ON_CALL(*fileStream, readLengthLimit()).WillByDefault(testing::Return(1000));
+        std::shared_ptr<ReadWindow> window{};
+        EXPECT_CALL(*fileStream, readPipelined(testing::_, testing::_, testing::_, testing::_))
+            .WillOnce(
+                [&window](std::size_t, ChunkCallback, ReadCallback, std::shared_ptr<ReadWindow> const& readWindow) {
+                    window = readWindow;
+                });
+
+        auto bucket = std::make_shared<TokenBucket>(1000);
+        DownloadOperation operation{
+            fileStream,
+            {
+                .localPath = isolateDirectory_.path() / "file.txt",
+                .readsInFlight = 8,
+                .bandwidthLimiter = BandwidthLimiter{{bucket}},
+            }};
+
+        EXPECT_TRUE(operation.work().has_value());
+        ASSERT_TRUE(window);
+
+        // A quarter second at 1000 bytes per second, not the 16 KB of the unlimited window:
+        EXPECT_EQ(window->reserve(1000), 250);
+        EXPECT_EQ(window->reserve(1000), 0);
+
+        // A higher limit lets more requests out:
+        window->release(250);
+        bucket->rate(8000);
+        EXPECT_TRUE(operation.work().has_value());
+        EXPECT_EQ(window->reserve(1000), 1000);
+        EXPECT_EQ(window->reserve(1000), 1000);
+
+        EXPECT_TRUE(operation.cancel(true).has_value());
+    }
+
     TEST_F(DownloadOperationTests, PrepareReservesSpaceForFile)
     {
         using namespace SecureShell;
@@ -616,4 +729,78 @@ namespace Test
         EXPECT_EQ(std::get<1>(progressCalls.back()), fakeFileContent_.size());
         EXPECT_EQ(std::get<2>(progressCalls.back()), fakeFileContent_.size());
     }
-}
\ No newline at end of file
+
+    TEST_F(DownloadOperationTests, SegmentedDownloadWritesAllSegmentsAtTheirOffsets)
+    {
+        std::vector<std::shared_ptr<::testing::NiceMock<SecureShell::Test::FileStreamMock>>> streams{};
+        for (int i = 0; i != 3; ++i)
+        {
+            streams.push_back(makeFileStreamMock());
+            giveMockDefaultStat(streams.back(), fakeFileContent_.size());
+            giveMockRangeRead(streams.back());
+        }
+
+        auto options = DownloadOperation::DownloadOperationOptions{
+            .localPath = isolateDirectory_.path() / "file.txt",
+            .segmentStreams = {streams[1], streams[2]},
+            .segmentThreshold = 1,
+            .minimumSegmentSize = 16,
+        };
+        DownloadOperation operation{streams[0], options};
+
+        decltype(operation.work()) result;
+        do
+        {
+            result = operation.work();
+            ASSERT_TRUE(result.has_value());
+        } while (result.value() == DownloadOperation::WorkStatus::MoreWork);
+
+        EXPECT_EQ(result.value(), DownloadOperation::WorkStatus::Complete);
+        EXPECT_EQ(readFile(options.localPath), fakeFileContent_);
+        EXPECT_FALSE(std::filesystem::exists(options.localPath.generic_string() + ".filepart.segments"));
+    }
+
+    TEST_F(DownloadOperationTests, SegmentedDownloadContinuesWhereSegmentsStopped)
+    {
+        auto fileStream = makeFileStreamMock();
+        auto segmentStream = makeFileStreamMock();
+        std::vector<std::uint64_t> requestedOffsets{};
+        for (auto const& stream : {fileStream, segmentStream})
+        {
+            giveMockDefaultStat(stream, fakeFileContent_.size());
+            giveMockRangeRead(stream, &requestedOffsets);
+        }
+
+        const auto localPath = isolateDirectory_.path() / "file.txt";
+        const auto half = fakeFileContent_.size() / 2;
+        {
+            // The first segment is complete, the second one is missing its last 10 bytes.
+            std::ofstream partFile{localPath.generic_string() + ".filepart", std::ios::binary};
+            partFile << fakeFileContent_.substr(0, fakeFileContent_.size() - 10);
+            std::ofstream map{localPath.generic_string() + ".filepart.segments"};
+            map << fakeFileContent_.size() << '\n'
+                << 0 << ' ' << half << ' ' << half << '\n'
+                << half << ' ' << fakeFileContent_.size() << ' ' << fakeFileContent_.size() - half - 10 << '\n';
+        }
+
+        auto options = DownloadOperation::DownloadOperationOptions{
+            .localPath = localPath,
+            .tryContinue = true,
+            .segmentStreams = {segmentStream},
+            .segmentThreshold = 1,
+            .minimumSegmentSize = 16,
+        };
+        DownloadOperation operation{fileStream, options};
+
+        decltype(operation.work()) result;
+        do
+        {
+            result = operation.work();
+            ASSERT_TRUE(result.has_value());
+        } while (result.value() == DownloadOperation::WorkStatus::MoreWork);
+
+        ASSERT_EQ(requestedOffsets.size(), 1);
+        EXPECT_EQ(requestedOffsets.front(), fakeFileContent_.size() - 10);
+        EXPECT_EQ(readFile(localPath), fakeFileContent_);
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <backend/sftp/find_listing_parser.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+namespace Test
+{
+    class FindListingParserTests : public ::testing::Test
+    {
+      protected:
+        static std::string record(std::string_view text)
+        {
+            std::string result{text};
+            result.push_back('\0');
+            return result;
+        }
+    };
+
+    TEST_F(FindListingParserTests, OutputBeforeTheMarkerIsSkipped)
+    {
+        FindListingParser parser{};
+        ASSERT_TRUE(parser.feed("Welcome!\nnui-scp-find is not here\n"));
+        EXPECT_FALSE(parser.started());
+
+        ASSERT_TRUE(parser.feed("nui-scp-find\n" + record("d:755:4096:1700000000.5:1000:100:alice:staff:sub")));
+        EXPECT_TRUE(parser.started());
+        EXPECT_EQ(parser.takeEntries().size(), 1);
+    }
+
+    TEST_F(FindListingParserTests, EntriesAreParsed)
+    {
+        FindListingParser parser{};
+        ASSERT_TRUE(parser.feed(
+            "nui-scp-find\n" + record("d:755:4096:1700000000.5:1000:100:alice:staff:sub") +
+            record("f:4644:42:1700000001.0000000000:1000:100:alice:staff:sub/a file.txt") +
+            record("l:777:7:1700000002.0:0:0:root:root:link")));
+
+        const auto entries = parser.takeEntries();
+        ASSERT_EQ(entries.size(), 3);
+        EXPECT_TRUE(entries[0].isDirectory());
+        EXPECT_EQ(entries[0].path, "sub");
+
+        EXPECT_TRUE(entries[1].isRegularFile());
+        EXPECT_EQ(entries[1].path, "sub/a file.txt");
+        EXPECT_EQ(entries[1].size, 42);
+        EXPECT_EQ(entries[1].mtime, 1700000001);
+        EXPECT_EQ(entries[1].permissions, static_cast<std::filesystem::perms>(04644));
+        EXPECT_EQ(entries[1].uid, 1000);
+        EXPECT_EQ(entries[1].gid, 100);
+        EXPECT_EQ(entries[1].owner, "alice");
+        EXPECT_EQ(entries[1].group, "staff");
+
+        EXPECT_TRUE(entries[2].isSymlink());
+        EXPECT_TRUE(parser.takeEntries().empty());
+    }
+
+    TEST_F(FindListingParserTests, OwnerAndGroupWithSpacesKeepThePathIntact)
+    {
+        FindListingParser parser{};
+        ASSERT_TRUE(parser.feed(
+            "nui-scp-find\n" + record("f:644:3:1700000000.0:1000:513:jane doe:domain users:dir/a b:c.txt")));
+
+        const auto entries = parser.takeEntries();
+        ASSERT_EQ(entries.size(), 1);
+        EXPECT_EQ(entries[0].path, "dir/a b:c.txt");
+        EXPECT_EQ(entries[0].owner, "jane doe");
+        EXPECT_EQ(entries[0].group, "domain users");
+        EXPECT_EQ(entries[0].uid, 1000);
+        EXPECT_EQ(entries[0].gid, 513);
+    }
+
+    TEST_F(FindListingParserTests, RecordsSplitAcrossFeedsAreReassembled)
+    {
+        FindListingParser parser{};
+        const auto output = "nui-scp-find\n" + record("f:644:1:1700000000.0:0:0:root:root:name\nwith newline") +
+            record("end 0");
+        for (char c : output)
+            ASSERT_TRUE(parser.feed(std::string_view{&c, 1}));
+
+        const auto entries = parser.takeEntries();
+        ASSERT_EQ(entries.size(), 1);
+        EXPECT_EQ(entries[0].path, "name\nwith newline");
+        ASSERT_TRUE(parser.exitStatus().has_value());
+        EXPECT_EQ(*parser.exitStatus(), 0);
+    }
+
+    TEST_F(FindListingParserTests, ExitStatusOfFindIsReported)
+    {
+        FindListingParser parser{};
+        ASSERT_TRUE(parser.feed("nui-scp-find\n"));
+        EXPECT_FALSE(parser.exitStatus().has_value());
+        ASSERT_TRUE(parser.feed(record("end 1")));
+        ASSERT_TRUE(parser.exitStatus().has_value());
+        EXPECT_EQ(*parser.exitStatus(), 1);
+    }
+
+    TEST_F(FindListingParserTests, MalformedEntryIsAnError)
+    {
+        FindListingParser parser{};
+        EXPECT_FALSE(parser.feed("nui-scp-find\n" + record("f:644:many:1700000000.0:0:0:root:root:name")));
+    }
+
+    TEST_F(FindListingParserTests, OutputWithoutMarkerIsAnErrorOnceItIsTooLong)
+    {
+        FindListingParser parser{};
+        const std::string noise(1024, 'x');
+        bool failed = false;
+        for (int i = 0; i < 128 && !failed; ++i)
+            failed = !parser.feed(noise).has_value();
+        EXPECT_TRUE(failed);
+        EXPECT_FALSE(parser.started());
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <backend/sftp/local_file_writer.hpp>
+#include <utility/temporary_directory.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+extern std::filesystem::path programDirectory;
+
+namespace Test
+{
+    class LocalFileWriterTests : public ::testing::Test
+    {
+      protected:
+        std::filesystem::path makeFile(std::string const& content)
+        {
+            const auto path = isolateDirectory_.path() / "file.bin";
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            file << content;
+            return path;
+        }
+
+        std::string readFile(std::filesystem::path const& path)
+        {
+            std::ifstream file{path, std::ios::binary};
+            return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        }
+
+        Utility::TemporaryDirectory isolateDirectory_{programDirectory / "temp", true};
+    };
+
+    TEST_F(LocalFileWriterTests, CannotOpenMissingFile)
+    {
+        LocalFileWriter writer{isolateDirectory_.path() / "missing.bin", {}};
+        EXPECT_FALSE(writer.isOpen());
+    }
+
+    TEST_F(LocalFileWriterTests, WritesDataAtItsOffsets)
+    {
+        const auto path = makeFile(std::string(20, 'x'));
+        LocalFileWriter writer{path, {.blockSize = 4}};
+        ASSERT_TRUE(writer.isOpen());
+
+        writer.write(10, "abc");
+        writer.write(0, "0123");
+        writer.write(13, "def");
+        EXPECT_TRUE(writer.close().has_value());
+
+        EXPECT_EQ(readFile(path), "0123xxxxxxabcdefxxxx");
+    }
+
+    TEST_F(LocalFileWriterTests, SyncWaitsForAllBlocks)
+    {
+        const auto path = makeFile("");
+        std::atomic<int> written{0};
+        LocalFileWriter writer{
+            path,
+            {
+                .blockSize = 8,
+                .maxQueuedBlocks = 2,
+                .onWritten =
+                    [&written]() {
+                        ++written;
+                    },
+            }};
+
+        std::string expected{};
+        for (int i = 0; i != 100; ++i)
+        {
+            const auto data = std::to_string(i) + ";";
+            writer.write(expected.size(), data);
+            expected += data;
+        }
+        ASSERT_TRUE(writer.sync().has_value());
+
+        EXPECT_FALSE(writer.full());
+        EXPECT_EQ(written.load(), static_cast<int>((expected.size() + 7) / 8));
+        EXPECT_EQ(readFile(path), expected);
+    }
+
+    TEST_F(LocalFileWriterTests, WritersShareThePoolThreads)
+    {
+        const auto firstPath = makeFile("");
+        const auto secondPath = isolateDirectory_.path() / "second.bin";
+        std::ofstream{secondPath, std::ios::binary};
+
+        auto pool = std::make_shared<LocalFileWritePool>(1);
+        std::mutex mutex{};
+        std::set<std::thread::id> threads{};
+        auto onWritten = [&mutex, &threads]() {
+            std::scoped_lock lock{mutex};
+            threads.insert(std::this_thread::get_id());
+        };
+
+        LocalFileWriter first{firstPath, {.blockSize = 4, .onWritten = onWritten, .pool = pool}};
+        LocalFileWriter second{secondPath, {.blockSize = 4, .onWritten = onWritten, .pool = pool}};
+        ASSERT_TRUE(first.isOpen());
+        ASSERT_TRUE(second.isOpen());
+
+        first.write(0, "first file");
+        second.write(0, "second file");
+        EXPECT_TRUE(first.close().has_value());
+        EXPECT_TRUE(second.close().has_value());
+
+        EXPECT_EQ(readFile(firstPath), "first file");
+        EXPECT_EQ(readFile(secondPath), "second file");
+        EXPECT_EQ(threads.size(), 1);
+    }
+
+    TEST_F(LocalFileWriterTests, WriterCanBeClosedWhilePoolIsBusy)
+    {
+        const auto path = makeFile("");
+        auto pool = std::make_shared<LocalFileWritePool>(1);
+        std::atomic_bool release{false};
+        pool->post([&release]() {
+            while (!release)
+                std::this_thread::yield();
+        });
+
+        LocalFileWriter writer{path, {.blockSize = 4, .pool = pool}};
+        writer.write(0, "written once the pool is free");
+        std::thread releaser{[&release]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            release = true;
+        }};
+        EXPECT_TRUE(writer.close().has_value());
+        releaser.join();
+
+        EXPECT_EQ(readFile(path), "written once the pool is free");
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <backend/sftp/pending_progress.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <tuple>
+
+namespace Test
+{
+    class PendingProgressTests : public ::testing::Test
+    {
+      protected:
+        static SharedData::DownloadProgress download(std::string const& id, std::uint64_t current)
+        {
+            return SharedData::DownloadProgress{
+                .operationId = Ids::makeOperationId(id),
+                .min = 0,
+                .max = 100,
+                .current = current,
+            };
+        }
+
+        PendingProgress pending_{};
+    };
+
+    TEST_F(PendingProgressTests, OnlyTheFirstProgressSchedulesABatch)
+    {
+        EXPECT_TRUE(pending_.add(&SharedData::ProgressBatch::downloads, download("a", 1)));
+        EXPECT_FALSE(pending_.add(&SharedData::ProgressBatch::downloads, download("b", 1)));
+        EXPECT_FALSE(pending_.add(&SharedData::ProgressBatch::downloads, download("a", 2)));
+
+        std::ignore = pending_.take();
+        EXPECT_TRUE(pending_.add(&SharedData::ProgressBatch::downloads, download("a", 3)));
+    }
+
+    TEST_F(PendingProgressTests, KeepsOnlyTheLatestProgressOfAnOperation)
+    {
+        pending_.add(&SharedData::ProgressBatch::downloads, download("a", 1));
+        pending_.add(&SharedData::ProgressBatch::downloads, download("b", 5));
+        pending_.add(&SharedData::ProgressBatch::downloads, download("a", 2));
+
+        const auto batch = pending_.take();
+        ASSERT_EQ(batch.downloads.size(), 2);
+        EXPECT_EQ(batch.downloads[0].operationId.value(), "a");
+        EXPECT_EQ(batch.downloads[0].current, 2);
+        EXPECT_EQ(batch.downloads[1].operationId.value(), "b");
+        EXPECT_EQ(batch.downloads[1].current, 5);
+        EXPECT_TRUE(pending_.take().downloads.empty());
+    }
+
+    TEST_F(PendingProgressTests, CompletionTakesTheFinalProgressFirst)
+    {
+        pending_.add(&SharedData::ProgressBatch::downloads, download("a", 50));
+        pending_.add(&SharedData::ProgressBatch::downloads, download("a", 100));
+        pending_.add(&SharedData::ProgressBatch::downloads, download("b", 10));
+
+        // Everything pending goes out with the completion, so the final progress precedes it:
+        const auto batch = pending_.complete(Ids::makeOperationId("a"));
+        ASSERT_EQ(batch.downloads.size(), 2);
+        EXPECT_EQ(batch.downloads[0].current, 100);
+        EXPECT_TRUE(pending_.take().downloads.empty());
+    }
+
+    TEST_F(PendingProgressTests, NoProgressIsKeptAfterCompletion)
+    {
+        pending_.add(&SharedData::ProgressBatch::downloads, download("a", 100));
+        std::ignore = pending_.complete(Ids::makeOperationId("a"));
+
+        // Progress reported late by another thread:
+        EXPECT_FALSE(pending_.add(&SharedData::ProgressBatch::downloads, download("a", 100)));
+        EXPECT_TRUE(pending_.take().downloads.empty());
+    }
+
+    TEST_F(PendingProgressTests, CompletionDoesNotDropOtherOperations)
+    {
+        std::ignore = pending_.complete(Ids::makeOperationId("a"));
+
+        EXPECT_TRUE(pending_.add(&SharedData::ProgressBatch::downloads, download("b", 1)));
+        EXPECT_FALSE(pending_.add(
+            &SharedData::ProgressBatch::uploads,
+            SharedData::UploadProgress{
+                .operationId = Ids::makeOperationId("a"),
+                .min = 0,
+                .max = 10,
+                .current = 1,
+            }));
+
+        const auto batch = pending_.take();
+        ASSERT_EQ(batch.downloads.size(), 1);
+        EXPECT_EQ(batch.downloads.front().operationId.value(), "b");
+        EXPECT_TRUE(batch.uploads.empty());
+    }
+}
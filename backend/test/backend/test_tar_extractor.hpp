@@ -0,0 +1,123 @@
+#pragma once
+
+#include <backend/sftp/tar_extractor.hpp>
+#include <backend/sftp/gzip_decoder.hpp>
+#include "tar_archive.hpp"
+#include <utility/temporary_directory.hpp>
+
+#include <gtest/gtest.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+extern std::filesystem::path programDirectory;
+
+namespace Test
+{
+    class TarExtractorTests : public ::testing::Test
+    {
+      protected:
+        std::string readFile(std::filesystem::path const& path)
+        {
+            std::ifstream file{path, std::ios::binary};
+            return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        }
+
+        Utility::TemporaryDirectory isolateDirectory_{programDirectory / "temp", true};
+    };
+
+    TEST_F(TarExtractorTests, ExtractsEntriesFedInSmallPieces)
+    {
+        const auto archive = TarArchive::entry("./", '5') + TarArchive::entry("./dir/", '5') +
+            TarArchive::entry("./dir/a.txt", '0', "hello") + TarArchive::entry("./b.bin", '0', std::string(1000, 'b')) +
+            TarArchive::entry("./empty", '0') + TarArchive::end();
+
+        TarExtractor extractor{isolateDirectory_.path(), {}};
+        for (std::size_t offset = 0; offset < archive.size(); offset += 7)
+            ASSERT_TRUE(extractor.feed(std::string_view{archive}.substr(offset, 7)).has_value());
+
+        EXPECT_TRUE(extractor.finished());
+        EXPECT_EQ(extractor.bytesExtracted(), 1005);
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "dir" / "a.txt"), "hello");
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "b.bin"), std::string(1000, 'b'));
+        EXPECT_TRUE(std::filesystem::exists(isolateDirectory_.path() / "empty"));
+    }
+
+    TEST_F(TarExtractorTests, LongNamesOverrideTheNextHeader)
+    {
+        const std::string longName = "./" + std::string(150, 'n');
+        const auto archive = TarArchive::entry("././@LongLink", 'L', longName) +
+            TarArchive::entry("./short", '0', "long") + TarArchive::entry("./PaxHeaders/x", 'x', "16 path=./paxed\n") +
+            TarArchive::entry("./ignored", '0', "pax") + TarArchive::end();
+
+        TarExtractor extractor{isolateDirectory_.path(), {}};
+        ASSERT_TRUE(extractor.feed(archive).has_value());
+
+        EXPECT_EQ(readFile(isolateDirectory_.path() / std::string(150, 'n')), "long");
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "paxed"), "pax");
+        EXPECT_FALSE(std::filesystem::exists(isolateDirectory_.path() / "short"));
+        EXPECT_FALSE(std::filesystem::exists(isolateDirectory_.path() / "ignored"));
+    }
+
+    TEST_F(TarExtractorTests, GnuHeadersHaveNoNamePrefix)
+    {
+        // The access and change time of GNU tar --format=gnu, where ustar has the prefix:
+        const auto archive = TarArchive::entry("./gnu", '0', "gnu", TarArchive::gnuMagic, "14712345670 14712345671") +
+            TarArchive::entry("file", '0', "ustar", TarArchive::ustarMagic, "dir") + TarArchive::end();
+
+        std::filesystem::create_directories(isolateDirectory_.path() / "dir");
+        TarExtractor extractor{isolateDirectory_.path(), {}};
+        ASSERT_TRUE(extractor.feed(archive).has_value());
+
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "gnu"), "gnu");
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "dir" / "file"), "ustar");
+    }
+
+    TEST_F(TarExtractorTests, RefusesEntriesOutsideTheDirectory)
+    {
+        TarExtractor extractor{isolateDirectory_.path() / "target", {}};
+        EXPECT_FALSE(extractor.feed(TarArchive::entry("../escaped", '0', "evil")).has_value());
+        EXPECT_FALSE(std::filesystem::exists(isolateDirectory_.path() / "escaped"));
+    }
+
+    TEST_F(TarExtractorTests, DoesNotOverwriteUnlessAllowed)
+    {
+        std::ofstream{isolateDirectory_.path() / "existing"} << "old";
+        const auto archive = TarArchive::entry("./existing", '0', "new") + TarArchive::end();
+
+        TarExtractor refusing{isolateDirectory_.path(), {}};
+        EXPECT_FALSE(refusing.feed(archive).has_value());
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "existing"), "old");
+
+        TarExtractor overwriting{isolateDirectory_.path(), {.mayOverwrite = true}};
+        EXPECT_TRUE(overwriting.feed(archive).has_value());
+        EXPECT_EQ(readFile(isolateDirectory_.path() / "existing"), "new");
+    }
+
+    TEST_F(TarExtractorTests, RejectsCorruptHeaders)
+    {
+        auto archive = TarArchive::entry("./file", '0', "data");
+        archive[0] = 'X';
+        TarExtractor extractor{isolateDirectory_.path(), {}};
+        EXPECT_FALSE(extractor.feed(archive).has_value());
+    }
+
+    TEST_F(TarExtractorTests, GzipDecoderRestoresTheStreamInPieces)
+    {
+        std::string data{};
+        for (int i = 0; i < 100'000; ++i)
+            data += fmt::format("{} ", i);
+        const auto compressed = TarArchive::gzip(data);
+
+        GzipDecoder decoder{};
+        std::string decoded{};
+        for (std::size_t offset = 0; offset < compressed.size(); offset += 1000)
+            ASSERT_TRUE(decoder.decode(std::string_view{compressed}.substr(offset, 1000), decoded).has_value());
+
+        EXPECT_TRUE(decoder.finished());
+        EXPECT_EQ(decoded, data);
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <backend/terminal_frame_exchange.hpp>
+#include <shared_data/terminal_frame.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Test
+{
+    class TerminalFrameExchangeTests : public ::testing::Test
+    {
+      protected:
+        std::vector<std::pair<SharedData::TerminalStream, std::string>> decode(std::string const& frames)
+        {
+            std::vector<std::pair<SharedData::TerminalStream, std::string>> result;
+            const bool complete = SharedData::forEachTerminalFrame(
+                frames, [&result](SharedData::TerminalStream stream, std::string_view payload) {
+                    result.emplace_back(stream, std::string{payload});
+                });
+            EXPECT_TRUE(complete);
+            return result;
+        }
+
+        TerminalFrameExchange exchange_{};
+    };
+
+    TEST_F(TerminalFrameExchangeTests, FramesRoundTripBinaryPayloads)
+    {
+        std::string frames;
+        const std::string binary{"\0\xFF\x01 text", 8};
+        SharedData::appendTerminalFrame(frames, SharedData::TerminalStream::Stdout, binary);
+        SharedData::appendTerminalFrame(frames, SharedData::TerminalStream::Stderr, "");
+        SharedData::appendTerminalFrame(frames, SharedData::TerminalStream::Stdout, std::string(70'000, 'x'));
+
+        const auto decoded = decode(frames);
+        ASSERT_EQ(decoded.size(), 3);
+        EXPECT_EQ(decoded[0].first, SharedData::TerminalStream::Stdout);
+        EXPECT_EQ(decoded[0].second, binary);
+        EXPECT_EQ(decoded[1].first, SharedData::TerminalStream::Stderr);
+        EXPECT_EQ(decoded[1].second, "");
+        EXPECT_EQ(decoded[2].second.size(), 70'000);
+    }
+
+    TEST_F(TerminalFrameExchangeTests, TruncatedFramesAreDetected)
+    {
+        std::string frames;
+        SharedData::appendTerminalFrame(frames, SharedData::TerminalStream::Stdout, "hello");
+        frames.pop_back();
+
+        EXPECT_FALSE(SharedData::forEachTerminalFrame(frames, [](auto, auto) {}));
+        EXPECT_FALSE(SharedData::forEachTerminalFrame(std::string_view{frames}.substr(0, 3), [](auto, auto) {}));
+    }
+
+    TEST_F(TerminalFrameExchangeTests, OnlyTheFirstPushAfterATakeNotifies)
+    {
+        int notifications = 0;
+        exchange_.open("a", {}, [&notifications]() {
+            ++notifications;
+        });
+
+        exchange_.push("a", SharedData::TerminalStream::Stdout, "1");
+        exchange_.push("a", SharedData::TerminalStream::Stderr, "2");
+        EXPECT_EQ(notifications, 1);
+
+        const auto decoded = decode(exchange_.take("a"));
+        ASSERT_EQ(decoded.size(), 2);
+        EXPECT_EQ(decoded[0].second, "1");
+        EXPECT_EQ(decoded[1].first, SharedData::TerminalStream::Stderr);
+        EXPECT_TRUE(exchange_.take("a").empty());
+
+        exchange_.push("a", SharedData::TerminalStream::Stdout, "3");
+        EXPECT_EQ(notifications, 2);
+    }
+
+    TEST_F(TerminalFrameExchangeTests, WritesReachTheWriterOfTheReceiver)
+    {
+        std::string written;
+        exchange_.open(
+            "a",
+            [&written](std::string&& data) {
+                written += data;
+            },
+            {});
+
+        EXPECT_TRUE(exchange_.write("a", "ls\r"));
+        EXPECT_FALSE(exchange_.write("b", "ls\r"));
+        EXPECT_EQ(written, "ls\r");
+    }
+
+    TEST_F(TerminalFrameExchangeTests, AcknowledgementsReachTheReceiverUntilClosed)
+    {
+        std::size_t acknowledged = 0;
+        exchange_.open("a", {}, {}, [&acknowledged](std::size_t bytes) {
+            acknowledged += bytes;
+        });
+
+        EXPECT_TRUE(exchange_.acknowledge("a", 100));
+        EXPECT_TRUE(exchange_.acknowledge("a", 23));
+        EXPECT_FALSE(exchange_.acknowledge("b", 1));
+        EXPECT_EQ(acknowledged, 123);
+
+        exchange_.push("a", SharedData::TerminalStream::Stdout, "x");
+        exchange_.close("a");
+        EXPECT_FALSE(exchange_.acknowledge("a", 1));
+        EXPECT_EQ(acknowledged, 123);
+    }
+
+    TEST_F(TerminalFrameExchangeTests, ClosedReceiversKeepTheirFramesUntilTaken)
+    {
+        exchange_.open("a", [](std::string&&) {}, {});
+        exchange_.push("a", SharedData::TerminalStream::Stdout, "last words");
+        exchange_.close("a");
+
+        EXPECT_FALSE(exchange_.write("a", "x"));
+        exchange_.push("a", SharedData::TerminalStream::Stdout, "ignored");
+
+        const auto decoded = decode(exchange_.take("a"));
+        ASSERT_EQ(decoded.size(), 1);
+        EXPECT_EQ(decoded[0].second, "last words");
+
+        // Gone now:
+        exchange_.push("a", SharedData::TerminalStream::Stdout, "ignored");
+        EXPECT_TRUE(exchange_.take("a").empty());
+    }
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <backend/transfer_connector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Test
+{
+    class TransferConnectorTests : public ::testing::Test
+    {
+      protected:
+        struct Connection
+        {
+            int number;
+        };
+
+        void SetUp() override
+        {
+            connected_.clear();
+            failed_.clear();
+        }
+
+        auto onConnected()
+        {
+            return [this](std::unique_ptr<Connection> connection) {
+                std::scoped_lock lock{mutex_};
+                connected_.push_back(connection->number);
+                arrived_.notify_all();
+            };
+        }
+
+        auto onFailed()
+        {
+            return [this](std::string const& error) {
+                std::scoped_lock lock{mutex_};
+                failed_.push_back(error);
+                arrived_.notify_all();
+            };
+        }
+
+        bool waitForResults(std::size_t count)
+        {
+            std::unique_lock lock{mutex_};
+            return arrived_.wait_for(lock, std::chrono::seconds{5}, [this, count]() {
+                return connected_.size() + failed_.size() >= count;
+            });
+        }
+
+      protected:
+        std::mutex mutex_{};
+        std::condition_variable arrived_{};
+        std::vector<int> connected_{};
+        std::vector<std::string> failed_{};
+    };
+
+    TEST_F(TransferConnectorTests, ConnectsInTheBackground)
+    {
+        std::mutex gateMutex{};
+        std::condition_variable gateChanged{};
+        bool open = false;
+
+        TransferConnector<Connection> connector{};
+        connector.connect(
+            2,
+            [&]() -> TransferConnector<Connection>::ConnectResult {
+                std::unique_lock lock{gateMutex};
+                gateChanged.wait(lock, [&open]() {
+                    return open;
+                });
+                return std::make_unique<Connection>(Connection{.number = 1});
+            },
+            onConnected(),
+            onFailed());
+
+        // connect returned while both connections are still opening:
+        EXPECT_EQ(connector.connecting(), 2);
+        {
+            std::scoped_lock lock{gateMutex};
+            open = true;
+        }
+        gateChanged.notify_all();
+
+        ASSERT_TRUE(waitForResults(2));
+        EXPECT_EQ(connected_.size(), 2);
+    }
+
+    TEST_F(TransferConnectorTests, ConnectsInParallel)
+    {
+        constexpr int count = 3;
+        std::mutex gateMutex{};
+        std::condition_variable gateChanged{};
+        int inside = 0;
+
+        TransferConnector<Connection> connector{};
+        connector.connect(
+            count,
+            [&]() -> TransferConnector<Connection>::ConnectResult {
+                std::unique_lock lock{gateMutex};
+                const int number = ++inside;
+                gateChanged.notify_all();
+                // Only finishes once all connections are opening at the same time:
+                if (!gateChanged.wait_for(lock, std::chrono::seconds{5}, [&inside]() {
+                        return inside == count;
+                    }))
+                    return std::unexpected("Connections were opened one after another");
+                return std::make_unique<Connection>(Connection{.number = number});
+            },
+            onConnected(),
+            onFailed());
+
+        ASSERT_TRUE(waitForResults(count));
+        EXPECT_EQ(connected_.size(), count);
+        EXPECT_TRUE(failed_.empty());
+    }
+
+    TEST_F(TransferConnectorTests, FailedConnectionDoesNotStopTheOthers)
+    {
+        std::atomic_int attempt = 0;
+
+        TransferConnector<Connection> connector{};
+        connector.connect(
+            3,
+            [&attempt]() -> TransferConnector<Connection>::ConnectResult {
+                const int number = ++attempt;
+                if (number == 1)
+                    return std::unexpected("Failed to authenticate");
+                return std::make_unique<Connection>(Connection{.number = number});
+            },
+            onConnected(),
+            onFailed());
+
+        ASSERT_TRUE(waitForResults(3));
+        EXPECT_EQ(connected_.size(), 2);
+        ASSERT_EQ(failed_.size(), 1);
+        EXPECT_EQ(failed_.front(), "Failed to authenticate");
+    }
+
+    TEST_F(TransferConnectorTests, DestructionWaitsForConnectionsStillOpening)
+    {
+        std::atomic_bool finished = false;
+        {
+            TransferConnector<Connection> connector{};
+            connector.connect(
+                1,
+                [&finished]() -> TransferConnector<Connection>::ConnectResult {
+                    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+                    finished = true;
+                    return std::unexpected("Canceled");
+                },
+                [](auto) {},
+                [](auto const&) {});
+        }
+        EXPECT_TRUE(finished);
+    }
+}
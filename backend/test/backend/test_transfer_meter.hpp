@@ -0,0 +1,59 @@
+#pragma once
+
+#include <backend/sftp/transfer_meter.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+namespace Test
+{
+    class TransferMeterTests : public ::testing::Test
+    {
+      protected:
+        using Clock = TransferMeter::Clock;
+    };
+
+    TEST_F(TransferMeterTests, FirstSampleOnlySetsTheBaseline)
+    {
+        const auto start = Clock::now();
+        TransferMeter meter{start};
+        meter.sample(1'000'000, 2'000'000, start + std::chrono::seconds{1});
+        EXPECT_EQ(meter.bytesPerSecond(), 0.0);
+        EXPECT_FALSE(meter.eta().has_value());
+    }
+
+    TEST_F(TransferMeterTests, SteadyRateIsApproached)
+    {
+        const auto start = Clock::now();
+        TransferMeter meter{start};
+        for (int i = 0; i <= 60; ++i)
+            meter.sample(i * 1000ull, 100'000, start + std::chrono::seconds{i});
+
+        EXPECT_NEAR(meter.bytesPerSecond(), 1000.0, 1.0);
+        ASSERT_TRUE(meter.eta().has_value());
+        EXPECT_NEAR(static_cast<double>(meter.eta()->count()), 40.0, 1.0);
+    }
+
+    TEST_F(TransferMeterTests, FinishedTransferHasNoTimeLeft)
+    {
+        const auto start = Clock::now();
+        TransferMeter meter{start};
+        meter.sample(0, 1000, start);
+        meter.sample(1000, 1000, start + std::chrono::seconds{1});
+        ASSERT_TRUE(meter.eta().has_value());
+        EXPECT_EQ(meter.eta()->count(), 0);
+    }
+
+    TEST_F(TransferMeterTests, StallsWithoutProgress)
+    {
+        const auto start = Clock::now();
+        TransferMeter meter{start};
+        meter.sample(0, 1000, start);
+        meter.sample(100, 1000, start + std::chrono::seconds{1});
+        meter.sample(100, 1000, start + std::chrono::seconds{10});
+
+        EXPECT_FALSE(meter.stalled(start + std::chrono::seconds{10}));
+        EXPECT_TRUE(meter.stalled(start + std::chrono::seconds{1} + TransferMeter::stallTime));
+    }
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <backend/sftp/upload_operation.hpp>
+#include <ssh/mocks/file_stream_mock.hpp>
+#include <ssh/mocks/sftp_session_mock.hpp>
+#include <utility/temporary_directory.hpp>
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using namespace std::string_literals;
+
+extern std::filesystem::path programDirectory;
+
+namespace Test
+{
+    class UploadOperationTests : public ::testing::Test
+    {
+      protected:
+        using VoidCallback = std::function<void(std::expected<void, SecureShell::SftpError>&&)>;
+        using StatCallback = std::function<void(std::expected<SecureShell::FileInformation, SecureShell::SftpError>&&)>;
+        using OpenCallback =
+            std::function<void(std::expected<std::weak_ptr<SecureShell::IFileStream>, SecureShell::SftpError>&&)>;
+        using WriteCallback = std::function<void(std::expected<std::size_t, SecureShell::SftpError>&&)>;
+
+        void SetUp() override
+        {
+            for (int i = 0; i != 1000; ++i)
+                localContent_ += "This is a test file content.\n";
+            std::ofstream{localPath(), std::ios::binary} << localContent_;
+
+            processingThread_.start(5ms);
+
+            ON_CALL(*sftp_, strand()).WillByDefault([this]() {
+                return strand_.get();
+            });
+            ON_CALL(*sftp_, stat(testing::_, testing::_))
+                .WillByDefault([this](std::filesystem::path const& path, StatCallback onComplete) {
+                    reply([this, path, onComplete = std::move(onComplete)]() {
+                        if (auto file = remoteFiles_.find(path.generic_string()); file != remoteFiles_.end())
+                        {
+                            onComplete(
+                                SecureShell::FileInformation{
+                                    .path = path,
+                                    .type = SharedData::FileType::Regular,
+                                    .size = file->second.size(),
+                                });
+                        }
+                        else
+                            onComplete(std::unexpected(SecureShell::SftpError{.message = "No such file"}));
+                    });
+                });
+            ON_CALL(*sftp_, openFile(testing::_, testing::_, testing::_, testing::_))
+                .WillByDefault([this](
+                                   std::filesystem::path const& path,
+                                   SecureShell::ISftpSession::OpenType openType,
+                                   std::filesystem::perms,
+                                   OpenCallback onComplete) {
+                    reply([this, path, openType, onComplete = std::move(onComplete)]() {
+                        using enum SecureShell::ISftpSession::OpenType;
+                        openedPath_ = path.generic_string();
+                        if ((static_cast<int>(openType) & static_cast<int>(Truncate)) != 0)
+                            remoteFiles_[openedPath_].clear();
+                        else
+                            remoteFiles_[openedPath_];
+                        onComplete(std::weak_ptr<SecureShell::IFileStream>{stream_});
+                    });
+                });
+            ON_CALL(*sftp_, rename(testing::_, testing::_, testing::_))
+                .WillByDefault([this](
+                                   std::filesystem::path const& source,
+                                   std::filesystem::path const& destination,
+                                   VoidCallback onComplete) {
+                    reply([this, source, destination, onComplete = std::move(onComplete)]() {
+                        if (remoteFiles_.contains(destination.generic_string()))
+                            return onComplete(std::unexpected(SecureShell::SftpError{.message = "File exists"}));
+                        moveRemoteFile(source, destination);
+                        onComplete({});
+                    });
+                });
+            ON_CALL(*sftp_, renameReplacing(testing::_, testing::_, testing::_))
+                .WillByDefault([this](
+                                   std::filesystem::path const& source,
+                                   std::filesystem::path const& destination,
+                                   VoidCallback onComplete) {
+                    reply([this, source, destination, onComplete = std::move(onComplete)]() {
+                        moveRemoteFile(source, destination);
+                        onComplete({});
+                    });
+                });
+            ON_CALL(*sftp_, chmod(testing::_, testing::_, testing::_))
+                .WillByDefault([this](std::filesystem::path const&, std::filesystem::perms, VoidCallback onComplete) {
+                    reply([onComplete = std::move(onComplete)]() {
+                        onComplete({});
+                    });
+                });
+
+            ON_CALL(*stream_, strand()).WillByDefault([this]() -> SecureShell::ProcessingStrand* {
+                return strand_.get();
+            });
+            ON_CALL(*stream_, writeLengthLimit()).WillByDefault(testing::Return(4096));
+            ON_CALL(*stream_, seek(testing::_, testing::_))
+                .WillByDefault([this](std::size_t pos, VoidCallback onComplete) {
+                    reply([this, pos, onComplete = std::move(onComplete)]() {
+                        writePosition_ = pos;
+                        onComplete({});
+                    });
+                });
+            ON_CALL(*stream_, writePipelined(testing::_, testing::_, testing::_))
+                .WillByDefault(
+                    [this](std::size_t, std::shared_ptr<SecureShell::PipelinedWriteSource> source, WriteCallback done) {
+                        writeSource_ = std::move(source);
+                        writeDone_ = std::move(done);
+                    });
+        }
+
+        void TearDown() override
+        {
+            processingThread_.stop();
+        }
+
+        std::filesystem::path localPath() const
+        {
+            return isolateDirectory_.path() / "local.txt";
+        }
+
+        void moveRemoteFile(std::filesystem::path const& source, std::filesystem::path const& destination)
+        {
+            auto node = remoteFiles_.extract(source.generic_string());
+            remoteFiles_[destination.generic_string()] = std::move(node.mapped());
+        }
+
+        // Server replies are held back until answer is called, like a server with a round trip time would.
+        void reply(std::function<void()> answer)
+        {
+            replies_.push_back(std::move(answer));
+        }
+
+        void answer()
+        {
+            auto replies = std::exchange(replies_, {});
+            for (auto& reply : replies)
+                reply();
+
+            if (!writeSource_)
+                return;
+            std::string block{};
+            for (;;)
+            {
+                const auto next = writeSource_->next(block);
+                if (next == SecureShell::PipelinedWriteSource::NextBlock::Block)
+                {
+                    auto& file = remoteFiles_[openedPath_];
+                    file.resize(std::max(file.size(), writePosition_ + block.size()));
+                    std::copy(block.begin(), block.end(), file.begin() + static_cast<std::ptrdiff_t>(writePosition_));
+                    writePosition_ += block.size();
+                    written_ += block.size();
+                    blockSizes_.push_back(block.size());
+                    writeSource_->confirm(block.size());
+                    continue;
+                }
+                if (next == SecureShell::PipelinedWriteSource::NextBlock::Finished)
+                {
+                    writeSource_.reset();
+                    std::exchange(writeDone_, {})(written_);
+                }
+                break;
+            }
+        }
+
+        std::expected<Operation::WorkStatus, Operation::Error> runToCompletion(UploadOperation& operation)
+        {
+            for (int i = 0; i != 10000; ++i)
+            {
+                auto result = operation.work();
+                if (!result.has_value() || result.value() == Operation::WorkStatus::Complete)
+                    return result;
+                answer();
+            }
+            return std::unexpected(Operation::Error{.type = Operation::ErrorType::UnknownWorkState});
+        }
+
+        UploadOperation::UploadOperationOptions options(bool mayOverwrite = false)
+        {
+            return UploadOperation::UploadOperationOptions{
+                .localPath = localPath(),
+                .remotePath = "/home/test/remote.txt",
+                .mayOverwrite = mayOverwrite,
+                .readBlockSize = 1024,
+            };
+        }
+
+      protected:
+        std::string localContent_{};
+        Utility::TemporaryDirectory isolateDirectory_{programDirectory / "temp", true};
+        SecureShell::ProcessingThread processingThread_{};
+        std::unique_ptr<SecureShell::ProcessingStrand> strand_{processingThread_.createStrand()};
+        std::shared_ptr<::testing::NiceMock<SecureShell::Test::SftpSessionMock>> sftp_{
+            std::make_shared<::testing::NiceMock<SecureShell::Test::SftpSessionMock>>()};
+        std::shared_ptr<::testing::NiceMock<SecureShell::Test::FileStreamMock>> stream_{
+            std::make_shared<::testing::NiceMock<SecureShell::Test::FileStreamMock>>()};
+        std::map<std::string, std::string> remoteFiles_{};
+        std::string openedPath_{};
+        std::size_t writePosition_{0};
+        std::size_t written_{0};
+        std::vector<std::size_t> blockSizes_{};
+        std::deque<std::function<void()>> replies_{};
+        std::shared_ptr<SecureShell::PipelinedWriteSource> writeSource_{};
+        WriteCallback writeDone_{};
+    };
+
+    TEST_F(UploadOperationTests, UploadsIntoTemporaryFileAndRenamesItIntoPlace)
+    {
+        EXPECT_CALL(*sftp_, renameReplacing(testing::_, testing::_, testing::_)).Times(0);
+        EXPECT_CALL(*sftp_, removeFile(testing::_, testing::_)).Times(0);
+
+        UploadOperation operation{*sftp_, options()};
+        const auto result = runToCompletion(operation);
+        ASSERT_TRUE(result.has_value()) << result.error().toString();
+        EXPECT_EQ(operation.state(), SharedData::OperationState::Completed);
+
+        EXPECT_EQ(remoteFiles_.size(), 1);
+        EXPECT_EQ(remoteFiles_["/home/test/remote.txt"], localContent_);
+    }
+
+    TEST_F(UploadOperationTests, WaitsForTheServerInsteadOfBlocking)
+    {
+        UploadOperation operation{*sftp_, options()};
+
+        // Every server call is answered only after work returned, a blocking operation would never get there:
+        auto result = operation.work();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+        EXPECT_EQ(replies_.size(), 1);
+        EXPECT_EQ(operation.work().value(), Operation::WorkStatus::Waiting);
+        EXPECT_EQ(replies_.size(), 1);
+
+        answer();
+        result = operation.work();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), Operation::WorkStatus::Waiting);
+        EXPECT_EQ(openedPath_, "");
+        answer();
+        EXPECT_EQ(openedPath_, "/home/test/remote.txt.filepart");
+
+        EXPECT_TRUE(runToCompletion(operation).has_value());
+    }
+
+    TEST_F(UploadOperationTests, BandwidthLimitKeepsBlocksWhole)
+    {
+        // The burst of 1000 bytes is smaller than a block, the bucket refills a byte every 0.1 ms afterwards:
+        auto uploadOptions = options();
+        uploadOptions.bandwidthLimiter = BandwidthLimiter{{std::make_shared<TokenBucket>(10'000)}};
+        UploadOperation operation{*sftp_, uploadOptions};
+
+        for (int i = 0; i != 30; ++i)
+        {
+            auto result = operation.work();
+            ASSERT_TRUE(result.has_value());
+            answer();
+            std::this_thread::sleep_for(1ms);
+        }
+
+        // Each write request carries a whole block and the limit holds the next one back until the debt is paid:
+        ASSERT_FALSE(blockSizes_.empty());
+        EXPECT_LE(blockSizes_.size(), 3);
+        for (auto size : blockSizes_)
+            EXPECT_EQ(size, uploadOptions.readBlockSize);
+    }
+
+    TEST_F(UploadOperationTests, DoesNotOverwriteExistingTargetUnlessAllowed)
+    {
+        remoteFiles_["/home/test/remote.txt"] = "existing";
+        EXPECT_CALL(*sftp_, openFile(testing::_, testing::_, testing::_, testing::_)).Times(0);
+
+        UploadOperation operation{*sftp_, options()};
+        const auto result = runToCompletion(operation);
+        ASSERT_FALSE(result.has_value());
+        EXPECT_EQ(result.error().type, Operation::ErrorType::FileExists);
+        EXPECT_EQ(remoteFiles_["/home/test/remote.txt"], "existing");
+    }
+
+    TEST_F(UploadOperationTests, OverwritingReplacesTheTargetInOneStep)
+    {
+        remoteFiles_["/home/test/remote.txt"] = "existing";
+        // Removing the target first would leave it missing if the rename failed:
+        EXPECT_CALL(*sftp_, removeFile(testing::_, testing::_)).Times(0);
+        EXPECT_CALL(*sftp_, rename(testing::_, testing::_, testing::_)).Times(0);
+        EXPECT_CALL(*sftp_, renameReplacing(testing::_, testing::_, testing::_)).Times(1);
+
+        UploadOperation operation{*sftp_, options(true)};
+        const auto result = runToCompletion(operation);
+        ASSERT_TRUE(result.has_value()) << result.error().toString();
+        EXPECT_EQ(remoteFiles_["/home/test/remote.txt"], localContent_);
+    }
+
+    TEST_F(UploadOperationTests, ContinuesAnIncompletePart)
+    {
+        remoteFiles_["/home/test/remote.txt.filepart"] = localContent_.substr(0, 100);
+        EXPECT_CALL(*stream_, seek(100, testing::_)).Times(1);
+
+        auto uploadOptions = options();
+        uploadOptions.tryContinue = true;
+        UploadOperation operation{*sftp_, uploadOptions};
+        const auto result = runToCompletion(operation);
+        ASSERT_TRUE(result.has_value()) << result.error().toString();
+        EXPECT_EQ(written_, localContent_.size() - 100);
+        EXPECT_EQ(remoteFiles_["/home/test/remote.txt"], localContent_);
+    }
+
+    TEST_F(UploadOperationTests, SetsPermissionsAfterTheRename)
+    {
+        testing::InSequence sequence;
+        EXPECT_CALL(*sftp_, rename(testing::_, std::filesystem::path{"/home/test/remote.txt"}, testing::_));
+        EXPECT_CALL(
+            *sftp_, chmod(std::filesystem::path{"/home/test/remote.txt"}, std::filesystem::perms::owner_all, testing::_));
+
+        auto uploadOptions = options();
+        uploadOptions.permissions = std::filesystem::perms::owner_all;
+        UploadOperation operation{*sftp_, uploadOptions};
+        EXPECT_TRUE(runToCompletion(operation).has_value());
+    }
+}
@@ -6,8 +6,10 @@
 #include <frontend/terminal/file_engine.hpp>
 
 #include <shared_data/file_operations/download_progress.hpp>
+#include <shared_data/file_operations/upload_progress.hpp>
 #include <shared_data/file_operations/bulk_download_progress.hpp>
 #include <shared_data/file_operations/scan_progress.hpp>
+#include <shared_data/file_operations/progress_batch.hpp>
 #include <shared_data/file_operations/operation_added.hpp>
 #include <shared_data/file_operations/operation_type.hpp>
 #include <shared_data/file_operations/operation_error_type.hpp>
@@ -40,6 +42,7 @@ class OperationQueue
     void enqueueDownload(
         std::filesystem::path const& remotePath,
         std::filesystem::path const& localPath,
+        SharedData::TransferFilterOptions const& filter,
         std::function<void(std::optional<Ids::OperationId> const&)> onComplete);
     void enqueueUpload(
         std::filesystem::path const& localPath,
@@ -60,7 +63,9 @@ class OperationQueue
     void cancelOperation(OperationCard const& operation);
 
     void onOperationAdded(SharedData::OperationAdded const& added);
+    void onProgress(SharedData::ProgressBatch const& batch);
     void onDownloadProgress(SharedData::DownloadProgress const& progress);
+    void onUploadProgress(SharedData::UploadProgress const& progress);
     void onBulkDownloadProgress(SharedData::BulkDownloadProgress const& progress);
     void onScanProgress(SharedData::ScanProgress const& progress);
     void onOperationCompleted(Nui::val val);
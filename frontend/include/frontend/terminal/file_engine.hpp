@@ -1,6 +1,7 @@
 #pragma once
 
 #include <shared_data/directory_entry.hpp>
+#include <shared_data/transfer_filter.hpp>
 #include <ids/ids.hpp>
 
 #include <filesystem>
@@ -35,9 +36,18 @@ class FileEngine
         std::string const& localPath,
         std::string const& remotePath) */
 
+    /**
+     * @param filter What is skipped when remotePath is a directory.
+     */
     virtual void addDownload(
         std::filesystem::path const& remotePath,
         std::filesystem::path const& localPath,
+        SharedData::TransferFilterOptions const& filter,
+        std::function<void(std::optional<Ids::OperationId>)> onOperationCreated) = 0;
+
+    virtual void addUpload(
+        std::filesystem::path const& localPath,
+        std::filesystem::path const& remotePath,
         std::function<void(std::optional<Ids::OperationId>)> onOperationCreated) = 0;
 
     virtual void dispose() = 0;
@@ -21,6 +21,11 @@ class SftpFileEngine : public FileEngine
     void addDownload(
         std::filesystem::path const& remotePath,
         std::filesystem::path const& localPath,
+        SharedData::TransferFilterOptions const& filter,
+        std::function<void(std::optional<Ids::OperationId>)> onOperationCreated) override;
+    void addUpload(
+        std::filesystem::path const& localPath,
+        std::filesystem::path const& remotePath,
         std::function<void(std::optional<Ids::OperationId>)> onOperationCreated) override;
 
   private:
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <frontend/terminal/channel_interface.hpp>
+#include <frontend/terminal/terminal_frame_link.hpp>
 #include <ids/ids.hpp>
 
 #include <nui/frontend/val.hpp>
@@ -40,8 +41,7 @@ class SshChannel : public ChannelInterface
 
   private:
     Nui::MoveDetector moveDetector_;
-    Nui::RpcClient::AutoUnregister stdoutReceiver_;
-    Nui::RpcClient::AutoUnregister stderrReceiver_;
+    TerminalFrameLink frames_;
     Nui::RpcClient::AutoUnregister onExitReceiver_;
     Ids::ChannelId sshChannelId_;
     Ids::SessionId sshSessionId_;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <shared_data/terminal_frame.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Frontend end of the TerminalFrameExchange of the backend. Fetches binary output frames whenever the backend
+ * is acknowledged in a timeout after it was passed on, which is what lets the backend throttle reading the channel.
+ * is acknowledged once per animation frame, which is what lets the backend throttle reading the channel.
+ */
+class TerminalFrameLink
+{
+  public:
+    TerminalFrameLink() = default;
+
+    /**
+     * @param receiver The receiver name the backend was told about.
+     * @param onOutput Called for every frame with its stream and payload.
+     */
+    TerminalFrameLink(
+        std::string receiver,
+        std::function<void(SharedData::TerminalStream, std::string const&)> onOutput);
+    ~TerminalFrameLink();
+    TerminalFrameLink(TerminalFrameLink const&) = delete;
+    TerminalFrameLink& operator=(TerminalFrameLink const&) = delete;
+    TerminalFrameLink(TerminalFrameLink&&) = default;
+    TerminalFrameLink& operator=(TerminalFrameLink&&) = default;
+
+    /**
+     * @brief Fetches the pending frames now, for instance to get the last output before an exit.
+     *
+     * @param onFetched Called after the frames were passed on.
+     */
+    void fetch(std::function<void()> onFetched = {});
+
+    /**
+     * @brief Writes data to the terminal. Data written while a write is in flight is sent together afterwards.
+     */
+    void write(std::string const& data);
+
+  private:
+    struct State;
+    static void fetchFrames(std::shared_ptr<State> const& state);
+    static void onFramesFetched(std::shared_ptr<State> const& state, std::string const& frames);
+    static void postWrite(std::shared_ptr<State> const& state);
+    static void scheduleAcknowledge(std::shared_ptr<State> const& state);
+
+  private:
+    std::shared_ptr<State> state_{};
+};
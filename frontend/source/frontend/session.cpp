@@ -302,34 +302,74 @@ void Session::setupFileGrid()
                      return;
                  }
 
-                 std::vector<std::pair<std::filesystem::path, std::filesystem::path>> downloadItems;
-                 std::transform(
-                     items.begin(), items.end(), std::back_inserter(downloadItems), [this](auto const& item) {
-                         // TODO: Proper target path handling:
-                         return std::make_pair(
-                             impl_->currentPath / item.path, "D:/DownloadTemp" / item.path.filename());
-                     });
-
-                 Log::info("Downloading items");
-                 for (const auto& item : downloadItems)
-                 {
-                     Log::info("Downloading '{}' to '{}'", item.first.generic_string(), item.second.generic_string());
-                     impl_->operationQueue.enqueueDownload(
-                         item.first, item.second, [this](std::optional<Ids::OperationId> const& opId) {
-                             if (!opId)
+                 auto download = [this, items](SharedData::TransferFilterOptions const& filter) {
+                     std::vector<std::pair<std::filesystem::path, std::filesystem::path>> downloadItems;
+                     std::transform(
+                         items.begin(), items.end(), std::back_inserter(downloadItems), [this](auto const& item) {
+                             // TODO: Proper target path handling:
+                             return std::make_pair(
+                                 impl_->currentPath / item.path, "D:/DownloadTemp" / item.path.filename());
+                         });
+
+                     Log::info("Downloading items");
+                     for (const auto& item : downloadItems)
+                     {
+                         Log::info(
+                             "Downloading '{}' to '{}'", item.first.generic_string(), item.second.generic_string());
+                         impl_->operationQueue.enqueueDownload(
+                             item.first, item.second, filter, [this](std::optional<Ids::OperationId> const& opId) {
+                                 if (!opId)
+                                 {
+                                     Log::error("Failed to create download operation");
+                                     impl_->confirmDialog->open({
+                                         .state = ConfirmDialog::State::Negative,
+                                         .headerText = "Download Failed",
+                                         .text = "Failed to create download operation",
+                                         .buttons = ConfirmDialog::Button::Ok,
+                                     });
+                                     return;
+                                 }
+                                 Log::info("Download operation created with id: {}", opId->value());
+                             });
+                     }
+                 };
+
+                 // Only directories have anything to filter:
+                 const bool hasDirectories = std::any_of(items.begin(), items.end(), [](auto const& item) {
+                     return item.type == NuiFileExplorer::FileGrid::Item::Type::Directory;
+                 });
+                 if (!hasDirectories)
+                     return download({});
+
+                 impl_->inputDialog->open({
+                     .whatFor = "Download filter",
+                     .prompt = "Skip while downloading, like: .git node_modules *.log size>100M age>30d. Leave empty "
+                               "to download everything.",
+                     .headerText = "Filter Directory Downloads",
+                     .isPassword = false,
+                     .onConfirm =
+                         [this, download](std::optional<std::string> const& text) {
+                             if (!text)
                              {
-                                 Log::error("Failed to create download operation");
+                                 Log::info("Download items cancelled");
+                                 return;
+                             }
+
+                             const auto filter = SharedData::parseTransferFilter(*text);
+                             if (!filter)
+                             {
+                                 Log::error("Invalid download filter: {}", filter.error());
                                  impl_->confirmDialog->open({
                                      .state = ConfirmDialog::State::Negative,
-                                     .headerText = "Download Failed",
-                                     .text = "Failed to create download operation",
+                                     .headerText = "Invalid Filter",
+                                     .text = filter.error(),
                                      .buttons = ConfirmDialog::Button::Ok,
                                  });
                                  return;
                              }
-                             Log::info("Download operation created with id: {}", opId->value());
-                         });
-                 }
+                             download(*filter);
+                         },
+                 });
              }});
     });
 
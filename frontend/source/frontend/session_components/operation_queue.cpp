@@ -36,6 +36,28 @@ namespace
     constexpr std::string_view progressHeight{"15px"};
     namespace Svgs = Components::Svg;
 
+    std::string formatTelemetry(SharedData::TransferTelemetry const& telemetry)
+    {
+        const auto bytesPerSecond = static_cast<long long>(telemetry.bytesPerSecond);
+        std::string text = fmt::format(
+            "{}/s", Utility::formatBytes(bytesPerSecond, Utility::determineOrderOfMagnitude(bytesPerSecond)));
+        if (telemetry.stalled)
+            text += ", stalled";
+        else if (telemetry.etaSeconds)
+        {
+            const auto eta = *telemetry.etaSeconds;
+            if (eta >= 3600)
+                text += fmt::format(", {}h {}m left", eta / 3600, (eta % 3600) / 60);
+            else if (eta >= 60)
+                text += fmt::format(", {}m {}s left", eta / 60, eta % 60);
+            else
+                text += fmt::format(", {}s left", eta);
+        }
+        if (telemetry.roundTripMicroseconds)
+            text += fmt::format(", RTT {:.1f} ms", *telemetry.roundTripMicroseconds / 1000.0);
+        return text;
+    }
+
     class OperationCardInterface
     {
       public:
@@ -267,17 +289,18 @@ namespace
         std::shared_ptr<Nui::Observed<bool>> doDeletionCountdown_;
     };
 
-    class DisplayedDownloadOperation : public OperationCard<DisplayedDownloadOperation>
+    class DisplayedTransferOperation : public OperationCard<DisplayedTransferOperation>
     {
       public:
-        DisplayedDownloadOperation(
+        DisplayedTransferOperation(
+            SharedData::OperationType type,
             long long max,
             Ids::OperationId operationId,
             std::filesystem::path localPath,
             std::filesystem::path remotePath,
             std::function<void(OperationCard const& operation)> doRemoveSelf,
             std::shared_ptr<Nui::Observed<bool>> doDeletionCountdown)
-            : OperationCard{SharedData::OperationType::Download, std::move(operationId), std::move(doRemoveSelf), std::move(doDeletionCountdown)}
+            : OperationCard{type, std::move(operationId), std::move(doRemoveSelf), std::move(doDeletionCountdown)}
             , progressBar_{{
                   .height = std::string{progressHeight},
                   .min = 0,
@@ -300,18 +323,31 @@ namespace
             return div{
                 bodyClass()
             }(
-                progressBar_()
+                progressBar_(),
+                div {
+                    style = "margin-top: 8px, font-size: 13px; color: var(--muted);"
+                }(
+                    observe(telemetry_),
+                    [this](){
+                        return telemetry_.value();
+                    }
+                )
             );
             // clang-format on
         }
 
-        void setProgress(long long current)
+        void setProgress(long long current, SharedData::TransferTelemetry const& telemetry)
         {
             progressBar_.setProgress(current);
+            auto text = formatTelemetry(telemetry);
+            if (telemetry_.value() != text)
+                telemetry_ = std::move(text);
         }
 
         std::string title() const override
         {
+            if (type_ == SharedData::OperationType::Upload)
+                return fmt::format("Upload '{}' to '{}'", localPath_.generic_string(), remotePath_.generic_string());
             return fmt::format("Download '{}' to '{}'", remotePath_.generic_string(), localPath_.generic_string());
         }
 
@@ -324,6 +360,7 @@ namespace
         Components::ProgressBar progressBar_;
         std::filesystem::path localPath_;
         std::filesystem::path remotePath_;
+        Nui::Observed<std::string> telemetry_{""};
     };
 
     class DisplayedScanOperation : public OperationCard<DisplayedScanOperation>
@@ -454,6 +491,9 @@ namespace
             fileCurrentIndex = progress.fileCurrentIndex;
             fileCount = progress.fileCount;
 
+            if (auto text = formatTelemetry(progress.telemetry); telemetry.value() != text)
+                telemetry = std::move(text);
+
             Nui::globalEventContext.executeActiveEventsImmediately();
         }
 
@@ -486,7 +526,13 @@ namespace
                             return statusText();
                         }
                     ),
-                    totalProgressBar_()
+                    totalProgressBar_(),
+                    span{}(
+                        observe(telemetry),
+                        [this](){
+                            return telemetry.value();
+                        }
+                    )
                 )
             );
             // clang-format on
@@ -494,6 +540,7 @@ namespace
 
       private:
         Nui::Observed<std::string> currentFile{""};
+        Nui::Observed<std::string> telemetry{""};
         Nui::Observed<std::uint64_t> fileCurrentIndex{0ull};
         Nui::Observed<std::uint64_t> fileCount{0ull};
 
@@ -717,23 +764,9 @@ void OperationQueue::activate(FileEngine* fileEngine, Ids::SessionId sessionId)
 
     impl_->onUpdate.push_back(
         Nui::RpcClient::autoRegisterFunction(
-            fmt::format("OperationQueue::{}::onDownloadProgress", impl_->sessionId.value()),
-            [this](SharedData::DownloadProgress const& progress) {
-                onDownloadProgress(progress);
-            }));
-
-    impl_->onUpdate.push_back(
-        Nui::RpcClient::autoRegisterFunction(
-            fmt::format("OperationQueue::{}::onBulkDownloadProgress", impl_->sessionId.value()),
-            [this](SharedData::BulkDownloadProgress const& progress) {
-                onBulkDownloadProgress(progress);
-            }));
-
-    impl_->onUpdate.push_back(
-        Nui::RpcClient::autoRegisterFunction(
-            fmt::format("OperationQueue::{}::onScanProgress", impl_->sessionId.value()),
-            [this](SharedData::ScanProgress const& progress) {
-                onScanProgress(progress);
+            fmt::format("OperationQueue::{}::onProgress", impl_->sessionId.value()),
+            [this](SharedData::ProgressBatch const& batch) {
+                onProgress(batch);
             }));
 
     impl_->onUpdate.push_back(
@@ -753,7 +786,7 @@ void OperationQueue::onOperationAdded(SharedData::OperationAdded const& added)
 {
     auto makeCard = [&added, this]() -> std::unique_ptr<OperationCardInterface> {
         Log::info("Operation of type '{}' added to frontend queue", Utility::enumToString(added.type));
-        if (added.type == SharedData::OperationType::Download)
+        if (added.type == SharedData::OperationType::Download || added.type == SharedData::OperationType::Upload)
         {
             if (!added.localPath || !added.remotePath)
             {
@@ -762,12 +795,13 @@ void OperationQueue::onOperationAdded(SharedData::OperationAdded const& added)
                     added.operationId.value());
                 return {};
             }
-            return std::make_unique<DisplayedDownloadOperation>(
+            return std::make_unique<DisplayedTransferOperation>(
+                added.type,
                 added.totalBytes ? static_cast<long long>(*added.totalBytes) : 0,
                 added.operationId,
                 *added.localPath,
                 *added.remotePath,
-                [this](OperationCard<DisplayedDownloadOperation> const& operation) {
+                [this](OperationCard<DisplayedTransferOperation> const& operation) {
                     cancelOperation(operation);
                 },
                 impl_->autoClean);
@@ -823,6 +857,18 @@ void OperationQueue::onOperationAdded(SharedData::OperationAdded const& added)
     Nui::globalEventContext.executeActiveEventsImmediately();
 }
 
+void OperationQueue::onProgress(SharedData::ProgressBatch const& batch)
+{
+    for (auto const& progress : batch.downloads)
+        onDownloadProgress(progress);
+    for (auto const& progress : batch.uploads)
+        onUploadProgress(progress);
+    for (auto const& progress : batch.scans)
+        onScanProgress(progress);
+    for (auto const& progress : batch.bulkDownloads)
+        onBulkDownloadProgress(progress);
+}
+
 void OperationQueue::onDownloadProgress(SharedData::DownloadProgress const& progress)
 {
     Log::debug(
@@ -843,7 +889,7 @@ void OperationQueue::onDownloadProgress(SharedData::DownloadProgress const& prog
             "Received download progress for operation id: {} which is not a download", progress.operationId.value());
         return;
     }
-    auto* renderer = operation->getCardSpecifically<DisplayedDownloadOperation>();
+    auto* renderer = operation->getCardSpecifically<DisplayedTransferOperation>();
     if (!renderer)
     {
         Log::error(
@@ -851,7 +897,32 @@ void OperationQueue::onDownloadProgress(SharedData::DownloadProgress const& prog
             progress.operationId.value());
         return;
     }
-    renderer->setProgress(progress.current - progress.min);
+    renderer->setProgress(progress.current - progress.min, progress.telemetry);
+}
+
+void OperationQueue::onUploadProgress(SharedData::UploadProgress const& progress)
+{
+    auto* operation = impl_->operations.at(progress.operationId);
+    if (!operation)
+    {
+        Log::error("Received upload progress for unknown operation id: {}", progress.operationId.value());
+        return;
+    }
+    if (operation->type() != SharedData::OperationType::Upload)
+    {
+        Log::error(
+            "Received upload progress for operation id: {} which is not an upload", progress.operationId.value());
+        return;
+    }
+    auto* renderer = operation->getCardSpecifically<DisplayedTransferOperation>();
+    if (!renderer)
+    {
+        Log::error(
+            "Received upload progress for operation id: {} which has no transfer renderer",
+            progress.operationId.value());
+        return;
+    }
+    renderer->setProgress(progress.current - progress.min, progress.telemetry);
 }
 
 void OperationQueue::onScanProgress(SharedData::ScanProgress const& progress)
@@ -1078,6 +1149,7 @@ Nui::ElementRenderer OperationQueue::operator()()
 void OperationQueue::enqueueDownload(
     std::filesystem::path const& remotePath,
     std::filesystem::path const& localPath,
+    SharedData::TransferFilterOptions const& filter,
     std::function<void(std::optional<Ids::OperationId> const&)> onComplete)
 {
     if (!impl_->fileEngine)
@@ -1088,20 +1160,22 @@ void OperationQueue::enqueueDownload(
     }
 
     Log::info("Frontend Operation Queue download: {} -> {}", remotePath.generic_string(), localPath.generic_string());
-    impl_->fileEngine->addDownload(remotePath, localPath, std::move(onComplete));
+    impl_->fileEngine->addDownload(remotePath, localPath, filter, std::move(onComplete));
 }
 void OperationQueue::enqueueUpload(
-    std::filesystem::path const&,
-    std::filesystem::path const&,
+    std::filesystem::path const& localPath,
+    std::filesystem::path const& remotePath,
     std::function<void(std::optional<Ids::OperationId> const&)> onComplete)
 {
     if (!impl_->fileEngine)
     {
-        Log::error("No file engine set for operation queue, cannot enqueue download");
+        Log::error("No file engine set for operation queue, cannot enqueue upload");
         onComplete(std::nullopt);
         return;
     }
-    // TODO: Implement
+
+    Log::info("Frontend Operation Queue upload: {} -> {}", localPath.generic_string(), remotePath.generic_string());
+    impl_->fileEngine->addUpload(localPath, remotePath, std::move(onComplete));
 }
 void OperationQueue::enqueueRename(
     std::filesystem::path const&,
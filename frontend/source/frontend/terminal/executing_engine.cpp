@@ -1,5 +1,6 @@
 #include <exception>
 #include <frontend/terminal/executing_engine.hpp>
+#include <frontend/terminal/terminal_frame_link.hpp>
 #include <frontend/nlohmann_compat.hpp>
 #include <log/log.hpp>
 #include <nui/frontend/api/timer.hpp>
@@ -13,8 +14,7 @@ struct ExecutingTerminalEngine::Implementation
     ExecutingTerminalEngine::Settings settings;
     std::string id;
 
-    Nui::RpcClient::AutoUnregister stdoutReceiver;
-    Nui::RpcClient::AutoUnregister stderrReceiver;
+    TerminalFrameLink frames;
 
     std::string processId;
 
@@ -26,8 +26,7 @@ struct ExecutingTerminalEngine::Implementation
     Implementation(ExecutingTerminalEngine::Settings&& settings)
         : settings{std::move(settings)}
         , id{Nui::val::global("generateId")().as<std::string>()}
-        , stdoutReceiver{}
-        , stderrReceiver{}
+        , frames{}
         , processId{}
         , stdoutHandler{}
         , stderrHandler{}
@@ -50,29 +49,16 @@ ROAR_PIMPL_SPECIAL_FUNCTIONS_IMPL_NO_DTOR(ExecutingTerminalEngine);
 
 void ExecutingTerminalEngine::open(std::function<void(bool, std::string const&)> onOpen)
 {
-    impl_->stdoutReceiver =
-        Nui::RpcClient::autoRegisterFunction("execTerminalStdout_" + impl_->id, [this](Nui::val val) {
-            if (val.hasOwnProperty("data"))
+    impl_->frames = TerminalFrameLink{
+        "process_" + impl_->id, [this](SharedData::TerminalStream stream, std::string const& data) {
+            if (stream == SharedData::TerminalStream::Stdout)
             {
-                const std::string data = Nui::val::global("atob")(val["data"]).as<std::string>();
                 if (impl_->stdoutHandler)
                     impl_->stdoutHandler(data);
             }
-            else
-                Log::error("execTerminalStdout_" + impl_->id + " received an empty message");
-        });
-
-    impl_->stderrReceiver =
-        Nui::RpcClient::autoRegisterFunction("execTerminalStderr_" + impl_->id, [this](Nui::val val) {
-            if (val.hasOwnProperty("data"))
-            {
-                const std::string data = Nui::val::global("atob")(val["data"]).as<std::string>();
-                if (impl_->stderrHandler)
-                    impl_->stderrHandler(data);
-            }
-            else
-                Log::error("execTerminalStderr_" + impl_->id + " received an empty message");
-        });
+            else if (impl_->stderrHandler)
+                impl_->stderrHandler(data);
+        }};
 
     Nui::val obj = Nui::val::object();
 
@@ -115,8 +101,7 @@ void ExecutingTerminalEngine::open(std::function<void(bool, std::string const&)>
     }
     obj.set("isPty", impl_->settings.engineOptions.isPty);
 
-    obj.set("stdout", "execTerminalStdout_" + impl_->id);
-    obj.set("stderr", "execTerminalStderr_" + impl_->id);
+    obj.set("terminalReceiver", "process_" + impl_->id);
     try
     {
         obj.set("termios", asVal(impl_->settings.termios));
@@ -156,8 +141,7 @@ void ExecutingTerminalEngine::dispose(std::function<void()> onDisposeComplete)
         },
         impl_->processId);
 
-    impl_->stdoutReceiver.reset();
-    impl_->stderrReceiver.reset();
+    impl_->frames = TerminalFrameLink{};
 }
 
 void ExecutingTerminalEngine::resize(int cols, int rows)
@@ -212,8 +196,7 @@ void ExecutingTerminalEngine::write(std::string const& data)
     if (!data.empty() && (data.back() == '\r' || data.back() == '\n'))
         updatePtyProcs();
 
-    Nui::RpcClient::callWithBackChannel(
-        "ProcessStore::write", [](Nui::val) {}, impl_->processId, Nui::val::global("btoa")(data).as<std::string>());
+    impl_->frames.write(data);
 }
 
 void ExecutingTerminalEngine::setStdoutHandler(std::function<void(std::string const&)> handler)
@@ -1,4 +1,5 @@
 #include <frontend/terminal/sftp_file_engine.hpp>
+#include <frontend/nlohmann_compat.hpp>
 #include <log/log.hpp>
 
 #include <nui/rpc.hpp>
@@ -161,10 +162,12 @@ void SftpFileEngine::createFile(std::filesystem::path const& path, std::function
 void SftpFileEngine::addDownload(
     std::filesystem::path const& remotePath,
     std::filesystem::path const& localPath,
+    SharedData::TransferFilterOptions const& filter,
     std::function<void(std::optional<Ids::OperationId>)> onOperationCreated)
 {
     Log::info("Requesting to add download: {} -> {}", remotePath.generic_string(), localPath.generic_string());
-    lazyOpen([this, remotePath, localPath, onOperationCreated = std::move(onOperationCreated)](auto const& channelId) {
+    lazyOpen([this, remotePath, localPath, filter, onOperationCreated = std::move(onOperationCreated)](
+                 auto const& channelId) {
         if (!channelId)
         {
             Log::error("Cannot add download, no channel");
@@ -196,6 +199,46 @@ void SftpFileEngine::addDownload(
             channelId.value().value(),
             operationId.value(),
             remotePath.generic_string(),
-            localPath.generic_string());
+            localPath.generic_string(),
+            asVal(filter));
+    });
+}
+void SftpFileEngine::addUpload(
+    std::filesystem::path const& localPath,
+    std::filesystem::path const& remotePath,
+    std::function<void(std::optional<Ids::OperationId>)> onOperationCreated)
+{
+    Log::info("Requesting to add upload: {} -> {}", localPath.generic_string(), remotePath.generic_string());
+    lazyOpen([this, localPath, remotePath, onOperationCreated = std::move(onOperationCreated)](auto const& channelId) {
+        if (!channelId)
+        {
+            Log::error("Cannot add upload, no channel");
+            onOperationCreated(std::nullopt);
+            return;
+        }
+
+        const auto operationId = Ids::generateOperationId();
+
+        Log::info(
+            "Adding upload (with ID '{}'): {} -> {}",
+            operationId.value(),
+            localPath.generic_string(),
+            remotePath.generic_string());
+
+        Nui::RpcClient::callWithBackChannel(
+            fmt::format("Session::{}::sftp::addUpload", impl_->engine->sshSessionId().value()),
+            [onOperationCreated = std::move(onOperationCreated), operationId](Nui::val val) {
+                if (val.hasOwnProperty("error"))
+                {
+                    Log::error("(Frontend) Failed to add upload: {}", val["error"].as<std::string>());
+                    onOperationCreated(std::nullopt);
+                    return;
+                }
+                onOperationCreated(operationId);
+            },
+            channelId.value().value(),
+            operationId.value(),
+            localPath.generic_string(),
+            remotePath.generic_string());
     });
-}
\ No newline at end of file
+}
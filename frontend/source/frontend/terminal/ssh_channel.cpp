@@ -3,8 +3,7 @@
 #include <log/log.hpp>
 
 SshChannel::SshChannel(Ids::SessionId sessionId, Ids::ChannelId channelId)
-    : stdoutReceiver_{}
-    , stderrReceiver_{}
+    : frames_{}
     , onExitReceiver_{}
     , sshChannelId_{channelId}
     , sshSessionId_{std::move(sessionId)}
@@ -31,45 +30,30 @@ void SshChannel::open(
         stdoutHandler_ = std::move(onStdout);
         stderrHandler_ = std::move(onStderr);
 
-        stdoutReceiver_ =
-            Nui::RpcClient::autoRegisterFunction("sshTerminalStdout_" + sshChannelId_.value(), [this](Nui::val val) {
-                if (val.hasOwnProperty("data"))
+        frames_ = TerminalFrameLink{
+            "ssh_" + sshChannelId_.value(),
+            [this](SharedData::TerminalStream stream, std::string const& data) {
+                if (stream == SharedData::TerminalStream::Stdout)
                 {
-                    const std::string data = Nui::val::global("atob")(val["data"]).as<std::string>();
                     if (stdoutHandler_)
                         stdoutHandler_(data);
                 }
-                else
-                    Log::info("sshTerminalStdout_" + sshChannelId_.value() + " received an empty message");
-            });
-
-        stderrReceiver_ =
-            Nui::RpcClient::autoRegisterFunction("sshTerminalStderr_" + sshChannelId_.value(), [this](Nui::val val) {
-                if (val.hasOwnProperty("data"))
-                {
-                    const std::string data = Nui::val::global("atob")(val["data"]).as<std::string>();
-                    if (stderrHandler_)
-                        stderrHandler_(data);
-                }
-                else
-                    Log::error("sshTerminalStderr_" + sshChannelId_.value() + " received an empty message");
-            });
+                else if (stderrHandler_)
+                    stderrHandler_(data);
+            }};
+        // Picks up output that arrived before the link was there to be notified:
+        frames_.fetch();
     }
 
     onExitReceiver_ =
-        Nui::RpcClient::autoRegisterFunction("sshTerminalOnExit_" + sshChannelId_.value(), [onExit](Nui::val) {
-            onExit();
+        Nui::RpcClient::autoRegisterFunction("sshTerminalOnExit_" + sshChannelId_.value(), [this, onExit](Nui::val) {
+            // The last output may still wait to be fetched:
+            frames_.fetch(onExit);
         });
 }
 void SshChannel::write(std::string const& data)
 {
-    Nui::RpcClient::callWithBackChannel(
-        fmt::format("Session::{}::Channel::write", sshSessionId_.value()),
-        [](Nui::val) {
-            // TODO: handle error
-        },
-        sshChannelId_.value(),
-        Nui::val::global("btoa")(data).as<std::string>());
+    frames_.write(data);
 }
 void SshChannel::resize(int cols, int rows)
 {
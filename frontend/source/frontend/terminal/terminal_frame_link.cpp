@@ -0,0 +1,225 @@
+#include <frontend/terminal/terminal_frame_link.hpp>
+
+#include <log/log.hpp>
+
+#include <nui/frontend/val.hpp>
+#include <nui/frontend/utility/functions.hpp>
+#include <nui/rpc.hpp>
+
+#include <emscripten/val.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct TerminalFrameLink::State
+{
+    std::string receiver;
+    std::function<void(SharedData::TerminalStream, std::string const&)> onOutput;
+    Nui::RpcClient::AutoUnregister framesAvailableReceiver{};
+
+    bool fetching{false};
+    bool fetchAgain{false};
+    std::vector<std::function<void()>> onFetched{};
+
+    bool writing{false};
+    std::string pendingWrite{};
+
+    std::size_t unacknowledged{0};
+    bool acknowledgeScheduled{false};
+
+    std::string url(std::string const& action) const
+    {
+        return "terminal://app.example/" + action + "/" + receiver;
+    }
+};
+
+namespace
+{
+    std::string toString(Nui::val const& arrayBuffer)
+    {
+        const auto bytes = Nui::val::global("Uint8Array").new_(arrayBuffer);
+        const auto length = bytes["length"].as<std::size_t>();
+        std::string result(length, '\0');
+        // Copies straight into wasm memory, without a detour over a js string:
+        Nui::val{emscripten::typed_memory_view(length, reinterpret_cast<std::uint8_t*>(result.data()))}
+            .call<void>("set", bytes);
+        return result;
+    }
+}
+
+TerminalFrameLink::TerminalFrameLink(
+    std::string receiver,
+    std::function<void(SharedData::TerminalStream, std::string const&)> onOutput)
+    : state_{std::make_shared<State>(State{.receiver = std::move(receiver), .onOutput = std::move(onOutput)})}
+{
+    std::weak_ptr<State> weak = state_;
+    state_->framesAvailableReceiver =
+        Nui::RpcClient::autoRegisterFunction("terminalFramesAvailable_" + state_->receiver, [weak](Nui::val) {
+            if (auto state = weak.lock(); state)
+                fetchFrames(state);
+        });
+}
+TerminalFrameLink::~TerminalFrameLink() = default;
+
+void TerminalFrameLink::onFramesFetched(std::shared_ptr<State> const& state, std::string const& frames)
+{
+    const bool complete = SharedData::forEachTerminalFrame(
+        frames, [&state](SharedData::TerminalStream stream, std::string_view payload) {
+            state->unacknowledged += payload.size();
+            if (state->onOutput)
+                state->onOutput(stream, std::string{payload});
+        });
+    if (!complete)
+        Log::error("Received malformed terminal frames for '{}'", state->receiver);
+    scheduleAcknowledge(state);
+
+    state->fetching = false;
+    auto onFetched = std::exchange(state->onFetched, {});
+    if (std::exchange(state->fetchAgain, false))
+        fetchFrames(state);
+    for (auto const& callback : onFetched)
+        callback();
+}
+
+void TerminalFrameLink::fetchFrames(std::shared_ptr<State> const& state)
+{
+    if (state->fetching)
+    {
+        // Frames pushed after the request was answered would be left behind otherwise.
+        state->fetchAgain = true;
+        return;
+    }
+    state->fetching = true;
+
+    std::weak_ptr<State> weak = state;
+    Nui::val::global("fetch")(state->url("frames"))
+        .call<Nui::val>(
+            "then",
+            Nui::bind(
+                [](Nui::val response) -> Nui::val {
+                    return response.call<Nui::val>("arrayBuffer");
+                },
+                std::placeholders::_1))
+        .call<Nui::val>(
+            "then",
+            Nui::bind(
+                [weak](Nui::val arrayBuffer) {
+                    if (auto state = weak.lock(); state)
+                        onFramesFetched(state, toString(arrayBuffer));
+                },
+                std::placeholders::_1))
+        .call<Nui::val>(
+            "catch",
+            Nui::bind(
+                [weak](Nui::val error) {
+                    if (auto state = weak.lock(); state)
+                    {
+                        Log::error(
+                            "Failed to fetch terminal frames for '{}': {}",
+                            state->receiver,
+                            error.call<std::string>("toString"));
+                        onFramesFetched(state, {});
+                    }
+                },
+                std::placeholders::_1));
+}
+
+void TerminalFrameLink::postWrite(std::shared_ptr<State> const& state)
+{
+    if (state->writing || state->pendingWrite.empty())
+        return;
+    state->writing = true;
+
+    const auto data = std::exchange(state->pendingWrite, {});
+    // The Uint8Array copies the view, so data may go out of scope.
+    auto body = Nui::val::global("Uint8Array")
+                    .new_(Nui::val{emscripten::typed_memory_view(
+                        data.size(), reinterpret_cast<std::uint8_t const*>(data.data()))});
+    auto options = Nui::val::object();
+    options.set("method", "POST");
+    options.set("body", body);
+
+    std::weak_ptr<State> weak = state;
+    auto onDone = [weak]() {
+        if (auto state = weak.lock(); state)
+        {
+            state->writing = false;
+            postWrite(state);
+        }
+    };
+    Nui::val::global("fetch")(state->url("write"), options)
+        .call<Nui::val>(
+            "then",
+            Nui::bind(
+                [onDone](Nui::val) {
+                    onDone();
+                },
+                std::placeholders::_1))
+        .call<Nui::val>(
+            "catch",
+            Nui::bind(
+                [onDone](Nui::val error) {
+                    Log::error("Failed to write to terminal: {}", error.call<std::string>("toString"));
+                    onDone();
+                },
+                std::placeholders::_1));
+}
+
+void TerminalFrameLink::scheduleAcknowledge(std::shared_ptr<State> const& state)
+{
+    if (state->acknowledgeScheduled || state->unacknowledged == 0)
+        return;
+    state->acknowledgeScheduled = true;
+
+    // Not tied to animation frames, browsers pause those in hidden windows and the backend would stop reading. The
+    // terminal parses what it was given in its own timer tasks, a timeout lets those run before the credit returns.
+    std::weak_ptr<State> weak = state;
+    Nui::val::global("setTimeout")(
+        Nui::bind(
+            [weak](Nui::val) {
+                auto state = weak.lock();
+                if (!state)
+                    return;
+                state->acknowledgeScheduled = false;
+
+                auto options = Nui::val::object();
+                options.set("method", "POST");
+                options.set("body", std::to_string(std::exchange(state->unacknowledged, 0)));
+                Nui::val::global("fetch")(state->url("ack"), options)
+                    .call<Nui::val>(
+                        "catch",
+                        Nui::bind(
+                            [](Nui::val error) {
+                                Log::error(
+                                    "Failed to acknowledge terminal output: {}", error.call<std::string>("toString"));
+                            },
+                            std::placeholders::_1));
+            },
+            std::placeholders::_1),
+        0);
+}
+
+void TerminalFrameLink::fetch(std::function<void()> onFetched)
+{
+    if (!state_)
+    {
+        if (onFetched)
+            onFetched();
+        return;
+    }
+
+    if (onFetched)
+        state_->onFetched.push_back(std::move(onFetched));
+    fetchFrames(state_);
+}
+
+void TerminalFrameLink::write(std::string const& data)
+{
+    if (!state_)
+        return;
+
+    state_->pendingWrite += data;
+    postWrite(state_);
+}
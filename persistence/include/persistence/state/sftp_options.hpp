@@ -2,6 +2,7 @@
 
 #include <persistence/state_core.hpp>
 
+#include <cstdint>
 #include <string>
 #include <optional>
 #include <filesystem>
@@ -17,6 +18,14 @@ namespace Persistence
         std::optional<bool> inheritPermissions{std::nullopt};
         std::optional<bool> doCleanup{std::nullopt};
         std::optional<std::filesystem::perms> customPermissions{std::nullopt};
+        // How many read requests a download keeps outstanding.
+        std::optional<std::size_t> readsInFlight{std::nullopt};
+        // How many write requests an upload keeps outstanding.
+        std::optional<std::size_t> writesInFlight{std::nullopt};
+        // How many streams read a large download in parallel segments, 1 turns segmenting off.
+        std::optional<std::size_t> segments{std::nullopt};
+        // Downloads of files smaller than this are not segmented.
+        std::optional<std::uint64_t> segmentThreshold{std::nullopt};
 
         void useDefaultsFrom(TransferOptions const& other);
     };
@@ -28,6 +37,19 @@ namespace Persistence
         std::optional<TransferOptions> downloadOptions{};
         std::optional<TransferOptions> uploadOptions{};
         std::optional<int> concurrency{std::nullopt}; // How many parallel transfers are allowed?
+        // Additional connections to the same host just for transfers, so they do not compete with the terminals.
+        std::optional<int> transferConnections{std::nullopt};
+        // Bandwidth limits in bytes per second for each transfer and for all transfers of a session. 0 does not
+        // limit. The limit for all transfers of the application is State::globalBandwidthLimit.
+        std::optional<std::uint64_t> operationBandwidthLimit{std::nullopt};
+        std::optional<std::uint64_t> sessionBandwidthLimit{std::nullopt};
+        // Downloads directories as one tar stream of the remote, instead of file by file. Much faster for many small
+        // files, falls back to file by file if the remote has no tar.
+        std::optional<bool> archiveDirectoryDownloads{std::nullopt};
+        // Directories listed at the same time when scanning a directory for a download, 1 lists one after another.
+        std::optional<std::size_t> scanConcurrency{std::nullopt};
+        // Scans directories with one find command of the remote, falls back to sftp if the remote has no GNU find.
+        std::optional<bool> scanWithFind{std::nullopt};
         std::chrono::seconds operationTimeout{5};
 
         void useDefaultsFrom(SftpOptions const& other);
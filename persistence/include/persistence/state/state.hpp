@@ -23,6 +23,8 @@ namespace Persistence
         std::unordered_map<std::string, QueueOptions> queueOptions{};
         UiOptions uiOptions{};
         Log::Level logLevel{Log::Level::Info};
+        // Bytes per second for all transfers of all sessions together, 0 does not limit.
+        std::uint64_t globalBandwidthLimit{0};
 
         State fullyResolve() const;
     };
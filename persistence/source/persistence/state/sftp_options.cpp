@@ -18,6 +18,14 @@ namespace Persistence
             doCleanup = other.doCleanup;
         if (!customPermissions)
             customPermissions = other.customPermissions;
+        if (!readsInFlight)
+            readsInFlight = other.readsInFlight;
+        if (!writesInFlight)
+            writesInFlight = other.writesInFlight;
+        if (!segments)
+            segments = other.segments;
+        if (!segmentThreshold)
+            segmentThreshold = other.segmentThreshold;
     }
     void to_json(nlohmann::json& j, TransferOptions const& options)
     {
@@ -35,6 +43,14 @@ namespace Persistence
             j["doCleanup"] = *options.doCleanup;
         if (options.customPermissions)
             j["customPermissions"] = static_cast<unsigned int>(*options.customPermissions);
+        if (options.readsInFlight)
+            j["readsInFlight"] = *options.readsInFlight;
+        if (options.writesInFlight)
+            j["writesInFlight"] = *options.writesInFlight;
+        if (options.segments)
+            j["segments"] = *options.segments;
+        if (options.segmentThreshold)
+            j["segmentThreshold"] = *options.segmentThreshold;
     }
     void from_json(nlohmann::json const& j, TransferOptions& options)
     {
@@ -52,6 +68,14 @@ namespace Persistence
             options.doCleanup = j["doCleanup"].get<bool>();
         if (j.contains("customPermissions"))
             options.customPermissions = std::filesystem::perms{j["customPermissions"].template get<unsigned int>()};
+        if (j.contains("readsInFlight"))
+            options.readsInFlight = j["readsInFlight"].get<std::size_t>();
+        if (j.contains("writesInFlight"))
+            options.writesInFlight = j["writesInFlight"].get<std::size_t>();
+        if (j.contains("segments"))
+            options.segments = j["segments"].get<std::size_t>();
+        if (j.contains("segmentThreshold"))
+            options.segmentThreshold = j["segmentThreshold"].get<std::uint64_t>();
     }
 
     void to_json(nlohmann::json& j, SftpOptions const& options)
@@ -62,6 +86,18 @@ namespace Persistence
             j["uploadOptions"] = *options.uploadOptions;
         if (options.concurrency)
             j["concurrency"] = *options.concurrency;
+        if (options.transferConnections)
+            j["transferConnections"] = *options.transferConnections;
+        if (options.operationBandwidthLimit)
+            j["operationBandwidthLimit"] = *options.operationBandwidthLimit;
+        if (options.sessionBandwidthLimit)
+            j["sessionBandwidthLimit"] = *options.sessionBandwidthLimit;
+        if (options.archiveDirectoryDownloads)
+            j["archiveDirectoryDownloads"] = *options.archiveDirectoryDownloads;
+        if (options.scanConcurrency)
+            j["scanConcurrency"] = *options.scanConcurrency;
+        if (options.scanWithFind)
+            j["scanWithFind"] = *options.scanWithFind;
         j["operationTimeout"] = options.operationTimeout.count();
     }
     void from_json(nlohmann::json const& j, SftpOptions& options)
@@ -72,6 +108,18 @@ namespace Persistence
             options.uploadOptions = j["uploadOptions"].get<TransferOptions>();
         if (j.contains("concurrency"))
             options.concurrency = j["concurrency"].get<int>();
+        if (j.contains("transferConnections"))
+            options.transferConnections = j["transferConnections"].get<int>();
+        if (j.contains("operationBandwidthLimit"))
+            options.operationBandwidthLimit = j["operationBandwidthLimit"].get<std::uint64_t>();
+        if (j.contains("sessionBandwidthLimit"))
+            options.sessionBandwidthLimit = j["sessionBandwidthLimit"].get<std::uint64_t>();
+        if (j.contains("archiveDirectoryDownloads"))
+            options.archiveDirectoryDownloads = j["archiveDirectoryDownloads"].get<bool>();
+        if (j.contains("scanConcurrency"))
+            options.scanConcurrency = j["scanConcurrency"].get<std::size_t>();
+        if (j.contains("scanWithFind"))
+            options.scanWithFind = j["scanWithFind"].get<bool>();
 
         if (j.contains("operationTimeout"))
             options.operationTimeout = std::chrono::seconds{j["operationTimeout"].get<int>()};
@@ -86,5 +134,17 @@ namespace Persistence
             uploadOptions = other.uploadOptions;
         if (!concurrency)
             concurrency = other.concurrency;
+        if (!transferConnections)
+            transferConnections = other.transferConnections;
+        if (!operationBandwidthLimit)
+            operationBandwidthLimit = other.operationBandwidthLimit;
+        if (!sessionBandwidthLimit)
+            sessionBandwidthLimit = other.sessionBandwidthLimit;
+        if (!archiveDirectoryDownloads)
+            archiveDirectoryDownloads = other.archiveDirectoryDownloads;
+        if (!scanConcurrency)
+            scanConcurrency = other.scanConcurrency;
+        if (!scanWithFind)
+            scanWithFind = other.scanWithFind;
     }
 }
\ No newline at end of file
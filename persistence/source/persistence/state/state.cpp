@@ -21,6 +21,7 @@ namespace Persistence
             return Log::levelToString(state.logLevel);
         }();
         j["queueOptions"] = state.queueOptions;
+        j["globalBandwidthLimit"] = state.globalBandwidthLimit;
     }
     void from_json(nlohmann::json const& j, State& state)
     {
@@ -50,6 +51,9 @@ namespace Persistence
 
         if (j.contains("queueOptions"))
             j.at("queueOptions").get_to(state.queueOptions);
+
+        if (j.contains("globalBandwidthLimit"))
+            state.globalBandwidthLimit = j.at("globalBandwidthLimit").get<std::uint64_t>();
     }
 
     State State::fullyResolve() const
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <shared_data/shared_data.hpp>
+
+#include <cstdint>
+#include <optional>
+
+namespace SharedData
+{
+    /**
+     * Bytes per second, 0 does not limit. Limits that are not set stay as they are. The application wide limit is
+     * changed through SessionManager::setGlobalBandwidthLimit.
+     */
+    struct BandwidthLimits
+    {
+        std::optional<std::uint64_t> operation{std::nullopt};
+        std::optional<std::uint64_t> session{std::nullopt};
+    };
+    BOOST_DESCRIBE_STRUCT(BandwidthLimits, (), (operation, session))
+}
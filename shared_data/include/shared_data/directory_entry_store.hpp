@@ -0,0 +1,180 @@
+#pragma once
+
+#include <shared_data/directory_entry.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SharedData
+{
+    /**
+     * @brief Compact storage for the entries of a recursive directory scan, which may have millions of them.
+     * Names live in one arena, owners and groups are interned and the metadata is kept in parallel arrays, so an entry
+     * costs a few dozen bytes instead of several allocations. Directories keep their path relative to the root, which
+     * makes the path of any entry a single concatenation, however deep it is.
+     * Entry 0 is the root of the scan.
+     */
+    class DirectoryEntryStore
+    {
+      public:
+        using Index = std::size_t;
+
+        /**
+         * @brief Creates an empty store, without even a root.
+         */
+        DirectoryEntryStore() = default;
+
+        /**
+         * @brief Creates a store with the directory root as entry 0.
+         */
+        explicit DirectoryEntryStore(std::filesystem::path root);
+
+        /**
+         * @brief Adds an entry of the directory listing of parent. Only the name, type, size, permissions, mtime and
+         * ownership are kept, the long name, acl and other times are dropped.
+         *
+         * @return The index of the new entry.
+         */
+        Index add(DirectoryEntry const& entry, Index parent);
+
+        void reserve(std::size_t entries);
+
+        std::size_t size() const
+        {
+            return types_.size();
+        }
+
+        bool empty() const
+        {
+            return types_.empty();
+        }
+
+        std::filesystem::path const& root() const
+        {
+            return root_;
+        }
+
+        std::string_view name(Index index) const
+        {
+            return std::string_view{names_}.substr(nameOffsets_[index], nameOffsets_[index + 1] - nameOffsets_[index]);
+        }
+
+        FileType type(Index index) const
+        {
+            return types_[index];
+        }
+
+        bool isDirectory(Index index) const
+        {
+            return types_[index] == FileType::Directory;
+        }
+
+        bool isRegularFile(Index index) const
+        {
+            return types_[index] == FileType::Regular;
+        }
+
+        bool isSymlink(Index index) const
+        {
+            return types_[index] == FileType::Symlink;
+        }
+
+        std::uint64_t fileSize(Index index) const
+        {
+            return sizes_[index];
+        }
+
+        std::filesystem::perms permissions(Index index) const
+        {
+            return static_cast<std::filesystem::perms>(permissions_[index]);
+        }
+
+        std::uint64_t mtime(Index index) const
+        {
+            return mtimes_[index];
+        }
+
+        std::uint32_t uid(Index index) const
+        {
+            return uids_[index];
+        }
+
+        std::uint32_t gid(Index index) const
+        {
+            return gids_[index];
+        }
+
+        std::string_view owner(Index index) const
+        {
+            return *interned_[owners_[index]];
+        }
+
+        std::string_view group(Index index) const
+        {
+            return *interned_[groups_[index]];
+        }
+
+        std::optional<Index> parent(Index index) const
+        {
+            if (index == 0)
+                return std::nullopt;
+            return parents_[index];
+        }
+
+        /**
+         * @brief The path of the entry relative to the root, separated by '/'. Empty for the root.
+         */
+        std::string relativePath(Index index) const;
+
+        /**
+         * @brief The root joined with the relative path of the entry.
+         */
+        std::filesystem::path fullPath(Index index) const;
+
+        /**
+         * @brief Rebuilds the entry, for code working with DirectoryEntry. Its path is the name only, like in a
+         * listing, and fields that are not stored are left default.
+         */
+        DirectoryEntry entry(Index index) const;
+
+        /**
+         * @brief The heap memory held by the store in bytes, roughly.
+         */
+        std::size_t memoryUsage() const;
+
+      private:
+        std::uint32_t intern(std::string const& text);
+        std::string_view directoryPrefix(Index index) const;
+
+      private:
+        std::filesystem::path root_{};
+
+        // Names of all entries back to back, entry i spans [nameOffsets_[i], nameOffsets_[i + 1]).
+        std::string names_{};
+        std::vector<std::uint64_t> nameOffsets_{0};
+
+        std::vector<std::uint32_t> parents_{};
+        std::vector<FileType> types_{};
+        std::vector<std::uint16_t> permissions_{};
+        std::vector<std::uint64_t> sizes_{};
+        std::vector<std::uint64_t> mtimes_{};
+        std::vector<std::uint32_t> uids_{};
+        std::vector<std::uint32_t> gids_{};
+        std::vector<std::uint32_t> owners_{};
+        std::vector<std::uint32_t> groups_{};
+
+        // Keys of the map do not move, so the vector can point to them.
+        std::unordered_map<std::string, std::uint32_t> internedIds_{};
+        std::vector<std::string const*> interned_{};
+
+        // Relative paths of the directories with a trailing '/', back to back. Maps the entry to offset and length.
+        std::string prefixes_{};
+        std::unordered_map<std::uint32_t, std::pair<std::uint64_t, std::uint32_t>> directoryPrefixes_{};
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ids/ids.hpp>
+#include <shared_data/file_operations/transfer_telemetry.hpp>
 #include <shared_data/shared_data.hpp>
 #include <utility/describe.hpp>
 
@@ -20,6 +21,7 @@ namespace SharedData
         std::uint64_t currentFileTotalBytes;
         std::uint64_t bytesCurrent;
         std::uint64_t bytesTotal;
+        TransferTelemetry telemetry{};
     };
     BOOST_DESCRIBE_STRUCT(
         BulkDownloadProgress,
@@ -31,5 +33,6 @@ namespace SharedData
          currentFileBytes,
          currentFileTotalBytes,
          bytesCurrent,
-         bytesTotal))
+         bytesTotal,
+         telemetry))
 }
\ No newline at end of file
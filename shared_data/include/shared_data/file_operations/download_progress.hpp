@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ids/ids.hpp>
+#include <shared_data/file_operations/transfer_telemetry.hpp>
 #include <shared_data/shared_data.hpp>
 #include <utility/describe.hpp>
 
@@ -16,6 +17,7 @@ namespace SharedData
         std::uint64_t min;
         std::uint64_t max;
         std::uint64_t current;
+        TransferTelemetry telemetry{};
     };
-    BOOST_DESCRIBE_STRUCT(DownloadProgress, (), (operationId, min, max, current))
+    BOOST_DESCRIBE_STRUCT(DownloadProgress, (), (operationId, min, max, current, telemetry))
 }
\ No newline at end of file
@@ -6,7 +6,7 @@
 
 namespace SecureShell
 {
-    BOOST_DESCRIBE_ENUM(WrapperErrors, None, OwnerNull, SharedPtrDestroyed, ShortWrite, FileNull)
+    BOOST_DESCRIBE_ENUM(WrapperErrors, None, OwnerNull, SharedPtrDestroyed, ShortWrite, FileNull, OperationDropped)
     BOOST_DESCRIBE_STRUCT(SftpError, (), (message, sshError, sftpError, wrapperError))
 
     inline void from_json(nlohmann::json const& json, WrapperErrors& error)
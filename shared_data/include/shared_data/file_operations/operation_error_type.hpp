@@ -33,5 +33,9 @@ namespace SharedData
         CannotCreateDirectory,
         UnknownWorkState,
         InvalidOperationState,
-        OperationNotPossibleOnFileType);
+        OperationNotPossibleOnFileType,
+        SourceFileNotGood,
+        ArchiveStreamFailure,
+        ScanIncomplete,
+        RemoteCommandFailed);
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <shared_data/file_operations/bulk_download_progress.hpp>
+#include <shared_data/file_operations/download_progress.hpp>
+#include <shared_data/file_operations/scan_progress.hpp>
+#include <shared_data/file_operations/upload_progress.hpp>
+#include <shared_data/shared_data.hpp>
+#include <utility/describe.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <vector>
+
+namespace SharedData
+{
+    /**
+     * The latest progress of every operation that made progress since the previous batch.
+     */
+    struct ProgressBatch
+    {
+        std::vector<DownloadProgress> downloads;
+        std::vector<UploadProgress> uploads;
+        std::vector<ScanProgress> scans;
+        std::vector<BulkDownloadProgress> bulkDownloads;
+    };
+    BOOST_DESCRIBE_STRUCT(ProgressBatch, (), (downloads, uploads, scans, bulkDownloads))
+}
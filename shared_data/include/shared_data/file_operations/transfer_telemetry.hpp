@@ -0,0 +1,24 @@
+#pragma once
+
+#include <shared_data/shared_data.hpp>
+#include <utility/describe.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <optional>
+
+namespace SharedData
+{
+    struct TransferTelemetry
+    {
+        /// Moving average over the last seconds.
+        double bytesPerSecond{0.0};
+        std::optional<std::uint64_t> etaSeconds{std::nullopt};
+        /// Smoothed time from an sftp request to its response.
+        std::optional<std::uint64_t> roundTripMicroseconds{std::nullopt};
+        /// No progress for a while although the transfer is not complete.
+        bool stalled{false};
+    };
+    BOOST_DESCRIBE_STRUCT(TransferTelemetry, (), (bytesPerSecond, etaSeconds, roundTripMicroseconds, stalled))
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <shared_data/shared_data.hpp>
+#include <utility/describe.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SharedData
+{
+    /**
+     * Bucket 0 counts durations below 1us, bucket i those in [2^(i-1), 2^i) us.
+     */
+    struct DurationHistogram
+    {
+        std::uint64_t count;
+        std::uint64_t totalMicroseconds;
+        std::uint64_t maximumMicroseconds;
+        std::uint64_t p50Microseconds;
+        std::uint64_t p99Microseconds;
+        std::vector<std::uint64_t> buckets;
+    };
+    BOOST_DESCRIBE_STRUCT(
+        DurationHistogram,
+        (),
+        (count, totalMicroseconds, maximumMicroseconds, p50Microseconds, p99Microseconds, buckets))
+
+    struct PermanentTaskMetrics
+    {
+        int id;
+        std::uint64_t calls;
+        std::uint64_t busyMicroseconds;
+        std::uint64_t longestMicroseconds;
+    };
+    BOOST_DESCRIBE_STRUCT(PermanentTaskMetrics, (), (id, calls, busyMicroseconds, longestMicroseconds))
+
+    struct StrandMetrics
+    {
+        /// "channel" or "sftp".
+        std::string kind;
+        std::string channelId;
+        std::uint64_t pendingTasks;
+        std::uint64_t tasksRun;
+        std::uint64_t busyMicroseconds;
+    };
+    BOOST_DESCRIBE_STRUCT(StrandMetrics, (), (kind, channelId, pendingTasks, tasksRun, busyMicroseconds))
+
+    struct ProcessingMetrics
+    {
+        DurationHistogram enqueueLatency;
+        DurationHistogram taskDuration;
+        DurationHistogram cycleDuration;
+        /// Per priority: interactive, metadata, bulk.
+        std::vector<std::uint64_t> queueDepth;
+        std::uint64_t peakQueueDepth;
+        std::vector<PermanentTaskMetrics> permanentTasks;
+        std::vector<StrandMetrics> strands;
+    };
+    BOOST_DESCRIBE_STRUCT(
+        ProcessingMetrics,
+        (),
+        (enqueueLatency, taskDuration, cycleDuration, queueDepth, peakQueueDepth, permanentTasks, strands))
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace SharedData
+{
+    /**
+     * Terminal output travels as a sequence of binary frames instead of base64 in json:
+     *   [1 byte stream][4 bytes little endian payload length][payload]
+     */
+    enum class TerminalStream : std::uint8_t
+    {
+        Stdout = 0,
+        Stderr = 1,
+    };
+
+    constexpr std::size_t terminalFrameHeaderSize = 5;
+
+    /**
+     * @brief Appends one frame to the given frame sequence.
+     */
+    inline void appendTerminalFrame(std::string& frames, TerminalStream stream, std::string_view payload)
+    {
+        const auto length = static_cast<std::uint32_t>(payload.size());
+        const std::array<char, terminalFrameHeaderSize> header{
+            static_cast<char>(stream),
+            static_cast<char>(length & 0xFF),
+            static_cast<char>((length >> 8) & 0xFF),
+            static_cast<char>((length >> 16) & 0xFF),
+            static_cast<char>((length >> 24) & 0xFF),
+        };
+        frames.append(header.data(), header.size());
+        frames.append(payload);
+    }
+
+    /**
+     * @brief Calls func(TerminalStream, std::string_view payload) for every frame in the sequence.
+     *
+     * @return false if the sequence ends within a frame or contains an unknown stream.
+     */
+    template <typename FunctionT>
+    bool forEachTerminalFrame(std::string_view frames, FunctionT&& func)
+    {
+        while (!frames.empty())
+        {
+            if (frames.size() < terminalFrameHeaderSize)
+                return false;
+
+            const auto byteAt = [&frames](std::size_t index) {
+                return static_cast<std::uint32_t>(static_cast<unsigned char>(frames[index]));
+            };
+            const auto stream = byteAt(0);
+            if (stream > static_cast<std::uint32_t>(TerminalStream::Stderr))
+                return false;
+
+            const std::size_t length = byteAt(1) | (byteAt(2) << 8) | (byteAt(3) << 16) | (byteAt(4) << 24);
+            if (frames.size() - terminalFrameHeaderSize < length)
+                return false;
+
+            func(static_cast<TerminalStream>(stream), frames.substr(terminalFrameHeaderSize, length));
+            frames.remove_prefix(terminalFrameHeaderSize + length);
+        }
+        return true;
+    }
+}
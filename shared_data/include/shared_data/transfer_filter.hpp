@@ -0,0 +1,114 @@
+#pragma once
+
+#include <shared_data/directory_entry.hpp>
+#include <shared_data/shared_data.hpp>
+
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SharedData
+{
+    /**
+     * @brief What a directory download skips. The patterns work like the lines of a .gitignore, the last one that
+     * matches decides and "!" includes again. What is inside a skipped directory is skipped too. Size and age only
+     * apply to files.
+     */
+    struct TransferFilterOptions
+    {
+        std::vector<std::string> patterns{};
+        // Bytes. Files are kept if they are larger than minSize and smaller than maxSize.
+        std::optional<std::uint64_t> minSize{std::nullopt};
+        std::optional<std::uint64_t> maxSize{std::nullopt};
+        // Seconds since the file was last modified, the bounds are exclusive too.
+        std::optional<std::uint64_t> minAge{std::nullopt};
+        std::optional<std::uint64_t> maxAge{std::nullopt};
+
+        bool empty() const
+        {
+            return patterns.empty() && !minSize && !maxSize && !minAge && !maxAge;
+        }
+    };
+    BOOST_DESCRIBE_STRUCT(TransferFilterOptions, (), (patterns, minSize, maxSize, minAge, maxAge))
+
+    /**
+     * @brief Parses a filter as the user types it: patterns separated by whitespace, and the conditions "size<10M",
+     * "size>1k", "age<7d" and "age>12h". Sizes take k, M, G and T, ages s, m, h and d.
+     */
+    std::expected<TransferFilterOptions, std::string> parseTransferFilter(std::string_view text);
+
+    /**
+     * @brief TransferFilterOptions prepared for deciding about millions of entries. Plain names and "*.ext"
+     * patterns are compared without the glob matcher.
+     */
+    class TransferFilter
+    {
+      public:
+        /**
+         * @brief A filter that excludes nothing.
+         */
+        TransferFilter() = default;
+
+        /**
+         * @param now Unix time the ages are measured from.
+         */
+        TransferFilter(TransferFilterOptions const& options, std::uint64_t now);
+
+        /**
+         * @brief Is the entry skipped? Its parent directory must not be, the patterns are not tried on the parents.
+         *
+         * @param relativePath The path of the entry relative to the root of the transfer, separated by '/'.
+         */
+        bool excludes(std::string_view relativePath, DirectoryEntry const& entry) const;
+
+        bool empty() const
+        {
+            return rules_.empty() && !minSize_ && !maxSize_ && !minAge_ && !maxAge_;
+        }
+
+        /**
+         * @brief Name globs whose directories are always excluded, for pruning them remotely. Empty if a pattern
+         * includes again, which could make that wrong.
+         */
+        std::vector<std::string> excludedDirectoryNames() const;
+
+      private:
+        struct Rule
+        {
+            enum class Kind
+            {
+                // Compared as is.
+                Literal,
+                // "*" followed by a literal.
+                Suffix,
+                Glob
+            };
+
+            std::string pattern;
+            Kind kind;
+            bool negated;
+            bool directoryOnly;
+            // Matches the relative path instead of the name, because it contains a '/'.
+            bool anchored;
+        };
+
+        static bool matches(Rule const& rule, std::string_view relativePath, std::string_view name);
+
+      private:
+        std::vector<Rule> rules_{};
+        bool hasNegatedRules_{false};
+        std::optional<std::uint64_t> minSize_{std::nullopt};
+        std::optional<std::uint64_t> maxSize_{std::nullopt};
+        std::optional<std::uint64_t> minAge_{std::nullopt};
+        std::optional<std::uint64_t> maxAge_{std::nullopt};
+        std::uint64_t now_{0};
+    };
+
+    /**
+     * @brief Matches text against a glob with "*", "?", "[...]" and "**". Only "**" matches across '/'.
+     */
+    bool globMatch(std::string_view pattern, std::string_view text);
+}
@@ -0,0 +1,149 @@
+#include <shared_data/directory_entry_store.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace SharedData
+{
+    DirectoryEntryStore::DirectoryEntryStore(std::filesystem::path root)
+        : root_{std::move(root)}
+    {
+        add(
+            DirectoryEntry{
+                .path = root_,
+                .type = FileType::Directory,
+            },
+            0);
+    }
+
+    DirectoryEntryStore::Index DirectoryEntryStore::add(DirectoryEntry const& entry, Index parent)
+    {
+        const auto index = size();
+        if (index >= std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("DirectoryEntryStore cannot hold more entries");
+        if (index != 0 && parent >= index)
+            throw std::out_of_range("Parent index is out of range");
+
+        // The root keeps its path in root_, its name would only be a duplicate:
+        if (index != 0)
+            names_ += entry.path.generic_string();
+        nameOffsets_.push_back(names_.size());
+
+        parents_.push_back(static_cast<std::uint32_t>(parent));
+        types_.push_back(entry.type);
+        permissions_.push_back(static_cast<std::uint16_t>(entry.permissions & std::filesystem::perms::mask));
+        sizes_.push_back(entry.size);
+        mtimes_.push_back(entry.mtime);
+        uids_.push_back(entry.uid);
+        gids_.push_back(entry.gid);
+        owners_.push_back(intern(entry.owner));
+        groups_.push_back(intern(entry.group));
+
+        if (index != 0 && entry.type == FileType::Directory)
+        {
+            const auto offset = prefixes_.size();
+            const auto entryName = name(index);
+            const auto needed = offset + directoryPrefix(parent).size() + entryName.size() + 1;
+            if (needed > prefixes_.capacity())
+                prefixes_.reserve(std::max(needed, 2 * prefixes_.capacity()));
+            // Taken after the reserve, the appends below do not reallocate what it points into anymore:
+            const auto parentPrefix = directoryPrefix(parent);
+            prefixes_.append(parentPrefix);
+            prefixes_.append(entryName);
+            prefixes_ += '/';
+            directoryPrefixes_.emplace(
+                static_cast<std::uint32_t>(index),
+                std::pair{static_cast<std::uint64_t>(offset), static_cast<std::uint32_t>(prefixes_.size() - offset)});
+        }
+        return index;
+    }
+
+    void DirectoryEntryStore::reserve(std::size_t entries)
+    {
+        nameOffsets_.reserve(entries + 1);
+        parents_.reserve(entries);
+        types_.reserve(entries);
+        permissions_.reserve(entries);
+        sizes_.reserve(entries);
+        mtimes_.reserve(entries);
+        uids_.reserve(entries);
+        gids_.reserve(entries);
+        owners_.reserve(entries);
+        groups_.reserve(entries);
+    }
+
+    std::uint32_t DirectoryEntryStore::intern(std::string const& text)
+    {
+        const auto [iter, inserted] = internedIds_.try_emplace(text, static_cast<std::uint32_t>(interned_.size()));
+        if (inserted)
+            interned_.push_back(&iter->first);
+        return iter->second;
+    }
+
+    std::string_view DirectoryEntryStore::directoryPrefix(Index index) const
+    {
+        if (index == 0)
+            return {};
+        const auto iter = directoryPrefixes_.find(static_cast<std::uint32_t>(index));
+        if (iter == directoryPrefixes_.end())
+            throw std::out_of_range("Parent of an entry must be a directory");
+        return std::string_view{prefixes_}.substr(iter->second.first, iter->second.second);
+    }
+
+    std::string DirectoryEntryStore::relativePath(Index index) const
+    {
+        if (index == 0)
+            return {};
+
+        const auto prefix = directoryPrefix(parents_[index]);
+        const auto entryName = name(index);
+        std::string path{};
+        path.reserve(prefix.size() + entryName.size());
+        path.append(prefix);
+        path.append(entryName);
+        return path;
+    }
+
+    std::filesystem::path DirectoryEntryStore::fullPath(Index index) const
+    {
+        if (index == 0)
+            return root_;
+        return root_ / relativePath(index);
+    }
+
+    DirectoryEntry DirectoryEntryStore::entry(Index index) const
+    {
+        return DirectoryEntry{
+            .path = index == 0 ? root_ : std::filesystem::path{std::string{name(index)}},
+            .type = types_[index],
+            .size = sizes_[index],
+            .uid = uids_[index],
+            .gid = gids_[index],
+            .owner = std::string{owner(index)},
+            .group = std::string{group(index)},
+            .permissions = permissions(index),
+            .mtime = mtimes_[index],
+            .parent = parent(index),
+        };
+    }
+
+    std::size_t DirectoryEntryStore::memoryUsage() const
+    {
+        auto vectorBytes = [](auto const& vector) {
+            return vector.capacity() * sizeof(typename std::decay_t<decltype(vector)>::value_type);
+        };
+
+        std::size_t interned = 0;
+        for (auto const& [text, id] : internedIds_)
+            interned += sizeof(std::pair<std::string const, std::uint32_t>) + text.capacity() + 2 * sizeof(void*);
+
+        return names_.capacity() + prefixes_.capacity() + vectorBytes(nameOffsets_) + vectorBytes(parents_) +
+            vectorBytes(types_) + vectorBytes(permissions_) + vectorBytes(sizes_) + vectorBytes(mtimes_) +
+            vectorBytes(uids_) + vectorBytes(gids_) + vectorBytes(owners_) + vectorBytes(groups_) +
+            vectorBytes(interned_) + interned +
+            directoryPrefixes_.size() *
+            (sizeof(std::pair<std::uint32_t const, std::pair<std::uint64_t, std::uint32_t>>) + 2 * sizeof(void*)) +
+            directoryPrefixes_.bucket_count() * sizeof(void*);
+    }
+}
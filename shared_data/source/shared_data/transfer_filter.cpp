@@ -0,0 +1,320 @@
+#include <shared_data/transfer_filter.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+namespace SharedData
+{
+    namespace
+    {
+        constexpr std::string_view globCharacters{"*?[\\"};
+
+        std::optional<std::uint64_t> parseQuantity(std::string_view text, std::string_view units, auto unitFactor)
+        {
+            std::uint64_t value = 0;
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (error != std::errc{} || end == text.data())
+                return std::nullopt;
+
+            const auto unit = std::string_view{end, static_cast<std::size_t>(text.data() + text.size() - end)};
+            if (unit.empty())
+                return value;
+            if (unit.size() != 1 || units.find(unit[0]) == std::string_view::npos)
+                return std::nullopt;
+            const std::uint64_t factor = unitFactor(unit[0]);
+            if (value > std::numeric_limits<std::uint64_t>::max() / factor)
+                return std::nullopt;
+            return value * factor;
+        }
+
+        std::optional<std::uint64_t> parseSize(std::string_view text)
+        {
+            return parseQuantity(text, "kMGT", [](char unit) -> std::uint64_t {
+                switch (unit)
+                {
+                    case ('k'):
+                        return 1024ull;
+                    case ('M'):
+                        return 1024ull * 1024;
+                    case ('G'):
+                        return 1024ull * 1024 * 1024;
+                    default:
+                        return 1024ull * 1024 * 1024 * 1024;
+                }
+            });
+        }
+
+        std::optional<std::uint64_t> parseAge(std::string_view text)
+        {
+            return parseQuantity(text, "smhd", [](char unit) -> std::uint64_t {
+                switch (unit)
+                {
+                    case ('s'):
+                        return 1;
+                    case ('m'):
+                        return 60;
+                    case ('h'):
+                        return 60 * 60;
+                    default:
+                        return 24 * 60 * 60;
+                }
+            });
+        }
+
+        /**
+         * @brief Matches a character against the class at the start of pattern, like "[a-z]".
+         *
+         * @param matched Set to whether the character is in the class.
+         * @return The length of the class in the pattern, nullopt if it has no end and is no class then.
+         */
+        std::optional<std::size_t> matchClass(std::string_view pattern, char c, bool& matched)
+        {
+            std::size_t i = 1;
+            const bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+            if (negated)
+                ++i;
+
+            matched = false;
+            // A ']' right at the start is part of the class:
+            for (bool first = true; i < pattern.size() && (first || pattern[i] != ']'); first = false)
+            {
+                auto low = pattern[i];
+                if (low == '\\' && i + 1 < pattern.size())
+                    low = pattern[++i];
+                auto high = low;
+                if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']')
+                {
+                    high = pattern[i + 2];
+                    i += 2;
+                }
+                if (low <= c && c <= high)
+                    matched = true;
+                ++i;
+            }
+            if (i >= pattern.size())
+                return std::nullopt;
+
+            matched = matched != negated;
+            return i + 1;
+        }
+    }
+
+    bool globMatch(std::string_view pattern, std::string_view text)
+    {
+        while (!pattern.empty())
+        {
+            if (pattern.starts_with("**"))
+            {
+                auto rest = pattern.substr(2);
+                if (rest.starts_with('/'))
+                {
+                    // Zero or more directories:
+                    rest.remove_prefix(1);
+                    if (globMatch(rest, text))
+                        return true;
+                    for (std::size_t i = 0; i < text.size(); ++i)
+                    {
+                        if (text[i] == '/' && globMatch(rest, text.substr(i + 1)))
+                            return true;
+                    }
+                    return false;
+                }
+                for (std::size_t i = 0; i <= text.size(); ++i)
+                {
+                    if (globMatch(rest, text.substr(i)))
+                        return true;
+                }
+                return false;
+            }
+
+            const char c = pattern.front();
+            if (c == '*')
+            {
+                const auto rest = pattern.substr(1);
+                for (std::size_t i = 0; i <= text.size(); ++i)
+                {
+                    if (globMatch(rest, text.substr(i)))
+                        return true;
+                    if (i < text.size() && text[i] == '/')
+                        break;
+                }
+                return false;
+            }
+
+            // Only a '/' of the pattern matches a '/':
+            if (text.empty() || (text.front() == '/' && c != '/'))
+                return false;
+
+            std::size_t consumed = 1;
+            if (c == '[')
+            {
+                bool matched = false;
+                const auto length = matchClass(pattern, text.front(), matched);
+                if (length)
+                {
+                    if (!matched)
+                        return false;
+                    consumed = *length;
+                }
+                else if (text.front() != '[')
+                    return false;
+            }
+            else if (c == '\\' && pattern.size() > 1)
+            {
+                if (text.front() != pattern[1])
+                    return false;
+                consumed = 2;
+            }
+            else if (c != '?' && c != text.front())
+                return false;
+
+            pattern.remove_prefix(consumed);
+            text.remove_prefix(1);
+        }
+        return text.empty();
+    }
+
+    std::expected<TransferFilterOptions, std::string> parseTransferFilter(std::string_view text)
+    {
+        constexpr std::string_view whitespace{" \t\r\n"};
+
+        TransferFilterOptions options{};
+        for (auto begin = text.find_first_not_of(whitespace); begin != std::string_view::npos;
+             begin = text.find_first_not_of(whitespace, begin))
+        {
+            const auto end = std::min(text.find_first_of(whitespace, begin), text.size());
+            const auto token = text.substr(begin, end - begin);
+            begin = end;
+
+            std::optional<std::uint64_t>* bound = nullptr;
+            std::optional<std::uint64_t> value{};
+            if (token.starts_with("size<") || token.starts_with("size>"))
+            {
+                bound = token[4] == '<' ? &options.maxSize : &options.minSize;
+                value = parseSize(token.substr(5));
+            }
+            else if (token.starts_with("age<") || token.starts_with("age>"))
+            {
+                bound = token[3] == '<' ? &options.maxAge : &options.minAge;
+                value = parseAge(token.substr(4));
+            }
+            else
+            {
+                options.patterns.emplace_back(token);
+                continue;
+            }
+
+            if (!value)
+                return std::unexpected(fmt::format("Invalid condition '{}'", token));
+            *bound = value;
+        }
+        return options;
+    }
+
+    TransferFilter::TransferFilter(TransferFilterOptions const& options, std::uint64_t now)
+        : minSize_{options.minSize}
+        , maxSize_{options.maxSize}
+        , minAge_{options.minAge}
+        , maxAge_{options.maxAge}
+        , now_{now}
+    {
+        for (std::string_view pattern : options.patterns)
+        {
+            if (pattern.empty() || pattern.starts_with('#'))
+                continue;
+
+            Rule rule{.kind = Rule::Kind::Glob, .negated = false, .directoryOnly = false, .anchored = false};
+            if (pattern.starts_with('!'))
+            {
+                rule.negated = true;
+                pattern.remove_prefix(1);
+            }
+            else if (pattern.starts_with("\\!") || pattern.starts_with("\\#"))
+                pattern.remove_prefix(1);
+
+            while (pattern.ends_with('/'))
+            {
+                rule.directoryOnly = true;
+                pattern.remove_suffix(1);
+            }
+            rule.anchored = pattern.find('/') != std::string_view::npos;
+            if (pattern.starts_with('/'))
+                pattern.remove_prefix(1);
+            if (pattern.empty())
+                continue;
+
+            if (pattern.find_first_of(globCharacters) == std::string_view::npos)
+                rule.kind = Rule::Kind::Literal;
+            else if (
+                !rule.anchored && pattern.starts_with('*') &&
+                pattern.find_first_of(globCharacters, 1) == std::string_view::npos)
+            {
+                rule.kind = Rule::Kind::Suffix;
+                pattern.remove_prefix(1);
+            }
+            rule.pattern = pattern;
+
+            hasNegatedRules_ = hasNegatedRules_ || rule.negated;
+            rules_.push_back(std::move(rule));
+        }
+    }
+
+    bool TransferFilter::matches(Rule const& rule, std::string_view relativePath, std::string_view name)
+    {
+        const auto subject = rule.anchored ? relativePath : name;
+        switch (rule.kind)
+        {
+            case (Rule::Kind::Literal):
+                return subject == rule.pattern;
+            case (Rule::Kind::Suffix):
+                return subject.ends_with(rule.pattern);
+            default:
+                return globMatch(rule.pattern, subject);
+        }
+    }
+
+    bool TransferFilter::excludes(std::string_view relativePath, DirectoryEntry const& entry) const
+    {
+        const auto slash = relativePath.rfind('/');
+        const auto name = slash == std::string_view::npos ? relativePath : relativePath.substr(slash + 1);
+
+        // The last matching pattern decides:
+        for (auto rule = rules_.rbegin(); rule != rules_.rend(); ++rule)
+        {
+            if (rule->directoryOnly && !entry.isDirectory())
+                continue;
+            if (matches(*rule, relativePath, name))
+            {
+                if (!rule->negated)
+                    return true;
+                break;
+            }
+        }
+
+        if (!entry.isRegularFile())
+            return false;
+
+        const auto age = now_ > entry.mtime ? now_ - entry.mtime : 0;
+        // The bounds are exclusive, like the "<" and ">" they are written with:
+        return (minSize_ && entry.size <= *minSize_) || (maxSize_ && entry.size >= *maxSize_) ||
+            (minAge_ && age <= *minAge_) || (maxAge_ && age >= *maxAge_);
+    }
+
+    std::vector<std::string> TransferFilter::excludedDirectoryNames() const
+    {
+        if (hasNegatedRules_)
+            return {};
+
+        std::vector<std::string> names{};
+        for (auto const& rule : rules_)
+        {
+            if (rule.anchored || rule.pattern.find("**") != std::string::npos)
+                continue;
+            names.push_back(rule.kind == Rule::Kind::Suffix ? "*" + rule.pattern : rule.pattern);
+        }
+        return names;
+    }
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <ssh/async/processing_thread.hpp>
+#include <ssh/async/processing_strand.hpp>
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/execution/outstanding_work.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/prefer.hpp>
+#include <boost/asio/system_executor.hpp>
+
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace SecureShell
+{
+    /**
+     * @brief Signature every asynchronous operation of the ssh wrappers completes with.
+     * The exception is only set if the operation could not run at all, for example because its strand was finalized
+     * or the processing thread dropped it. The result is default constructed then.
+     */
+    template <typename ResultT>
+    using AsyncSignature = void(std::exception_ptr, ResultT);
+
+    namespace Detail
+    {
+        /**
+         * @brief Owns the completion handler of an asynchronous operation until the operation completes.
+         * Handlers with an associated executor, like those of coroutines, are posted to it. Handlers without one are
+         * called right away on the processing thread, so plain callbacks do not need an io context.
+         * If the completion is destroyed before it completed, the handler gets an exception instead of waiting forever.
+         */
+        template <typename ResultT, typename HandlerT>
+        class AsyncCompletion
+        {
+          public:
+            explicit AsyncCompletion(HandlerT handler)
+                : handler_{std::move(handler)}
+                , work_{boost::asio::prefer(
+                      boost::asio::get_associated_executor(*handler_),
+                      boost::asio::execution::outstanding_work.tracked)}
+            {}
+            ~AsyncCompletion()
+            {
+                if (handler_)
+                {
+                    complete(
+                        std::make_exception_ptr(std::runtime_error("The operation was dropped before it could run.")),
+                        ResultT{});
+                }
+            }
+            AsyncCompletion(AsyncCompletion const&) = delete;
+            AsyncCompletion& operator=(AsyncCompletion const&) = delete;
+            AsyncCompletion(AsyncCompletion&&) = delete;
+            AsyncCompletion& operator=(AsyncCompletion&&) = delete;
+
+            void complete(std::exception_ptr error, ResultT&& result)
+            {
+                if (!handler_)
+                    return;
+
+                auto handler = std::move(*handler_);
+                handler_.reset();
+                if constexpr (std::is_same_v<ExecutorType, boost::asio::system_executor>)
+                {
+                    std::move(handler)(std::move(error), std::move(result));
+                }
+                else
+                {
+                    boost::asio::post(
+                        work_,
+                        [handler = std::move(handler), error = std::move(error), result = std::move(result)]() mutable {
+                            std::move(handler)(std::move(error), std::move(result));
+                        });
+                }
+            }
+
+          private:
+            using ExecutorType = boost::asio::associated_executor_t<HandlerT>;
+
+            std::optional<HandlerT> handler_;
+            // Keeps the io context of the handler from running out of work while the operation is in flight:
+            std::decay_t<decltype(boost::asio::prefer(
+                std::declval<ExecutorType>(),
+                boost::asio::execution::outstanding_work.tracked))>
+                work_;
+        };
+
+        /**
+         * @brief Implements asyncPerform, push hands the task to whatever runs it.
+         */
+        template <typename FunctionT, typename CompletionTokenT, typename PushT>
+        auto asyncPerformWith(PushT push, FunctionT&& func, CompletionTokenT&& token)
+        {
+            using ResultT = std::invoke_result_t<std::decay_t<FunctionT>&>;
+            static_assert(
+                std::default_initializable<ResultT>, "Results must be default constructible to report drops.");
+            return boost::asio::async_initiate<CompletionTokenT, AsyncSignature<ResultT>>(
+                [push = std::move(push)](auto handler, auto func) {
+                    auto completion =
+                        std::make_shared<Detail::AsyncCompletion<ResultT, decltype(handler)>>(std::move(handler));
+                    // A task that is not pushed or never runs destroys the completion, which reports the drop:
+                    push([completion = std::move(completion), func = std::move(func)]() mutable {
+                        std::optional<ResultT> result{};
+                        try
+                        {
+                            result.emplace(func());
+                        }
+                        catch (...)
+                        {
+                            return completion->complete(std::current_exception(), ResultT{});
+                        }
+                        completion->complete(nullptr, std::move(*result));
+                    });
+                },
+                token,
+                std::forward<FunctionT>(func));
+        }
+    }
+
+    /**
+     * @brief Turns an operation that reports its result to a callback into one that takes any asio completion token,
+     * for example boost::asio::use_awaitable.
+     *
+     * @tparam ResultT The type the callback is called with.
+     * @param initiation Starts the operation, gets the std::function<void(ResultT&&)> to call with the result.
+     * @param token The completion token.
+     */
+    template <typename ResultT, typename InitiationT, typename CompletionTokenT>
+    auto asyncFromCallback(InitiationT&& initiation, CompletionTokenT&& token)
+    {
+        static_assert(std::default_initializable<ResultT>, "Results must be default constructible to report drops.");
+        return boost::asio::async_initiate<CompletionTokenT, AsyncSignature<ResultT>>(
+            [](auto handler, auto initiation) {
+                auto completion =
+                    std::make_shared<Detail::AsyncCompletion<ResultT, decltype(handler)>>(std::move(handler));
+                initiation(std::function<void(ResultT&&)>{[completion](ResultT&& result) {
+                    completion->complete(nullptr, std::move(result));
+                }});
+            },
+            token,
+            std::forward<InitiationT>(initiation));
+    }
+
+    /**
+     * @brief Runs a function on a processing thread and completes the token with its return value, without blocking
+     * the caller.
+     *
+     * @param processingThread The processing thread to run the function on.
+     * @param func The function to run on the processing thread.
+     * @param priority The scheduling class of the task.
+     * @param token The completion token, like boost::asio::use_awaitable.
+     */
+    template <typename FunctionT, typename CompletionTokenT>
+    auto asyncPerform(
+        ProcessingThread& processingThread,
+        FunctionT&& func,
+        TaskPriority priority,
+        CompletionTokenT&& token)
+    {
+        return Detail::asyncPerformWith(
+            [&processingThread, priority](Task task) {
+                processingThread.pushTask(std::move(task), priority);
+            },
+            std::forward<FunctionT>(func),
+            std::forward<CompletionTokenT>(token));
+    }
+
+    /**
+     * @brief Runs a function on a strand and completes the token with its return value, without blocking the caller.
+     * The function runs with the priority of the strand, after everything pushed through the strand before.
+     *
+     * @param strand The strand to run the function on.
+     * @param func The function to run on the processing thread.
+     * @param token The completion token, like boost::asio::use_awaitable.
+     */
+    template <typename FunctionT, typename CompletionTokenT>
+    auto asyncPerform(ProcessingStrand& strand, FunctionT&& func, CompletionTokenT&& token)
+    {
+        return Detail::asyncPerformWith(
+            [&strand](Task task) {
+                strand.pushTask(std::move(task));
+            },
+            std::forward<FunctionT>(func),
+            std::forward<CompletionTokenT>(token));
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace SecureShell
+{
+    namespace Detail
+    {
+        /**
+         * @brief Recycler for the small blocks that promise/future shared states consist of.
+         * Blocks are kept in per thread, per size class free lists instead of being returned to the system allocator.
+         */
+        class CompletionBlockPool
+        {
+          public:
+            constexpr static std::size_t largestPooledBlock = 256;
+
+            static void* allocate(std::size_t size);
+            static void deallocate(void* block, std::size_t size) noexcept;
+        };
+    }
+
+    /**
+     * @brief Allocator for std::promise, so that the shared state of the returned future comes from a pool.
+     */
+    template <typename T>
+    class CompletionAllocator
+    {
+      public:
+        using value_type = T;
+
+        CompletionAllocator() noexcept = default;
+        template <typename U>
+        CompletionAllocator(CompletionAllocator<U> const&) noexcept
+        {}
+
+        T* allocate(std::size_t count)
+        {
+            return static_cast<T*>(Detail::CompletionBlockPool::allocate(count * sizeof(T)));
+        }
+
+        void deallocate(T* pointer, std::size_t count) noexcept
+        {
+            Detail::CompletionBlockPool::deallocate(pointer, count * sizeof(T));
+        }
+
+        template <typename U>
+        friend bool operator==(CompletionAllocator const&, CompletionAllocator<U> const&) noexcept
+        {
+            return true;
+        }
+    };
+}
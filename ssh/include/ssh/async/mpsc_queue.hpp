@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace SecureShell
+{
+    /**
+     * @brief A multi producer, single consumer queue.
+     * Producers claim slots of a fixed ring buffer without locks or allocations. Should the ring be full, values spill
+     * into a mutex protected overflow list. Overflowed values remember the ring position they were pushed at, so the
+     * consumer still pops everything in the order each producer pushed it.
+     *
+     * @tparam T The value type, must be default constructible and move assignable.
+     * @tparam Capacity The ring size, must be a power of two.
+     */
+    template <typename T, std::size_t Capacity = 256>
+    class MpscQueue
+    {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+      public:
+        MpscQueue()
+        {
+            for (std::size_t i = 0; i < Capacity; ++i)
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        MpscQueue(MpscQueue const&) = delete;
+        MpscQueue& operator=(MpscQueue const&) = delete;
+        MpscQueue(MpscQueue&&) = delete;
+        MpscQueue& operator=(MpscQueue&&) = delete;
+
+        /**
+         * @brief Pushes a value. Can be called from any thread.
+         */
+        void push(T value)
+        {
+            auto position = enqueuePosition_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto& cell = cells_[position & (Capacity - 1)];
+                const auto sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto difference =
+                    static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+                if (difference == 0)
+                {
+                    if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(value);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // Ring is full, every slot claimed so far precedes this value:
+                    std::lock_guard lock{overflowMutex_};
+                    overflow_.push_back({.position = position, .value = std::move(value)});
+                    overflowSize_.fetch_add(1, std::memory_order_release);
+                    return;
+                }
+                else
+                {
+                    position = enqueuePosition_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Pops the next value. Must only be called by the consumer.
+         *
+         * @param value Receives the popped value.
+         * @return true If a value was popped.
+         * @return false If no value is ready yet.
+         */
+        bool tryPop(T& value)
+        {
+            if (overflowSize_.load(std::memory_order_acquire) > 0)
+            {
+                std::lock_guard lock{overflowMutex_};
+                if (!overflow_.empty() && overflow_.front().position <= dequeuePosition_)
+                {
+                    value = std::move(overflow_.front().value);
+                    overflow_.pop_front();
+                    overflowSize_.fetch_sub(1, std::memory_order_release);
+                    return true;
+                }
+            }
+
+            const auto position = dequeuePosition_.load(std::memory_order_relaxed);
+            auto& cell = cells_[position & (Capacity - 1)];
+            if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+                return false;
+
+            value = std::move(cell.value);
+            cell.value = T{};
+            cell.sequence.store(position + Capacity, std::memory_order_release);
+            dequeuePosition_.store(position + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief Returns an approximation of the amount of queued values.
+         */
+        std::size_t size() const noexcept
+        {
+            const auto dequeued = dequeuePosition_.load(std::memory_order_relaxed);
+            const auto enqueued = enqueuePosition_.load(std::memory_order_relaxed);
+            return (enqueued > dequeued ? enqueued - dequeued : 0) + overflowSize_.load(std::memory_order_relaxed);
+        }
+
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+      private:
+        struct Cell
+        {
+            std::atomic<std::size_t> sequence{0};
+            T value{};
+        };
+
+        struct OverflowEntry
+        {
+            std::size_t position;
+            T value;
+        };
+
+        // Keeps producers and the consumer off each others cache lines.
+        constexpr static std::size_t cacheLineSize = 64;
+
+        alignas(cacheLineSize) std::atomic<std::size_t> enqueuePosition_{0};
+        alignas(cacheLineSize) std::atomic<std::size_t> dequeuePosition_{0};
+        alignas(cacheLineSize) std::atomic<std::size_t> overflowSize_{0};
+        std::mutex overflowMutex_{};
+        std::deque<OverflowEntry> overflow_{};
+        std::array<Cell, Capacity> cells_{};
+    };
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace SecureShell
+{
+    namespace Detail
+    {
+        /**
+         * @brief Adds to a counter that only one thread at a time writes to, which saves the locked instruction of a
+         * fetch_add. Readers may see a slightly stale value.
+         */
+        template <typename T>
+        void singleWriterAdd(std::atomic<T>& counter, T value) noexcept
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Histogram of durations with power of two buckets in microseconds.
+     * Recording is a handful of relaxed loads and stores, so it can stay enabled all the time.
+     * Must only be recorded to by one thread at a time, like the thread that runs the cycles of a processing thread.
+     */
+    class DurationHistogram
+    {
+      public:
+        /// Bucket 0 holds durations below 1us, bucket i holds [2^(i-1), 2^i) us, the last one everything above.
+        constexpr static std::size_t bucketCount = 32;
+
+        struct Snapshot
+        {
+            std::uint64_t count{0};
+            std::chrono::nanoseconds total{0};
+            std::chrono::nanoseconds maximum{0};
+            std::array<std::uint64_t, bucketCount> buckets{};
+
+            /**
+             * @brief Returns the upper bound of the bucket that contains the given percentile.
+             *
+             * @param percentile Between 0 and 100.
+             */
+            std::chrono::microseconds percentile(double percentile) const noexcept
+            {
+                if (count == 0)
+                    return std::chrono::microseconds{0};
+                const auto rank = static_cast<std::uint64_t>(static_cast<double>(count) * percentile / 100.0);
+                std::uint64_t seen = 0;
+                for (std::size_t i = 0; i < bucketCount; ++i)
+                {
+                    seen += buckets[i];
+                    if (seen > rank || seen == count)
+                        return std::chrono::microseconds{std::uint64_t{1} << i};
+                }
+                return std::chrono::duration_cast<std::chrono::microseconds>(maximum);
+            }
+
+            std::chrono::nanoseconds mean() const noexcept
+            {
+                if (count == 0)
+                    return std::chrono::nanoseconds{0};
+                return total / static_cast<std::int64_t>(count);
+            }
+        };
+
+        void record(std::chrono::nanoseconds duration) noexcept
+        {
+            const auto nanoseconds = std::max<std::int64_t>(duration.count(), 0);
+            const auto microseconds = static_cast<std::uint64_t>(nanoseconds / 1000);
+            const auto bucket = std::min<std::size_t>(std::bit_width(microseconds), bucketCount - 1);
+
+            Detail::singleWriterAdd(buckets_[bucket], std::uint64_t{1});
+            Detail::singleWriterAdd(count_, std::uint64_t{1});
+            Detail::singleWriterAdd(total_, nanoseconds);
+            if (nanoseconds > maximum_.load(std::memory_order_relaxed))
+                maximum_.store(nanoseconds, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Copies the current state. Not atomic as a whole, the fields may be off by the recordings that happen
+         * concurrently.
+         */
+        Snapshot snapshot() const noexcept
+        {
+            Snapshot result{};
+            result.count = count_.load(std::memory_order_relaxed);
+            result.total = std::chrono::nanoseconds{total_.load(std::memory_order_relaxed)};
+            result.maximum = std::chrono::nanoseconds{maximum_.load(std::memory_order_relaxed)};
+            for (std::size_t i = 0; i < bucketCount; ++i)
+                result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+            return result;
+        }
+
+      private:
+        std::atomic<std::uint64_t> count_{0};
+        std::atomic<std::int64_t> total_{0};
+        std::atomic<std::int64_t> maximum_{0};
+        std::array<std::atomic<std::uint64_t>, bucketCount> buckets_{};
+    };
+
+    /**
+     * @brief Time spent in one permanent task.
+     */
+    struct PermanentTaskMetrics
+    {
+        int id{-1};
+        std::uint64_t calls{0};
+        std::chrono::nanoseconds busy{0};
+        std::chrono::nanoseconds longest{0};
+    };
+
+    /**
+     * @brief What a processing strand cost the processing thread so far, including its permanent tasks.
+     */
+    struct StrandMetrics
+    {
+        std::size_t pendingTasks{0};
+        std::uint64_t tasksRun{0};
+        std::chrono::nanoseconds busy{0};
+    };
+
+    /**
+     * @brief A snapshot of the instrumentation of a processing thread.
+     */
+    struct ProcessingThreadMetrics
+    {
+        /// Time between pushing a task and it being started.
+        DurationHistogram::Snapshot enqueueLatency{};
+        /// Run time of one shot tasks.
+        DurationHistogram::Snapshot taskDuration{};
+        /// Duration of cycles that did any work.
+        DurationHistogram::Snapshot cycleDuration{};
+        /// Tasks waiting per priority, lowest value (highest priority) first.
+        std::vector<std::size_t> queueDepth{};
+        /// Highest total queue depth seen at the start of a cycle.
+        std::size_t peakQueueDepth{0};
+        std::vector<PermanentTaskMetrics> permanentTasks{};
+    };
+
+    namespace Detail
+    {
+        /**
+         * @brief Counters of a strand, shared with its queued tasks, which may outlive the strand.
+         * The pending count is changed by pushing threads, the rest only by the processing thread.
+         */
+        struct StrandCounters
+        {
+            std::atomic<std::size_t> pending{0};
+            std::atomic<std::uint64_t> tasksRun{0};
+            std::atomic<std::int64_t> busy{0};
+
+            void record(std::chrono::nanoseconds duration) noexcept
+            {
+                singleWriterAdd(tasksRun, std::uint64_t{1});
+                singleWriterAdd(busy, static_cast<std::int64_t>(duration.count()));
+            }
+        };
+
+        /**
+         * @brief Counters of a permanent task. Written by the processing thread only, read by anyone.
+         */
+        struct PermanentTaskCounters
+        {
+            std::atomic<std::uint64_t> calls{0};
+            std::atomic<std::int64_t> busy{0};
+            std::atomic<std::int64_t> longest{0};
+            // Strand the permanent task was pushed through, if any:
+            std::shared_ptr<StrandCounters> strand{};
+
+            void record(std::chrono::nanoseconds duration) noexcept
+            {
+                singleWriterAdd(calls, std::uint64_t{1});
+                singleWriterAdd(busy, static_cast<std::int64_t>(duration.count()));
+                if (duration.count() > longest.load(std::memory_order_relaxed))
+                    longest.store(duration.count(), std::memory_order_relaxed);
+                if (strand)
+                    strand->record(duration);
+            }
+        };
+    }
+}
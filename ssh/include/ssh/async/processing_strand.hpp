@@ -2,10 +2,12 @@
 
 #include <ssh/async/processing_thread.hpp>
 
+#include <atomic>
 #include <future>
 #include <functional>
 #include <mutex>
 #include <set>
+#include <thread>
 
 namespace SecureShell
 {
@@ -13,6 +15,10 @@ namespace SecureShell
      * @brief This class makes it impossible to push tasks to a strand after it has been finalized.
      * Finalization usually means some close operation is happening and no more tasks should be pushed.
      * Like reading a file when the session is closed.
+     *
+     * All tasks of a strand are scheduled with the priority of the strand, so they run in the order they were pushed.
+     * Priorities only decide between strands. Tasks of one strand usually work on the same handles, a close must not
+     * overtake a read that is still queued.
      */
     class ProcessingStrand
     {
@@ -21,59 +27,80 @@ namespace SecureShell
          * @brief Construct a new Processing Strand object living on top of a processing thread.
          *
          * @param processingThread The processing thread to push tasks to.
+         * @param priority The scheduling class of all tasks of this strand.
          */
-        ProcessingStrand(ProcessingThread* processingThread)
+        ProcessingStrand(ProcessingThread* processingThread, TaskPriority priority = TaskPriority::Metadata)
             : processingThread_(processingThread)
+            , priority_(priority)
         {}
 
         /**
-         * @brief Pushes a task, but not if the strand has been finalized and not simultaneously with any other push.
+         * @brief Pushes a task, but not if the strand has been finalized.
+         * Does not lock, finalization waits for pushes that are in flight instead.
          *
          * @param task The task to push.
          * @return true If the task was pushed.
-         * @return false If the strand has been finalized or the task was empty.
+         * @return false If the strand has been finalized.
          */
-        bool pushTask(std::function<void()> task)
+        bool pushTask(Task task)
         {
-            std::scoped_lock lock(mutex_);
-            if (finalized_)
+            ActivePush push{activePushes_};
+            if (finalized_.load())
                 return false;
-            return processingThread_->pushTask(std::move(task));
+            counters_->pending.fetch_add(1, std::memory_order_relaxed);
+            if (!processingThread_->pushScheduledTask({.task = std::move(task), .strand = counters_}, priority_))
+            {
+                counters_->pending.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
         }
 
         /**
          * @brief Pushes a task that will be executed until the strand is finalized.
          * But not if the strand has been finalized and not simultaneously with any other push.
          *
-         * @param task The task to push.
+         * @param task The task to push. See ProcessingThread::pushPermanentTask for bool returning tasks.
          * @return std::pair<bool, ProcessingThread::PermanentTaskId> If the task was pushed and the id of the task.
          */
-        std::pair<bool, ProcessingThread::PermanentTaskId> pushPermanentTask(std::function<void()> task)
+        template <typename FunctionT>
+        std::pair<bool, ProcessingThread::PermanentTaskId> pushPermanentTask(FunctionT&& task)
         {
             std::scoped_lock lock(mutex_);
             if (finalized_)
                 return {false, ProcessingThread::PermanentTaskId{-1}};
-            auto result = processingThread_->pushPermanentTask(std::move(task));
+            auto result = processingThread_->pushPermanentTaskImpl(
+                ProcessingThread::toPermanentTask(std::forward<FunctionT>(task)), counters_);
             this->permanentTasks_.insert(result.second);
             return result;
         }
 
+        /**
+         * @brief Removes a permanent task of this strand before the strand is finalized. May be called from within
+         * the task itself, it is then removed after the current cycle.
+         *
+         * @param id The id pushPermanentTask returned.
+         * @return true If the task was removed.
+         */
+        bool removePermanentTask(ProcessingThread::PermanentTaskId const& id)
+        {
+            std::scoped_lock lock(mutex_);
+            if (permanentTasks_.erase(id) == 0)
+                return false;
+            return processingThread_->removePermanentTask(id);
+        }
+
         /**
          * @brief Pushes a task that makes any further pushes impossible. Also removes all permanent tasks.
          *
          * @param task The task to push.
          */
-        void pushFinalTask(std::function<void()> task)
+        void pushFinalTask(Task task)
         {
             std::scoped_lock lock(mutex_);
-            if (finalized_)
+            if (!finalize())
                 return;
-            finalized_ = true;
-            for (auto const& id : permanentTasks_)
-            {
-                processingThread_->removePermanentTask(id);
-            }
-            processingThread_->pushTask(std::move(task));
+            pushFinal(std::move(task));
         }
 
         /**
@@ -92,12 +119,10 @@ namespace SecureShell
                     std::make_exception_ptr(std::runtime_error("Cannot push task to finalized strand.")));
                 return promise.get_future();
             }
-            finalized_ = true;
-            for (auto const& id : permanentTasks_)
-            {
-                processingThread_->removePermanentTask(id);
-            }
-            return processingThread_->pushPromiseTask(std::forward<FunctionT>(func));
+            finalize();
+            auto [task, future] = ProcessingThread::makePromiseTask(std::forward<FunctionT>(func));
+            pushFinal(std::move(task));
+            return std::move(future);
         }
 
         /**
@@ -109,13 +134,8 @@ namespace SecureShell
         void doFinalSync(std::function<void()> const& task)
         {
             std::scoped_lock lock(mutex_);
-            if (finalized_)
+            if (!finalize())
                 return;
-            finalized_ = true;
-            for (auto const& id : permanentTasks_)
-            {
-                processingThread_->removePermanentTask(id);
-            }
             task();
         }
 
@@ -129,15 +149,27 @@ namespace SecureShell
         template <typename Func>
         auto pushPromiseTask(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>>
         {
-            std::scoped_lock lock(mutex_);
-            if (finalized_)
+            if (finalized_.load())
+            {
+                std::promise<std::invoke_result_t<std::decay_t<Func>>> promise{};
+                promise.set_exception(
+                    std::make_exception_ptr(std::runtime_error("Cannot push task to finalized strand.")));
+                return promise.get_future();
+            }
+            auto [task, future] = ProcessingThread::makePromiseTask(std::forward<Func>(func));
+            if (!pushTask(std::move(task)) && finalized_.load())
             {
                 std::promise<std::invoke_result_t<std::decay_t<Func>>> promise{};
                 promise.set_exception(
                     std::make_exception_ptr(std::runtime_error("Cannot push task to finalized strand.")));
                 return promise.get_future();
             }
-            return processingThread_->pushPromiseTask(std::forward<Func>(func));
+            return std::move(future);
+        }
+
+        TaskPriority priority() const noexcept
+        {
+            return priority_;
         }
 
         bool withinProcessingThread() const noexcept
@@ -147,13 +179,73 @@ namespace SecureShell
 
         bool isFinalized() const noexcept
         {
-            return finalized_;
+            return finalized_.load();
+        }
+
+        /**
+         * @brief Returns how many tasks of this strand ran and how long they took.
+         */
+        StrandMetrics metrics() const noexcept
+        {
+            return StrandMetrics{
+                .pendingTasks = counters_->pending.load(std::memory_order_relaxed),
+                .tasksRun = counters_->tasksRun.load(std::memory_order_relaxed),
+                .busy = std::chrono::nanoseconds{counters_->busy.load(std::memory_order_relaxed)},
+            };
+        }
+
+      private:
+        /**
+         * The final task is queued behind every task of the strand, as they all share its priority.
+         */
+        void pushFinal(Task task)
+        {
+            processingThread_->pushTask(std::move(task), priority_);
+        }
+
+        struct ActivePush
+        {
+            std::atomic<int>& counter;
+            explicit ActivePush(std::atomic<int>& counter)
+                : counter{counter}
+            {
+                ++counter;
+            }
+            ~ActivePush()
+            {
+                --counter;
+            }
+            ActivePush(ActivePush const&) = delete;
+            ActivePush& operator=(ActivePush const&) = delete;
+        };
+
+        /**
+         * @brief Marks the strand as finalized and removes its permanent tasks. mutex_ must be held.
+         *
+         * @return true If the strand was not finalized before.
+         */
+        bool finalize()
+        {
+            if (finalized_.exchange(true))
+                return false;
+            // Pushes that saw the strand unfinalized must land before whatever the caller pushes next:
+            while (activePushes_.load() != 0)
+                std::this_thread::yield();
+            for (auto const& id : permanentTasks_)
+            {
+                processingThread_->removePermanentTask(id);
+            }
+            return true;
         }
 
       private:
         std::recursive_mutex mutex_{};
-        bool finalized_ = false;
+        std::atomic_bool finalized_ = false;
+        std::atomic<int> activePushes_ = 0;
+        // Shared with the queued tasks, which can outlive the strand:
+        std::shared_ptr<Detail::StrandCounters> counters_ = std::make_shared<Detail::StrandCounters>();
         ProcessingThread* processingThread_{};
+        TaskPriority priority_{TaskPriority::Metadata};
         std::set<ProcessingThread::PermanentTaskId> permanentTasks_{};
     };
 }
\ No newline at end of file
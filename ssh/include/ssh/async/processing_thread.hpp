@@ -1,28 +1,67 @@
 #pragma once
 
+#include <ssh/async/wakeup_signal.hpp>
+#include <ssh/async/task.hpp>
+#include <ssh/async/mpsc_queue.hpp>
+#include <ssh/async/completion_allocator.hpp>
+#include <ssh/async/processing_metrics.hpp>
+
 #include <thread>
 #include <atomic>
-#include <deque>
 #include <mutex>
 #include <functional>
 #include <map>
 #include <future>
 #include <memory>
 #include <vector>
+#include <type_traits>
+#include <array>
+#include <utility>
 
 namespace SecureShell
 {
     class ProcessingStrand;
+    class ProcessingThreadPool;
+
+    /**
+     * @brief Scheduling class of a task. Lower values are served first.
+     */
+    enum class TaskPriority
+    {
+        /// Keystrokes, pty reads and everything else a user waits for.
+        Interactive = 0,
+        /// Directory listings, stats, opening files and the like.
+        Metadata = 1,
+        /// Reading and writing file contents.
+        Bulk = 2,
+    };
+    constexpr std::size_t taskPriorityCount = 3;
 
     /**
      * @brief A processing thread that can be used to execute tasks sequentially in a separate thread.
      * This allows for complex simultaneous operations to be executed in a single thread.
+     *
+     * When a cycle does no work, the thread goes idle and sleeps until a task is pushed, a watched socket becomes
+     * readable or the idle timeout expires.
+     *
+     * Instead of owning an OS thread, a processing thread can be started on a ProcessingThreadPool. Its cycles are then
+     * run by one of the pool workers, which makes withinProcessingThread and the ordering guarantees behave the same.
      */
     class ProcessingThread
     {
       public:
         constexpr static std::size_t maximumTasksProcessableAtOnce = 100ull;
 
+        /// How many cycles in a row must be without work before the thread goes idle.
+        constexpr static int quietCyclesBeforeIdle = 2;
+
+        /// Upper bound for an idle sleep, covers data that libssh buffered without the socket being readable.
+        constexpr static std::chrono::milliseconds defaultIdleTimeout{100};
+
+        /// How many tasks of each priority are run per cycle at most. Before every task the highest priority that has
+        /// work and quota left is served, so interactive tasks never wait behind more than one bulk task.
+        constexpr static std::array<std::size_t, taskPriorityCount> priorityWeights{64, 16, 2};
+
         /**
          * @brief A permanent task id that can be used to remove permanent tasks.
          */
@@ -45,12 +84,26 @@ namespace SecureShell
         /**
          * @brief Starts the processing thread.
          *
-         * @param waitCycleTimeout The time to wait for a task to become available before checking if the thread should
-         * stop.
          * @param minimumCycleWait The minimum wait time between cycles to throttle the processing thread in case of the
-         * existence of permanent tasks.
+         * existence of permanent tasks that always report work.
+         * @param idleTimeout The maximum time the thread sleeps when there is nothing to do.
          */
-        void start(std::chrono::milliseconds const& minimumCycleWait = std::chrono::milliseconds{0});
+        void start(
+            std::chrono::milliseconds const& minimumCycleWait = std::chrono::milliseconds{0},
+            std::chrono::milliseconds const& idleTimeout = defaultIdleTimeout);
+
+        /**
+         * @brief Starts processing on a worker of the given pool instead of a dedicated thread.
+         * The pool must outlive this processing thread or at least the next call to stop.
+         *
+         * @param pool The pool that runs the cycles.
+         * @param minimumCycleWait The minimum wait time between cycles that did work.
+         * @param idleTimeout The maximum time the worker sleeps when there is nothing to do.
+         */
+        void start(
+            ProcessingThreadPool& pool,
+            std::chrono::milliseconds const& minimumCycleWait = std::chrono::milliseconds{0},
+            std::chrono::milliseconds const& idleTimeout = defaultIdleTimeout);
 
         /**
          * @brief Stops the processing thread. Executes all pending tasks.
@@ -66,47 +119,74 @@ namespace SecureShell
         bool isRunning() const;
 
         /**
-         * @brief Pushes a task to the processing thread.
+         * @brief Pushes a task to the processing thread. Lock free and does not allocate for small tasks.
          *
          * @param task The task to push.
+         * @param priority The scheduling class of the task.
          * @return true If the task was pushed.
-         * @return false If the task was empty or the processing thread is shutting down.
+         * @return false If the processing thread is shutting down.
+         * @throws std::invalid_argument If the task is empty.
          */
-        bool pushTask(std::function<void()> task);
+        bool pushTask(Task task, TaskPriority priority = TaskPriority::Metadata);
 
         /**
          * @brief Pushes a task that has a return value to the processing thread.
          * The return value is then accessible through the returned future.
          *
          * @param func The function to execute.
+         * @param priority The scheduling class of the task.
          * @return std::future<std::invoke_result_t<std::decay_t<Func>>> The future that will contain the return value.
          */
         template <typename Func>
-        auto pushPromiseTask(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>>
+        auto pushPromiseTask(Func&& func, TaskPriority priority = TaskPriority::Metadata)
+            -> std::future<std::invoke_result_t<std::decay_t<Func>>>
+        {
+            auto [task, future] = makePromiseTask(std::forward<Func>(func));
+            pushTask(std::move(task), priority);
+            return std::move(future);
+        }
+
+        /**
+         * @brief Wraps a function into a task that fulfills the returned future.
+         *
+         * @param func The function to wrap.
+         * @return std::pair<Task, std::future<...>> The task and the future of its return value.
+         */
+        template <typename Func>
+        static auto makePromiseTask(Func&& func) -> std::pair<Task, std::future<std::invoke_result_t<std::decay_t<Func>>>>
         {
             using ReturnType = std::invoke_result_t<std::decay_t<Func>>;
-            auto promise = std::make_shared<std::promise<ReturnType>>();
-            pushTask([promise, func = std::forward<Func>(func)]() mutable {
-                if constexpr (std::is_void_v<ReturnType>)
-                {
-                    func();
-                    promise->set_value();
-                }
-                else
-                {
-                    promise->set_value(func());
-                }
-            });
-            return promise->get_future();
+            std::promise<ReturnType> promise{std::allocator_arg, CompletionAllocator<ReturnType>{}};
+            auto future = promise.get_future();
+            return {
+                Task{[promise = std::move(promise), func = std::forward<Func>(func)]() mutable {
+                    if constexpr (std::is_void_v<ReturnType>)
+                    {
+                        func();
+                        promise.set_value();
+                    }
+                    else
+                    {
+                        promise.set_value(func());
+                    }
+                }},
+                std::move(future),
+            };
         }
 
         /**
          * @brief Pushes a task that is not removed upon execution. Will be executed every cycle.
+         * A task returning bool reports whether it did any work, which allows the thread to go idle when it did not.
+         * A task returning void is assumed to always do work and keeps the thread polling.
          *
          * @param task The task to push.
          * @return std::pair<bool, PermanentTaskId> If the task was pushed and the id of the task.
          */
-        std::pair<bool, PermanentTaskId> pushPermanentTask(std::function<void()> task);
+        template <typename FunctionT>
+        std::pair<bool, PermanentTaskId> pushPermanentTask(FunctionT&& task)
+        {
+            return pushPermanentTaskImpl(toPermanentTask(std::forward<FunctionT>(task)));
+        }
 
         /**
          * @brief Removes a permanent task.
@@ -129,6 +209,21 @@ namespace SecureShell
          */
         void clearPermanentTasks();
 
+        /**
+         * @brief Adds a socket that wakes the thread up when it becomes readable while idling.
+         * Sockets are only watched while permanent tasks exist, because only those consume the incoming data.
+         *
+         * @param socket The socket to watch.
+         */
+        void watchSocket(NativeSocket socket);
+
+        /**
+         * @brief Stops watching a socket.
+         *
+         * @param socket The socket to no longer watch.
+         */
+        void unwatchSocket(NativeSocket socket);
+
         /**
          * @brief Waits for a cycle to complete.
          *
@@ -138,6 +233,13 @@ namespace SecureShell
          */
         bool awaitCycle(std::chrono::milliseconds maxWait = std::chrono::seconds{5});
 
+        /**
+         * @brief Returns the instrumentation of the thread. Cheap enough to be polled for live graphs.
+         *
+         * @return ProcessingThreadMetrics The latencies, durations and queue depths so far.
+         */
+        ProcessingThreadMetrics metrics() const;
+
         /**
          * @brief Returns true if the current thread is the processing thread.
          *
@@ -152,12 +254,77 @@ namespace SecureShell
         /**
          * @brief Creates a new processing strand.
          *
+         * @param priority The scheduling class of tasks pushed through the strand.
          * @return std::unique_ptr<ProcessingStrand> The processing strand.
          */
-        std::unique_ptr<ProcessingStrand> createStrand();
+        std::unique_ptr<ProcessingStrand> createStrand(TaskPriority priority = TaskPriority::Metadata);
 
       private:
-        void run(std::chrono::milliseconds const& minimumCycleWait);
+        friend class ProcessingStrand;
+        friend class ProcessingThreadPool;
+
+        // Socket readiness that no permanent task consumes would otherwise wake the idle thread in a loop.
+        constexpr static int maximumFruitlessSocketWakeups = 3;
+
+        // Request/response patterns push the next task right away, spinning briefly saves the sleep and wakeup.
+        constexpr static std::chrono::microseconds idleSpinDuration{50};
+
+        struct ScheduledTask
+        {
+            Task task{};
+            // Counters of the strand the task was pushed through, the pending count is decremented right before the
+            // task runs.
+            std::shared_ptr<Detail::StrandCounters> strand{};
+            std::chrono::steady_clock::time_point enqueued{};
+        };
+
+        struct PermanentTask
+        {
+            std::function<bool()> task{};
+            std::shared_ptr<Detail::PermanentTaskCounters> counters{};
+        };
+
+        bool pushScheduledTask(ScheduledTask scheduled, TaskPriority priority);
+        bool popScheduledTask(ScheduledTask& scheduled, std::array<std::size_t, taskPriorityCount>& quota);
+        void runScheduledTask(ScheduledTask& scheduled, std::chrono::steady_clock::time_point& now);
+        bool tasksQueued() const noexcept;
+
+        template <typename FunctionT>
+        static std::function<bool()> toPermanentTask(FunctionT&& task)
+        {
+            if constexpr (std::is_same_v<std::invoke_result_t<std::decay_t<FunctionT>&>, bool>)
+            {
+                return std::function<bool()>{std::forward<FunctionT>(task)};
+            }
+            else
+            {
+                std::function<void()> voidTask{std::forward<FunctionT>(task)};
+                if (!voidTask)
+                    return {};
+                return [voidTask = std::move(voidTask)]() {
+                    voidTask();
+                    return true;
+                };
+            }
+        }
+
+        std::pair<bool, PermanentTaskId>
+        pushPermanentTaskImpl(std::function<bool()> task, std::shared_ptr<Detail::StrandCounters> strand = {});
+        void notifyWakeup() noexcept;
+        void run(std::chrono::milliseconds const& minimumCycleWait, std::chrono::milliseconds const& idleTimeout);
+        void idle(std::chrono::milliseconds const& idleTimeout);
+
+        /**
+         * @brief Runs the permanent tasks once and then the queued tasks up to the per cycle limits.
+         *
+         * @return true If any work was done.
+         */
+        bool runCycle();
+
+        /**
+         * @brief Appends the sockets that are worth waking up for while idle.
+         */
+        void appendIdleSockets(std::vector<NativeSocket>& sockets) const;
 
       private:
         std::thread thread_{};
@@ -169,8 +336,29 @@ namespace SecureShell
         std::atomic<std::thread::id> processingThreadId_{};
         std::atomic_bool processingPermanents_{false};
         std::vector<std::function<void()>> deferredTaskModification_{};
+        WakeupSignal wakeup_{};
+        // Either wakeup_ or the signal of the pool worker the thread is currently assigned to:
+        std::atomic<WakeupSignal*> activeWakeup_{&wakeup_};
+        std::vector<NativeSocket> watchedSockets_{};
+        std::vector<NativeSocket> idleSockets_{};
+        int fruitlessSocketWakeups_{0};
+
+        std::array<MpscQueue<ScheduledTask, 128>, taskPriorityCount> tasks_{};
+        std::map<PermanentTaskId, PermanentTask> permanentTasks_{};
+        // Also readable while the permanent tasks are moved out for a cycle:
+        std::map<PermanentTaskId, std::shared_ptr<Detail::PermanentTaskCounters>> permanentTaskCounters_{};
+
+        DurationHistogram enqueueLatency_{};
+        DurationHistogram taskDuration_{};
+        DurationHistogram cycleDuration_{};
+        std::atomic<std::size_t> peakQueueDepth_{0};
 
-        std::deque<std::function<void()>> tasks_{};
-        std::map<PermanentTaskId, std::function<void()>> permanentTasks_{};
+        // Only used on a pool, owned by the worker that runs the cycles:
+        ProcessingThreadPool* pool_{nullptr};
+        std::chrono::milliseconds minimumCycleWait_{0};
+        std::chrono::milliseconds idleTimeout_{defaultIdleTimeout};
+        std::chrono::steady_clock::time_point throttledUntil_{};
+        std::chrono::nanoseconds windowLoad_{0};
+        std::chrono::nanoseconds lastWindowLoad_{0};
     };
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <ssh/async/processing_thread.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace SecureShell
+{
+    /**
+     * @brief A fixed set of worker threads that run the cycles of many processing threads.
+     *
+     * Every processing thread started on the pool is assigned to exactly one worker at a time, so everything it runs
+     * stays sequential and on one OS thread, which is what libssh requires. Idle processing threads cost nothing, a
+     * worker sleeps on the union of the sockets of its processing threads. Processing threads are migrated between
+     * cycles from busy workers to less busy ones.
+     *
+     * libssh is used in blocking mode, so a cycle can hang on a slow server. The other processing threads of a worker
+     * that is stuck in a cycle for longer than stallThreshold are taken over by the other workers, a slow session only
+     * ever holds up itself.
+     */
+    class ProcessingThreadPool
+    {
+      public:
+        /// Length of the window over which the load of workers is measured and balanced.
+        constexpr static std::chrono::milliseconds rebalanceInterval{500};
+
+        /// Workers whose busy time within a window differs by less than this are considered balanced.
+        constexpr static std::chrono::milliseconds migrationThreshold{100};
+
+        /// A worker in the same cycle for longer than this is considered stuck in a blocking call.
+        constexpr static std::chrono::milliseconds stallThreshold{50};
+
+        /**
+         * @brief Creates the pool and starts the workers.
+         *
+         * @param workerCount The amount of workers, the number of hardware threads by default.
+         */
+        explicit ProcessingThreadPool(std::size_t workerCount = defaultWorkerCount());
+        ~ProcessingThreadPool();
+        ProcessingThreadPool(ProcessingThreadPool const&) = delete;
+        ProcessingThreadPool& operator=(ProcessingThreadPool const&) = delete;
+        ProcessingThreadPool(ProcessingThreadPool&&) = delete;
+        ProcessingThreadPool& operator=(ProcessingThreadPool&&) = delete;
+
+        /**
+         * @brief Returns the number of hardware threads, at least 1.
+         */
+        static std::size_t defaultWorkerCount() noexcept;
+
+        /**
+         * @brief Returns the amount of workers.
+         */
+        std::size_t workerCount() const noexcept;
+
+        /**
+         * @brief Returns the amount of processing threads that are currently running on the pool.
+         */
+        std::size_t attachedCount() const;
+
+      private:
+        friend class ProcessingThread;
+        struct Worker;
+
+        /**
+         * @brief Assigns the processing thread to the worker with the fewest processing threads.
+         */
+        void attach(ProcessingThread& context);
+
+        /**
+         * @brief Removes the processing thread from its worker. Blocks until the worker is done with its current cycle,
+         * unless called from within that cycle.
+         */
+        void detach(ProcessingThread& context);
+
+        void work(Worker& worker);
+        void idle(Worker& worker, std::chrono::steady_clock::time_point wakeAt);
+        void rebalance(Worker& worker);
+
+        /**
+         * @brief Takes over the processing threads that wait behind the cycle of a stuck worker.
+         */
+        void rescueStalled(Worker& worker);
+
+        /**
+         * @brief Is the worker stuck in a cycle? mutex_ must be held.
+         */
+        static bool stalled(Worker const& worker, std::chrono::steady_clock::time_point now);
+
+      private:
+        mutable std::mutex mutex_{};
+        std::condition_variable cycleDone_{};
+        std::atomic_bool running_{true};
+        std::vector<std::unique_ptr<Worker>> workers_{};
+    };
+}
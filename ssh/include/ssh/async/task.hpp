@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace SecureShell
+{
+    /**
+     * @brief A move-only type erased void() callable.
+     * Callables up to inlineCapacity bytes are stored within the task itself, so creating and moving them does not
+     * allocate.
+     */
+    class Task
+    {
+      public:
+        constexpr static std::size_t inlineCapacity = 64;
+
+        Task() noexcept = default;
+        Task(std::nullptr_t) noexcept
+        {}
+
+        template <typename FunctionT>
+            requires(!std::is_same_v<std::decay_t<FunctionT>, Task> && std::is_invocable_v<std::decay_t<FunctionT>&>)
+        Task(FunctionT&& func)
+        {
+            using StoredT = std::decay_t<FunctionT>;
+
+            // std::function and function pointers can be empty, these make for an empty task:
+            if constexpr (requires(StoredT const& f) { f == nullptr; })
+            {
+                if (func == nullptr)
+                    return;
+            }
+
+            if constexpr (fitsInline<StoredT>)
+            {
+                ::new (static_cast<void*>(storage_)) StoredT(std::forward<FunctionT>(func));
+                operations_ = &inlineOperations<StoredT>;
+            }
+            else
+            {
+                ::new (static_cast<void*>(storage_)) StoredT*(new StoredT(std::forward<FunctionT>(func)));
+                operations_ = &heapOperations<StoredT>;
+            }
+        }
+
+        Task(Task&& other) noexcept
+            : operations_{std::exchange(other.operations_, nullptr)}
+        {
+            if (operations_)
+                operations_->relocate(other.storage_, storage_);
+        }
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                operations_ = std::exchange(other.operations_, nullptr);
+                if (operations_)
+                    operations_->relocate(other.storage_, storage_);
+            }
+            return *this;
+        }
+
+        Task(Task const&) = delete;
+        Task& operator=(Task const&) = delete;
+
+        ~Task()
+        {
+            reset();
+        }
+
+        /**
+         * @brief Calls the stored callable. The task must not be empty.
+         */
+        void operator()()
+        {
+            operations_->invoke(storage_);
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return operations_ != nullptr;
+        }
+
+        /**
+         * @brief Destroys the stored callable and leaves the task empty.
+         */
+        void reset() noexcept
+        {
+            if (operations_)
+                std::exchange(operations_, nullptr)->destroy(storage_);
+        }
+
+      private:
+        struct Operations
+        {
+            void (*invoke)(std::byte* storage);
+            // Moves the callable from one storage to another and destroys the source.
+            void (*relocate)(std::byte* from, std::byte* to) noexcept;
+            void (*destroy)(std::byte* storage) noexcept;
+        };
+
+        template <typename T>
+        constexpr static bool fitsInline = sizeof(T) <= inlineCapacity && alignof(T) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible_v<T>;
+
+        template <typename T>
+        static T* inlineObject(std::byte* storage) noexcept
+        {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+
+        template <typename T>
+        static T*& heapObject(std::byte* storage) noexcept
+        {
+            return *std::launder(reinterpret_cast<T**>(storage));
+        }
+
+        template <typename T>
+        constexpr static Operations inlineOperations{
+            .invoke =
+                [](std::byte* storage) {
+                    (*inlineObject<T>(storage))();
+                },
+            .relocate =
+                [](std::byte* from, std::byte* to) noexcept {
+                    auto* source = inlineObject<T>(from);
+                    ::new (static_cast<void*>(to)) T(std::move(*source));
+                    source->~T();
+                },
+            .destroy =
+                [](std::byte* storage) noexcept {
+                    inlineObject<T>(storage)->~T();
+                },
+        };
+
+        template <typename T>
+        constexpr static Operations heapOperations{
+            .invoke =
+                [](std::byte* storage) {
+                    (*heapObject<T>(storage))();
+                },
+            .relocate =
+                [](std::byte* from, std::byte* to) noexcept {
+                    ::new (static_cast<void*>(to)) T*(heapObject<T>(from));
+                },
+            .destroy =
+                [](std::byte* storage) noexcept {
+                    delete heapObject<T>(storage);
+                },
+        };
+
+      private:
+        alignas(std::max_align_t) std::byte storage_[inlineCapacity];
+        Operations const* operations_{nullptr};
+    };
+}
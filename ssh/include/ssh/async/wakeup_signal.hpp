@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#ifndef _WIN32
+#    include <poll.h>
+#endif
+
+namespace SecureShell
+{
+#ifdef _WIN32
+    using NativeSocket = std::uintptr_t;
+#else
+    using NativeSocket = int;
+#endif
+
+    /**
+     * @brief Lets an idle thread sleep until it is signalled by another thread or until one of a set of sockets
+     * becomes readable. Signalling is a single atomic store when nobody is asleep.
+     */
+    class WakeupSignal
+    {
+      public:
+        enum class Reason
+        {
+            Signalled,
+            SocketReadable,
+            Timeout
+        };
+
+        WakeupSignal();
+        ~WakeupSignal();
+        WakeupSignal(WakeupSignal const&) = delete;
+        WakeupSignal& operator=(WakeupSignal const&) = delete;
+        WakeupSignal(WakeupSignal&&) = delete;
+        WakeupSignal& operator=(WakeupSignal&&) = delete;
+
+        /**
+         * @brief Wakes up the waiting thread. If no thread is waiting, the next wait returns immediately.
+         */
+        void notify() noexcept;
+
+        /**
+         * @brief Blocks until notify is called, any of the sockets becomes readable or the timeout expires.
+         * Must only be called by one thread at a time.
+         *
+         * @param sockets The sockets to watch for readability.
+         * @param timeout The maximum time to wait.
+         * @return Reason Why the wait returned.
+         */
+        Reason wait(std::span<NativeSocket const> sockets, std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Returns true if notify was called since the last wait. Allows spinning before going to sleep.
+         */
+        bool pending() const noexcept
+        {
+            return pending_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::atomic_bool pending_{false};
+        std::atomic_bool sleeping_{false};
+#ifdef _WIN32
+        // A loopback UDP socket connected to itself, WSAPoll cannot wait on anything but sockets:
+        NativeSocket socket_{};
+#else
+        int readFd_{-1};
+        int writeFd_{-1};
+        std::vector<pollfd> pollFds_{};
+#endif
+    };
+}
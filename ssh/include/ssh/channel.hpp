@@ -3,8 +3,12 @@
 #include <libssh/libsshpp.hpp>
 #include <ssh/async/processing_thread.hpp>
 #include <ssh/async/processing_strand.hpp>
+#include <ssh/async/async_operation.hpp>
+#include <ssh/channel_interface.hpp>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <functional>
 #include <string>
 #include <chrono>
@@ -14,7 +18,9 @@ namespace SecureShell
 {
     class Session;
 
-    class Channel : public std::enable_shared_from_this<Channel>
+    class Channel
+        : public IChannel
+        , public std::enable_shared_from_this<Channel>
     {
       public:
         Channel(Session* owner, std::unique_ptr<ProcessingStrand> strand, std::unique_ptr<ssh::Channel>);
@@ -29,15 +35,25 @@ namespace SecureShell
             return *channel_;
         }
 
-        bool close(bool isBackElement = false);
+        bool close(bool isBackElement = false) override;
 
         /**
-         * @brief Writes data to the channel.
+         * @brief Queues data to be written to the channel. Writes that queue up before the strand gets to them are
+         * sent together, data beyond the remote window stays queued until the window opens again.
          *
          * @param data The data to write
+         * @return false if the channel does not take writes anymore.
          */
         bool write(std::string data);
 
+        /**
+         * @brief The amount of bytes written but not sent yet.
+         */
+        std::size_t queuedBytes() const
+        {
+            return queuedBytes_.load(std::memory_order_relaxed);
+        }
+
         struct Dimensions
         {
             int columns;
@@ -62,20 +78,97 @@ namespace SecureShell
             return resizePty(dimensions.columns, dimensions.rows);
         }
 
+        /**
+         * @brief Asynchronous version of resizePty, completes with AsyncSignature<int>.
+         *
+         * @param cols The new number of columns.
+         * @param rows The new number of rows.
+         * @param token A completion token, like boost::asio::use_awaitable or a callback.
+         */
+        template <typename CompletionTokenT>
+        auto asyncResizePty(int cols, int rows, CompletionTokenT&& token)
+        {
+            return asyncPerform(
+                *strand_,
+                [this, cols, rows]() {
+                    return changePtySize(cols, rows);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
         /**
          * @brief Starts reading and processing the channel.
+         * Output arriving while the channel is idle is passed on immediately, continuous output is coalesced into
+         * chunks of up to options.maxChunkSize.
          *
          * @param onStdout
          * @param onStderr
          * @param onExit
+         * @param options
          */
         void startReading(
             std::function<void(std::string const&)> onStdout,
             std::function<void(std::string const&)> onStderr,
-            std::function<void()> onExit);
+            std::function<void()> onExit,
+            ChannelReadOptions options = {}) override;
+
+        /**
+         * @brief Gives back read credit for output that was consumed, see ChannelReadOptions::window.
+         *
+         * @param bytes The amount of output bytes consumed.
+         */
+        void acknowledge(std::size_t bytes) override;
+
+        ProcessingStrand* strand() const
+        {
+            return strand_.get();
+        }
 
       private:
-        void readTask(std::chrono::milliseconds pollTimeout = std::chrono::milliseconds{0});
+        int changePtySize(int cols, int rows);
+
+        /**
+         * @brief Reads what is available on stdout and stderr, at most one chunk of each per call.
+         *
+         * @return true If data was read or the channel ended.
+         */
+        bool readTask(std::chrono::milliseconds pollTimeout = std::chrono::milliseconds{0});
+
+        struct PendingOutput
+        {
+            // Reused between flushes, so its capacity stays allocated.
+            std::string buffer{};
+            std::chrono::steady_clock::time_point firstByteAt{};
+            std::chrono::steady_clock::time_point lastFlushAt{};
+        };
+
+        /**
+         * @brief Reads what is available on one stream into its pending output, but no more than limit and one chunk.
+         *
+         * @return The amount of bytes read or -1 if the channel is done.
+         */
+        int drain(PendingOutput& pending, bool isStderr, std::chrono::milliseconds pollTimeout, std::size_t limit);
+
+        /**
+         * @brief How many bytes may still be read before the window is exhausted.
+         */
+        std::size_t readCredit() const;
+
+        /**
+         * @brief Sends as much of the queued writes as the remote window allows, but at most maxWriteBatch bytes, so
+         * large pastes do not starve the reads.
+         *
+         * @return The amount of bytes sent.
+         */
+        std::size_t flushWrites();
+
+        /**
+         * @brief Passes pending output on if it is due.
+         *
+         * @param drained Did the last drain empty the stream?
+         * @return true if output is left pending.
+         */
+        bool flushIfDue(PendingOutput& pending, bool isStderr, bool drained, bool force);
 
       private:
         Session* owner_;
@@ -84,5 +177,19 @@ namespace SecureShell
         std::function<void(std::string const&)> onStdout_{};
         std::function<void(std::string const&)> onStderr_{};
         std::function<void()> onExit_{};
+        ChannelReadOptions readOptions_{};
+        PendingOutput pendingStdout_{};
+        PendingOutput pendingStderr_{};
+        // Passed on and not acknowledged yet. Only touched on the strand.
+        std::size_t unacknowledged_{0};
+
+        constexpr static std::size_t maxWriteBatch = 64 * 1024;
+        // Filled by write from any thread, taken over by the strand.
+        std::mutex incomingWritesMutex_{};
+        std::string incomingWrites_{};
+        // Only touched on the strand, sent from outgoingOffset_ on.
+        std::string outgoingWrites_{};
+        std::size_t outgoingOffset_{0};
+        std::atomic<std::size_t> queuedBytes_{0};
     };
 }
\ No newline at end of file
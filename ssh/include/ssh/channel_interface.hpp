@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace SecureShell
+{
+    /**
+     * @brief Controls how channel reads are coalesced before they are passed to the callbacks.
+     */
+    struct ChannelReadOptions
+    {
+        /// Output is passed on once this many bytes are buffered. 0 passes on every read as is.
+        std::size_t maxChunkSize = 64 * 1024;
+        /// Buffered output is passed on at the latest this long after its first byte arrived.
+        std::chrono::microseconds flushDelay = std::chrono::milliseconds{2};
+        /// Output that may be passed on without being acknowledged. Once exhausted, the channel is not read until
+        /// acknowledge is called, so the ssh window pushes back on the server. 0 disables flow control.
+        std::size_t window = 0;
+    };
+
+    /**
+     * @brief The calls operations make on the channel of a remote command while they read its output.
+     */
+    class IChannel
+    {
+      public:
+        IChannel() = default;
+        virtual ~IChannel() = default;
+        IChannel(IChannel const&) = default;
+        IChannel& operator=(IChannel const&) = default;
+        IChannel(IChannel&&) = default;
+        IChannel& operator=(IChannel&&) = default;
+
+        virtual bool close(bool isBackElement = false) = 0;
+
+        /**
+         * @brief Starts reading and processing the channel, see Channel::startReading.
+         */
+        virtual void startReading(
+            std::function<void(std::string const&)> onStdout,
+            std::function<void(std::string const&)> onStderr,
+            std::function<void()> onExit,
+            ChannelReadOptions options = {}) = 0;
+
+        /**
+         * @brief Gives back read credit for output that was consumed, see ChannelReadOptions::window.
+         */
+        virtual void acknowledge(std::size_t bytes) = 0;
+    };
+}
@@ -6,10 +6,13 @@
 
 #include <libssh/sftp.h>
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <functional>
 #include <future>
 #include <expected>
+#include <optional>
 
 namespace SecureShell
 {
@@ -73,6 +76,37 @@ namespace SecureShell
         std::future<std::expected<std::size_t, SftpError>>
         readAll(std::function<bool(std::string_view data)> onRead) override;
 
+        /**
+         * @brief Reads from the current position to the end of the file with up to maxInFlight read requests of
+         * readLengthLimit() bytes outstanding, see IFileStream::readPipelined.
+         */
+        void readPipelined(
+            std::size_t maxInFlight,
+            std::function<bool(std::string_view data)> onChunk,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+            std::shared_ptr<ReadWindow> window) override;
+
+        /**
+         * @brief Reads length bytes from offset on with up to maxInFlight read requests of readLengthLimit() bytes
+         * outstanding, see IFileStream::readRangePipelined.
+         */
+        void readRangePipelined(
+            std::uint64_t offset,
+            std::uint64_t length,
+            std::size_t maxInFlight,
+            std::function<bool(std::string_view data)> onChunk,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+            std::shared_ptr<ReadWindow> window) override;
+
+        /**
+         * @brief Writes the blocks of source with up to maxInFlight write requests of writeLengthLimit() bytes
+         * outstanding, see IFileStream::writePipelined.
+         */
+        void writePipelined(
+            std::size_t maxInFlight,
+            std::shared_ptr<PipelinedWriteSource> source,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete) override;
+
         /**
          * @brief Writes some bytes to the file.
          * Makes sure that all data is written even if the data is larger than the write limit by breaking it into
@@ -99,6 +133,8 @@ namespace SecureShell
          */
         std::size_t readLengthLimit() const override;
 
+        std::optional<std::chrono::microseconds> roundTripTime() const override;
+
         /**
          * @brief Brings this class into an invalid state and returns the sftp_file. The ownership of the file is
          * transferred to the caller.
@@ -111,9 +147,18 @@ namespace SecureShell
          * @brief Closes the file and removes itself from the sftp session.
          */
         void close(bool isBackElement = false) override;
+        void closeInBackground() override;
 
         ProcessingStrand* strand() const override;
 
+        void seek(std::size_t pos, std::function<void(std::expected<void, SftpError>&&)> onComplete) override;
+        void stat(std::function<void(std::expected<FileInformation, SftpError>&&)> onComplete) override;
+        void readSome(
+            char* buffer,
+            std::size_t bufferSize,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete) override;
+        void write(std::string_view data, std::function<void(std::expected<void, SftpError>&&)> onComplete) override;
+
       private:
         std::function<void(sftp_file)> makeFileDeleter();
 
@@ -123,13 +168,39 @@ namespace SecureShell
         template <typename FunctionT>
         auto performPromise(FunctionT&& func);
 
+        template <typename FunctionT, typename ResultT>
+        void performCallback(FunctionT&& func, std::function<void(ResultT&&)> onComplete);
+
         SftpError lastError() const;
 
+        /**
+         * @brief Smoothes the measured round trip time like TCP does, called by the pipelines.
+         */
+        void recordRoundTrip(std::chrono::steady_clock::duration roundTrip);
+
+        std::expected<void, SftpError> seekImpl(std::size_t pos);
+        std::expected<FileInformation, SftpError> statImpl();
+        std::expected<std::size_t, SftpError> readSomeImpl(char* buffer, std::size_t bufferSize);
+        std::expected<void, SftpError> writeImpl(std::string_view data);
+
         void writePart(std::string_view toWrite, std::function<void(std::expected<void, SftpError>&&)> onWriteComplete);
 
+        void startReadPipeline(
+            std::optional<std::uint64_t> offset,
+            std::uint64_t length,
+            std::size_t maxInFlight,
+            std::function<bool(std::string_view data)> onChunk,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+            std::shared_ptr<ReadWindow> window);
+
+        struct ReadPipeline;
+        struct WritePipeline;
+
       private:
         std::weak_ptr<SftpSession> sftp_;
         std::unique_ptr<sftp_file_struct, std::function<void(sftp_file)>> file_;
         sftp_limits_struct limits_;
+        // 0 until the first pipelined request completed.
+        std::atomic<std::int64_t> roundTripMicroseconds_{0};
     };
 }
\ No newline at end of file
@@ -1,14 +1,22 @@
 #pragma once
 
 #include <ssh/async/processing_strand.hpp>
+#include <ssh/async/async_operation.hpp>
 #include <ssh/sftp_error.hpp>
 #include <ssh/file_information.hpp>
+#include <ssh/pipelined_write_source.hpp>
+#include <ssh/read_window.hpp>
 
 #include <libssh/sftp.h>
 
+#include <chrono>
 #include <functional>
+#include <cstdint>
 #include <future>
+#include <memory>
+#include <optional>
 #include <expected>
+#include <string_view>
 
 namespace SecureShell
 {
@@ -70,6 +78,51 @@ namespace SecureShell
         virtual std::future<std::expected<std::size_t, SftpError>>
         readAll(std::function<bool(std::string_view data)> onRead) = 0;
 
+        /**
+         * @brief Reads from the current position to the end of the file with up to maxInFlight read requests of
+         * readLengthLimit() bytes outstanding, so the round trip time is not paid for every request.
+         * Responses are collected without blocking the processing thread.
+         *
+         * @param maxInFlight How many read requests to keep outstanding.
+         * @param onChunk Called on the processing thread for every chunk in file order. Let it return false to stop.
+         * @param onComplete Called on the processing thread at the end with the amount of bytes read or an error.
+         * @param window Bounds what is requested but not released by the consumer yet, unbounded if null. The consumer
+         * releases the size of every chunk it was passed once it processed it.
+         */
+        virtual void readPipelined(
+            std::size_t maxInFlight,
+            std::function<bool(std::string_view data)> onChunk,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+            std::shared_ptr<ReadWindow> window) = 0;
+
+        /**
+         * @brief Like readPipelined, but reads at most length bytes starting at offset. Several streams of the same
+         * file can read disjoint ranges in parallel this way.
+         *
+         * @param offset Where to start reading, the file pointer is moved there.
+         * @param length How many bytes to read at most, less if the file ends before.
+         */
+        virtual void readRangePipelined(
+            std::uint64_t offset,
+            std::uint64_t length,
+            std::size_t maxInFlight,
+            std::function<bool(std::string_view data)> onChunk,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+            std::shared_ptr<ReadWindow> window) = 0;
+
+        /**
+         * @brief Writes the blocks of source from the current position on with up to maxInFlight write requests of
+         * writeLengthLimit() bytes outstanding. Confirmations are collected without blocking the processing thread.
+         *
+         * @param maxInFlight How many write requests to keep outstanding.
+         * @param source Blocks are taken from it as they are pushed, written bytes are confirmed to it.
+         * @param onComplete Called on the processing thread at the end with the amount of bytes written or an error.
+         */
+        virtual void writePipelined(
+            std::size_t maxInFlight,
+            std::shared_ptr<PipelinedWriteSource> source,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete) = 0;
+
         /**
          * @brief Writes some bytes to the file.
          * Makes sure that all data is written even if the data is larger than the write limit by breaking it into
@@ -96,6 +149,12 @@ namespace SecureShell
          */
         virtual std::size_t readLengthLimit() const = 0;
 
+        /**
+         * @brief The smoothed time from sending a pipelined request to its response, nullopt before the first one.
+         * Includes the time requests wait behind others, so it grows when the link is saturated.
+         */
+        virtual std::optional<std::chrono::microseconds> roundTripTime() const = 0;
+
         /**
          * @brief Brings this class into an invalid state and returns the sftp_file. The ownership of the file is
          * transferred to the caller.
@@ -109,11 +168,97 @@ namespace SecureShell
          */
         virtual void close(bool isBackElement = false) = 0;
 
+        /**
+         * @brief Like close, but returns right away instead of waiting for the server. For streams whose result
+         * does not depend on the close, like finished reads. The processing thread still makes the blocking close
+         * later, other calls on the same session wait for it.
+         */
+        virtual void closeInBackground() = 0;
+
         /**
          * @brief Returns the processing strand of the file stream.
          *
          * @return void*
          */
         virtual ProcessingStrand* strand() const = 0;
+
+        /**
+         * @brief Like seek, but calls onComplete on the processing thread instead of returning a future.
+         */
+        virtual void seek(std::size_t pos, std::function<void(std::expected<void, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Like stat, but calls onComplete on the processing thread instead of returning a future.
+         */
+        virtual void stat(std::function<void(std::expected<FileInformation, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Like readSome, but calls onComplete on the processing thread instead of returning a future.
+         * The buffer must stay valid until onComplete was called.
+         */
+        virtual void readSome(
+            char* buffer,
+            std::size_t bufferSize,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Like write, but calls onComplete on the processing thread instead of returning a future.
+         * The data must stay valid until onComplete was called.
+         */
+        virtual void write(std::string_view data, std::function<void(std::expected<void, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Asynchronous version of seek, completes with AsyncSignature<std::expected<void, SftpError>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncSeek(std::size_t pos, CompletionTokenT&& token)
+        {
+            return asyncFromCallback<std::expected<void, SftpError>>(
+                [this, pos](auto onComplete) {
+                    seek(pos, std::move(onComplete));
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of stat.
+         * Completes with AsyncSignature<std::expected<FileInformation, SftpError>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncStat(CompletionTokenT&& token)
+        {
+            return asyncFromCallback<std::expected<FileInformation, SftpError>>(
+                [this](auto onComplete) {
+                    stat(std::move(onComplete));
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of readSome.
+         * Completes with AsyncSignature<std::expected<std::size_t, SftpError>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncReadSome(char* buffer, std::size_t bufferSize, CompletionTokenT&& token)
+        {
+            return asyncFromCallback<std::expected<std::size_t, SftpError>>(
+                [this, buffer, bufferSize](auto onComplete) {
+                    readSome(buffer, bufferSize, std::move(onComplete));
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of write, completes with AsyncSignature<std::expected<void, SftpError>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncWrite(std::string_view data, CompletionTokenT&& token)
+        {
+            return asyncFromCallback<std::expected<void, SftpError>>(
+                [this, data](auto onComplete) {
+                    write(data, std::move(onComplete));
+                },
+                std::forward<CompletionTokenT>(token));
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <ssh/channel_interface.hpp>
+
+#include <gmock/gmock.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace SecureShell::Test
+{
+    class ChannelMock : public SecureShell::IChannel
+    {
+      public:
+        MOCK_METHOD(bool, close, (bool isBackElement), (override));
+        MOCK_METHOD(
+            void,
+            startReading,
+            (std::function<void(std::string const&)> onStdout,
+             std::function<void(std::string const&)> onStderr,
+             std::function<void()> onExit,
+             ChannelReadOptions options),
+            (override));
+        MOCK_METHOD(void, acknowledge, (std::size_t bytes), (override));
+    };
+}
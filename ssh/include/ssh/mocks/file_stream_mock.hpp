@@ -30,12 +30,61 @@ namespace SecureShell::Test
             readAll,
             (std::function<bool(std::string_view data)> onRead),
             (override));
+        MOCK_METHOD(
+            void,
+            readPipelined,
+            (std::size_t maxInFlight,
+             std::function<bool(std::string_view data)> onChunk,
+             std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+             std::shared_ptr<ReadWindow> window),
+            (override));
+        MOCK_METHOD(
+            void,
+            readRangePipelined,
+            (std::uint64_t offset,
+             std::uint64_t length,
+             std::size_t maxInFlight,
+             std::function<bool(std::string_view data)> onChunk,
+             std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+             std::shared_ptr<ReadWindow> window),
+            (override));
+        MOCK_METHOD(
+            void,
+            writePipelined,
+            (std::size_t maxInFlight,
+             std::shared_ptr<PipelinedWriteSource> source,
+             std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete),
+            (override));
         MOCK_METHOD((std::future<std::expected<void, SftpError>>), write, (std::string_view data), (override));
         MOCK_METHOD(std::size_t, writeLengthLimit, (), (const, override));
         MOCK_METHOD(std::size_t, readLengthLimit, (), (const, override));
+        MOCK_METHOD(std::optional<std::chrono::microseconds>, roundTripTime, (), (const, override));
         MOCK_METHOD(sftp_file, release, (), (override));
         MOCK_METHOD(void, close, (bool isBackElement), (override));
+        MOCK_METHOD(void, closeInBackground, (), (override));
         MOCK_METHOD(ProcessingStrand*, strand, (), (const, override));
+        MOCK_METHOD(
+            void,
+            seek,
+            (std::size_t, std::function<void(std::expected<void, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            stat,
+            (std::function<void(std::expected<FileInformation, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            readSome,
+            (char* buffer,
+             std::size_t bufferSize,
+             std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            write,
+            (std::string_view data, std::function<void(std::expected<void, SftpError>&&)> onComplete),
+            (override));
     };
     ;
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <ssh/sftp_session_interface.hpp>
+
+#include <gmock/gmock.h>
+
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace SecureShell::Test
+{
+    class SftpSessionMock : public SecureShell::ISftpSession
+    {
+      public:
+        MOCK_METHOD(ProcessingStrand*, strand, (), (const, override));
+        MOCK_METHOD(
+            void,
+            stat,
+            (std::filesystem::path const& path,
+             std::function<void(std::expected<FileInformation, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            openFile,
+            (std::filesystem::path const& path,
+             OpenType openType,
+             std::filesystem::perms permissions,
+             std::function<void(std::expected<std::weak_ptr<IFileStream>, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            rename,
+            (std::filesystem::path const& source,
+             std::filesystem::path const& destination,
+             std::function<void(std::expected<void, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            renameReplacing,
+            (std::filesystem::path const& source,
+             std::filesystem::path const& destination,
+             std::function<void(std::expected<void, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            chmod,
+            (std::filesystem::path const& path,
+             std::filesystem::perms permissions,
+             std::function<void(std::expected<void, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            removeFile,
+            (std::filesystem::path const& path, std::function<void(std::expected<void, SftpError>&&)> onComplete),
+            (override));
+        MOCK_METHOD(
+            void,
+            createExecChannel,
+            (std::string const& command,
+             std::function<void(std::expected<std::weak_ptr<IChannel>, SftpError>&&)> onComplete),
+            (override));
+    };
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace SecureShell
+{
+    /**
+     * @brief Hands blocks of data from a producer to a pipelined write running on the processing thread.
+     * The producer pushes blocks from any thread, the write takes them in order and confirms what the server wrote.
+     */
+    class PipelinedWriteSource
+    {
+      public:
+        enum class NextBlock
+        {
+            Block,
+            // Nothing pushed yet, more may follow.
+            Empty,
+            // Everything pushed was taken and the producer finished.
+            Finished,
+            Stopped
+        };
+
+        /**
+         * @param onConfirmed Called on the processing thread after the server confirmed writes.
+         */
+        explicit PipelinedWriteSource(std::function<void()> onConfirmed = {})
+            : onConfirmed_{std::move(onConfirmed)}
+        {}
+
+        /**
+         * @brief Appends a block to write.
+         *
+         * @return false If the write stopped, the block is dropped then.
+         */
+        bool push(std::string&& block)
+        {
+            std::function<void()> notify{};
+            {
+                std::scoped_lock lock{mutex_};
+                if (stopped_ || finished_)
+                    return false;
+                pushed_ += block.size();
+                if (blocks_.empty())
+                    notify = onPush_;
+                blocks_.push_back(std::move(block));
+            }
+            if (notify)
+                notify();
+            return true;
+        }
+
+        /**
+         * @brief No more blocks follow, the write completes after the pushed ones were written.
+         */
+        void finish()
+        {
+            std::function<void()> notify{};
+            {
+                std::scoped_lock lock{mutex_};
+                finished_ = true;
+                notify = onPush_;
+            }
+            if (notify)
+                notify();
+        }
+
+        /**
+         * @brief Makes the write stop at the next opportunity, without writing what was not sent yet.
+         */
+        void stop()
+        {
+            std::function<void()> notify{};
+            {
+                std::scoped_lock lock{mutex_};
+                stopped_ = true;
+                blocks_.clear();
+                notify = onPush_;
+            }
+            if (notify)
+                notify();
+        }
+
+        /**
+         * @brief Bytes pushed so far.
+         */
+        std::size_t pushed() const
+        {
+            std::scoped_lock lock{mutex_};
+            return pushed_;
+        }
+
+        /**
+         * @brief Bytes the server confirmed so far.
+         */
+        std::size_t confirmed() const noexcept
+        {
+            return confirmed_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Sets what wakes the writer up when a block arrives. Set by the write itself.
+         */
+        void onPush(std::function<void()> onPush)
+        {
+            std::scoped_lock lock{mutex_};
+            onPush_ = std::move(onPush);
+        }
+
+        /**
+         * @brief Takes the next block, called by the write.
+         */
+        NextBlock next(std::string& block)
+        {
+            std::scoped_lock lock{mutex_};
+            if (stopped_)
+                return NextBlock::Stopped;
+            if (blocks_.empty())
+                return finished_ ? NextBlock::Finished : NextBlock::Empty;
+            block = std::move(blocks_.front());
+            blocks_.pop_front();
+            return NextBlock::Block;
+        }
+
+        /**
+         * @brief Counts written bytes, called by the write once per cycle that received confirmations.
+         */
+        void confirm(std::size_t bytes)
+        {
+            confirmed_.fetch_add(bytes, std::memory_order_acq_rel);
+            if (onConfirmed_)
+                onConfirmed_();
+        }
+
+      private:
+        mutable std::mutex mutex_{};
+        std::deque<std::string> blocks_{};
+        std::size_t pushed_{0};
+        bool finished_{false};
+        bool stopped_{false};
+        std::function<void()> onPush_{};
+        std::function<void()> onConfirmed_;
+        std::atomic<std::size_t> confirmed_{0};
+    };
+}
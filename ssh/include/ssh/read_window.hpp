@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace SecureShell
+{
+    /**
+     * @brief Limits how far a pipelined read may run ahead of its consumer.
+     * The read reserves the size of every request before sending it, the consumer releases what it processed. Once
+     * the window is exhausted no more requests are sent, so a slow consumer pushes back on the server instead of
+     * responses piling up in memory.
+     */
+    class ReadWindow
+    {
+      public:
+        explicit ReadWindow(std::size_t size)
+            : size_{size}
+            , available_{size}
+            , limit_{std::max(size, std::size_t{1})}
+        {}
+
+        /**
+         * @brief Reserves bytes for a request, called by the read.
+         *
+         * @return The bytes reserved, 0 if the window cannot fit the request. A window smaller than one request is
+         * reserved entirely once it is completely free.
+         */
+        std::size_t reserve(std::size_t bytes)
+        {
+            std::scoped_lock lock{mutex_};
+            const auto outstanding = size_ - available_;
+            const auto room = outstanding < limit_ ? std::min(available_, limit_ - outstanding) : 0;
+            if (room < bytes && outstanding != 0)
+            {
+                exhausted_ = true;
+                return 0;
+            }
+            const auto reserved = std::min(bytes, room);
+            available_ -= reserved;
+            exhausted_ = reserved == 0;
+            return reserved;
+        }
+
+        /**
+         * @brief Gives bytes back. Called by the consumer for processed data and by the read for requested bytes
+         * that never arrived.
+         */
+        void release(std::size_t bytes)
+        {
+            std::function<void()> notify{};
+            {
+                std::scoped_lock lock{mutex_};
+                available_ += bytes;
+                if (exhausted_)
+                {
+                    exhausted_ = false;
+                    notify = onRelease_;
+                }
+            }
+            if (notify)
+                notify();
+        }
+
+        /**
+         * @brief Lets fewer bytes than the size be outstanding, like to follow a bandwidth limit. Requests are made
+         * smaller than the limit when nothing is outstanding. Raising the limit wakes an exhausted read up.
+         */
+        void limit(std::size_t bytes)
+        {
+            std::function<void()> notify{};
+            {
+                std::scoped_lock lock{mutex_};
+                const auto raised = bytes > limit_;
+                limit_ = std::clamp(bytes, std::size_t{1}, std::max(size_, std::size_t{1}));
+                if (raised && exhausted_)
+                {
+                    exhausted_ = false;
+                    notify = onRelease_;
+                }
+            }
+            if (notify)
+                notify();
+        }
+
+        /**
+         * @brief Sets what wakes the read up when an exhausted window was released. Set by the read itself.
+         */
+        void onRelease(std::function<void()> onRelease)
+        {
+            std::scoped_lock lock{mutex_};
+            onRelease_ = std::move(onRelease);
+        }
+
+        std::size_t available() const
+        {
+            std::scoped_lock lock{mutex_};
+            return available_;
+        }
+
+      private:
+        mutable std::mutex mutex_{};
+        const std::size_t size_;
+        std::size_t available_;
+        std::size_t limit_;
+        bool exhausted_{false};
+        std::function<void()> onRelease_{};
+    };
+}
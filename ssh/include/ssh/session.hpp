@@ -1,6 +1,8 @@
 #pragma once
 
 #include <ssh/async/processing_thread.hpp>
+#include <ssh/async/processing_thread_pool.hpp>
+#include <ssh/async/async_operation.hpp>
 #include <ssh/sftp_error.hpp>
 #include <persistence/state/terminal_engine.hpp>
 #include <ssh/channel.hpp>
@@ -8,6 +10,7 @@
 #include <libssh/libsshpp.hpp>
 
 #include <expected>
+#include <functional>
 #include <unordered_map>
 #include <string>
 #include <optional>
@@ -26,7 +29,12 @@ namespace SecureShell
         friend class SftpSession;
         friend class FileStream;
 
-        Session();
+        /**
+         * @brief Creates a session.
+         *
+         * @param pool Runs the session on a worker of this pool if set, otherwise on its own thread.
+         */
+        explicit Session(std::shared_ptr<ProcessingThreadPool> pool = {});
         ~Session();
         Session(Session const&) = delete;
         Session& operator=(Session const&) = delete;
@@ -57,6 +65,11 @@ namespace SecureShell
          */
         bool isRunning() const;
 
+        /**
+         * @brief Returns the instrumentation of the thread that processes this session.
+         */
+        ProcessingThreadMetrics processingMetrics() const;
+
         struct PtyCreationOptions
         {
             std::optional<std::unordered_map<std::string, std::string>> environment = std::nullopt;
@@ -72,6 +85,22 @@ namespace SecureShell
          */
         std::future<std::expected<std::weak_ptr<Channel>, int>> createPtyChannel(PtyCreationOptions options);
 
+        /**
+         * @brief Creates a new channel without a pty that runs command. Its output is binary safe, which makes it
+         * suitable for streaming data, like an archive of a remote directory.
+         *
+         * @param command The command, run by the shell of the remote user.
+         */
+        std::future<std::expected<std::weak_ptr<Channel>, SftpError>> createExecChannel(std::string command);
+
+        /**
+         * @brief Creates a new channel without a pty that runs a subsystem, like "sftp". The protocol of the
+         * subsystem is spoken by the owner of the channel.
+         *
+         * @param subsystem The name of the subsystem.
+         */
+        std::future<std::expected<std::weak_ptr<Channel>, SftpError>> createSubsystemChannel(std::string subsystem);
+
         /**
          * @brief Create a Sftp Session object
          *
@@ -79,7 +108,81 @@ namespace SecureShell
          */
         std::future<std::expected<std::weak_ptr<SftpSession>, SftpError>> createSftpSession();
 
+        /**
+         * @brief Asynchronous version of createPtyChannel.
+         * Completes with AsyncSignature<std::expected<std::weak_ptr<Channel>, int>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncCreatePtyChannel(PtyCreationOptions options, CompletionTokenT&& token)
+        {
+            return asyncPerform(
+                processingThread_,
+                [this, options = std::move(options)]() {
+                    return createPtyChannelImpl(options);
+                },
+                TaskPriority::Metadata,
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of createExecChannel.
+         * Completes with AsyncSignature<std::expected<std::weak_ptr<Channel>, SftpError>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncCreateExecChannel(std::string command, CompletionTokenT&& token)
+        {
+            return asyncPerform(
+                processingThread_,
+                [this, command = std::move(command)]() {
+                    return createExecChannelImpl(command);
+                },
+                TaskPriority::Metadata,
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of createSubsystemChannel.
+         * Completes with AsyncSignature<std::expected<std::weak_ptr<Channel>, SftpError>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncCreateSubsystemChannel(std::string subsystem, CompletionTokenT&& token)
+        {
+            return asyncPerform(
+                processingThread_,
+                [this, subsystem = std::move(subsystem)]() {
+                    return createSubsystemChannelImpl(subsystem);
+                },
+                TaskPriority::Metadata,
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of createSftpSession.
+         * Completes with AsyncSignature<std::expected<std::weak_ptr<SftpSession>, SftpError>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncCreateSftpSession(CompletionTokenT&& token)
+        {
+            return asyncPerform(
+                processingThread_,
+                [this]() {
+                    return createSftpSessionImpl();
+                },
+                TaskPriority::Metadata,
+                std::forward<CompletionTokenT>(token));
+        }
+
       private:
+        std::expected<std::weak_ptr<Channel>, int> createPtyChannelImpl(PtyCreationOptions const& options);
+        std::expected<std::weak_ptr<Channel>, SftpError> createExecChannelImpl(std::string const& command);
+        std::expected<std::weak_ptr<Channel>, SftpError> createSubsystemChannelImpl(std::string const& subsystem);
+        /**
+         * @brief Opens a session channel and makes the request, that decides what runs on it.
+         */
+        std::expected<std::weak_ptr<Channel>, SftpError>
+        createRequestChannelImpl(std::function<int(ssh::Channel&)> const& request);
+        std::expected<std::weak_ptr<SftpSession>, SftpError> createSftpSessionImpl();
+
         void channelRemoveItself(Channel* channel, bool isBackElement);
         void removeAllChannels();
 
@@ -93,6 +196,8 @@ namespace SecureShell
         void shutdown();
 
       private:
+        // Declared before the processing thread, which must be stopped before the pool goes away:
+        std::shared_ptr<ProcessingThreadPool> processingPool_;
         SecureShell::ProcessingThread processingThread_;
         ssh::Session session_;
         std::vector<std::shared_ptr<Channel>> channels_;
@@ -114,5 +219,6 @@ namespace SecureShell
         AskPassCallback askPass,
         void* askPassUserDataKeyPhrase,
         void* askPassUserDataPassword,
-        std::vector<PasswordCacheEntry>* pwCache);
+        std::vector<PasswordCacheEntry>* pwCache,
+        std::shared_ptr<ProcessingThreadPool> pool = {});
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <ssh/file_information.hpp>
+#include <ssh/sftp_error.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SecureShell
+{
+    /**
+     * @brief Lists many directories at once over a channel that runs the sftp subsystem.
+     * libssh sends one request at a time and waits for its reply, so listing a tree costs several round trips per
+     * directory. This speaks version 3 of the sftp protocol itself and keeps the requests of all listed directories in
+     * flight. It does no io of its own, what it sends goes to the send function and the channel output is passed to
+     * receive.
+     */
+    class SftpDirectoryLister
+    {
+      public:
+        using Listing = std::expected<std::vector<FileInformation>, SftpError>;
+
+        /**
+         * @param send Writes protocol data to the channel.
+         */
+        explicit SftpDirectoryLister(std::function<void(std::string)> send);
+
+        /**
+         * @brief Sends the version handshake. Directories listed before the server answered are requested after.
+         */
+        void start();
+
+        /**
+         * @brief Requests the listing of a directory, "." and ".." are part of it.
+         *
+         * @param tag Identifies the listing in takeListings.
+         * @param path The remote path of the directory.
+         */
+        void list(std::uint64_t tag, std::string path);
+
+        /**
+         * @brief Processes output of the channel, partial packets are kept until the rest arrives.
+         *
+         * @return An error if the server sent something that is not sftp. The lister must not be used anymore then.
+         */
+        std::expected<void, SftpError> receive(std::string_view data);
+
+        /**
+         * @brief Moves out the listings that completed since the last call, in the order they completed.
+         */
+        std::vector<std::pair<std::uint64_t, Listing>> takeListings();
+
+        /**
+         * @brief The amount of directories listed and not completed yet.
+         */
+        std::size_t pending() const
+        {
+            return waiting_.size() + directories_.size();
+        }
+
+        /**
+         * @brief Did the server answer the handshake?
+         */
+        bool ready() const
+        {
+            return version_ != 0;
+        }
+
+      private:
+        enum class RequestType
+        {
+            OpenDirectory,
+            ReadDirectory,
+            Close
+        };
+
+        struct Request
+        {
+            RequestType type;
+            std::uint64_t tag;
+        };
+
+        struct Directory
+        {
+            std::string handle{};
+            std::vector<FileInformation> entries{};
+        };
+
+        void sendRequest(std::uint8_t type, RequestType requestType, std::uint64_t tag, std::string_view argument);
+        std::expected<void, SftpError> handlePacket(std::string_view packet);
+        void complete(std::uint64_t tag, Listing&& listing);
+
+      private:
+        std::function<void(std::string)> send_;
+        std::uint32_t version_{0};
+        std::uint32_t nextId_{0};
+        // Listed before the handshake completed.
+        std::deque<std::pair<std::uint64_t, std::string>> waiting_{};
+        std::unordered_map<std::uint32_t, Request> requests_{};
+        std::unordered_map<std::uint64_t, Directory> directories_{};
+        std::vector<std::pair<std::uint64_t, Listing>> completed_{};
+        // Received and not processed yet, which is at most one partial packet after receive.
+        std::string received_{};
+    };
+}
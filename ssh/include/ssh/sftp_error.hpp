@@ -15,6 +15,10 @@ namespace SecureShell
         // See: https://api.libssh.org/stable/structsftp__limits__struct.html
         ShortWrite,
         FileNull,
+        // The strand was finalized or the processing thread stopped before the operation could run.
+        OperationDropped,
+        // The server sent something that is not valid sftp.
+        MalformedReply,
     };
 
     struct SftpError
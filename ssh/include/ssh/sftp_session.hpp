@@ -4,8 +4,10 @@
 #include <libssh/sftp.h>
 #include <ssh/async/processing_thread.hpp>
 #include <ssh/async/processing_strand.hpp>
+#include <ssh/async/async_operation.hpp>
 #include <ssh/file_information.hpp>
 #include <ssh/file_stream.hpp>
+#include <ssh/sftp_session_interface.hpp>
 #include <ssh/sftp_error.hpp>
 #include <ssh/session.hpp>
 
@@ -16,20 +18,20 @@
 #include <utility>
 #include <type_traits>
 
-#include <fcntl.h>
-
 namespace SecureShell
 {
     class Session;
 
-    class SftpSession : public std::enable_shared_from_this<SftpSession>
+    class SftpSession
+        : public ISftpSession
+        , public std::enable_shared_from_this<SftpSession>
     {
       public:
         using Error = SftpError;
         friend class FileStream;
 
         SftpSession(Session* owner, std::unique_ptr<ProcessingStrand> strand, sftp_session session);
-        ~SftpSession();
+        ~SftpSession() override;
         SftpSession(SftpSession const&) = delete;
         SftpSession& operator=(SftpSession const&) = delete;
         SftpSession(SftpSession&&) = delete;
@@ -42,6 +44,14 @@ namespace SecureShell
 
         bool close(bool isBackElement = false);
 
+        /**
+         * @brief The ssh session this sftp session runs on.
+         */
+        Session& session() const
+        {
+            return *owner_;
+        }
+
         template <typename FunctionT>
         void perform(FunctionT&& func)
         {
@@ -98,6 +108,9 @@ namespace SecureShell
          * @return std::future<std::expected<void, Error>>
          */
         std::future<std::expected<void, Error>> removeFile(std::filesystem::path const& path);
+        void removeFile(
+            std::filesystem::path const& path,
+            std::function<void(std::expected<void, Error>&&)> onComplete) override;
 
         /**
          * @brief Removes a directory.
@@ -114,6 +127,9 @@ namespace SecureShell
          * @return std::future<std::expected<FileInformation, Error>>
          */
         std::future<std::expected<FileInformation, Error>> stat(std::filesystem::path const& path);
+        void stat(
+            std::filesystem::path const& path,
+            std::function<void(std::expected<FileInformation, Error>&&)> onComplete) override;
 
         /**
          * @brief Sets the attributes of a file or directory.
@@ -142,34 +158,216 @@ namespace SecureShell
          * @return std::future<std::expected<void, Error>>
          */
         std::future<std::expected<void, Error>> chmod(std::filesystem::path const& path, std::filesystem::perms perms);
+        void chmod(
+            std::filesystem::path const& path,
+            std::filesystem::perms perms,
+            std::function<void(std::expected<void, Error>&&)> onComplete) override;
 
         /**
          * @brief Move a file or directory.
          */
         std::future<std::expected<void, Error>>
         rename(std::filesystem::path const& source, std::filesystem::path const& destination);
+        void rename(
+            std::filesystem::path const& source,
+            std::filesystem::path const& destination,
+            std::function<void(std::expected<void, Error>&&)> onComplete) override;
 
-        enum class OpenType : int
-        {
-            Read = O_RDONLY,
-            Write = O_WRONLY,
-            ReadWrite = O_RDWR,
-            Create = O_CREAT,
-            Truncate = O_TRUNC,
-            Exclusive = O_EXCL,
-        };
+        /**
+         * @brief Moves a file over an existing destination. libssh uses posix-rename@openssh.com for the rename when
+         * the server offers it and the overwrite flag from protocol version 4 on, both replace atomically. Otherwise
+         * the destination is moved aside first and removed after, so it is never lost, but briefly missing.
+         */
+        std::future<std::expected<void, Error>>
+        renameReplacing(std::filesystem::path const& source, std::filesystem::path const& destination);
+        void renameReplacing(
+            std::filesystem::path const& source,
+            std::filesystem::path const& destination,
+            std::function<void(std::expected<void, Error>&&)> onComplete) override;
 
         std::future<std::expected<std::weak_ptr<FileStream>, Error>>
         openFile(std::filesystem::path const& path, OpenType openType, std::filesystem::perms permissions);
+        void openFile(
+            std::filesystem::path const& path,
+            OpenType openType,
+            std::filesystem::perms permissions,
+            std::function<void(std::expected<std::weak_ptr<IFileStream>, Error>&&)> onComplete) override;
+
+        void createExecChannel(
+            std::string const& command,
+            std::function<void(std::expected<std::weak_ptr<IChannel>, Error>&&)> onComplete) override;
 
         std::future<std::expected<sftp_limits_struct, Error>> limits();
 
-        ProcessingStrand* strand() const
+        ProcessingStrand* strand() const override
         {
             return strand_.get();
         }
 
+        /**
+         * @brief Runs a function on the strand of this session and completes the token with its return value.
+         * Unlike performPromise, nothing blocks while waiting for the result.
+         *
+         * @param func The function to run on the processing thread.
+         * @param token A completion token, like boost::asio::use_awaitable or a callback.
+         */
+        template <typename FunctionT, typename CompletionTokenT>
+        auto performAsync(FunctionT&& func, CompletionTokenT&& token)
+        {
+            return asyncPerform(*strand_, std::forward<FunctionT>(func), std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of listDirectory.
+         * Completes with AsyncSignature<std::expected<std::vector<FileInformation>, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncListDirectory(std::filesystem::path path, CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, path = std::move(path)]() {
+                    return listDirectoryImpl(path);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of createDirectory.
+         * Completes with AsyncSignature<std::expected<void, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncCreateDirectory(
+            std::filesystem::path path,
+            std::filesystem::perms permissions,
+            CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, path = std::move(path), permissions]() {
+                    return createDirectoryImpl(path, permissions);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of createFile.
+         * Completes with AsyncSignature<std::expected<void, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncCreateFile(std::filesystem::path path, std::filesystem::perms permissions, CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, path = std::move(path), permissions]() {
+                    return createFileImpl(path, permissions);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of removeFile.
+         * Completes with AsyncSignature<std::expected<void, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncRemoveFile(std::filesystem::path path, CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, path = std::move(path)]() {
+                    return removeFileImpl(path);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of removeDirectory.
+         * Completes with AsyncSignature<std::expected<void, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncRemoveDirectory(std::filesystem::path path, CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, path = std::move(path)]() {
+                    return removeDirectoryImpl(path);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of stat.
+         * Completes with AsyncSignature<std::expected<FileInformation, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncStat(std::filesystem::path path, CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, path = std::move(path)]() {
+                    return statImpl(path);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of rename.
+         * Completes with AsyncSignature<std::expected<void, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncRename(std::filesystem::path source, std::filesystem::path destination, CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, source = std::move(source), destination = std::move(destination)]() {
+                    return renameImpl(source, destination);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
+        /**
+         * @brief Asynchronous version of openFile.
+         * Completes with AsyncSignature<std::expected<std::weak_ptr<FileStream>, Error>>.
+         */
+        template <typename CompletionTokenT>
+        auto asyncOpenFile(
+            std::filesystem::path path,
+            OpenType openType,
+            std::filesystem::perms permissions,
+            CompletionTokenT&& token)
+        {
+            return performAsync(
+                [this, path = std::move(path), openType, permissions]() {
+                    return openFileImpl(path, openType, permissions);
+                },
+                std::forward<CompletionTokenT>(token));
+        }
+
       private:
+        /**
+         * @brief Runs func on the strand and passes its result to onComplete there.
+         */
+        template <typename FunctionT, typename ResultT>
+        void performCallback(FunctionT&& func, std::function<void(ResultT&&)> onComplete)
+        {
+            // If the task is dropped, onComplete is destroyed without being called.
+            perform([func = std::forward<FunctionT>(func), onComplete = std::move(onComplete)]() mutable {
+                onComplete(func());
+            });
+        }
+
+        std::expected<std::vector<FileInformation>, Error> listDirectoryImpl(std::filesystem::path const& path);
+        std::expected<void, Error>
+        createDirectoryImpl(std::filesystem::path const& path, std::filesystem::perms permissions);
+        std::expected<void, Error>
+        createFileImpl(std::filesystem::path const& path, std::filesystem::perms permissions);
+        std::expected<void, Error> removeFileImpl(std::filesystem::path const& path);
+        std::expected<void, Error> removeDirectoryImpl(std::filesystem::path const& path);
+        std::expected<FileInformation, Error> statImpl(std::filesystem::path const& path);
+        std::expected<void, Error> setStatImpl(std::filesystem::path const& path, sftp_attributes attributes);
+        std::expected<void, Error>
+        renameImpl(std::filesystem::path const& source, std::filesystem::path const& destination);
+        std::expected<void, Error>
+        renameReplacingImpl(std::filesystem::path const& source, std::filesystem::path const& destination);
+        std::expected<void, Error> chownImpl(std::filesystem::path const& path, uid_t owner, gid_t group);
+        std::expected<void, Error> chmodImpl(std::filesystem::path const& path, std::filesystem::perms perms);
+        std::expected<sftp_limits_struct, Error> limitsImpl();
+        std::expected<std::weak_ptr<FileStream>, Error>
+        openFileImpl(std::filesystem::path const& path, OpenType openType, std::filesystem::perms permissions);
+
         void fileStreamRemoveItself(FileStream* stream, bool isBackElement);
         void removeAllFileStreams();
 
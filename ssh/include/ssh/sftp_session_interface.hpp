@@ -0,0 +1,110 @@
+#pragma once
+
+#include <ssh/async/processing_strand.hpp>
+#include <ssh/channel_interface.hpp>
+#include <ssh/file_information.hpp>
+#include <ssh/file_stream_interface.hpp>
+#include <ssh/sftp_error.hpp>
+
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+
+namespace SecureShell
+{
+    /**
+     * @brief The calls of an sftp session that operations make while they run. They complete on the processing
+     * thread, so the caller is never blocked waiting for the server.
+     */
+    class ISftpSession
+    {
+      public:
+        ISftpSession() = default;
+        virtual ~ISftpSession() = default;
+        ISftpSession(ISftpSession const&) = default;
+        ISftpSession& operator=(ISftpSession const&) = default;
+        ISftpSession(ISftpSession&&) = default;
+        ISftpSession& operator=(ISftpSession&&) = default;
+
+        enum class OpenType : int
+        {
+            Read = O_RDONLY,
+            Write = O_WRONLY,
+            ReadWrite = O_RDWR,
+            Create = O_CREAT,
+            Truncate = O_TRUNC,
+            Exclusive = O_EXCL,
+        };
+
+        friend constexpr OpenType operator|(OpenType lhs, OpenType rhs) noexcept
+        {
+            return static_cast<OpenType>(static_cast<int>(lhs) | static_cast<int>(rhs));
+        }
+
+        /**
+         * @brief Returns the processing strand of the sftp session.
+         */
+        virtual ProcessingStrand* strand() const = 0;
+
+        /**
+         * @brief Retrieves information about a file, calls onComplete on the processing thread.
+         */
+        virtual void stat(
+            std::filesystem::path const& path,
+            std::function<void(std::expected<FileInformation, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Opens a file, calls onComplete on the processing thread with its stream.
+         */
+        virtual void openFile(
+            std::filesystem::path const& path,
+            OpenType openType,
+            std::filesystem::perms permissions,
+            std::function<void(std::expected<std::weak_ptr<IFileStream>, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Moves a file or directory, fails if the destination exists. Calls onComplete on the processing
+         * thread.
+         */
+        virtual void rename(
+            std::filesystem::path const& source,
+            std::filesystem::path const& destination,
+            std::function<void(std::expected<void, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Moves a file over an existing destination. Atomic where the server supports it, see
+         * SftpSession::renameReplacing. Calls onComplete on the processing thread.
+         */
+        virtual void renameReplacing(
+            std::filesystem::path const& source,
+            std::filesystem::path const& destination,
+            std::function<void(std::expected<void, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Changes the permissions of a file, calls onComplete on the processing thread.
+         */
+        virtual void chmod(
+            std::filesystem::path const& path,
+            std::filesystem::perms permissions,
+            std::function<void(std::expected<void, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Removes a file, calls onComplete on the processing thread.
+         */
+        virtual void removeFile(
+            std::filesystem::path const& path,
+            std::function<void(std::expected<void, SftpError>&&)> onComplete) = 0;
+
+        /**
+         * @brief Runs command on a channel of the ssh session next to the sftp session, calls onComplete on the
+         * processing thread with the channel. Its output is read with IChannel::startReading.
+         */
+        virtual void createExecChannel(
+            std::string const& command,
+            std::function<void(std::expected<std::weak_ptr<IChannel>, SftpError>&&)> onComplete) = 0;
+    };
+}
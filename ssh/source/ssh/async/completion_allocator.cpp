@@ -0,0 +1,90 @@
+#include <ssh/async/completion_allocator.hpp>
+
+#include <array>
+#include <utility>
+
+namespace SecureShell::Detail
+{
+    namespace
+    {
+        constexpr std::size_t sizeClassGranularity = 32;
+        constexpr std::size_t sizeClassCount = CompletionBlockPool::largestPooledBlock / sizeClassGranularity;
+        constexpr std::size_t maximumFreeBlocksPerClass = 256;
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        /**
+         * Blocks are mostly freed by the thread that allocated them (the one waiting on the future), so per thread
+         * free lists need no synchronization at all. Blocks freed elsewhere simply end up in that threads list.
+         */
+        struct ThreadCache
+        {
+            struct SizeClass
+            {
+                FreeBlock* head{nullptr};
+                std::size_t count{0};
+            };
+            std::array<SizeClass, sizeClassCount> sizeClasses{};
+
+            ~ThreadCache();
+        };
+
+        thread_local ThreadCache threadCache{};
+        // Trivially destructible, so it stays valid while other thread_local objects are destroyed:
+        thread_local bool threadCacheDestroyed = false;
+
+        ThreadCache::~ThreadCache()
+        {
+            threadCacheDestroyed = true;
+            for (auto& sizeClass : sizeClasses)
+            {
+                while (sizeClass.head)
+                    ::operator delete(std::exchange(sizeClass.head, sizeClass.head->next));
+            }
+        }
+
+        std::size_t sizeClassIndex(std::size_t size)
+        {
+            return (size + sizeClassGranularity - 1) / sizeClassGranularity - 1;
+        }
+    }
+
+    void* CompletionBlockPool::allocate(std::size_t size)
+    {
+        if (size == 0 || size > largestPooledBlock)
+            return ::operator new(size);
+
+        const auto index = sizeClassIndex(size);
+        if (!threadCacheDestroyed)
+        {
+            auto& sizeClass = threadCache.sizeClasses[index];
+            if (sizeClass.head)
+            {
+                --sizeClass.count;
+                return std::exchange(sizeClass.head, sizeClass.head->next);
+            }
+        }
+        return ::operator new((index + 1) * sizeClassGranularity);
+    }
+
+    void CompletionBlockPool::deallocate(void* block, std::size_t size) noexcept
+    {
+        if (size == 0 || size > largestPooledBlock || threadCacheDestroyed)
+        {
+            ::operator delete(block);
+            return;
+        }
+
+        auto& sizeClass = threadCache.sizeClasses[sizeClassIndex(size)];
+        if (sizeClass.count >= maximumFreeBlocksPerClass)
+        {
+            ::operator delete(block);
+            return;
+        }
+        sizeClass.head = ::new (block) FreeBlock{.next = sizeClass.head};
+        ++sizeClass.count;
+    }
+}
@@ -1,8 +1,11 @@
 #include <ssh/async/processing_thread.hpp>
 #include <ssh/async/processing_strand.hpp>
+#include <ssh/async/processing_thread_pool.hpp>
 
 #include <stdexcept>
 #include <future>
+#include <algorithm>
+#include <utility>
 
 namespace SecureShell
 {
@@ -16,7 +19,9 @@ namespace SecureShell
     {
         return running_;
     }
-    void ProcessingThread::start(std::chrono::milliseconds const& minimumCycleWait)
+    void ProcessingThread::start(
+        std::chrono::milliseconds const& minimumCycleWait,
+        std::chrono::milliseconds const& idleTimeout)
     {
         {
             std::lock_guard lock{taskMutex_};
@@ -24,13 +29,28 @@ namespace SecureShell
         }
         shuttingDown_ = false;
         std::promise<void> awaitThreadStart{};
-        thread_ = std::thread([this, &awaitThreadStart, minimumCycleWait] {
+        thread_ = std::thread([this, &awaitThreadStart, minimumCycleWait, idleTimeout] {
             awaitThreadStart.set_value();
             processingThreadId_.store(std::this_thread::get_id());
-            run(minimumCycleWait);
+            run(minimumCycleWait, idleTimeout);
         });
         awaitThreadStart.get_future().wait();
     }
+    void ProcessingThread::start(
+        ProcessingThreadPool& pool,
+        std::chrono::milliseconds const& minimumCycleWait,
+        std::chrono::milliseconds const& idleTimeout)
+    {
+        {
+            std::lock_guard lock{taskMutex_};
+            running_ = true;
+        }
+        shuttingDown_ = false;
+        pool_ = &pool;
+        minimumCycleWait_ = minimumCycleWait;
+        idleTimeout_ = idleTimeout;
+        pool.attach(*this);
+    }
     void ProcessingThread::stop()
     {
         shuttingDown_ = true;
@@ -38,21 +58,33 @@ namespace SecureShell
             std::lock_guard lock{taskMutex_};
             running_ = false;
         }
+        if (pool_)
+        {
+            // Returns once no worker runs a cycle of this thread anymore:
+            std::exchange(pool_, nullptr)->detach(*this);
+        }
+        wakeup_.notify();
         if (thread_.joinable())
             thread_.join();
 
-        // execute all pending tasks:
-        std::lock_guard lock{taskMutex_};
-        while (!tasks_.empty())
+        // execute all pending tasks, the thread is gone, so this is the only consumer now.
+        // Pushes are refused while shutting down, so the queues only shrink. Drain them in priority order:
+        ScheduledTask scheduled{};
+        auto now = std::chrono::steady_clock::now();
+        for (auto& queue : tasks_)
         {
-            tasks_.back()();
-            tasks_.pop_back();
+            while (queue.tryPop(scheduled))
+                runScheduledTask(scheduled, now);
         }
         shuttingDown_ = false;
     }
-    bool ProcessingThread::pushTask(std::function<void()> task)
+    bool ProcessingThread::pushTask(Task task, TaskPriority priority)
     {
-        if (!task)
+        return pushScheduledTask(ScheduledTask{.task = std::move(task)}, priority);
+    }
+    bool ProcessingThread::pushScheduledTask(ScheduledTask scheduled, TaskPriority priority)
+    {
+        if (!scheduled.task)
         {
             throw std::invalid_argument("Task must not be empty.");
         }
@@ -62,17 +94,60 @@ namespace SecureShell
             return false;
         }
 
+        scheduled.enqueued = std::chrono::steady_clock::now();
+        tasks_[static_cast<std::size_t>(priority)].push(std::move(scheduled));
+        notifyWakeup();
+        return true;
+    }
+    void ProcessingThread::notifyWakeup() noexcept
+    {
+        activeWakeup_.load()->notify();
+    }
+    bool ProcessingThread::popScheduledTask(
+        ScheduledTask& scheduled,
+        std::array<std::size_t, taskPriorityCount>& quota)
+    {
+        for (std::size_t priority = 0; priority < taskPriorityCount; ++priority)
         {
-            std::lock_guard lock{taskMutex_};
-            tasks_.push_back(std::move(task));
+            if (quota[priority] > 0 && tasks_[priority].tryPop(scheduled))
+            {
+                --quota[priority];
+                return true;
+            }
         }
-        return true;
+        return false;
     }
-    std::unique_ptr<ProcessingStrand> ProcessingThread::createStrand()
+    void ProcessingThread::runScheduledTask(ScheduledTask& scheduled, std::chrono::steady_clock::time_point& now)
     {
-        return std::make_unique<ProcessingStrand>(this);
+        const auto start = now;
+        enqueueLatency_.record(start - scheduled.enqueued);
+        auto strand = std::move(scheduled.strand);
+        if (strand)
+            strand->pending.fetch_sub(1, std::memory_order_release);
+        scheduled.task();
+        scheduled.task.reset();
+
+        // The end of this task is the start of the next, which saves reading the clock twice:
+        now = std::chrono::steady_clock::now();
+        taskDuration_.record(now - start);
+        if (strand)
+            strand->record(now - start);
+    }
+    bool ProcessingThread::tasksQueued() const noexcept
+    {
+        for (auto const& queue : tasks_)
+        {
+            if (!queue.empty())
+                return true;
+        }
+        return false;
+    }
+    std::unique_ptr<ProcessingStrand> ProcessingThread::createStrand(TaskPriority priority)
+    {
+        return std::make_unique<ProcessingStrand>(this, priority);
     }
-    std::pair<bool, ProcessingThread::PermanentTaskId> ProcessingThread::pushPermanentTask(std::function<void()> task)
+    std::pair<bool, ProcessingThread::PermanentTaskId>
+    ProcessingThread::pushPermanentTaskImpl(std::function<bool()> task, std::shared_ptr<Detail::StrandCounters> strand)
     {
         if (!task)
         {
@@ -89,11 +164,36 @@ namespace SecureShell
             std::lock_guard lock{taskMutex_};
             ++permanentTaskIdCounter_;
             id = PermanentTaskId{permanentTaskIdCounter_};
-            permanentTasks_.insert({id, std::move(task)});
+            auto counters = std::make_shared<Detail::PermanentTaskCounters>();
+            counters->strand = std::move(strand);
+            permanentTaskCounters_.insert({id, counters});
+            permanentTasks_.insert({id, PermanentTask{.task = std::move(task), .counters = std::move(counters)}});
             permanentTasksAvailable_ = true;
         }
+        notifyWakeup();
         return {true, id};
     }
+    void ProcessingThread::watchSocket(NativeSocket socket)
+    {
+        {
+            std::lock_guard lock{taskMutex_};
+            if (std::find(watchedSockets_.begin(), watchedSockets_.end(), socket) == watchedSockets_.end())
+                watchedSockets_.push_back(socket);
+        }
+        notifyWakeup();
+    }
+    void ProcessingThread::unwatchSocket(NativeSocket socket)
+    {
+        std::lock_guard lock{taskMutex_};
+        std::erase(watchedSockets_, socket);
+    }
+    void ProcessingThread::appendIdleSockets(std::vector<NativeSocket>& sockets) const
+    {
+        std::lock_guard lock{taskMutex_};
+        // Nothing reads the sockets without permanent tasks, so they would stay readable forever:
+        if (permanentTasksAvailable_)
+            sockets.insert(sockets.end(), watchedSockets_.begin(), watchedSockets_.end());
+    }
     void ProcessingThread::clearPermanentTasks()
     {
         std::lock_guard lock{taskMutex_};
@@ -102,12 +202,14 @@ namespace SecureShell
             deferredTaskModification_.push_back([this]() {
                 /* taskMutex_ is held here */
                 permanentTasks_.clear();
+                permanentTaskCounters_.clear();
                 permanentTasksAvailable_ = false;
             });
             return;
         }
 
         permanentTasks_.clear();
+        permanentTaskCounters_.clear();
         permanentTasksAvailable_ = false;
     }
     bool ProcessingThread::removePermanentTask(PermanentTaskId const& id)
@@ -120,6 +222,7 @@ namespace SecureShell
                 deferredTaskModification_.push_back([this, id]() {
                     /* taskMutex_ is held here */
                     permanentTasks_.erase(id);
+                    permanentTaskCounters_.erase(id);
                     permanentTasksAvailable_ = !permanentTasks_.empty();
                 });
                 return true;
@@ -130,6 +233,7 @@ namespace SecureShell
                 deferredTaskModification_.push_back([this, id, promise]() {
                     /* taskMutex_ is held here */
                     const bool result = permanentTasks_.erase(id) > 0;
+                    permanentTaskCounters_.erase(id);
                     permanentTasksAvailable_ = !permanentTasks_.empty();
                     promise->set_value(result);
                 });
@@ -139,81 +243,116 @@ namespace SecureShell
         }
 
         auto result = permanentTasks_.erase(id);
+        permanentTaskCounters_.erase(id);
         permanentTasksAvailable_ = !permanentTasks_.empty();
         return result > 0;
     }
-    void ProcessingThread::run(std::chrono::milliseconds const& minimumCycleWait)
+    void ProcessingThread::idle(std::chrono::milliseconds const& idleTimeout)
     {
-        auto timePoint = std::chrono::steady_clock::now();
+        const auto spinEnd = std::chrono::steady_clock::now() + idleSpinDuration;
+        while (!tasksQueued() && running_ && std::chrono::steady_clock::now() < spinEnd)
+            std::this_thread::yield();
 
-        try
         {
-            while (running_)
+            std::lock_guard lock{taskMutex_};
+            if (!running_ || tasksQueued())
+                return;
+            idleSockets_.clear();
+            if (fruitlessSocketWakeups_ < maximumFruitlessSocketWakeups)
+                appendIdleSockets(idleSockets_);
+        }
+
+        if (wakeup_.wait(idleSockets_, idleTimeout) == WakeupSignal::Reason::SocketReadable)
+            ++fruitlessSocketWakeups_;
+        else
+            fruitlessSocketWakeups_ = 0;
+    }
+    bool ProcessingThread::runCycle()
+    {
+        const auto cycleStart = std::chrono::steady_clock::now();
+        auto now = cycleStart;
+        bool didWork = false;
+
+        // Sampling here is enough to see whether tasks pile up:
+        std::size_t queueDepth = 0;
+        for (auto const& queue : tasks_)
+            queueDepth += queue.size();
+        if (queueDepth > peakQueueDepth_.load(std::memory_order_relaxed))
+            peakQueueDepth_.store(queueDepth, std::memory_order_relaxed);
+
+        if (permanentTasksAvailable_)
+        {
+            std::unique_lock lock(taskMutex_);
+            auto permaTasksMoved = std::move(permanentTasks_);
+            permanentTasks_ = {};
+            processingPermanents_ = true;
+            lock.unlock();
+
+            for (auto const& [_, permanent] : permaTasksMoved)
             {
-                timePoint = std::chrono::steady_clock::now();
+                // Task is checked before adding, shouldnt possibly be empty:
+                const auto start = now;
+                didWork = permanent.task() || didWork;
+                now = std::chrono::steady_clock::now();
+                permanent.counters->record(now - start);
+
+                // Stop running if shutdown was requested:
+                if (!running_ || shuttingDown_)
+                    break;
+            }
 
-                if (permanentTasksAvailable_)
+            lock.lock();
+            processingPermanents_ = false;
+            if (permanentTasks_.empty())
+                permanentTasks_ = std::move(permaTasksMoved);
+            else
+            {
+                // Move em back the expensive way:
+                for (auto& [id, task] : permaTasksMoved)
                 {
-                    std::unique_lock lock(taskMutex_);
-                    const auto permaTasksMoved = std::move(permanentTasks_);
-                    permanentTasks_ = {};
-                    processingPermanents_ = true;
-                    lock.unlock();
+                    permanentTasks_.insert({id, std::move(task)});
+                }
+            }
+            permanentTasksAvailable_ = !permanentTasks_.empty();
+            for (auto& modify : deferredTaskModification_)
+            {
+                modify();
+            }
+            deferredTaskModification_.clear();
+        }
 
-                    for (auto const& [_, task] : permaTasksMoved)
-                    {
-                        // Task is checked before adding, shouldnt possibly be empty:
-                        task();
+        ScheduledTask scheduled{};
+        auto quota = priorityWeights;
+        std::size_t executed = 0;
+        for (; executed < maximumTasksProcessableAtOnce && popScheduledTask(scheduled, quota); ++executed)
+            runScheduledTask(scheduled, now);
 
-                        // Stop running if shutdown was requested:
-                        if (!running_ || shuttingDown_)
-                            break;
-                    }
+        didWork = didWork || executed > 0;
+        if (didWork)
+            cycleDuration_.record(now - cycleStart);
+        return didWork;
+    }
+    void ProcessingThread::run(
+        std::chrono::milliseconds const& minimumCycleWait,
+        std::chrono::milliseconds const& idleTimeout)
+    {
+        auto timePoint = std::chrono::steady_clock::now();
+        int quietCycles = 0;
 
-                    lock.lock();
-                    processingPermanents_ = false;
-                    if (permanentTasks_.empty())
-                        permanentTasks_ = std::move(permaTasksMoved);
-                    else
-                    {
-                        // Move em back the expensive way:
-                        for (auto& [id, task] : permaTasksMoved)
-                        {
-                            permanentTasks_.insert({id, std::move(task)});
-                        }
-                    }
-                    permanentTasksAvailable_ = !permanentTasks_.empty();
-                    for (auto& modify : deferredTaskModification_)
-                    {
-                        modify();
-                    }
-                }
+        try
+        {
+            while (running_)
+            {
+                timePoint = std::chrono::steady_clock::now();
 
+                if (!runCycle())
                 {
-                    std::vector<std::function<void()>> tasks{};
-                    {
-                        std::lock_guard lock(taskMutex_);
-                        tasks.reserve(std::min(tasks_.size(), maximumTasksProcessableAtOnce));
-                        std::move(
-                            tasks_.begin(),
-                            tasks_.begin() + std::min(tasks_.size(), maximumTasksProcessableAtOnce),
-                            std::back_inserter(tasks));
-                        tasks_.erase(
-                            tasks_.begin(), tasks_.begin() + std::min(tasks_.size(), maximumTasksProcessableAtOnce));
-                    }
-
-                    for (auto const& task : tasks)
-                    {
-                        // Task is checked before adding, shouldnt possibly be empty:
-#ifndef N_DEBUG
-                        if (!task)
-                        {
-                            throw std::runtime_error("Task must not be empty.");
-                        }
-#endif
-                        task();
-                    }
+                    if (++quietCycles >= quietCyclesBeforeIdle)
+                        idle(idleTimeout);
+                    continue;
                 }
+                quietCycles = 0;
+                fruitlessSocketWakeups_ = 0;
 
                 if (minimumCycleWait.count() > 0)
                 {
@@ -221,7 +360,8 @@ namespace SecureShell
                     auto diff = now - timePoint;
                     if (diff < minimumCycleWait)
                     {
-                        std::this_thread::sleep_for(minimumCycleWait - diff);
+                        // Pushed tasks cut the throttle short:
+                        wakeup_.wait({}, std::chrono::ceil<std::chrono::milliseconds>(minimumCycleWait - diff));
                     }
                 }
             }
@@ -232,6 +372,32 @@ namespace SecureShell
             running_ = false;
         }
     }
+    ProcessingThreadMetrics ProcessingThread::metrics() const
+    {
+        ProcessingThreadMetrics result{
+            .enqueueLatency = enqueueLatency_.snapshot(),
+            .taskDuration = taskDuration_.snapshot(),
+            .cycleDuration = cycleDuration_.snapshot(),
+            .queueDepth = {},
+            .peakQueueDepth = peakQueueDepth_.load(std::memory_order_relaxed),
+            .permanentTasks = {},
+        };
+        for (auto const& queue : tasks_)
+            result.queueDepth.push_back(queue.size());
+
+        std::lock_guard lock{taskMutex_};
+        result.permanentTasks.reserve(permanentTaskCounters_.size());
+        for (auto const& [id, counters] : permanentTaskCounters_)
+        {
+            result.permanentTasks.push_back(PermanentTaskMetrics{
+                .id = id.id,
+                .calls = counters->calls.load(std::memory_order_relaxed),
+                .busy = std::chrono::nanoseconds{counters->busy.load(std::memory_order_relaxed)},
+                .longest = std::chrono::nanoseconds{counters->longest.load(std::memory_order_relaxed)},
+            });
+        }
+        return result;
+    }
     int ProcessingThread::permanentTaskCount() const
     {
         std::lock_guard lock{taskMutex_};
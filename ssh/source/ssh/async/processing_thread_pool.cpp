@@ -0,0 +1,336 @@
+#include <ssh/async/processing_thread_pool.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+namespace SecureShell
+{
+    struct ProcessingThreadPool::Worker
+    {
+        std::thread thread{};
+        std::thread::id id{};
+        WakeupSignal wakeup{};
+
+        // Guarded by the pool mutex:
+        std::vector<ProcessingThread*> contexts{};
+        ProcessingThread* cycling{nullptr};
+        std::chrono::steady_clock::time_point cycleStart{};
+
+        // Busy time of the last complete window, read by the other workers when balancing:
+        std::atomic<std::chrono::nanoseconds::rep> lastWindowLoad{0};
+
+        // Only touched by the worker thread itself:
+        std::vector<ProcessingThread*> round{};
+        std::vector<NativeSocket> idleSockets{};
+        std::chrono::steady_clock::time_point windowStart{};
+        std::chrono::nanoseconds windowLoad{0};
+        int quietRounds{0};
+        int fruitlessSocketWakeups{0};
+    };
+
+    ProcessingThreadPool::ProcessingThreadPool(std::size_t workerCount)
+    {
+        workers_.reserve(std::max<std::size_t>(workerCount, 1));
+        for (std::size_t i = 0; i < std::max<std::size_t>(workerCount, 1); ++i)
+            workers_.push_back(std::make_unique<Worker>());
+
+        // Workers are only started once the vector does not change anymore, they look at each other when balancing:
+        for (auto& worker : workers_)
+        {
+            worker->thread = std::thread([this, worker = worker.get()] {
+                work(*worker);
+            });
+            worker->id = worker->thread.get_id();
+        }
+    }
+    ProcessingThreadPool::~ProcessingThreadPool()
+    {
+        running_ = false;
+        for (auto& worker : workers_)
+            worker->wakeup.notify();
+        for (auto& worker : workers_)
+        {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+
+        // Processing threads that were not stopped before the pool can no longer run:
+        for (auto& worker : workers_)
+        {
+            for (auto* context : worker->contexts)
+            {
+                context->running_ = false;
+                context->activeWakeup_.store(&context->wakeup_);
+                context->processingThreadId_.store(std::thread::id{});
+                context->pool_ = nullptr;
+            }
+        }
+    }
+    std::size_t ProcessingThreadPool::defaultWorkerCount() noexcept
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t ProcessingThreadPool::workerCount() const noexcept
+    {
+        return workers_.size();
+    }
+    std::size_t ProcessingThreadPool::attachedCount() const
+    {
+        std::lock_guard lock{mutex_};
+        std::size_t count = 0;
+        for (auto const& worker : workers_)
+            count += worker->contexts.size();
+        return count;
+    }
+    bool ProcessingThreadPool::stalled(Worker const& worker, std::chrono::steady_clock::time_point now)
+    {
+        return worker.cycling != nullptr && now - worker.cycleStart >= stallThreshold;
+    }
+    void ProcessingThreadPool::attach(ProcessingThread& context)
+    {
+        Worker* target = nullptr;
+        {
+            std::lock_guard lock{mutex_};
+            const auto now = std::chrono::steady_clock::now();
+            // A stuck worker would only hand the new thread on, unless all of them are stuck:
+            target = std::min_element(workers_.begin(), workers_.end(), [now](auto const& lhs, auto const& rhs) {
+                         if (stalled(*lhs, now) != stalled(*rhs, now))
+                             return !stalled(*lhs, now);
+                         if (lhs->contexts.size() != rhs->contexts.size())
+                             return lhs->contexts.size() < rhs->contexts.size();
+                         return lhs->lastWindowLoad.load() < rhs->lastWindowLoad.load();
+                     })->get();
+
+            context.throttledUntil_ = {};
+            context.windowLoad_ = {};
+            context.lastWindowLoad_ = {};
+            context.processingThreadId_.store(target->id);
+            context.activeWakeup_.store(&target->wakeup);
+            target->contexts.push_back(&context);
+        }
+        target->wakeup.notify();
+    }
+    void ProcessingThreadPool::detach(ProcessingThread& context)
+    {
+        std::unique_lock lock{mutex_};
+        for (auto& worker : workers_)
+            std::erase(worker->contexts, &context);
+
+        // A cycle of the context that stops itself cannot be waited for, it continues after this returns:
+        cycleDone_.wait(lock, [this, &context] {
+            return std::none_of(workers_.begin(), workers_.end(), [&context](auto const& worker) {
+                return worker->cycling == &context && worker->id != std::this_thread::get_id();
+            });
+        });
+
+        context.activeWakeup_.store(&context.wakeup_);
+        context.processingThreadId_.store(std::thread::id{});
+    }
+    void ProcessingThreadPool::work(Worker& worker)
+    {
+        worker.windowStart = std::chrono::steady_clock::now();
+        while (running_)
+        {
+            bool didWork = false;
+            auto wakeAt = std::chrono::steady_clock::time_point::max();
+            rescueStalled(worker);
+            {
+                std::lock_guard lock{mutex_};
+                worker.round.assign(worker.contexts.begin(), worker.contexts.end());
+            }
+
+            for (auto* context : worker.round)
+            {
+                const auto cycleStart = std::chrono::steady_clock::now();
+                {
+                    std::lock_guard lock{mutex_};
+                    // Detached or migrated while the round was running:
+                    if (std::find(worker.contexts.begin(), worker.contexts.end(), context) == worker.contexts.end())
+                        continue;
+                    // Same as the throttle of a dedicated thread, pushed tasks cut it short:
+                    if (cycleStart < context->throttledUntil_ && !context->tasksQueued())
+                    {
+                        wakeAt = std::min(wakeAt, context->throttledUntil_);
+                        continue;
+                    }
+                    worker.cycling = context;
+                    worker.cycleStart = cycleStart;
+                }
+
+                bool worked = false;
+                bool failed = false;
+                try
+                {
+                    worked = context->runCycle();
+                }
+                catch (...)
+                {
+                    failed = true;
+                }
+
+                if (worked)
+                {
+                    const auto elapsed = std::chrono::steady_clock::now() - cycleStart;
+                    context->windowLoad_ += elapsed;
+                    worker.windowLoad += elapsed;
+                    context->throttledUntil_ = cycleStart + context->minimumCycleWait_;
+                    didWork = true;
+                }
+
+                if (failed)
+                {
+                    std::lock_guard lock{context->taskMutex_};
+                    context->running_ = false;
+                }
+
+                {
+                    std::lock_guard lock{mutex_};
+                    worker.cycling = nullptr;
+                    if (failed)
+                    {
+                        std::erase(worker.contexts, context);
+                        context->activeWakeup_.store(&context->wakeup_);
+                        context->processingThreadId_.store(std::thread::id{});
+                    }
+                }
+                cycleDone_.notify_all();
+            }
+
+            if (std::chrono::steady_clock::now() - worker.windowStart >= rebalanceInterval)
+                rebalance(worker);
+
+            if (didWork)
+            {
+                worker.quietRounds = 0;
+                worker.fruitlessSocketWakeups = 0;
+                continue;
+            }
+            if (++worker.quietRounds >= ProcessingThread::quietCyclesBeforeIdle)
+                idle(worker, wakeAt);
+        }
+    }
+    void ProcessingThreadPool::idle(Worker& worker, std::chrono::steady_clock::time_point wakeAt)
+    {
+        // Every push notifies the signal of the worker, so it is enough to look at that:
+        const auto spinEnd = std::chrono::steady_clock::now() + ProcessingThread::idleSpinDuration;
+        while (!worker.wakeup.pending() && running_ && std::chrono::steady_clock::now() < spinEnd)
+            std::this_thread::yield();
+
+        auto timeout = ProcessingThread::defaultIdleTimeout;
+        {
+            std::lock_guard lock{mutex_};
+            if (!running_)
+                return;
+            worker.idleSockets.clear();
+            for (auto* context : worker.contexts)
+            {
+                if (context->tasksQueued())
+                    return;
+                timeout = std::min(timeout, context->idleTimeout_);
+                if (worker.fruitlessSocketWakeups < ProcessingThread::maximumFruitlessSocketWakeups)
+                    context->appendIdleSockets(worker.idleSockets);
+            }
+
+            // Nobody notifies this worker when another one gets stuck, so it has to look again in time:
+            for (auto const& other : workers_)
+            {
+                if (other.get() != &worker && other->cycling != nullptr && other->contexts.size() > 1)
+                    timeout = std::min(timeout, stallThreshold);
+            }
+        }
+
+        // Also wake up for the next rebalancing, so that the published load does not go stale:
+        const auto now = std::chrono::steady_clock::now();
+        wakeAt = std::min(wakeAt, worker.windowStart + rebalanceInterval);
+        if (wakeAt <= now)
+            return;
+        timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(wakeAt - now));
+
+        if (worker.wakeup.wait(worker.idleSockets, timeout) == WakeupSignal::Reason::SocketReadable)
+            ++worker.fruitlessSocketWakeups;
+        else
+            worker.fruitlessSocketWakeups = 0;
+    }
+    void ProcessingThreadPool::rebalance(Worker& worker)
+    {
+        const auto load = worker.windowLoad;
+        worker.lastWindowLoad.store(load.count());
+        worker.windowLoad = {};
+        worker.windowStart = std::chrono::steady_clock::now();
+
+        std::unique_lock lock{mutex_};
+        for (auto* context : worker.contexts)
+            context->lastWindowLoad_ = std::exchange(context->windowLoad_, std::chrono::nanoseconds{0});
+
+        if (worker.contexts.size() < 2)
+            return;
+
+        Worker* target = nullptr;
+        const auto now = std::chrono::steady_clock::now();
+        for (auto& other : workers_)
+        {
+            if (other.get() != &worker && !stalled(*other, now) &&
+                (!target || other->lastWindowLoad.load() < target->lastWindowLoad.load()))
+            {
+                target = other.get();
+            }
+        }
+        if (!target)
+            return;
+
+        const auto difference = load - std::chrono::nanoseconds{target->lastWindowLoad.load()};
+        if (difference < migrationThreshold)
+            return;
+
+        // Move the processing thread that brings both workers closest to each other:
+        ProcessingThread* candidate = nullptr;
+        auto remainingDifference = difference;
+        for (auto* context : worker.contexts)
+        {
+            const auto remaining = std::chrono::abs(difference - 2 * context->lastWindowLoad_);
+            if (remaining < remainingDifference)
+            {
+                candidate = context;
+                remainingDifference = remaining;
+            }
+        }
+        if (!candidate)
+            return;
+
+        // Not within a cycle of the candidate, because this is the only worker that runs it:
+        std::erase(worker.contexts, candidate);
+        candidate->processingThreadId_.store(target->id);
+        candidate->activeWakeup_.store(&target->wakeup);
+        target->contexts.push_back(candidate);
+        // Keeps other workers from picking the same target before it published a new load:
+        target->lastWindowLoad.fetch_add(candidate->lastWindowLoad_.count());
+        worker.lastWindowLoad.fetch_sub(candidate->lastWindowLoad_.count());
+        lock.unlock();
+
+        target->wakeup.notify();
+    }
+    void ProcessingThreadPool::rescueStalled(Worker& worker)
+    {
+        std::lock_guard lock{mutex_};
+        const auto now = std::chrono::steady_clock::now();
+        for (auto& other : workers_)
+        {
+            if (other.get() == &worker || !stalled(*other, now) || other->contexts.size() < 2)
+                continue;
+
+            // Like a migration, the stuck worker skips them once its cycle returns. Only the stuck one stays:
+            for (auto* context : other->contexts)
+            {
+                if (context == other->cycling)
+                    continue;
+                context->processingThreadId_.store(worker.id);
+                context->activeWakeup_.store(&worker.wakeup);
+                worker.contexts.push_back(context);
+            }
+            std::erase_if(other->contexts, [cycling = other->cycling](auto* context) {
+                return context != cycling;
+            });
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#include <ssh/async/wakeup_signal.hpp>
+
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#    include <winsock2.h>
+#    include <ws2tcpip.h>
+#else
+#    include <unistd.h>
+#    include <fcntl.h>
+#    include <cerrno>
+#    ifdef __linux__
+#        include <sys/eventfd.h>
+#    endif
+#endif
+
+namespace SecureShell
+{
+#ifdef _WIN32
+    WakeupSignal::WakeupSignal()
+    {
+        WSADATA wsaData;
+        if (const auto error = WSAStartup(MAKEWORD(2, 2), &wsaData); error != 0)
+            throw std::system_error(error, std::system_category(), "Could not initialize winsock.");
+
+        const auto fail = [this](char const* message) {
+            const auto error = WSAGetLastError();
+            if (socket_ != static_cast<NativeSocket>(INVALID_SOCKET))
+                closesocket(static_cast<SOCKET>(socket_));
+            WSACleanup();
+            throw std::system_error(error, std::system_category(), message);
+        };
+
+        socket_ = static_cast<NativeSocket>(::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+        if (socket_ == static_cast<NativeSocket>(INVALID_SOCKET))
+            fail("Could not create wakeup socket.");
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        int addressLength = sizeof(address);
+        const auto sock = static_cast<SOCKET>(socket_);
+        if (::bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::getsockname(sock, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0 ||
+            ::connect(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            fail("Could not connect wakeup socket.");
+        }
+        u_long nonBlocking = 1;
+        if (::ioctlsocket(sock, FIONBIO, &nonBlocking) != 0)
+            fail("Could not make wakeup socket non-blocking.");
+    }
+
+    WakeupSignal::~WakeupSignal()
+    {
+        closesocket(static_cast<SOCKET>(socket_));
+        WSACleanup();
+    }
+
+    void WakeupSignal::notify() noexcept
+    {
+        pending_.store(true);
+        // Only the first notifier has to send, which saves the syscall for bursts of pushes:
+        if (sleeping_.load() && sleeping_.exchange(false))
+        {
+            // Failure means the receive buffer is already full, which still wakes the waiter:
+            const char one = 1;
+            [[maybe_unused]] const auto sent = ::send(static_cast<SOCKET>(socket_), &one, sizeof(one), 0);
+        }
+    }
+
+    WakeupSignal::Reason WakeupSignal::wait(std::span<NativeSocket const> sockets, std::chrono::milliseconds timeout)
+    {
+        sleeping_.store(true);
+        if (pending_.exchange(false))
+        {
+            sleeping_.store(false);
+            return Reason::Signalled;
+        }
+
+        std::vector<WSAPOLLFD> pollFds;
+        pollFds.reserve(sockets.size() + 1);
+        pollFds.push_back(WSAPOLLFD{.fd = static_cast<SOCKET>(socket_), .events = POLLRDNORM, .revents = 0});
+        for (auto socket : sockets)
+            pollFds.push_back(WSAPOLLFD{.fd = static_cast<SOCKET>(socket), .events = POLLRDNORM, .revents = 0});
+
+        const auto result =
+            WSAPoll(pollFds.data(), static_cast<ULONG>(pollFds.size()), static_cast<INT>(timeout.count()));
+        sleeping_.store(false);
+
+        // Drain the signal so the next wait blocks again:
+        char drain[64];
+        while (::recv(static_cast<SOCKET>(socket_), drain, sizeof(drain), 0) > 0)
+        {
+        }
+
+        if (pending_.exchange(false) || (pollFds[0].revents & POLLRDNORM) != 0)
+            return Reason::Signalled;
+        if (result > 0)
+            return Reason::SocketReadable;
+        return Reason::Timeout;
+    }
+#else
+    WakeupSignal::WakeupSignal()
+    {
+#    ifdef __linux__
+        readFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        writeFd_ = readFd_;
+        if (readFd_ < 0)
+            throw std::system_error(errno, std::generic_category(), "Could not create eventfd.");
+#    else
+        int fds[2];
+        if (pipe(fds) != 0)
+            throw std::system_error(errno, std::generic_category(), "Could not create wakeup pipe.");
+        for (auto fd : fds)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        readFd_ = fds[0];
+        writeFd_ = fds[1];
+#    endif
+    }
+
+    WakeupSignal::~WakeupSignal()
+    {
+        if (writeFd_ != readFd_)
+            ::close(writeFd_);
+        ::close(readFd_);
+    }
+
+    void WakeupSignal::notify() noexcept
+    {
+        pending_.store(true);
+        // Only the first notifier has to write, which saves the syscall for bursts of pushes:
+        if (sleeping_.load() && sleeping_.exchange(false))
+        {
+            // Failure means the counter / pipe is already full, which still wakes the waiter:
+#    ifdef __linux__
+            const std::uint64_t one = 1;
+            [[maybe_unused]] const auto written = ::write(writeFd_, &one, sizeof(one));
+#    else
+            const char one = 1;
+            [[maybe_unused]] const auto written = ::write(writeFd_, &one, sizeof(one));
+#    endif
+        }
+    }
+
+    WakeupSignal::Reason WakeupSignal::wait(std::span<NativeSocket const> sockets, std::chrono::milliseconds timeout)
+    {
+        sleeping_.store(true);
+        if (pending_.exchange(false))
+        {
+            sleeping_.store(false);
+            return Reason::Signalled;
+        }
+
+        pollFds_.clear();
+        pollFds_.push_back(pollfd{.fd = readFd_, .events = POLLIN, .revents = 0});
+        for (auto socket : sockets)
+            pollFds_.push_back(pollfd{.fd = socket, .events = POLLIN, .revents = 0});
+
+        int result = 0;
+        do
+        {
+            result = ::poll(pollFds_.data(), pollFds_.size(), static_cast<int>(timeout.count()));
+        } while (result < 0 && errno == EINTR);
+        sleeping_.store(false);
+
+        // Drain the signal so the next wait blocks again:
+        char drain[64];
+        while (::read(readFd_, drain, sizeof(drain)) > 0)
+        {
+        }
+
+        if (pending_.exchange(false) || (pollFds_[0].revents & POLLIN) != 0)
+            return Reason::Signalled;
+        if (result > 0)
+            return Reason::SocketReadable;
+        return Reason::Timeout;
+    }
+#endif
+}
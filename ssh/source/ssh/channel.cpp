@@ -1,6 +1,10 @@
 #include <ssh/channel.hpp>
 #include <ssh/session.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
 namespace SecureShell
 {
     Channel::Channel(Session* owner, std::unique_ptr<ProcessingStrand> strand, std::unique_ptr<ssh::Channel> channel)
@@ -48,89 +52,243 @@ namespace SecureShell
     }
     bool Channel::write(std::string data)
     {
-        return strand_->pushTask([this, data = std::move(data)]() {
-            if (channel_)
-                channel_->write(data.data(), data.size());
-        });
+        if (data.empty())
+            return true;
+
+        bool scheduled = false;
+        {
+            std::scoped_lock lock{incomingWritesMutex_};
+            // A task is already on its way for the writes queued before, this one goes with them.
+            scheduled = !incomingWrites_.empty();
+            queuedBytes_ += data.size();
+            if (scheduled)
+                incomingWrites_ += data;
+            else
+                incomingWrites_ = std::move(data);
+        }
+        if (scheduled)
+            return true;
+
+        if (!strand_->pushTask([this]() {
+                flushWrites();
+            }))
+        {
+            std::scoped_lock lock{incomingWritesMutex_};
+            queuedBytes_ -= incomingWrites_.size();
+            incomingWrites_.clear();
+            return false;
+        }
+        return true;
+    }
+    std::size_t Channel::flushWrites()
+    {
+        {
+            std::scoped_lock lock{incomingWritesMutex_};
+            if (!incomingWrites_.empty())
+            {
+                if (outgoingOffset_ == outgoingWrites_.size())
+                {
+                    outgoingWrites_.clear();
+                    outgoingOffset_ = 0;
+                    std::swap(outgoingWrites_, incomingWrites_);
+                }
+                else
+                {
+                    outgoingWrites_.erase(0, outgoingOffset_);
+                    outgoingOffset_ = 0;
+                    outgoingWrites_ += incomingWrites_;
+                    incomingWrites_.clear();
+                }
+            }
+        }
+
+        if (!channel_)
+            return 0;
+
+        std::size_t total = 0;
+        while (outgoingOffset_ < outgoingWrites_.size() && total < maxWriteBatch)
+        {
+            // Never write more than the window, libssh would block the processing thread until the server adjusts it.
+            const auto window = static_cast<std::size_t>(ssh_channel_window_size(channel_->getCChannel()));
+            if (window == 0)
+                break;
+
+            const auto toWrite = std::min({outgoingWrites_.size() - outgoingOffset_, window, maxWriteBatch - total});
+            const auto written = ssh_channel_write(
+                channel_->getCChannel(), outgoingWrites_.data() + outgoingOffset_, static_cast<std::uint32_t>(toWrite));
+            if (written <= 0)
+            {
+                if (written < 0)
+                {
+                    // The channel is broken, the read task finds out and ends it.
+                    queuedBytes_ -= outgoingWrites_.size() - outgoingOffset_;
+                    outgoingWrites_.clear();
+                    outgoingOffset_ = 0;
+                }
+                break;
+            }
+            outgoingOffset_ += static_cast<std::size_t>(written);
+            total += static_cast<std::size_t>(written);
+            queuedBytes_ -= static_cast<std::size_t>(written);
+        }
+        return total;
     }
     std::future<int> Channel::resizePty(int cols, int rows)
     {
         auto promise = std::make_shared<std::promise<int>>();
         if (!strand_->pushTask([this, cols, rows, promise]() {
-                if (channel_)
-                    promise->set_value(channel_->changePtySize(cols, rows));
-                else
-                    promise->set_value(SSH_ERROR);
+                promise->set_value(changePtySize(cols, rows));
             }))
         {
             promise->set_value(SSH_ERROR);
         }
         return promise->get_future();
     }
-    void Channel::readTask(std::chrono::milliseconds pollTimeout)
+    int Channel::changePtySize(int cols, int rows)
     {
-        if (!onStdout_ || !onStderr_ || !onExit_)
-            return;
-
         if (!channel_)
-        {
-            std::this_thread::sleep_for(pollTimeout);
-            return;
-        }
+            return SSH_ERROR;
+        return channel_->changePtySize(cols, rows);
+    }
+    int Channel::drain(PendingOutput& pending, bool isStderr, std::chrono::milliseconds pollTimeout, std::size_t limit)
+    {
+        if (limit == 0)
+            return 0;
 
-        constexpr static int bufferSize = 1024;
-        char buffer[bufferSize];
+        constexpr static int minimumReadSize = 1024;
 
-        auto readOne = [this, &buffer, pollTimeout](bool stdout_) {
-            auto rdy = ssh_channel_poll_timeout(channel_->getCChannel(), pollTimeout.count(), stdout_ ? 0 : 1);
-            if (rdy < 0)
+        auto rdy = ssh_channel_poll_timeout(channel_->getCChannel(), pollTimeout.count(), isStderr ? 1 : 0);
+        if (rdy < 0)
+            return -1;
+
+        const auto chunkSize = std::max(readOptions_.maxChunkSize, static_cast<std::size_t>(minimumReadSize));
+        // A remote that sends faster than we read would otherwise keep this task going forever. The read task is
+        // permanent, so it continues with the next chunk after the other tasks had their turn:
+        limit = std::min(limit, chunkSize);
+        int total = 0;
+        while (rdy > 0)
+        {
+            if (pending.buffer.empty())
+                pending.firstByteAt = std::chrono::steady_clock::now();
+
+            const auto offset = pending.buffer.size();
+            const auto toRead = static_cast<int>(std::min(
+                {static_cast<std::size_t>(rdy), chunkSize - offset, limit - static_cast<std::size_t>(total)}));
+            pending.buffer.resize(offset + static_cast<std::size_t>(toRead));
+            const auto bytesRead =
+                ssh_channel_read(channel_->getCChannel(), pending.buffer.data() + offset, toRead, isStderr ? 1 : 0);
+            if (bytesRead <= 0)
+            {
+                pending.buffer.resize(offset);
                 return -1;
+            }
+            pending.buffer.resize(offset + static_cast<std::size_t>(bytesRead));
 
+            rdy -= bytesRead;
+            total += bytesRead;
+
+            if (pending.buffer.size() >= readOptions_.maxChunkSize)
+                flushIfDue(pending, isStderr, false, true);
+
+            if (static_cast<std::size_t>(total) == limit)
+                break;
+
+            // More may have arrived while reading:
             if (rdy == 0)
-                return 0;
+                rdy = ssh_channel_poll(channel_->getCChannel(), isStderr ? 1 : 0);
+        }
+        return total;
+    }
+    bool Channel::flushIfDue(PendingOutput& pending, bool isStderr, bool drained, bool force)
+    {
+        if (pending.buffer.empty())
+            return false;
 
-            while (rdy > 0)
-            {
-                const auto toRead = std::min(bufferSize, rdy);
-                const auto bytesRead = ssh_channel_read(channel_->getCChannel(), buffer, toRead, stdout_ ? 0 : 1);
-                if (bytesRead <= 0)
-                    return -1;
-
-                std::string data{buffer, static_cast<std::size_t>(bytesRead)};
-                if (stdout_)
-                    onStdout_(data);
-                else
-                    onStderr_(data);
+        const auto now = std::chrono::steady_clock::now();
+        // Output after an idle period, like the echo of a keystroke, is not held back. Continuous output is held
+        // until the flush delay passed or the chunk is full:
+        const bool due = force || pending.buffer.size() >= readOptions_.maxChunkSize ||
+            now - pending.firstByteAt >= readOptions_.flushDelay ||
+            (drained && now - pending.lastFlushAt >= readOptions_.flushDelay);
+        if (!due)
+            return true;
 
-                rdy -= bytesRead;
-            }
-            return rdy;
-        };
+        if (isStderr)
+            onStderr_(pending.buffer);
+        else
+            onStdout_(pending.buffer);
+        unacknowledged_ += pending.buffer.size();
+        pending.buffer.clear();
+        pending.lastFlushAt = now;
+        return false;
+    }
+    std::size_t Channel::readCredit() const
+    {
+        if (readOptions_.window == 0)
+            return std::numeric_limits<int>::max();
 
-        if (readOne(true) < 0)
+        const auto used = unacknowledged_ + pendingStdout_.buffer.size() + pendingStderr_.buffer.size();
+        return used >= readOptions_.window ? 0 : readOptions_.window - used;
+    }
+    void Channel::acknowledge(std::size_t bytes)
+    {
+        // Pushing the task also wakes the processing thread, if it idled because the window was exhausted.
+        strand_->pushTask([this, bytes]() {
+            unacknowledged_ -= std::min(bytes, unacknowledged_);
+        });
+    }
+    bool Channel::readTask(std::chrono::milliseconds pollTimeout)
+    {
+        if (!onStdout_ || !onStderr_ || !onExit_)
+            return false;
+
+        if (!channel_)
         {
-            if (onExit_)
-                onExit_();
-            return;
+            std::this_thread::sleep_for(pollTimeout);
+            return false;
         }
-        if (readOne(false) < 0)
-        {
+
+        // Writes left over by a full window or batch limit are retried here. The window adjust from the server
+        // arrives on the socket and wakes the processing thread.
+        const auto written = flushWrites();
+
+        auto exit = [this]() {
+            flushIfDue(pendingStdout_, false, true, true);
+            flushIfDue(pendingStderr_, true, true, true);
             if (onExit_)
                 onExit_();
-            return;
-        }
+            return true;
+        };
+
+        // Without credit the channel is not even polled, libssh then keeps the ssh window closed.
+        const auto stdoutRead = drain(pendingStdout_, false, pollTimeout, readCredit());
+        if (stdoutRead < 0)
+            return exit();
+        const auto stderrRead = drain(pendingStderr_, true, pollTimeout, readCredit());
+        if (stderrRead < 0)
+            return exit();
+
+        const bool stdoutPending = flushIfDue(pendingStdout_, false, true, false);
+        const bool stderrPending = flushIfDue(pendingStderr_, true, true, false);
+
+        // Pending output needs another cycle soon to be flushed by its deadline.
+        return written > 0 || stdoutRead > 0 || stderrRead > 0 || stdoutPending || stderrPending;
     }
     void Channel::startReading(
         std::function<void(std::string const&)> onStdout,
         std::function<void(std::string const&)> onStderr,
-        std::function<void()> onExit)
+        std::function<void()> onExit,
+        ChannelReadOptions options)
     {
         onStdout_ = std::move(onStdout);
         onStderr_ = std::move(onStderr);
         onExit_ = std::move(onExit);
+        readOptions_ = options;
+        pendingStdout_.buffer.reserve(readOptions_.maxChunkSize);
+        pendingStderr_.buffer.reserve(readOptions_.maxChunkSize);
 
         auto [success, id] = strand_->pushPermanentTask([this]() {
-            readTask();
+            return readTask();
         });
         if (!success)
         {
@@ -1,6 +1,12 @@
 #include <ssh/file_stream.hpp>
 #include <ssh/sftp_session.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
 #include <utility>
 
 namespace SecureShell
@@ -33,6 +39,27 @@ namespace SecureShell
         return promise.get_future();
     }
 
+    template <typename FunctionT, typename ResultT>
+    void FileStream::performCallback(FunctionT&& func, std::function<void(ResultT&&)> onComplete)
+    {
+        if (auto sftp = sftp_.lock(); sftp)
+        {
+            // If the task is dropped, onComplete is destroyed without being called, which asynchronous callers
+            // observe as a dropped operation.
+            return sftp->perform(
+                [func = std::forward<FunctionT>(func), onComplete = std::move(onComplete)]() mutable {
+                    onComplete(func());
+                });
+        }
+
+        onComplete(
+            std::unexpected(
+                SftpError{
+                    .message = "Owner is null",
+                    .wrapperError = WrapperErrors::OwnerNull,
+                }));
+    }
+
     FileStream::FileStream(std::shared_ptr<SftpSession> sftp, sftp_file file, sftp_limits_struct limits)
         : sftp_{std::move(sftp)}
         , file_{file, makeFileDeleter()}
@@ -64,11 +91,32 @@ namespace SecureShell
             }
         }
     }
+    void FileStream::closeInBackground()
+    {
+        auto sftp = sftp_.lock();
+        if (!sftp)
+            return;
+        if (sftp->strand_->withinProcessingThread())
+            return close(false);
+
+        // The session holds the last reference otherwise, which it drops in the task:
+        sftp->perform([self = shared_from_this(), sftp]() {
+            self->file_.reset();
+            sftp->fileStreamRemoveItself(self.get(), false);
+        });
+    }
     std::function<void(sftp_file)> FileStream::makeFileDeleter()
     {
         return [this](sftp_file file) {
             if (auto sftp = this->sftp_.lock(); sftp)
             {
+                // On the strand the close happens right away, so calls pushed after a close find the file closed:
+                if (sftp->strand_->withinProcessingThread())
+                {
+                    sftp_close(file);
+                    return;
+                }
+
                 // This is safe because file is just a pointer, even if 'this' is deleted by this point.
                 sftp->perform([file]() {
                     sftp_close(file);
@@ -86,25 +134,49 @@ namespace SecureShell
         }
         return *this;
     }
+    std::expected<void, SftpError> FileStream::seekImpl(std::size_t pos)
+    {
+        VERIFY_FILE_STREAM();
+        sftp_seek64(file_.get(), pos);
+        return {};
+    }
     std::future<std::expected<void, SftpError>> FileStream::seek(std::size_t pos)
     {
-        return performPromise([this, pos]() -> std::expected<void, SftpError> {
-            VERIFY_FILE_STREAM();
-            sftp_seek64(file_.get(), pos);
-            return {};
+        return performPromise([this, pos]() {
+            return seekImpl(pos);
         });
     }
+    void FileStream::seek(std::size_t pos, std::function<void(std::expected<void, SftpError>&&)> onComplete)
+    {
+        performCallback(
+            [this, pos]() {
+                return seekImpl(pos);
+            },
+            std::move(onComplete));
+    }
+    std::expected<FileInformation, SftpError> FileStream::statImpl()
+    {
+        VERIFY_FILE_STREAM();
+        std::unique_ptr<sftp_attributes_struct, decltype(&sftp_attributes_free)> attributes{
+            sftp_fstat(file_.get()), sftp_attributes_free};
+        if (attributes == nullptr)
+            return std::unexpected(lastError());
+        return fromSftpAttributes(attributes.get());
+    }
     std::future<std::expected<FileInformation, SftpError>> FileStream::stat()
     {
-        return performPromise([this]() -> std::expected<FileInformation, SftpError> {
-            VERIFY_FILE_STREAM();
-            std::unique_ptr<sftp_attributes_struct, decltype(&sftp_attributes_free)> attributes{
-                sftp_fstat(file_.get()), sftp_attributes_free};
-            if (attributes == nullptr)
-                return std::unexpected(lastError());
-            return fromSftpAttributes(attributes.get());
+        return performPromise([this]() {
+            return statImpl();
         });
     }
+    void FileStream::stat(std::function<void(std::expected<FileInformation, SftpError>&&)> onComplete)
+    {
+        performCallback(
+            [this]() {
+                return statImpl();
+            },
+            std::move(onComplete));
+    }
     std::future<std::expected<std::size_t, SftpError>> FileStream::tell()
     {
         return performPromise([this]() -> std::expected<std::size_t, SftpError> {
@@ -134,16 +206,31 @@ namespace SecureShell
             };
         }
     }
+    std::expected<std::size_t, SftpError> FileStream::readSomeImpl(char* buffer, std::size_t bufferSize)
+    {
+        VERIFY_FILE_STREAM();
+        const auto result = sftp_read(file_.get(), buffer, bufferSize);
+        if (result < 0)
+            return std::unexpected(lastError());
+        return static_cast<std::size_t>(result);
+    }
     std::future<std::expected<std::size_t, SftpError>> FileStream::readSome(char* buffer, std::size_t bufferSize)
     {
-        return performPromise([this, buffer, bufferSize]() -> std::expected<std::size_t, SftpError> {
-            VERIFY_FILE_STREAM();
-            const auto result = sftp_read(file_.get(), buffer, bufferSize);
-            if (result < 0)
-                return std::unexpected(lastError());
-            return static_cast<std::size_t>(result);
+        return performPromise([this, buffer, bufferSize]() {
+            return readSomeImpl(buffer, bufferSize);
         });
     }
+    void FileStream::readSome(
+        char* buffer,
+        std::size_t bufferSize,
+        std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete)
+    {
+        performCallback(
+            [this, buffer, bufferSize]() {
+                return readSomeImpl(buffer, bufferSize);
+            },
+            std::move(onComplete));
+    }
 
     std::future<std::expected<std::size_t, SftpError>>
     FileStream::readAll(std::function<bool(std::string_view data)> onReadFunc)
@@ -213,6 +300,468 @@ namespace SecureShell
         state->doRead();
         return state->promise.get_future();
     }
+    struct FileStream::ReadPipeline
+    {
+        std::weak_ptr<FileStream> stream;
+        std::size_t maxInFlight;
+        std::size_t chunkSize;
+        // Bytes to read at most, ranges end before the end of the file.
+        std::uint64_t length;
+        std::function<bool(std::string_view data)> onChunk;
+        std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete;
+        // Bounds the requested bytes the consumer did not release yet, unbounded if null.
+        std::shared_ptr<ReadWindow> window;
+        ProcessingThread::PermanentTaskId taskId{};
+        struct Request
+        {
+            sftp_aio aio;
+            std::size_t size;
+            std::chrono::steady_clock::time_point sent;
+        };
+        std::deque<Request> inFlight{};
+        std::string buffer{};
+        std::uint64_t startOffset{0};
+        std::size_t totalRead{0};
+        std::uint64_t requested{0};
+        bool endOfFile{false};
+        bool shortRead{false};
+        std::size_t staleResponses{0};
+        bool finished{false};
+
+        ReadPipeline(
+            std::weak_ptr<FileStream> stream,
+            std::size_t maxInFlight,
+            std::size_t chunkSize,
+            std::uint64_t length,
+            std::function<bool(std::string_view data)> onChunk,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+            std::shared_ptr<ReadWindow> window)
+            : stream{std::move(stream)}
+            , maxInFlight{std::max(maxInFlight, std::size_t{1})}
+            , chunkSize{chunkSize}
+            , length{length}
+            , onChunk{std::move(onChunk)}
+            , onComplete{std::move(onComplete)}
+            , window{std::move(window)}
+            , buffer(chunkSize, '\0')
+        {}
+        ~ReadPipeline()
+        {
+            dropInFlight();
+        }
+        ReadPipeline(ReadPipeline const&) = delete;
+        ReadPipeline& operator=(ReadPipeline const&) = delete;
+
+        void dropInFlight()
+        {
+            for (auto& request : inFlight)
+                sftp_aio_free(request.aio);
+            inFlight.clear();
+        }
+
+        /**
+         * @brief Returns requested bytes to the window that are not passed on to the consumer.
+         */
+        void unreserve(std::size_t bytes)
+        {
+            if (window && bytes > 0)
+                window->release(bytes);
+        }
+
+        void finish(FileStream* self, std::expected<std::size_t, SftpError>&& result)
+        {
+            finished = true;
+            dropInFlight();
+            if (window)
+                window->onRelease({});
+            if (self)
+            {
+                if (auto* strand = self->strand(); strand)
+                    strand->removePermanentTask(taskId);
+            }
+            onComplete(std::move(result));
+        }
+
+        /**
+         * @brief Keeps the requests outstanding and passes on the responses that arrived.
+         *
+         * @return true If a response arrived or the read ended.
+         */
+        bool step()
+        {
+            if (finished)
+                return false;
+
+            auto self = stream.lock();
+            if (!self || !self->file_)
+            {
+                finish(
+                    self.get(),
+                    std::unexpected(SftpError{.message = "File is null", .wrapperError = WrapperErrors::FileNull}));
+                return true;
+            }
+            auto* file = self->file_.get();
+
+            if (shortRead && inFlight.empty())
+            {
+                // Nothing was requested behind the short read, so nothing confirms the end of the file. The read is
+                // repeated from where the short read ended, it reads 0 bytes at the end of the file.
+                shortRead = false;
+                sftp_seek64(file, startOffset + totalRead);
+                requested = totalRead;
+            }
+
+            while (!endOfFile && requested < length && inFlight.size() < maxInFlight)
+            {
+                auto size = static_cast<std::size_t>(std::min<std::uint64_t>(chunkSize, length - requested));
+                if (window)
+                {
+                    // Requests wait until the consumer released enough, the window wakes the task up then.
+                    size = window->reserve(size);
+                    if (size == 0)
+                        break;
+                }
+                sftp_aio aio = nullptr;
+                if (sftp_aio_begin_read(file, size, &aio) < 0)
+                {
+                    finish(self.get(), std::unexpected(self->lastError()));
+                    return true;
+                }
+                inFlight.push_back(Request{.aio = aio, .size = size, .sent = std::chrono::steady_clock::now()});
+                requested += size;
+            }
+
+            bool progressed = false;
+            // Only collects responses that already arrived, the permanent task is polled again when the socket
+            // becomes readable.
+            sftp_file_set_nonblocking(file);
+            while (!inFlight.empty())
+            {
+                const auto result = sftp_aio_wait_read(&inFlight.front().aio, buffer.data(), buffer.size());
+                if (result == SSH_AGAIN)
+                    break;
+
+                // The aio is freed by anything but SSH_AGAIN.
+                const auto requestSize = inFlight.front().size;
+                self->recordRoundTrip(std::chrono::steady_clock::now() - inFlight.front().sent);
+                inFlight.pop_front();
+                progressed = true;
+                if (staleResponses > 0)
+                {
+                    --staleResponses;
+                    unreserve(requestSize);
+                    continue;
+                }
+                if (result < 0)
+                {
+                    sftp_file_set_blocking(file);
+                    finish(self.get(), std::unexpected(self->lastError()));
+                    return true;
+                }
+                if (result == 0)
+                {
+                    endOfFile = true;
+                    unreserve(requestSize);
+                    continue;
+                }
+
+                if (shortRead)
+                {
+                    // The requests behind a short read started past its end, so this was not the end of the file.
+                    // Their responses are discarded and the reads repeated from where the short read ended.
+                    shortRead = false;
+                    staleResponses = inFlight.size();
+                    sftp_seek64(file, startOffset + totalRead);
+                    requested = totalRead;
+                    unreserve(requestSize);
+                    continue;
+                }
+
+                // The consumer releases what it is passed.
+                unreserve(requestSize - static_cast<std::size_t>(result));
+                totalRead += static_cast<std::size_t>(result);
+                if (!onChunk({buffer.data(), static_cast<std::size_t>(result)}))
+                {
+                    sftp_file_set_blocking(file);
+                    finish(self.get(), totalRead);
+                    return true;
+                }
+                // Usually the end of the file, which the next response confirms by reading 0 bytes.
+                shortRead = static_cast<std::size_t>(result) < requestSize;
+            }
+            sftp_file_set_blocking(file);
+
+            if ((endOfFile || totalRead == length) && inFlight.empty())
+            {
+                finish(self.get(), totalRead);
+                return true;
+            }
+            return progressed;
+        }
+    };
+
+    void FileStream::readPipelined(
+        std::size_t maxInFlight,
+        std::function<bool(std::string_view data)> onChunk,
+        std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+        std::shared_ptr<ReadWindow> window)
+    {
+        startReadPipeline(
+            std::nullopt,
+            std::numeric_limits<std::uint64_t>::max(),
+            maxInFlight,
+            std::move(onChunk),
+            std::move(onComplete),
+            std::move(window));
+    }
+    void FileStream::readRangePipelined(
+        std::uint64_t offset,
+        std::uint64_t length,
+        std::size_t maxInFlight,
+        std::function<bool(std::string_view data)> onChunk,
+        std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+        std::shared_ptr<ReadWindow> window)
+    {
+        startReadPipeline(offset, length, maxInFlight, std::move(onChunk), std::move(onComplete), std::move(window));
+    }
+    void FileStream::startReadPipeline(
+        std::optional<std::uint64_t> offset,
+        std::uint64_t length,
+        std::size_t maxInFlight,
+        std::function<bool(std::string_view data)> onChunk,
+        std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete,
+        std::shared_ptr<ReadWindow> window)
+    {
+        auto pipeline = std::make_shared<ReadPipeline>(
+            weak_from_this(),
+            maxInFlight,
+            readLengthLimit(),
+            length,
+            std::move(onChunk),
+            std::move(onComplete),
+            std::move(window));
+
+        // The permanent task is pushed from the processing thread, so its id is known before it runs for the first
+        // time.
+        performCallback(
+            [this, pipeline, offset]() -> std::expected<void, SftpError> {
+                VERIFY_FILE_STREAM();
+                if (offset)
+                    sftp_seek64(file_.get(), *offset);
+                pipeline->startOffset = sftp_tell64(file_.get());
+                auto [pushed, id] = strand()->pushPermanentTask([pipeline]() {
+                    return pipeline->step();
+                });
+                if (!pushed)
+                    return std::unexpected(
+                        SftpError{.message = "Strand finalized", .wrapperError = WrapperErrors::OperationDropped});
+                pipeline->taskId = id;
+
+                // Like pushed blocks of a write, released window space brings a task along to wake the thread.
+                if (pipeline->window)
+                {
+                    pipeline->window->onRelease([weak = weak_from_this()]() {
+                        if (auto self = weak.lock(); self)
+                        {
+                            if (auto* strand = self->strand(); strand)
+                                strand->pushTask([]() {});
+                        }
+                    });
+                }
+                return {};
+            },
+            std::function<void(std::expected<void, SftpError>&&)>{
+                [pipeline](std::expected<void, SftpError>&& started) {
+                    if (!started.has_value())
+                        pipeline->finish(nullptr, std::unexpected(std::move(started).error()));
+                }});
+    }
+    struct FileStream::WritePipeline
+    {
+        std::weak_ptr<FileStream> stream;
+        std::size_t maxInFlight;
+        std::size_t chunkSize;
+        std::shared_ptr<PipelinedWriteSource> source;
+        std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete;
+        ProcessingThread::PermanentTaskId taskId{};
+        // The requests with the time they were sent.
+        std::deque<std::pair<sftp_aio, std::chrono::steady_clock::time_point>> inFlight{};
+        // The block being sent, the requests copy their part of it.
+        std::string block{};
+        std::size_t blockOffset{0};
+        std::size_t totalWritten{0};
+        bool sourceFinished{false};
+        bool finished{false};
+
+        WritePipeline(
+            std::weak_ptr<FileStream> stream,
+            std::size_t maxInFlight,
+            std::size_t chunkSize,
+            std::shared_ptr<PipelinedWriteSource> source,
+            std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete)
+            : stream{std::move(stream)}
+            , maxInFlight{std::max(maxInFlight, std::size_t{1})}
+            , chunkSize{chunkSize}
+            , source{std::move(source)}
+            , onComplete{std::move(onComplete)}
+        {}
+        ~WritePipeline()
+        {
+            dropInFlight();
+        }
+        WritePipeline(WritePipeline const&) = delete;
+        WritePipeline& operator=(WritePipeline const&) = delete;
+
+        void dropInFlight()
+        {
+            for (auto& [aio, sent] : inFlight)
+                sftp_aio_free(aio);
+            inFlight.clear();
+        }
+
+        void finish(FileStream* self, std::expected<std::size_t, SftpError>&& result)
+        {
+            finished = true;
+            dropInFlight();
+            source->onPush({});
+            if (self)
+            {
+                if (auto* strand = self->strand(); strand)
+                    strand->removePermanentTask(taskId);
+            }
+            onComplete(std::move(result));
+        }
+
+        /**
+         * @brief Sends what was pushed while requests are available and collects the confirmations that arrived.
+         *
+         * @return true If a request was sent, a confirmation arrived or the write ended.
+         */
+        bool step()
+        {
+            if (finished)
+                return false;
+
+            auto self = stream.lock();
+            if (!self || !self->file_)
+            {
+                finish(
+                    self.get(),
+                    std::unexpected(SftpError{.message = "File is null", .wrapperError = WrapperErrors::FileNull}));
+                return true;
+            }
+            auto* file = self->file_.get();
+
+            bool progressed = false;
+            while (inFlight.size() < maxInFlight)
+            {
+                if (blockOffset == block.size())
+                {
+                    block.clear();
+                    blockOffset = 0;
+                    const auto next = source->next(block);
+                    if (next == PipelinedWriteSource::NextBlock::Stopped)
+                    {
+                        finish(self.get(), totalWritten);
+                        return true;
+                    }
+                    sourceFinished = next == PipelinedWriteSource::NextBlock::Finished;
+                    if (next != PipelinedWriteSource::NextBlock::Block)
+                        break;
+                    continue;
+                }
+
+                const auto length = std::min(block.size() - blockOffset, chunkSize);
+                sftp_aio aio = nullptr;
+                if (sftp_aio_begin_write(file, block.data() + blockOffset, length, &aio) < 0)
+                {
+                    finish(self.get(), std::unexpected(self->lastError()));
+                    return true;
+                }
+                blockOffset += length;
+                inFlight.emplace_back(aio, std::chrono::steady_clock::now());
+                progressed = true;
+            }
+
+            std::size_t confirmed = 0;
+            std::optional<SftpError> error{};
+            // Only collects confirmations that already arrived, the permanent task is polled again when the socket
+            // becomes readable.
+            sftp_file_set_nonblocking(file);
+            while (!inFlight.empty())
+            {
+                const auto result = sftp_aio_wait_write(&inFlight.front().first);
+                if (result == SSH_AGAIN)
+                    break;
+
+                // The aio is freed by anything but SSH_AGAIN.
+                self->recordRoundTrip(std::chrono::steady_clock::now() - inFlight.front().second);
+                inFlight.pop_front();
+                progressed = true;
+                if (result < 0)
+                {
+                    error = self->lastError();
+                    break;
+                }
+                confirmed += static_cast<std::size_t>(result);
+            }
+            sftp_file_set_blocking(file);
+
+            if (confirmed > 0)
+            {
+                totalWritten += confirmed;
+                source->confirm(confirmed);
+            }
+            if (error)
+            {
+                finish(self.get(), std::unexpected(std::move(*error)));
+                return true;
+            }
+            if (sourceFinished && inFlight.empty())
+            {
+                finish(self.get(), totalWritten);
+                return true;
+            }
+            return progressed;
+        }
+    };
+
+    void FileStream::writePipelined(
+        std::size_t maxInFlight,
+        std::shared_ptr<PipelinedWriteSource> source,
+        std::function<void(std::expected<std::size_t, SftpError>&&)> onComplete)
+    {
+        auto pipeline = std::make_shared<WritePipeline>(
+            weak_from_this(), maxInFlight, writeLengthLimit(), std::move(source), std::move(onComplete));
+
+        performCallback(
+            [this, pipeline]() -> std::expected<void, SftpError> {
+                VERIFY_FILE_STREAM();
+                auto [pushed, id] = strand()->pushPermanentTask([pipeline]() {
+                    return pipeline->step();
+                });
+                if (!pushed)
+                    return std::unexpected(
+                        SftpError{.message = "Strand finalized", .wrapperError = WrapperErrors::OperationDropped});
+                pipeline->taskId = id;
+
+                // An idle processing thread only wakes up for the socket or for tasks, so pushed blocks bring a task
+                // along when the pipeline may be waiting for them.
+                pipeline->source->onPush([weak = weak_from_this()]() {
+                    if (auto self = weak.lock(); self)
+                    {
+                        if (auto* strand = self->strand(); strand)
+                            strand->pushTask([]() {});
+                    }
+                });
+                return {};
+            },
+            std::function<void(std::expected<void, SftpError>&&)>{
+                [pipeline](std::expected<void, SftpError>&& started) {
+                    if (!started.has_value())
+                        pipeline->finish(nullptr, std::unexpected(std::move(started).error()));
+                }});
+    }
     std::size_t FileStream::writeLengthLimit() const
     {
         return limits_.max_write_length;
@@ -221,6 +770,22 @@ namespace SecureShell
     {
         return limits_.max_read_length;
     }
+    std::optional<std::chrono::microseconds> FileStream::roundTripTime() const
+    {
+        const auto roundTrip = roundTripMicroseconds_.load(std::memory_order_relaxed);
+        if (roundTrip == 0)
+            return std::nullopt;
+        return std::chrono::microseconds{roundTrip};
+    }
+    void FileStream::recordRoundTrip(std::chrono::steady_clock::duration roundTrip)
+    {
+        const auto sample =
+            std::max<std::int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(roundTrip).count(), 1);
+        const auto smoothed = roundTripMicroseconds_.load(std::memory_order_relaxed);
+        // Only the processing thread records, so load and store do not race with each other.
+        roundTripMicroseconds_.store(
+            smoothed == 0 ? sample : smoothed + (sample - smoothed) / 8, std::memory_order_relaxed);
+    }
     void FileStream::writePart(
         std::string_view toWrite,
         std::function<void(std::expected<void, SftpError>&&)> onWriteComplete)
@@ -255,17 +820,21 @@ namespace SecureShell
         auto sftp = sftp_.lock();
         return sftp ? sftp->strand_.get() : nullptr;
     }
+    std::expected<void, SftpError> FileStream::writeImpl(std::string_view data)
+    {
+        VERIFY_FILE_STREAM();
+        const auto written = sftp_write(file_.get(), data.data(), data.size());
+        if (written < 0)
+            return std::unexpected(lastError());
+        return {};
+    }
     std::future<std::expected<void, SftpError>> FileStream::write(std::string_view data)
     {
         // Short easy path:
         if (data.size() <= writeLengthLimit())
         {
-            return performPromise([this, data]() -> std::expected<void, SftpError> {
-                VERIFY_FILE_STREAM();
-                const auto written = sftp_write(file_.get(), data.data(), data.size());
-                if (written < 0)
-                    return std::unexpected(lastError());
-                return {};
+            return performPromise([this, data]() {
+                return writeImpl(data);
             });
         }
 
@@ -276,6 +845,18 @@ namespace SecureShell
         });
         return promise->get_future();
     }
+    void FileStream::write(std::string_view data, std::function<void(std::expected<void, SftpError>&&)> onComplete)
+    {
+        if (data.size() <= writeLengthLimit())
+        {
+            return performCallback(
+                [this, data]() {
+                    return writeImpl(data);
+                },
+                std::move(onComplete));
+        }
+        writePart(data, std::move(onComplete));
+    }
     sftp_file FileStream::release()
     {
         sftp_.reset();
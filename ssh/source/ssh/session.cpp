@@ -26,15 +26,22 @@ namespace SecureShell
         }
     }
 
-    Session::Session()
-        : processingThread_{}
+    Session::Session(std::shared_ptr<ProcessingThreadPool> pool)
+        : processingPool_{std::move(pool)}
+        , processingThread_{}
         , session_{}
         , channels_{}
     {}
 
     void Session::start()
     {
-        processingThread_.start(std::chrono::milliseconds{1});
+        // No throttling needed, the thread sleeps on the socket when there is nothing to do:
+        if (processingPool_)
+            processingThread_.start(*processingPool_, std::chrono::milliseconds{0});
+        else
+            processingThread_.start(std::chrono::milliseconds{0});
+        if (const auto socket = ssh_get_fd(session_.getCSession()); socket != SSH_INVALID_SOCKET)
+            processingThread_.watchSocket(static_cast<NativeSocket>(socket));
     }
 
     void Session::stop()
@@ -47,6 +54,11 @@ namespace SecureShell
         return processingThread_.isRunning();
     }
 
+    ProcessingThreadMetrics Session::processingMetrics() const
+    {
+        return processingThread_.metrics();
+    }
+
     void Session::shutdown()
     {
         removeAllChannels();
@@ -87,82 +99,143 @@ namespace SecureShell
 
     std::future<std::expected<std::weak_ptr<Channel>, int>> Session::createPtyChannel(PtyCreationOptions options)
     {
-        auto promise = std::make_shared<std::promise<std::expected<std::weak_ptr<Channel>, int>>>();
-
-        processingThread_.pushTask([this, options = std::move(options), promise]() mutable {
-            auto ptyChannel = std::make_unique<ssh::Channel>(session_);
-            auto& channel = *ptyChannel;
-            auto result = Detail::sequential(
-                [&channel]() {
-                    if (!channel.isOpen())
-                        return channel.openSession();
+        return processingThread_.pushPromiseTask([this, options = std::move(options)]() {
+            return createPtyChannelImpl(options);
+        });
+    }
+
+    std::future<std::expected<std::weak_ptr<Channel>, SftpError>> Session::createExecChannel(std::string command)
+    {
+        return processingThread_.pushPromiseTask([this, command = std::move(command)]() {
+            return createExecChannelImpl(command);
+        });
+    }
+
+    std::future<std::expected<std::weak_ptr<Channel>, SftpError>>
+    Session::createSubsystemChannel(std::string subsystem)
+    {
+        return processingThread_.pushPromiseTask([this, subsystem = std::move(subsystem)]() {
+            return createSubsystemChannelImpl(subsystem);
+        });
+    }
+
+    std::future<std::expected<std::weak_ptr<SftpSession>, SftpError>> Session::createSftpSession()
+    {
+        return processingThread_.pushPromiseTask([this]() {
+            return createSftpSessionImpl();
+        });
+    }
+
+    std::expected<std::weak_ptr<Channel>, int> Session::createPtyChannelImpl(PtyCreationOptions const& options)
+    {
+        auto ptyChannel = std::make_unique<ssh::Channel>(session_);
+        auto& channel = *ptyChannel;
+        auto result = Detail::sequential(
+            [&channel]() {
+                if (!channel.isOpen())
+                    return channel.openSession();
+                return 0;
+            },
+            [&channel, &environment = options.environment]() {
+                if (!environment.has_value())
                     return 0;
-                },
-                [&channel, &environment = options.environment]() {
-                    if (!environment.has_value())
-                        return 0;
-                    for (auto const& [key, value] : *environment)
-                    {
-                        if (channel.requestEnv(key.c_str(), value.c_str()) != 0)
-                            return -1;
-                    }
+                for (auto const& [key, value] : *environment)
+                {
+                    if (channel.requestEnv(key.c_str(), value.c_str()) != 0)
+                        return -1;
+                }
+                return 0;
+            },
+            [&channel, &options]() {
+                return channel.requestPty(options.terminalType.c_str(), options.columns, options.rows);
+            },
+            [&channel, &options]() {
+                if (!options.requestShell)
                     return 0;
-                },
-                [&channel, &options]() {
-                    return channel.requestPty(options.terminalType.c_str(), options.columns, options.rows);
-                },
-                [&channel, &options]() {
-                    if (!options.requestShell)
-                        return 0;
-                    return channel.requestShell();
-                });
+                return channel.requestShell();
+            });
 
-            if (result.result != SSH_OK)
-            {
-                return promise->set_value(std::unexpected(session_.getErrorCode()));
-            }
+        if (result.result != SSH_OK)
+            return std::unexpected(session_.getErrorCode());
+
+        auto sharedChannel = std::make_shared<Channel>(
+            this, processingThread_.createStrand(TaskPriority::Interactive), std::move(ptyChannel));
+        channels_.push_back(sharedChannel);
+        return sharedChannel;
+    }
 
-            auto sharedChannel =
-                std::make_shared<Channel>(this, processingThread_.createStrand(), std::move(ptyChannel));
-            channels_.push_back(sharedChannel);
-            return promise->set_value(sharedChannel);
+    std::expected<std::weak_ptr<Channel>, SftpError> Session::createExecChannelImpl(std::string const& command)
+    {
+        return createRequestChannelImpl([&command](ssh::Channel& channel) {
+            return channel.requestExec(command.c_str());
         });
+    }
 
-        return promise->get_future();
+    std::expected<std::weak_ptr<Channel>, SftpError>
+    Session::createSubsystemChannelImpl(std::string const& subsystem)
+    {
+        return createRequestChannelImpl([&subsystem](ssh::Channel& channel) {
+            return channel.requestSubsystem(subsystem.c_str());
+        });
     }
 
-    std::future<std::expected<std::weak_ptr<SftpSession>, SftpError>> Session::createSftpSession()
+    std::expected<std::weak_ptr<Channel>, SftpError>
+    Session::createRequestChannelImpl(std::function<int(ssh::Channel&)> const& request)
     {
-        auto promise = std::make_shared<std::promise<std::expected<std::weak_ptr<SftpSession>, SftpError>>>();
+        auto requestChannel = std::make_unique<ssh::Channel>(session_);
+        auto& channel = *requestChannel;
+        auto result = Detail::sequential(
+            [&channel]() {
+                if (!channel.isOpen())
+                    return channel.openSession();
+                return 0;
+            },
+            [&channel, &request]() {
+                return request(channel);
+            });
 
-        processingThread_.pushTask([this, promise]() -> void {
-            auto sftp = sftp_new(session_.getCSession());
-            if (sftp == nullptr)
-            {
-                return promise->set_value(std::unexpected(SftpError{
-                    .message = ssh_get_error(session_.getCSession()),
-                    .sshError = ssh_get_error_code(session_.getCSession()),
-                    .sftpError = 0,
-                }));
-            }
+        if (result.result != SSH_OK)
+        {
+            return std::unexpected(SftpError{
+                .message = ssh_get_error(session_.getCSession()),
+                .sshError = ssh_get_error_code(session_.getCSession()),
+            });
+        }
 
-            auto result = sftp_init(sftp);
-            if (result != SSH_OK)
-            {
-                promise->set_value(std::unexpected(SftpError{
-                    .message = ssh_get_error(session_.getCSession()),
-                    .sshError = result,
-                    .sftpError = sftp_get_error(sftp),
-                }));
-                sftp_free(sftp);
-            }
+        // These channels carry file contents and listings, so they must not get in the way of terminals:
+        auto sharedChannel = std::make_shared<Channel>(
+            this, processingThread_.createStrand(TaskPriority::Bulk), std::move(requestChannel));
+        channels_.push_back(sharedChannel);
+        return sharedChannel;
+    }
 
-            auto sftpSession = std::make_shared<SftpSession>(this, processingThread_.createStrand(), sftp);
-            promise->set_value(sftpSession);
-            sftpSessions_.push_back(sftpSession);
-        });
+    std::expected<std::weak_ptr<SftpSession>, SftpError> Session::createSftpSessionImpl()
+    {
+        auto sftp = sftp_new(session_.getCSession());
+        if (sftp == nullptr)
+        {
+            return std::unexpected(SftpError{
+                .message = ssh_get_error(session_.getCSession()),
+                .sshError = ssh_get_error_code(session_.getCSession()),
+                .sftpError = 0,
+            });
+        }
+
+        auto result = sftp_init(sftp);
+        if (result != SSH_OK)
+        {
+            auto error = SftpError{
+                .message = ssh_get_error(session_.getCSession()),
+                .sshError = result,
+                .sftpError = sftp_get_error(sftp),
+            };
+            sftp_free(sftp);
+            return std::unexpected(std::move(error));
+        }
 
-        return promise->get_future();
+        auto sftpSession = std::make_shared<SftpSession>(this, processingThread_.createStrand(), sftp);
+        sftpSessions_.push_back(sftpSession);
+        return sftpSession;
     }
 
     std::expected<std::unique_ptr<Session>, std::string> makeSession(
@@ -170,9 +243,10 @@ namespace SecureShell
         AskPassCallback askPass,
         void* askPassUserDataKeyPhrase,
         void* askPassUserDataPassword,
-        std::vector<PasswordCacheEntry>* pwCache)
+        std::vector<PasswordCacheEntry>* pwCache,
+        std::shared_ptr<ProcessingThreadPool> pool)
     {
-        auto session = std::make_unique<Session>();
+        auto session = std::make_unique<Session>(std::move(pool));
 
         const auto sessionOptions = engine.sshSessionOptions.value();
         const auto sshOptions = sessionOptions.sshOptions.value();
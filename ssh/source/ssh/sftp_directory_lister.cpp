@@ -0,0 +1,373 @@
+#include <ssh/sftp_directory_lister.hpp>
+
+#include <fmt/format.h>
+
+#include <optional>
+
+namespace SecureShell
+{
+    namespace
+    {
+        // See draft-ietf-secsh-filexfer-02, which describes version 3.
+        constexpr std::uint32_t protocolVersion = 3;
+        // Far beyond what servers send, anything larger is not sftp.
+        constexpr std::uint32_t maxPacketLength = 16 * 1024 * 1024;
+
+        constexpr std::uint8_t fxpInit = 1;
+        constexpr std::uint8_t fxpVersion = 2;
+        constexpr std::uint8_t fxpClose = 4;
+        constexpr std::uint8_t fxpOpenDir = 11;
+        constexpr std::uint8_t fxpReadDir = 12;
+        constexpr std::uint8_t fxpStatus = 101;
+        constexpr std::uint8_t fxpHandle = 102;
+        constexpr std::uint8_t fxpName = 104;
+
+        constexpr std::uint32_t fxEof = 1;
+
+        constexpr std::uint32_t attrSize = 0x00000001;
+        constexpr std::uint32_t attrUidGid = 0x00000002;
+        constexpr std::uint32_t attrPermissions = 0x00000004;
+        constexpr std::uint32_t attrAccessModificationTime = 0x00000008;
+        constexpr std::uint32_t attrExtended = 0x80000000;
+
+        constexpr std::uint32_t typeMask = 0170000;
+        constexpr std::uint32_t typeDirectory = 0040000;
+        constexpr std::uint32_t typeRegular = 0100000;
+        constexpr std::uint32_t typeSymlink = 0120000;
+
+        class PacketReader
+        {
+          public:
+            explicit PacketReader(std::string_view data)
+                : data_{data}
+            {}
+
+            bool failed() const
+            {
+                return failed_;
+            }
+
+            bool atEnd() const
+            {
+                return data_.empty();
+            }
+
+            std::size_t remaining() const
+            {
+                return data_.size();
+            }
+
+            std::uint8_t byte()
+            {
+                if (!require(1))
+                    return 0;
+                const auto value = static_cast<std::uint8_t>(data_[0]);
+                data_.remove_prefix(1);
+                return value;
+            }
+
+            std::uint32_t uint32()
+            {
+                if (!require(4))
+                    return 0;
+                std::uint32_t value = 0;
+                for (int i = 0; i < 4; ++i)
+                    value = (value << 8) | static_cast<std::uint8_t>(data_[i]);
+                data_.remove_prefix(4);
+                return value;
+            }
+
+            std::uint64_t uint64()
+            {
+                const std::uint64_t high = uint32();
+                return (high << 32) | uint32();
+            }
+
+            std::string_view string()
+            {
+                const auto length = uint32();
+                if (!require(length))
+                    return {};
+                const auto value = data_.substr(0, length);
+                data_.remove_prefix(length);
+                return value;
+            }
+
+          private:
+            bool require(std::size_t bytes)
+            {
+                if (failed_ || data_.size() < bytes)
+                {
+                    failed_ = true;
+                    return false;
+                }
+                return true;
+            }
+
+          private:
+            std::string_view data_;
+            bool failed_{false};
+        };
+
+        void appendUint32(std::string& out, std::uint32_t value)
+        {
+            out.push_back(static_cast<char>((value >> 24) & 0xFF));
+            out.push_back(static_cast<char>((value >> 16) & 0xFF));
+            out.push_back(static_cast<char>((value >> 8) & 0xFF));
+            out.push_back(static_cast<char>(value & 0xFF));
+        }
+
+        SharedData::FileType fileTypeOf(std::uint32_t permissions)
+        {
+            // Like libssh for version 3, which has no type field.
+            switch (permissions & typeMask)
+            {
+                case (typeDirectory):
+                    return SharedData::FileType::Directory;
+                case (typeRegular):
+                    return SharedData::FileType::Regular;
+                case (typeSymlink):
+                    return SharedData::FileType::Symlink;
+                case (0):
+                    return SharedData::FileType::Unknown;
+                default:
+                    return SharedData::FileType::Special;
+            }
+        }
+
+        /**
+         * @brief Takes a field of the "ls -l" like long name, which is the only place version 3 names owner and
+         * group, like libssh does.
+         */
+        std::string longNameField(std::string_view longName, std::size_t field)
+        {
+            constexpr std::string_view whitespace = " \t";
+            std::size_t begin = longName.find_first_not_of(whitespace);
+            for (std::size_t i = 0; i < field && begin != std::string_view::npos; ++i)
+            {
+                begin = longName.find_first_of(whitespace, begin);
+                if (begin != std::string_view::npos)
+                    begin = longName.find_first_not_of(whitespace, begin);
+            }
+            if (begin == std::string_view::npos)
+                return {};
+            return std::string{longName.substr(begin, longName.find_first_of(whitespace, begin) - begin)};
+        }
+
+        std::optional<FileInformation> readEntry(PacketReader& reader)
+        {
+            FileInformation entry{};
+            entry.path = reader.string();
+            const auto longName = reader.string();
+            entry.longName = longName;
+            entry.flags = reader.uint32();
+            if (entry.flags & attrSize)
+                entry.size = reader.uint64();
+            if (entry.flags & attrUidGid)
+            {
+                entry.uid = reader.uint32();
+                entry.gid = reader.uint32();
+            }
+            if (entry.flags & attrPermissions)
+            {
+                const auto permissions = reader.uint32();
+                entry.permissions = static_cast<std::filesystem::perms>(permissions);
+                entry.type = fileTypeOf(permissions);
+            }
+            if (entry.flags & attrAccessModificationTime)
+            {
+                entry.atime = reader.uint32();
+                entry.mtime = reader.uint32();
+            }
+            if (entry.flags & attrExtended)
+            {
+                const auto count = reader.uint32();
+                for (std::uint32_t i = 0; i < count && !reader.failed(); ++i)
+                {
+                    reader.string();
+                    reader.string();
+                }
+            }
+            if (reader.failed())
+                return std::nullopt;
+
+            entry.owner = longNameField(longName, 2);
+            entry.group = longNameField(longName, 3);
+            return entry;
+        }
+
+        SftpError malformed(std::string message)
+        {
+            return SftpError{.message = std::move(message), .wrapperError = WrapperErrors::MalformedReply};
+        }
+    }
+
+    SftpDirectoryLister::SftpDirectoryLister(std::function<void(std::string)> send)
+        : send_{std::move(send)}
+    {}
+
+    void SftpDirectoryLister::start()
+    {
+        std::string packet{};
+        appendUint32(packet, 5);
+        packet.push_back(static_cast<char>(fxpInit));
+        appendUint32(packet, protocolVersion);
+        send_(std::move(packet));
+    }
+
+    void SftpDirectoryLister::list(std::uint64_t tag, std::string path)
+    {
+        if (!ready())
+        {
+            waiting_.emplace_back(tag, std::move(path));
+            return;
+        }
+        directories_.emplace(tag, Directory{});
+        sendRequest(fxpOpenDir, RequestType::OpenDirectory, tag, path);
+    }
+
+    void SftpDirectoryLister::sendRequest(
+        std::uint8_t type,
+        RequestType requestType,
+        std::uint64_t tag,
+        std::string_view argument)
+    {
+        const auto id = nextId_++;
+        requests_.emplace(id, Request{.type = requestType, .tag = tag});
+
+        std::string packet{};
+        packet.reserve(13 + argument.size());
+        appendUint32(packet, static_cast<std::uint32_t>(9 + argument.size()));
+        packet.push_back(static_cast<char>(type));
+        appendUint32(packet, id);
+        appendUint32(packet, static_cast<std::uint32_t>(argument.size()));
+        packet.append(argument);
+        send_(std::move(packet));
+    }
+
+    std::expected<void, SftpError> SftpDirectoryLister::receive(std::string_view data)
+    {
+        received_.append(data);
+
+        std::size_t offset = 0;
+        while (received_.size() - offset >= 4)
+        {
+            PacketReader header{std::string_view{received_}.substr(offset, 4)};
+            const auto length = header.uint32();
+            if (length == 0 || length > maxPacketLength)
+                return std::unexpected(malformed(fmt::format("Invalid sftp packet length {}", length)));
+            if (received_.size() - offset - 4 < length)
+                break;
+
+            auto result = handlePacket(std::string_view{received_}.substr(offset + 4, length));
+            if (!result)
+                return result;
+            offset += 4 + length;
+        }
+        received_.erase(0, offset);
+        return {};
+    }
+
+    std::expected<void, SftpError> SftpDirectoryLister::handlePacket(std::string_view packet)
+    {
+        PacketReader reader{packet};
+        const auto type = reader.byte();
+
+        if (type == fxpVersion)
+        {
+            version_ = reader.uint32();
+            if (reader.failed() || version_ == 0)
+                return std::unexpected(malformed("Invalid sftp version"));
+
+            auto waiting = std::move(waiting_);
+            for (auto& [tag, path] : waiting)
+                list(tag, std::move(path));
+            return {};
+        }
+        if (!ready())
+            return std::unexpected(malformed(fmt::format("Sftp packet of type {} before the version", type)));
+
+        const auto id = reader.uint32();
+        auto requestIter = requests_.find(id);
+        if (reader.failed() || requestIter == requests_.end())
+            return std::unexpected(malformed(fmt::format("Sftp reply to unknown request {}", id)));
+        const auto request = requestIter->second;
+        requests_.erase(requestIter);
+
+        if (request.type == RequestType::Close)
+            return {};
+
+        auto directoryIter = directories_.find(request.tag);
+        if (directoryIter == directories_.end())
+            return std::unexpected(malformed("Sftp reply for a directory that is not listed"));
+        auto& directory = directoryIter->second;
+
+        switch (type)
+        {
+            case (fxpHandle):
+            {
+                directory.handle = reader.string();
+                if (reader.failed() || request.type != RequestType::OpenDirectory)
+                    return std::unexpected(malformed("Unexpected sftp handle"));
+                sendRequest(fxpReadDir, RequestType::ReadDirectory, request.tag, directory.handle);
+                return {};
+            }
+            case (fxpName):
+            {
+                if (request.type != RequestType::ReadDirectory)
+                    return std::unexpected(malformed("Unexpected sftp name"));
+                // Name, long name and attribute flags take at least 12 bytes per entry:
+                const auto count = reader.uint32();
+                if (reader.failed() || count > reader.remaining() / 12)
+                    return std::unexpected(malformed(fmt::format("Sftp name count {} exceeds the packet", count)));
+                directory.entries.reserve(directory.entries.size() + count);
+                for (std::uint32_t i = 0; i < count; ++i)
+                {
+                    auto entry = readEntry(reader);
+                    if (!entry)
+                        return std::unexpected(malformed("Invalid sftp directory entry"));
+                    directory.entries.push_back(std::move(*entry));
+                }
+                sendRequest(fxpReadDir, RequestType::ReadDirectory, request.tag, directory.handle);
+                return {};
+            }
+            case (fxpStatus):
+            {
+                const auto code = reader.uint32();
+                if (reader.failed())
+                    return std::unexpected(malformed("Invalid sftp status"));
+                // Only the code is mandatory in older versions:
+                const auto message = reader.string();
+
+                if (!directory.handle.empty())
+                    sendRequest(fxpClose, RequestType::Close, request.tag, directory.handle);
+
+                if (request.type == RequestType::ReadDirectory && code == fxEof)
+                {
+                    complete(request.tag, std::move(directory.entries));
+                    return {};
+                }
+                complete(
+                    request.tag,
+                    std::unexpected(SftpError{
+                        .message = message.empty() ? fmt::format("Sftp status {}", code) : std::string{message},
+                        .sftpError = static_cast<int>(code),
+                    }));
+                return {};
+            }
+            default:
+                return std::unexpected(malformed(fmt::format("Unexpected sftp packet of type {}", type)));
+        }
+    }
+
+    void SftpDirectoryLister::complete(std::uint64_t tag, Listing&& listing)
+    {
+        directories_.erase(tag);
+        completed_.emplace_back(tag, std::move(listing));
+    }
+
+    std::vector<std::pair<std::uint64_t, SftpDirectoryLister::Listing>> SftpDirectoryLister::takeListings()
+    {
+        return std::exchange(completed_, {});
+    }
+}
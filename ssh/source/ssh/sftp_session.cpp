@@ -3,6 +3,8 @@
 
 #include <fcntl.h>
 
+#include <tuple>
+
 namespace SecureShell
 {
     SftpSession::SftpSession(Session* owner, std::unique_ptr<ProcessingStrand> strand, sftp_session session)
@@ -58,182 +60,168 @@ namespace SecureShell
     std::future<std::expected<std::vector<FileInformation>, SftpSession::Error>>
     SftpSession::listDirectory(std::filesystem::path const& path)
     {
-        return performPromise(
-            [this, path = std::move(path)]() -> std::expected<std::vector<FileInformation>, SftpSession::Error> {
-                int closeResult = 0;
-                std::vector<FileInformation> entries{};
-
-                {
-                    std::unique_ptr<sftp_dir_struct, std::function<void(sftp_dir_struct*)>> dir{
-                        sftp_opendir(session_, path.generic_string().c_str()), [&](sftp_dir_struct* dir) {
-                            if (dir != nullptr)
-                            {
-                                closeResult = sftp_closedir(dir);
-                            }
-                        }};
-                    if (dir == nullptr)
-                    {
-                        return std::unexpected(
-                            SftpSession::Error{
-                                .message = ssh_get_error(session_),
-                                .sshError = ssh_get_error_code(session_),
-                                .sftpError = sftp_get_error(session_),
-                            });
-                    }
-
-                    {
-                        std::unique_ptr<sftp_attributes_struct, decltype(&sftp_attributes_free)> entry{
-                            sftp_readdir(session_, dir.get()), sftp_attributes_free};
-
-                        for (; entry != nullptr; entry.reset(sftp_readdir(session_, dir.get())))
-                        {
-                            entries.push_back(fromSftpAttributes(entry.get()));
-                        }
-                    }
-
-                    if (!sftp_dir_eof(dir.get()))
-                    {
-                        return std::unexpected(
-                            SftpSession::Error{
-                                .message = ssh_get_error(session_),
-                                .sshError = ssh_get_error_code(session_),
-                                .sftpError = sftp_get_error(session_),
-                            });
-                    }
-                }
-                if (closeResult != SSH_OK)
-                {
-                    return std::unexpected(
-                        SftpSession::Error{
-                            .message = ssh_get_error(session_),
-                            .sshError = closeResult,
-                            .sftpError = sftp_get_error(session_),
-                        });
-                }
-
-                return entries;
-            });
+        return performPromise([this, path]() {
+            return listDirectoryImpl(path);
+        });
     }
     std::future<std::expected<void, SftpSession::Error>>
     SftpSession::createDirectory(std::filesystem::path const& path, std::filesystem::perms permissions)
     {
-        return performPromise([this, path = std::move(path), permissions]() -> std::expected<void, SftpSession::Error> {
-            auto result = sftp_mkdir(
-                session_,
-                path.generic_string().c_str(),
-                static_cast<unsigned long>(permissions & std::filesystem::perms::mask));
-            if (result != SSH_OK)
-                return std::unexpected(lastError());
-            return {};
+        return performPromise([this, path, permissions]() {
+            return createDirectoryImpl(path, permissions);
         });
     }
-
     std::future<std::expected<void, SftpSession::Error>>
     SftpSession::createFile(std::filesystem::path const& path, std::filesystem::perms permissions)
     {
-        return performPromise([this, path = std::move(path), permissions]() -> std::expected<void, SftpSession::Error> {
-            std::unique_ptr<sftp_file_struct, std::function<void(sftp_file_struct*)>> file{
-                sftp_open(
-                    session_,
-                    path.generic_string().c_str(),
-                    O_CREAT,
-                    static_cast<unsigned long>(permissions & std::filesystem::perms::mask)),
-                [&](sftp_file_struct* file) {
-                    if (file != nullptr)
-                    {
-                        sftp_close(file);
-                    }
-                }};
-
-            if (file == nullptr)
-                return std::unexpected(lastError());
-
-            return {};
+        return performPromise([this, path, permissions]() {
+            return createFileImpl(path, permissions);
         });
     }
-
     std::future<std::expected<void, SftpSession::Error>> SftpSession::removeFile(std::filesystem::path const& path)
     {
-        return performPromise([this, path = std::move(path)]() -> std::expected<void, Error> {
-            auto result = sftp_unlink(session_, path.generic_string().c_str());
-            if (result != SSH_OK)
-                return std::unexpected(lastError());
-            return {};
+        return performPromise([this, path]() {
+            return removeFileImpl(path);
         });
     }
-
+    void SftpSession::removeFile(
+        std::filesystem::path const& path,
+        std::function<void(std::expected<void, Error>&&)> onComplete)
+    {
+        performCallback(
+            [this, path]() {
+                return removeFileImpl(path);
+            },
+            std::move(onComplete));
+    }
     std::future<std::expected<void, SftpSession::Error>> SftpSession::removeDirectory(std::filesystem::path const& path)
     {
-        return performPromise([this, path = std::move(path)]() -> std::expected<void, Error> {
-            auto result = sftp_rmdir(session_, path.generic_string().c_str());
-            if (result != SSH_OK)
-                return std::unexpected(lastError());
-            return {};
+        return performPromise([this, path]() {
+            return removeDirectoryImpl(path);
         });
     }
-
     std::future<std::expected<FileInformation, SftpSession::Error>> SftpSession::stat(std::filesystem::path const& path)
     {
-        return performPromise([this, path = std::move(path)]() -> std::expected<FileInformation, Error> {
-            std::unique_ptr<sftp_attributes_struct, decltype(&sftp_attributes_free)> attributes{
-                sftp_stat(session_, path.generic_string().c_str()), sftp_attributes_free};
-            if (attributes == nullptr)
-                return std::unexpected(lastError());
-
-            return fromSftpAttributes(attributes.get());
+        return performPromise([this, path]() {
+            return statImpl(path);
         });
     }
-
+    void SftpSession::stat(
+        std::filesystem::path const& path,
+        std::function<void(std::expected<FileInformation, Error>&&)> onComplete)
+    {
+        performCallback(
+            [this, path]() {
+                return statImpl(path);
+            },
+            std::move(onComplete));
+    }
     std::future<std::expected<void, SftpSession::Error>>
     SftpSession::stat(std::filesystem::path const& path, sftp_attributes attributes)
     {
-        return performPromise([this, path = std::move(path), attributes]() -> std::expected<void, Error> {
-            auto result = sftp_setstat(session_, path.generic_string().c_str(), attributes);
-            if (result != SSH_OK)
-                return std::unexpected(lastError());
-            return {};
+        return performPromise([this, path, attributes]() {
+            return setStatImpl(path, attributes);
         });
     }
-
     std::future<std::expected<void, SftpSession::Error>>
     SftpSession::rename(std::filesystem::path const& source, std::filesystem::path const& destination)
     {
-        return performPromise(
-            [this, source = std::move(source), destination = std::move(destination)]() -> std::expected<void, Error> {
-                auto s = source.generic_string();
-                auto d = destination.generic_string();
-
-                auto result = sftp_rename(session_, s.c_str(), d.c_str());
-                if (result != SSH_OK)
-                {
-                    const auto le = lastError();
-                    return std::unexpected(le);
-                }
-                return {};
-            });
+        return performPromise([this, source, destination]() {
+            return renameImpl(source, destination);
+        });
+    }
+    void SftpSession::rename(
+        std::filesystem::path const& source,
+        std::filesystem::path const& destination,
+        std::function<void(std::expected<void, Error>&&)> onComplete)
+    {
+        performCallback(
+            [this, source, destination]() {
+                return renameImpl(source, destination);
+            },
+            std::move(onComplete));
+    }
+    std::future<std::expected<void, SftpSession::Error>>
+    SftpSession::renameReplacing(std::filesystem::path const& source, std::filesystem::path const& destination)
+    {
+        return performPromise([this, source, destination]() {
+            return renameReplacingImpl(source, destination);
+        });
+    }
+    void SftpSession::renameReplacing(
+        std::filesystem::path const& source,
+        std::filesystem::path const& destination,
+        std::function<void(std::expected<void, Error>&&)> onComplete)
+    {
+        performCallback(
+            [this, source, destination]() {
+                return renameReplacingImpl(source, destination);
+            },
+            std::move(onComplete));
     }
-
     std::future<std::expected<void, SftpSession::Error>>
     SftpSession::chown(std::filesystem::path const& path, uid_t owner, gid_t group)
     {
-        return performPromise([this, path = std::move(path), owner, group]() -> std::expected<void, Error> {
-            auto result = sftp_chown(session_, path.generic_string().c_str(), owner, group);
-            if (result != SSH_OK)
-                return std::unexpected(lastError());
-            return {};
+        return performPromise([this, path, owner, group]() {
+            return chownImpl(path, owner, group);
         });
     }
-
     std::future<std::expected<void, SftpSession::Error>>
     SftpSession::chmod(std::filesystem::path const& path, std::filesystem::perms perms)
     {
-        return performPromise([this, path = std::move(path), perms]() -> std::expected<void, Error> {
-            auto result = sftp_chmod(session_, path.generic_string().c_str(), static_cast<mode_t>(perms));
-            if (result != SSH_OK)
-                return std::unexpected(lastError());
-            return {};
+        return performPromise([this, path, perms]() {
+            return chmodImpl(path, perms);
+        });
+    }
+    void SftpSession::chmod(
+        std::filesystem::path const& path,
+        std::filesystem::perms perms,
+        std::function<void(std::expected<void, Error>&&)> onComplete)
+    {
+        performCallback(
+            [this, path, perms]() {
+                return chmodImpl(path, perms);
+            },
+            std::move(onComplete));
+    }
+    std::future<std::expected<sftp_limits_struct, SftpSession::Error>> SftpSession::limits()
+    {
+        return performPromise([this]() {
+            return limitsImpl();
+        });
+    }
+    std::future<std::expected<std::weak_ptr<FileStream>, SftpSession::Error>>
+    SftpSession::openFile(std::filesystem::path const& path, OpenType openType, std::filesystem::perms permissions)
+    {
+        return performPromise([this, path, openType, permissions]() {
+            return openFileImpl(path, openType, permissions);
         });
     }
+    void SftpSession::openFile(
+        std::filesystem::path const& path,
+        OpenType openType,
+        std::filesystem::perms permissions,
+        std::function<void(std::expected<std::weak_ptr<IFileStream>, Error>&&)> onComplete)
+    {
+        performCallback(
+            [this, path, openType, permissions]() -> std::expected<std::weak_ptr<IFileStream>, Error> {
+                return openFileImpl(path, openType, permissions);
+            },
+            std::move(onComplete));
+    }
+    void SftpSession::createExecChannel(
+        std::string const& command,
+        std::function<void(std::expected<std::weak_ptr<IChannel>, Error>&&)> onComplete)
+    {
+        session().asyncCreateExecChannel(
+            command,
+            [onComplete = std::move(onComplete)](
+                std::exception_ptr error, std::expected<std::weak_ptr<Channel>, Error> result) {
+                if (error)
+                    return onComplete(std::unexpected(Error{.message = "The session closed before the channel opened"}));
+                onComplete(std::move(result));
+            });
+    }
 
     SftpError SftpSession::lastError() const
     {
@@ -244,45 +232,214 @@ namespace SecureShell
         };
     }
 
-    std::future<std::expected<sftp_limits_struct, SftpSession::Error>> SftpSession::limits()
+    std::expected<std::vector<FileInformation>, SftpSession::Error>
+    SftpSession::listDirectoryImpl(std::filesystem::path const& path)
     {
-        return performPromise([this]() -> std::expected<sftp_limits_struct, Error> {
-            auto const* limits = sftp_limits(session_);
-            if (limits == nullptr)
-                return std::unexpected(lastError());
-            return *limits;
-        });
+        int closeResult = 0;
+        std::vector<FileInformation> entries{};
+
+        {
+            std::unique_ptr<sftp_dir_struct, std::function<void(sftp_dir_struct*)>> dir{
+                sftp_opendir(session_, path.generic_string().c_str()), [&](sftp_dir_struct* dir) {
+                    if (dir != nullptr)
+                    {
+                        closeResult = sftp_closedir(dir);
+                    }
+                }};
+            if (dir == nullptr)
+            {
+                return std::unexpected(
+                    SftpSession::Error{
+                        .message = ssh_get_error(session_),
+                        .sshError = ssh_get_error_code(session_),
+                        .sftpError = sftp_get_error(session_),
+                    });
+            }
+
+            {
+                std::unique_ptr<sftp_attributes_struct, decltype(&sftp_attributes_free)> entry{
+                    sftp_readdir(session_, dir.get()), sftp_attributes_free};
+
+                for (; entry != nullptr; entry.reset(sftp_readdir(session_, dir.get())))
+                {
+                    entries.push_back(fromSftpAttributes(entry.get()));
+                }
+            }
+
+            if (!sftp_dir_eof(dir.get()))
+            {
+                return std::unexpected(
+                    SftpSession::Error{
+                        .message = ssh_get_error(session_),
+                        .sshError = ssh_get_error_code(session_),
+                        .sftpError = sftp_get_error(session_),
+                    });
+            }
+        }
+        if (closeResult != SSH_OK)
+        {
+            return std::unexpected(
+                SftpSession::Error{
+                    .message = ssh_get_error(session_),
+                    .sshError = closeResult,
+                    .sftpError = sftp_get_error(session_),
+                });
+        }
+
+        return entries;
+    }
+    std::expected<void, SftpSession::Error>
+    SftpSession::createDirectoryImpl(std::filesystem::path const& path, std::filesystem::perms permissions)
+    {
+        auto result = sftp_mkdir(
+            session_,
+            path.generic_string().c_str(),
+            static_cast<unsigned long>(permissions & std::filesystem::perms::mask));
+        if (result != SSH_OK)
+            return std::unexpected(lastError());
+        return {};
     }
+    std::expected<void, SftpSession::Error>
+    SftpSession::createFileImpl(std::filesystem::path const& path, std::filesystem::perms permissions)
+    {
+        std::unique_ptr<sftp_file_struct, std::function<void(sftp_file_struct*)>> file{
+            sftp_open(
+                session_,
+                path.generic_string().c_str(),
+                O_CREAT,
+                static_cast<unsigned long>(permissions & std::filesystem::perms::mask)),
+            [&](sftp_file_struct* file) {
+                if (file != nullptr)
+                {
+                    sftp_close(file);
+                }
+            }};
 
-    std::future<std::expected<std::weak_ptr<FileStream>, SftpSession::Error>>
-    SftpSession::openFile(std::filesystem::path const& path, OpenType openType, std::filesystem::perms permissions)
+        if (file == nullptr)
+            return std::unexpected(lastError());
+
+        return {};
+    }
+    std::expected<void, SftpSession::Error> SftpSession::removeFileImpl(std::filesystem::path const& path)
+    {
+        auto result = sftp_unlink(session_, path.generic_string().c_str());
+        if (result != SSH_OK)
+            return std::unexpected(lastError());
+        return {};
+    }
+    std::expected<void, SftpSession::Error> SftpSession::removeDirectoryImpl(std::filesystem::path const& path)
     {
-        return performPromise(
-            [this, path = std::move(path), openType, permissions]() -> std::expected<std::weak_ptr<FileStream>, Error> {
-                std::unique_ptr<sftp_file_struct, std::function<void(sftp_file_struct*)>> file{
-                    sftp_open(
-                        session_,
-                        path.generic_string().c_str(),
-                        static_cast<int>(openType),
-                        static_cast<unsigned long>(permissions & std::filesystem::perms::mask)),
-                    [&](sftp_file_struct* file) {
-                        if (file != nullptr)
-                        {
-                            sftp_close(file);
-                        }
-                    }};
+        auto result = sftp_rmdir(session_, path.generic_string().c_str());
+        if (result != SSH_OK)
+            return std::unexpected(lastError());
+        return {};
+    }
+    std::expected<FileInformation, SftpSession::Error> SftpSession::statImpl(std::filesystem::path const& path)
+    {
+        std::unique_ptr<sftp_attributes_struct, decltype(&sftp_attributes_free)> attributes{
+            sftp_stat(session_, path.generic_string().c_str()), sftp_attributes_free};
+        if (attributes == nullptr)
+            return std::unexpected(lastError());
 
-                if (!file)
-                    return std::unexpected(lastError());
+        return fromSftpAttributes(attributes.get());
+    }
+    std::expected<void, SftpSession::Error>
+    SftpSession::setStatImpl(std::filesystem::path const& path, sftp_attributes attributes)
+    {
+        auto result = sftp_setstat(session_, path.generic_string().c_str(), attributes);
+        if (result != SSH_OK)
+            return std::unexpected(lastError());
+        return {};
+    }
+    std::expected<void, SftpSession::Error>
+    SftpSession::renameImpl(std::filesystem::path const& source, std::filesystem::path const& destination)
+    {
+        auto s = source.generic_string();
+        auto d = destination.generic_string();
 
-                auto const* limits = sftp_limits(session_);
-                if (limits == nullptr)
-                    return std::unexpected(lastError());
+        auto result = sftp_rename(session_, s.c_str(), d.c_str());
+        if (result != SSH_OK)
+        {
+            const auto le = lastError();
+            return std::unexpected(le);
+        }
+        return {};
+    }
+    std::expected<void, SftpSession::Error>
+    SftpSession::renameReplacingImpl(std::filesystem::path const& source, std::filesystem::path const& destination)
+    {
+        // sftp_rename replaces atomically with either of these:
+        if (sftp_extension_supported(session_, "posix-rename@openssh.com", "1") != 0 ||
+            sftp_server_version(session_) >= 4)
+        {
+            return renameImpl(source, destination);
+        }
 
-                auto stream = std::make_shared<FileStream>(shared_from_this(), file.release(), *limits);
-                fileStreams_.push_back(stream);
+        if (!statImpl(destination).has_value())
+            return renameImpl(source, destination);
 
-                return std::weak_ptr<FileStream>{stream};
-            });
+        const auto aside = std::filesystem::path{destination.generic_string() + ".replaced"};
+        if (auto result = renameImpl(destination, aside); !result.has_value())
+            return result;
+        if (auto result = renameImpl(source, destination); !result.has_value())
+        {
+            std::ignore = renameImpl(aside, destination);
+            return result;
+        }
+        std::ignore = removeFileImpl(aside);
+        return {};
+    }
+    std::expected<void, SftpSession::Error>
+    SftpSession::chownImpl(std::filesystem::path const& path, uid_t owner, gid_t group)
+    {
+        auto result = sftp_chown(session_, path.generic_string().c_str(), owner, group);
+        if (result != SSH_OK)
+            return std::unexpected(lastError());
+        return {};
+    }
+    std::expected<void, SftpSession::Error>
+    SftpSession::chmodImpl(std::filesystem::path const& path, std::filesystem::perms perms)
+    {
+        auto result = sftp_chmod(session_, path.generic_string().c_str(), static_cast<mode_t>(perms));
+        if (result != SSH_OK)
+            return std::unexpected(lastError());
+        return {};
+    }
+    std::expected<sftp_limits_struct, SftpSession::Error> SftpSession::limitsImpl()
+    {
+        auto const* limits = sftp_limits(session_);
+        if (limits == nullptr)
+            return std::unexpected(lastError());
+        return *limits;
+    }
+    std::expected<std::weak_ptr<FileStream>, SftpSession::Error> SftpSession::openFileImpl(
+        std::filesystem::path const& path,
+        OpenType openType,
+        std::filesystem::perms permissions)
+    {
+        std::unique_ptr<sftp_file_struct, std::function<void(sftp_file_struct*)>> file{
+            sftp_open(
+                session_,
+                path.generic_string().c_str(),
+                static_cast<int>(openType),
+                static_cast<unsigned long>(permissions & std::filesystem::perms::mask)),
+            [&](sftp_file_struct* file) {
+                if (file != nullptr)
+                {
+                    sftp_close(file);
+                }
+            }};
+
+        if (!file)
+            return std::unexpected(lastError());
+
+        auto const* limits = sftp_limits(session_);
+        if (limits == nullptr)
+            return std::unexpected(lastError());
+
+        auto stream = std::make_shared<FileStream>(shared_from_this(), file.release(), *limits);
+        fileStreams_.push_back(stream);
+
+        return std::weak_ptr<FileStream>{stream};
     }
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <utility/awaiter.hpp>
+#include <ssh/async/processing_thread.hpp>
+#include <ssh/async/processing_strand.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SecureShell::Test
+{
+    /**
+     * Microbenchmarks of the task submission path. Disabled by default, run them with
+     * --gtest_also_run_disabled_tests --gtest_filter=ProcessingThreadBenchmark.*
+     */
+    class ProcessingThreadBenchmark : public ::testing::Test
+    {
+      protected:
+        template <typename FunctionT>
+        void measure(std::string const& name, int operations, FunctionT&& func)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            std::cout << "[ BENCHMARK ] " << name << ": " << nanoseconds / operations << " ns/op (" << operations
+                      << " ops in " << nanoseconds / 1'000'000 << " ms)\n";
+        }
+    };
+
+    // The submission path without a second thread: tasks are pushed into a thread that is not started and then
+    // executed by stop() in batches that fit into the queue.
+    TEST_F(ProcessingThreadBenchmark, DISABLED_SubmitWithoutContention)
+    {
+        constexpr static int batchSize = 200;
+        constexpr static int batches = 1'000;
+        std::atomic_int counter = 0;
+        ProcessingThread processingThread;
+        auto strand = processingThread.createStrand();
+
+        measure("strand pushTask + stop, single thread", batchSize * batches, [&] {
+            for (int batch = 0; batch < batches; ++batch)
+            {
+                for (int i = 0; i < batchSize; ++i)
+                {
+                    strand->pushTask([&counter] {
+                        ++counter;
+                    });
+                }
+                processingThread.stop();
+            }
+        });
+        EXPECT_EQ(batchSize * batches, counter.load());
+
+        std::vector<std::future<int>> futures(batchSize);
+        int sum = 0;
+        measure("strand pushPromiseTask + stop + get, single thread", batchSize * batches, [&] {
+            for (int batch = 0; batch < batches; ++batch)
+            {
+                for (int i = 0; i < batchSize; ++i)
+                {
+                    futures[i] = strand->pushPromiseTask([i] {
+                        return i;
+                    });
+                }
+                processingThread.stop();
+                for (auto& future : futures)
+                    sum += future.get();
+            }
+        });
+        EXPECT_EQ(batches * (batchSize * (batchSize - 1) / 2), sum);
+    }
+
+    // Like CanPushMultipleTasks, but with many more tasks.
+    TEST_F(ProcessingThreadBenchmark, DISABLED_PushManyTasks)
+    {
+        constexpr static int taskCount = 200'000;
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0});
+        std::atomic_int counter = 0;
+        Awaiter awaiter{};
+
+        measure("pushTask + execute", taskCount, [&] {
+            for (int i = 0; i < taskCount; ++i)
+            {
+                processingThread.pushTask([&counter, &awaiter] {
+                    if (++counter == taskCount)
+                        awaiter.arrive();
+                });
+            }
+            awaiter.wait();
+        });
+        EXPECT_EQ(taskCount, counter.load());
+    }
+
+    // The pattern of a download, which waits for every chunk read.
+    TEST_F(ProcessingThreadBenchmark, DISABLED_PromiseTaskRoundTrips)
+    {
+        constexpr static int roundTrips = 50'000;
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0});
+        auto strand = processingThread.createStrand();
+        std::vector<char> buffer(8192);
+
+        measure("strand pushPromiseTask round trip", roundTrips, [&] {
+            for (int i = 0; i < roundTrips; ++i)
+            {
+                auto future = strand->pushPromiseTask([data = buffer.data(), size = buffer.size(), i]() {
+                    data[i % size] = static_cast<char>(i);
+                    return size;
+                });
+                future.get();
+            }
+        });
+    }
+
+    // Like TaskInStrandIsExecuted, but from several producers at once.
+    TEST_F(ProcessingThreadBenchmark, DISABLED_StrandPushFromSeveralThreads)
+    {
+        constexpr static int producerCount = 4;
+        constexpr static int tasksPerProducer = 50'000;
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0});
+        auto strand = processingThread.createStrand();
+        std::atomic_int counter = 0;
+        Awaiter awaiter{};
+
+        measure("strand pushTask from 4 threads", producerCount * tasksPerProducer, [&] {
+            std::vector<std::thread> producers;
+            for (int p = 0; p < producerCount; ++p)
+            {
+                producers.emplace_back([&] {
+                    for (int i = 0; i < tasksPerProducer; ++i)
+                    {
+                        strand->pushTask([&counter, &awaiter] {
+                            if (++counter == producerCount * tasksPerProducer)
+                                awaiter.arrive();
+                        });
+                    }
+                });
+            }
+            for (auto& producer : producers)
+                producer.join();
+            awaiter.wait();
+        });
+        EXPECT_EQ(producerCount * tasksPerProducer, counter.load());
+    }
+}
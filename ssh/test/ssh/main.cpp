@@ -1,6 +1,10 @@
 #include "test_processing_thread.hpp"
+#include "test_processing_thread_pool.hpp"
+#include "test_async_operation.hpp"
+#include "benchmark_processing_thread.hpp"
 #include "test_ssh_session.hpp"
 #include "test_sftp.hpp"
+#include "test_sftp_directory_lister.hpp"
 
 #include "utility/node.hpp"
 
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <utility/awaiter.hpp>
+#include <ssh/async/async_operation.hpp>
+#include <ssh/async/processing_thread.hpp>
+#include <ssh/async/processing_strand.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <expected>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace SecureShell::Test
+{
+    class AsyncOperationTest : public ::testing::Test
+    {
+      protected:
+        void SetUp() override
+        {
+            processingThread_.start();
+        }
+
+        void TearDown() override
+        {
+            processingThread_.stop();
+        }
+
+      protected:
+        ProcessingThread processingThread_{};
+    };
+
+    TEST_F(AsyncOperationTest, CallbackWithoutExecutorIsCalledOnTheProcessingThread)
+    {
+        Awaiter awaiter{};
+        std::thread::id callbackThread{};
+        int value = 0;
+
+        asyncPerform(
+            processingThread_,
+            [] {
+                return 42;
+            },
+            TaskPriority::Metadata,
+            [&](std::exception_ptr error, int result) {
+                EXPECT_FALSE(error);
+                value = result;
+                callbackThread = std::this_thread::get_id();
+                awaiter.arrive();
+            });
+
+        ASSERT_TRUE(awaiter.waitFor());
+        EXPECT_EQ(42, value);
+        EXPECT_NE(std::this_thread::get_id(), callbackThread);
+    }
+
+    TEST_F(AsyncOperationTest, CoroutineResumesOnItsOwnStrand)
+    {
+        boost::asio::io_context context{};
+        auto strand = boost::asio::make_strand(context);
+        std::vector<std::expected<int, std::string>> results{};
+        bool resumedOnStrand = true;
+
+        boost::asio::co_spawn(
+            strand,
+            [&]() -> boost::asio::awaitable<void> {
+                for (int i = 0; i < 10; ++i)
+                {
+                    auto result = co_await asyncPerform(
+                        processingThread_,
+                        [i]() -> std::expected<int, std::string> {
+                            return i;
+                        },
+                        TaskPriority::Metadata,
+                        boost::asio::use_awaitable);
+                    resumedOnStrand = resumedOnStrand && strand.running_in_this_thread();
+                    results.push_back(std::move(result));
+                }
+            },
+            [](std::exception_ptr error) {
+                EXPECT_FALSE(error);
+            });
+
+        // Returns once the coroutine finished, the operations in flight keep the context alive:
+        context.run();
+
+        EXPECT_TRUE(resumedOnStrand);
+        ASSERT_EQ(10, results.size());
+        for (int i = 0; i < 10; ++i)
+            EXPECT_EQ(i, results[i].value());
+    }
+
+    TEST_F(AsyncOperationTest, OperationsOfManyCoroutinesOverlap)
+    {
+        boost::asio::io_context context{};
+        auto strand = boost::asio::make_strand(context);
+        std::atomic_bool released = false;
+        int finished = 0;
+
+        // The first operation blocks the processing thread until the second coroutine got to run:
+        boost::asio::co_spawn(
+            strand,
+            [&]() -> boost::asio::awaitable<void> {
+                co_await asyncPerform(
+                    processingThread_,
+                    [&released] {
+                        while (!released)
+                            std::this_thread::yield();
+                        return 0;
+                    },
+                    TaskPriority::Metadata,
+                    boost::asio::use_awaitable);
+                ++finished;
+            },
+            [](std::exception_ptr) {});
+        boost::asio::co_spawn(
+            strand,
+            [&]() -> boost::asio::awaitable<void> {
+                released = true;
+                co_await asyncPerform(
+                    processingThread_,
+                    [] {
+                        return 0;
+                    },
+                    TaskPriority::Metadata,
+                    boost::asio::use_awaitable);
+                ++finished;
+            },
+            [](std::exception_ptr) {});
+
+        context.run();
+        EXPECT_EQ(2, finished);
+    }
+
+    TEST_F(AsyncOperationTest, FinalizedStrandReportsTheDrop)
+    {
+        auto strand = processingThread_.createStrand();
+        strand->pushFinalTask([] {});
+
+        Awaiter awaiter{};
+        std::exception_ptr error{};
+        asyncPerform(
+            *strand,
+            [] {
+                return 1;
+            },
+            [&](std::exception_ptr e, int) {
+                error = e;
+                awaiter.arrive();
+            });
+
+        ASSERT_TRUE(awaiter.waitFor());
+        EXPECT_TRUE(error);
+    }
+
+    TEST_F(AsyncOperationTest, ExceptionsOfTheFunctionArePassedOn)
+    {
+        Awaiter awaiter{};
+        std::exception_ptr error{};
+        asyncPerform(
+            processingThread_,
+            []() -> int {
+                throw std::runtime_error("failed");
+            },
+            TaskPriority::Metadata,
+            [&](std::exception_ptr e, int) {
+                error = e;
+                awaiter.arrive();
+            });
+
+        ASSERT_TRUE(awaiter.waitFor());
+        EXPECT_TRUE(error);
+    }
+
+    TEST_F(AsyncOperationTest, CallbackBasedOperationsAcceptCompletionTokens)
+    {
+        boost::asio::io_context context{};
+        std::string result{};
+
+        boost::asio::co_spawn(
+            context,
+            [&]() -> boost::asio::awaitable<void> {
+                result = co_await asyncFromCallback<std::string>(
+                    [this](std::function<void(std::string&&)> onComplete) {
+                        processingThread_.pushTask([onComplete = std::move(onComplete)]() {
+                            onComplete("done");
+                        });
+                    },
+                    boost::asio::use_awaitable);
+            },
+            [](std::exception_ptr error) {
+                EXPECT_FALSE(error);
+            });
+
+        context.run();
+        EXPECT_EQ("done", result);
+    }
+}
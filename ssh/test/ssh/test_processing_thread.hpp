@@ -8,6 +8,14 @@
 
 #include <latch>
 #include <thread>
+#include <array>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#    include <sys/socket.h>
+#    include <unistd.h>
+#endif
 
 using namespace std::chrono_literals;
 using namespace std::string_literals;
@@ -287,7 +295,6 @@ namespace SecureShell::Test
     {
         Awaiter awaiter{};
         ProcessingThread processingThread;
-        processingThread.start(std::chrono::milliseconds{1});
         std::shared_ptr<std::pair<bool, ProcessingThread::PermanentTaskId>> result =
             std::make_shared<std::pair<bool, ProcessingThread::PermanentTaskId>>();
         *result = processingThread.pushPermanentTask([&processingThread, result, &awaiter] {
@@ -297,6 +304,8 @@ namespace SecureShell::Test
              * DONT DO ANYTHING HERE WITH CAPTURES, AS THEY ARE DESTROYED
              */
         });
+        // Started afterwards, so that the task cannot run before its id is known:
+        processingThread.start(std::chrono::milliseconds{1});
         ASSERT_TRUE(awaiter.waitFor());
         processingThread.stop();
         EXPECT_EQ(0, processingThread.permanentTaskCount());
@@ -307,7 +316,6 @@ namespace SecureShell::Test
         Awaiter awaiter{};
         std::atomic_int counter = 0;
         ProcessingThread processingThread;
-        processingThread.start(std::chrono::milliseconds{1});
         std::shared_ptr<std::pair<bool, ProcessingThread::PermanentTaskId>> result =
             std::make_shared<std::pair<bool, ProcessingThread::PermanentTaskId>>();
         *result = processingThread.pushPermanentTask([&]() {
@@ -315,6 +323,8 @@ namespace SecureShell::Test
             ++counter;
             processingThread.removePermanentTask(result->second);
         });
+        // Started afterwards, so that the task cannot run before its id is known:
+        processingThread.start(std::chrono::milliseconds{1});
 
         ASSERT_TRUE(awaiter.waitFor());
         std::this_thread::sleep_for(std::chrono::milliseconds{100});
@@ -482,4 +492,303 @@ namespace SecureShell::Test
         });
         ASSERT_TRUE(awaiter.waitFor());
     }
+
+    TEST_F(ProcessingThreadTest, IdleThreadWakesUpForPushedTask)
+    {
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0}, std::chrono::seconds{10});
+        // Let the thread go idle:
+        std::this_thread::sleep_for(50ms);
+
+        Awaiter awaiter{};
+        const auto pushTime = std::chrono::steady_clock::now();
+        processingThread.pushTask([&awaiter] {
+            awaiter.arrive();
+        });
+        ASSERT_TRUE(awaiter.waitFor());
+        EXPECT_LT(std::chrono::steady_clock::now() - pushTime, 500ms);
+    }
+
+    TEST_F(ProcessingThreadTest, IdleThreadDoesNotSpinOnQuietPermanentTask)
+    {
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0}, std::chrono::seconds{1});
+        std::atomic_int counter = 0;
+        auto result = processingThread.pushPermanentTask([&counter] {
+            ++counter;
+            return false;
+        });
+        ASSERT_TRUE(result.first);
+        std::this_thread::sleep_for(200ms);
+        EXPECT_LE(counter.load(), ProcessingThread::quietCyclesBeforeIdle + 2);
+    }
+
+    TEST_F(ProcessingThreadTest, IdleThreadRunsPermanentTasksAfterTimeout)
+    {
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0}, std::chrono::milliseconds{10});
+        std::latch latch{5};
+        std::atomic_int counter = 5;
+        auto result = processingThread.pushPermanentTask([&] {
+            if (counter.load() > 0)
+            {
+                latch.count_down();
+                --counter;
+            }
+            return false;
+        });
+        ASSERT_TRUE(result.first);
+        bool waitResult = false;
+        for (int tryWaitCount = 0; tryWaitCount < 5 && !waitResult; ++tryWaitCount)
+        {
+            if (waitResult = latch.try_wait(); !waitResult)
+                std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        }
+        EXPECT_TRUE(waitResult);
+    }
+
+    TEST_F(ProcessingThreadTest, StopInterruptsIdleThread)
+    {
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0}, std::chrono::seconds{10});
+        std::this_thread::sleep_for(50ms);
+        const auto stopTime = std::chrono::steady_clock::now();
+        processingThread.stop();
+        EXPECT_LT(std::chrono::steady_clock::now() - stopTime, 1s);
+    }
+
+    TEST_F(ProcessingThreadTest, TaskCanHoldMoveOnlyAndLargeCallables)
+    {
+        int result = 0;
+        Task small{[value = std::make_unique<int>(3), &result] {
+            result += *value;
+        }};
+        std::array<int, 64> largeCapture{};
+        largeCapture.fill(1);
+        Task large{[largeCapture, &result] {
+            for (auto value : largeCapture)
+                result += value;
+        }};
+
+        Task movedSmall = std::move(small);
+        Task movedLarge = std::move(large);
+        EXPECT_FALSE(small);
+        EXPECT_FALSE(large);
+        movedSmall();
+        movedLarge();
+        EXPECT_EQ(67, result);
+    }
+
+    TEST_F(ProcessingThreadTest, EmptyFunctionCannotBePushed)
+    {
+        ProcessingThread processingThread;
+        EXPECT_THROW(processingThread.pushTask(std::function<void()>{}), std::invalid_argument);
+    }
+
+    TEST_F(ProcessingThreadTest, QueueKeepsOrderWhenOverflowing)
+    {
+        MpscQueue<int, 4> queue;
+        int next = 0;
+        int expected = 0;
+        int value = -1;
+        for (int round = 0; round < 10; ++round)
+        {
+            for (int i = 0; i < 7; ++i)
+                queue.push(next++);
+            for (int i = 0; i < 5; ++i)
+            {
+                ASSERT_TRUE(queue.tryPop(value));
+                EXPECT_EQ(expected++, value);
+            }
+        }
+        while (queue.tryPop(value))
+            EXPECT_EQ(expected++, value);
+        EXPECT_EQ(next, expected);
+        EXPECT_TRUE(queue.empty());
+    }
+
+    TEST_F(ProcessingThreadTest, PromiseTaskCanCaptureMoveOnlyValues)
+    {
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0});
+        auto future = processingThread.pushPromiseTask([value = std::make_unique<int>(42)]() {
+            return *value;
+        });
+        ASSERT_EQ(std::future_status::ready, future.wait_for(1s));
+        EXPECT_EQ(42, future.get());
+    }
+
+    TEST_F(ProcessingThreadTest, InteractiveLatencyStaysLowWhileBulkWorkIsQueued)
+    {
+        ProcessingThread processingThread;
+        processingThread.start(std::chrono::milliseconds{0});
+        auto transfer = processingThread.createStrand(TaskPriority::Bulk);
+        auto shell = processingThread.createStrand(TaskPriority::Interactive);
+
+        // Imitates blocking sftp reads of a large download:
+        constexpr int bulkTaskCount = 500;
+        std::atomic_int bulkDone = 0;
+        for (int i = 0; i < bulkTaskCount; ++i)
+        {
+            transfer->pushTask([&bulkDone] {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                ++bulkDone;
+            });
+        }
+
+        // Imitates keystroke echoes:
+        std::chrono::steady_clock::duration worstLatency{};
+        for (int i = 0; i < 20; ++i)
+        {
+            const auto pushTime = std::chrono::steady_clock::now();
+            auto ranAt = shell->pushPromiseTask([] {
+                return std::chrono::steady_clock::now();
+            });
+            ASSERT_EQ(std::future_status::ready, ranAt.wait_for(1s));
+            worstLatency = std::max(worstLatency, ranAt.get() - pushTime);
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        }
+
+        // In FIFO order a keystroke would wait for hundreds of reads:
+        EXPECT_LT(bulkDone.load(), bulkTaskCount);
+        EXPECT_LT(worstLatency, 50ms);
+        processingThread.stop();
+        EXPECT_EQ(bulkTaskCount, bulkDone.load());
+    }
+
+    TEST_F(ProcessingThreadTest, HigherPriorityTasksOvertakeLowerOnes)
+    {
+        ProcessingThread processingThread;
+        std::vector<TaskPriority> order{};
+        for (auto priority : {TaskPriority::Bulk, TaskPriority::Metadata, TaskPriority::Interactive})
+        {
+            processingThread.pushTask(
+                [&order, priority] {
+                    order.push_back(priority);
+                },
+                priority);
+        }
+
+        Awaiter awaiter{};
+        processingThread.pushTask(
+            [&awaiter] {
+                awaiter.arrive();
+            },
+            TaskPriority::Bulk);
+        processingThread.start(std::chrono::milliseconds{0});
+        ASSERT_TRUE(awaiter.waitFor());
+        EXPECT_EQ(
+            (std::vector<TaskPriority>{TaskPriority::Interactive, TaskPriority::Metadata, TaskPriority::Bulk}), order);
+    }
+
+    TEST_F(ProcessingThreadTest, TasksOfAStrandKeepTheirOrderWhileOtherStrandsOvertake)
+    {
+        ProcessingThread processingThread;
+        auto transfer = processingThread.createStrand(TaskPriority::Bulk);
+        auto shell = processingThread.createStrand(TaskPriority::Interactive);
+        std::vector<int> order{};
+        for (int i = 0; i < 10; ++i)
+        {
+            transfer->pushTask([&order, i] {
+                order.push_back(i);
+            });
+        }
+        shell->pushTask([&order] {
+            order.push_back(100);
+        });
+        auto final = transfer->pushFinalPromiseTask([&order] {
+            order.push_back(-1);
+        });
+        processingThread.start(std::chrono::milliseconds{0});
+        ASSERT_EQ(std::future_status::ready, final.wait_for(1s));
+        EXPECT_EQ((std::vector<int>{100, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1}), order);
+    }
+
+    TEST_F(ProcessingThreadTest, DurationHistogramSortsIntoPowerOfTwoBuckets)
+    {
+        DurationHistogram histogram;
+        histogram.record(std::chrono::nanoseconds{500});
+        histogram.record(std::chrono::microseconds{1});
+        histogram.record(std::chrono::microseconds{3});
+        histogram.record(std::chrono::milliseconds{10});
+
+        const auto snapshot = histogram.snapshot();
+        EXPECT_EQ(4, snapshot.count);
+        EXPECT_EQ(1, snapshot.buckets[0]);
+        EXPECT_EQ(1, snapshot.buckets[1]);
+        EXPECT_EQ(1, snapshot.buckets[2]);
+        EXPECT_EQ(1, snapshot.buckets[14]);
+        EXPECT_EQ(std::chrono::milliseconds{10}, snapshot.maximum);
+        EXPECT_EQ(std::chrono::microseconds{4}, snapshot.percentile(50));
+        EXPECT_EQ(std::chrono::microseconds{16384}, snapshot.percentile(100));
+    }
+
+    TEST_F(ProcessingThreadTest, MetricsCoverTasksPermanentTasksAndStrands)
+    {
+        ProcessingThread processingThread;
+        auto strand = processingThread.createStrand();
+        for (int i = 0; i < 10; ++i)
+        {
+            strand->pushTask([] {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            });
+        }
+        EXPECT_EQ(10, strand->metrics().pendingTasks);
+        EXPECT_EQ(10, processingThread.metrics().queueDepth[static_cast<std::size_t>(TaskPriority::Metadata)]);
+
+        std::atomic_int calls = 0;
+        auto result = strand->pushPermanentTask([&calls] {
+            return ++calls < 3;
+        });
+        processingThread.start(std::chrono::milliseconds{0});
+        ASSERT_TRUE(processingThread.awaitCycle());
+        while (calls < 3)
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+        const auto metrics = processingThread.metrics();
+        EXPECT_GE(metrics.peakQueueDepth, 10);
+        EXPECT_GE(metrics.taskDuration.count, 11);
+        EXPECT_GE(metrics.taskDuration.total, std::chrono::milliseconds{10});
+        EXPECT_GE(metrics.enqueueLatency.count, 11);
+        EXPECT_GE(metrics.cycleDuration.count, 1);
+        ASSERT_EQ(1, metrics.permanentTasks.size());
+        EXPECT_EQ(result.second.id, metrics.permanentTasks.front().id);
+        EXPECT_GE(metrics.permanentTasks.front().calls, 3);
+
+        const auto strandMetrics = strand->metrics();
+        EXPECT_EQ(0, strandMetrics.pendingTasks);
+        EXPECT_GE(strandMetrics.tasksRun, 13);
+        EXPECT_GE(strandMetrics.busy, std::chrono::milliseconds{10});
+    }
+
+#ifndef _WIN32
+    TEST_F(ProcessingThreadTest, ReadableWatchedSocketWakesIdleThread)
+    {
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+
+        Awaiter awaiter{};
+        ProcessingThread processingThread;
+        processingThread.watchSocket(sockets[0]);
+        processingThread.start(std::chrono::milliseconds{0}, std::chrono::seconds{10});
+        auto result = processingThread.pushPermanentTask([&awaiter, &sockets] {
+            char buffer[16];
+            if (recv(sockets[0], buffer, sizeof(buffer), MSG_DONTWAIT) <= 0)
+                return false;
+            awaiter.arrive();
+            return true;
+        });
+        ASSERT_TRUE(result.first);
+        std::this_thread::sleep_for(50ms);
+
+        const auto sendTime = std::chrono::steady_clock::now();
+        ASSERT_EQ(1, send(sockets[1], "x", 1, 0));
+        ASSERT_TRUE(awaiter.waitFor());
+        EXPECT_LT(std::chrono::steady_clock::now() - sendTime, 500ms);
+
+        processingThread.stop();
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+#endif
 }
\ No newline at end of file
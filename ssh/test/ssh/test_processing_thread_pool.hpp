@@ -0,0 +1,249 @@
+#pragma once
+
+#include <utility/awaiter.hpp>
+#include <ssh/async/processing_thread.hpp>
+#include <ssh/async/processing_thread_pool.hpp>
+#include <ssh/async/processing_strand.hpp>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <memory>
+#include <set>
+#include <vector>
+
+#ifndef _WIN32
+#    include <sys/socket.h>
+#    include <unistd.h>
+#endif
+
+using namespace std::chrono_literals;
+
+namespace SecureShell::Test
+{
+    class ProcessingThreadPoolTest : public ::testing::Test
+    {
+      protected:
+        std::thread::id threadOf(ProcessingThread& processingThread)
+        {
+            auto future = processingThread.pushPromiseTask([] {
+                return std::this_thread::get_id();
+            });
+            if (future.wait_for(1s) != std::future_status::ready)
+                return std::thread::id{};
+            return future.get();
+        }
+    };
+
+    TEST_F(ProcessingThreadPoolTest, ManyThreadsShareTheWorkers)
+    {
+        ProcessingThreadPool pool{2};
+        std::vector<std::unique_ptr<ProcessingThread>> processingThreads;
+        for (int i = 0; i < 20; ++i)
+        {
+            processingThreads.push_back(std::make_unique<ProcessingThread>());
+            processingThreads.back()->start(pool);
+        }
+        EXPECT_EQ(20, pool.attachedCount());
+
+        std::set<std::thread::id> workerIds;
+        for (auto& processingThread : processingThreads)
+        {
+            const auto id = threadOf(*processingThread);
+            ASSERT_NE(std::thread::id{}, id);
+            workerIds.insert(id);
+        }
+        EXPECT_EQ(2, workerIds.size());
+
+        for (auto& processingThread : processingThreads)
+            processingThread->stop();
+        EXPECT_EQ(0, pool.attachedCount());
+    }
+
+    TEST_F(ProcessingThreadPoolTest, TasksKnowTheyAreWithinTheProcessingThread)
+    {
+        ProcessingThreadPool pool{2};
+        ProcessingThread processingThread;
+        processingThread.start(pool);
+        EXPECT_FALSE(processingThread.withinProcessingThread());
+
+        auto within = processingThread.pushPromiseTask([&processingThread] {
+            return processingThread.withinProcessingThread();
+        });
+        ASSERT_EQ(std::future_status::ready, within.wait_for(1s));
+        EXPECT_TRUE(within.get());
+        EXPECT_TRUE(processingThread.awaitCycle());
+    }
+
+    TEST_F(ProcessingThreadPoolTest, StrandKeepsOrderOnPool)
+    {
+        ProcessingThreadPool pool{2};
+        ProcessingThread processingThread;
+        processingThread.start(pool);
+        auto strand = processingThread.createStrand();
+
+        std::vector<int> order;
+        for (int i = 0; i < 1000; ++i)
+        {
+            strand->pushTask([&order, i] {
+                order.push_back(i);
+            });
+        }
+        auto final = strand->pushFinalPromiseTask([&order] {
+            return order.size();
+        });
+        ASSERT_EQ(std::future_status::ready, final.wait_for(1s));
+        EXPECT_EQ(1000, final.get());
+        for (int i = 0; i < 1000; ++i)
+            ASSERT_EQ(i, order[i]);
+    }
+
+    TEST_F(ProcessingThreadPoolTest, StopRunsPendingTasksAndDetaches)
+    {
+        ProcessingThreadPool pool{1};
+        ProcessingThread blocker;
+        blocker.start(pool);
+        ProcessingThread processingThread;
+        processingThread.start(pool);
+
+        // Keeps the only worker busy, so the tasks below can only be run by stop:
+        std::promise<void> release;
+        blocker.pushTask([future = release.get_future().share()] {
+            future.wait();
+        });
+        ASSERT_EQ(2, pool.attachedCount());
+
+        int counter = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+            processingThread.pushTask([&counter] {
+                ++counter;
+            });
+        }
+        std::thread releaser{[&release] {
+            std::this_thread::sleep_for(50ms);
+            release.set_value();
+        }};
+        processingThread.stop();
+        releaser.join();
+        EXPECT_EQ(10, counter);
+        EXPECT_FALSE(processingThread.isRunning());
+        EXPECT_EQ(1, pool.attachedCount());
+    }
+
+    TEST_F(ProcessingThreadPoolTest, IdleWorkerDoesNotSpinOnQuietPermanentTasks)
+    {
+        ProcessingThreadPool pool{1};
+        std::vector<std::unique_ptr<ProcessingThread>> processingThreads;
+        std::atomic_int calls = 0;
+        for (int i = 0; i < 5; ++i)
+        {
+            processingThreads.push_back(std::make_unique<ProcessingThread>());
+            processingThreads.back()->start(pool, 0ms, 100ms);
+            processingThreads.back()->pushPermanentTask([&calls] {
+                ++calls;
+                return false;
+            });
+        }
+
+        std::this_thread::sleep_for(500ms);
+        // Five threads with two quiet rounds per wakeup every 100ms are far below a busy loop:
+        EXPECT_LT(calls.load(), 200);
+    }
+
+    TEST_F(ProcessingThreadPoolTest, BusyThreadsAreMigratedToIdleWorkers)
+    {
+        ProcessingThreadPool pool{2};
+        std::vector<std::unique_ptr<ProcessingThread>> processingThreads;
+        for (int i = 0; i < 4; ++i)
+        {
+            processingThreads.push_back(std::make_unique<ProcessingThread>());
+            processingThreads.back()->start(pool);
+        }
+
+        // Placement alternates between the workers, so the first and the third end up on the same one:
+        auto& first = *processingThreads[0];
+        auto& third = *processingThreads[2];
+        ASSERT_EQ(threadOf(first), threadOf(third));
+
+        for (auto* busy : {&first, &third})
+        {
+            busy->pushPermanentTask([] {
+                std::this_thread::sleep_for(1ms);
+                return true;
+            });
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (threadOf(first) == threadOf(third) && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(50ms);
+        EXPECT_NE(threadOf(first), threadOf(third));
+    }
+
+    TEST_F(ProcessingThreadPoolTest, BlockedThreadDoesNotHoldUpOthersOnItsWorker)
+    {
+        ProcessingThreadPool pool{2};
+        std::vector<std::unique_ptr<ProcessingThread>> processingThreads;
+        for (int i = 0; i < 3; ++i)
+        {
+            processingThreads.push_back(std::make_unique<ProcessingThread>());
+            processingThreads.back()->start(pool);
+        }
+        auto& blocked = *processingThreads[0];
+        auto& neighbour = *processingThreads[2];
+        ASSERT_EQ(threadOf(blocked), threadOf(neighbour));
+
+        // Stands in for a blocking libssh call on a slow connection:
+        Awaiter release{};
+        blocked.pushTask([&release] {
+            release.waitFor(5s);
+        });
+        std::this_thread::sleep_for(10ms);
+
+        const auto pushTime = std::chrono::steady_clock::now();
+        auto result = neighbour.pushPromiseTask([] {
+            return std::this_thread::get_id();
+        });
+        EXPECT_EQ(std::future_status::ready, result.wait_for(1s));
+        EXPECT_LT(std::chrono::steady_clock::now() - pushTime, 500ms);
+        release.arrive();
+
+        for (auto& processingThread : processingThreads)
+            processingThread->stop();
+        EXPECT_EQ(0, pool.attachedCount());
+    }
+
+#ifndef _WIN32
+    TEST_F(ProcessingThreadPoolTest, ReadableWatchedSocketWakesIdleWorker)
+    {
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+
+        Awaiter awaiter{};
+        ProcessingThreadPool pool{1};
+        ProcessingThread other;
+        other.start(pool, 0ms, 10s);
+        ProcessingThread processingThread;
+        processingThread.watchSocket(sockets[0]);
+        processingThread.start(pool, 0ms, 10s);
+        auto result = processingThread.pushPermanentTask([&awaiter, &sockets] {
+            char buffer[16];
+            if (recv(sockets[0], buffer, sizeof(buffer), MSG_DONTWAIT) <= 0)
+                return false;
+            awaiter.arrive();
+            return true;
+        });
+        ASSERT_TRUE(result.first);
+        std::this_thread::sleep_for(50ms);
+
+        const auto sendTime = std::chrono::steady_clock::now();
+        ASSERT_EQ(1, send(sockets[1], "x", 1, 0));
+        ASSERT_TRUE(awaiter.waitFor());
+        EXPECT_LT(std::chrono::steady_clock::now() - sendTime, 100ms);
+
+        processingThread.stop();
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+#endif
+}
@@ -7,6 +7,8 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+
 using namespace std::chrono_literals;
 using namespace std::string_literals;
 
@@ -358,6 +360,218 @@ namespace SecureShell::Test
         EXPECT_EQ(data, createAlphabetString(1024 * 1024));
     }
 
+    TEST_F(SftpTests, CanReadBigFilePipelined)
+    {
+        CREATE_SERVER_AND_JOINER(Sftp);
+        auto [_, sftp] = createSftpSession(serverStartResult->port);
+
+        auto fut =
+            sftp->openFile("/home/test/large.txt", SftpSession::OpenType::Read, std::filesystem::perms::owner_read);
+        ASSERT_EQ(fut.wait_for(1s), std::future_status::ready);
+        auto result = fut.get();
+        ASSERT_TRUE(result.has_value());
+
+        auto fileWeak = std::move(result).value();
+        auto file = fileWeak.lock();
+        ASSERT_TRUE(file);
+
+        std::string data;
+        std::promise<std::expected<std::size_t, SftpError>> readPromise{};
+        file->readPipelined(
+            8,
+            [&data](std::string_view chunk) {
+                data.append(chunk);
+                return true;
+            },
+            [&readPromise](std::expected<std::size_t, SftpError>&& readResult) {
+                readPromise.set_value(std::move(readResult));
+            },
+            nullptr);
+
+        auto readFut = readPromise.get_future();
+        ASSERT_EQ(readFut.wait_for(10s), std::future_status::ready);
+        auto readResult = readFut.get();
+        ASSERT_TRUE(readResult.has_value());
+
+        EXPECT_EQ(readResult.value(), 1024 * 1024);
+        EXPECT_EQ(data, createAlphabetString(1024 * 1024));
+    }
+
+    TEST_F(SftpTests, CanReadRangeOfBigFilePipelined)
+    {
+        CREATE_SERVER_AND_JOINER(Sftp);
+        auto [_, sftp] = createSftpSession(serverStartResult->port);
+
+        auto fut =
+            sftp->openFile("/home/test/large.txt", SftpSession::OpenType::Read, std::filesystem::perms::owner_read);
+        ASSERT_EQ(fut.wait_for(1s), std::future_status::ready);
+        auto result = fut.get();
+        ASSERT_TRUE(result.has_value());
+
+        auto fileWeak = std::move(result).value();
+        auto file = fileWeak.lock();
+        ASSERT_TRUE(file);
+
+        constexpr std::uint64_t offset = 300'000;
+        constexpr std::uint64_t length = 500'001;
+        std::string data;
+        std::promise<std::expected<std::size_t, SftpError>> readPromise{};
+        file->readRangePipelined(
+            offset,
+            length,
+            8,
+            [&data](std::string_view chunk) {
+                data.append(chunk);
+                return true;
+            },
+            [&readPromise](std::expected<std::size_t, SftpError>&& readResult) {
+                readPromise.set_value(std::move(readResult));
+            },
+            nullptr);
+
+        auto readFut = readPromise.get_future();
+        ASSERT_EQ(readFut.wait_for(10s), std::future_status::ready);
+        auto readResult = readFut.get();
+        ASSERT_TRUE(readResult.has_value());
+
+        EXPECT_EQ(readResult.value(), length);
+        EXPECT_EQ(data, createAlphabetString(1024 * 1024).substr(offset, length));
+    }
+
+    TEST_F(SftpTests, RangeReadPastTheEndOfFileEndsAtTheEndOfFile)
+    {
+        CREATE_SERVER_AND_JOINER(Sftp);
+        auto [_, sftp] = createSftpSession(serverStartResult->port);
+
+        auto fut =
+            sftp->openFile("/home/test/large.txt", SftpSession::OpenType::Read, std::filesystem::perms::owner_read);
+        ASSERT_EQ(fut.wait_for(1s), std::future_status::ready);
+        auto result = fut.get();
+        ASSERT_TRUE(result.has_value());
+
+        auto fileWeak = std::move(result).value();
+        auto file = fileWeak.lock();
+        ASSERT_TRUE(file);
+
+        // The last chunk comes back short and nothing is in flight behind it:
+        constexpr std::uint64_t offset = 1024 * 1024 - 1000;
+        constexpr std::uint64_t length = 100'000;
+        std::string data;
+        std::promise<std::expected<std::size_t, SftpError>> readPromise{};
+        file->readRangePipelined(
+            offset,
+            length,
+            1,
+            [&data](std::string_view chunk) {
+                data.append(chunk);
+                return true;
+            },
+            [&readPromise](std::expected<std::size_t, SftpError>&& readResult) {
+                readPromise.set_value(std::move(readResult));
+            },
+            nullptr);
+
+        auto readFut = readPromise.get_future();
+        ASSERT_EQ(readFut.wait_for(10s), std::future_status::ready);
+        auto readResult = readFut.get();
+        ASSERT_TRUE(readResult.has_value());
+
+        EXPECT_EQ(readResult.value(), 1000);
+        EXPECT_EQ(data, createAlphabetString(1024 * 1024).substr(offset));
+    }
+
+    TEST_F(SftpTests, PipelinedReadStaysWithinReadWindow)
+    {
+        CREATE_SERVER_AND_JOINER(Sftp);
+        auto [_, sftp] = createSftpSession(serverStartResult->port);
+
+        auto fut =
+            sftp->openFile("/home/test/large.txt", SftpSession::OpenType::Read, std::filesystem::perms::owner_read);
+        ASSERT_EQ(fut.wait_for(1s), std::future_status::ready);
+        auto result = fut.get();
+        ASSERT_TRUE(result.has_value());
+
+        auto fileWeak = std::move(result).value();
+        auto file = fileWeak.lock();
+        ASSERT_TRUE(file);
+
+        constexpr std::size_t windowSize = 128 * 1024;
+        auto window = std::make_shared<ReadWindow>(windowSize);
+        std::string data;
+        std::atomic<std::size_t> received{0};
+        std::promise<std::expected<std::size_t, SftpError>> readPromise{};
+        file->readPipelined(
+            8,
+            [&data, &received](std::string_view chunk) {
+                data.append(chunk);
+                received += chunk.size();
+                return true;
+            },
+            [&readPromise](std::expected<std::size_t, SftpError>&& readResult) {
+                readPromise.set_value(std::move(readResult));
+            },
+            window);
+
+        auto readFut = readPromise.get_future();
+        ASSERT_EQ(readFut.wait_for(300ms), std::future_status::timeout);
+        EXPECT_LE(received.load(), windowSize);
+
+        // Releasing what arrived lets the read continue:
+        std::size_t released = 0;
+        for (int i = 0; i != 1000 && readFut.wait_for(10ms) != std::future_status::ready; ++i)
+        {
+            const auto arrived = received.load();
+            window->release(arrived - released);
+            released = arrived;
+        }
+        ASSERT_EQ(readFut.wait_for(1s), std::future_status::ready);
+        auto readResult = readFut.get();
+        ASSERT_TRUE(readResult.has_value());
+
+        EXPECT_EQ(data, createAlphabetString(1024 * 1024));
+    }
+
+    TEST_F(SftpTests, CanWriteBigFilePipelined)
+    {
+        CREATE_SERVER_AND_JOINER(Sftp);
+        auto [_, sftp] = createSftpSession(serverStartResult->port);
+
+        auto fut = sftp->openFile(
+            "/home/test/upload.txt",
+            SftpSession::OpenType::Write | SftpSession::OpenType::Create | SftpSession::OpenType::Truncate,
+            std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+        ASSERT_EQ(fut.wait_for(1s), std::future_status::ready);
+        auto result = fut.get();
+        ASSERT_TRUE(result.has_value());
+
+        auto file = std::move(result).value().lock();
+        ASSERT_TRUE(file);
+
+        const auto content = createAlphabetString(1024 * 1024);
+        auto source = std::make_shared<PipelinedWriteSource>();
+        std::promise<std::expected<std::size_t, SftpError>> writePromise{};
+        file->writePipelined(8, source, [&writePromise](std::expected<std::size_t, SftpError>&& writeResult) {
+            writePromise.set_value(std::move(writeResult));
+        });
+        // Blocks arriving after the write started are picked up too:
+        for (std::size_t offset = 0; offset < content.size(); offset += 100'000)
+            source->push(content.substr(offset, 100'000));
+        source->finish();
+
+        auto writeFut = writePromise.get_future();
+        ASSERT_EQ(writeFut.wait_for(10s), std::future_status::ready);
+        auto writeResult = writeFut.get();
+        ASSERT_TRUE(writeResult.has_value());
+        EXPECT_EQ(writeResult.value(), content.size());
+        EXPECT_EQ(source->confirmed(), content.size());
+
+        auto statFut = sftp->stat("/home/test/upload.txt");
+        ASSERT_EQ(statFut.wait_for(1s), std::future_status::ready);
+        auto statResult = statFut.get();
+        ASSERT_TRUE(statResult.has_value());
+        EXPECT_EQ(statResult->size, content.size());
+    }
+
     TEST_F(SftpTests, CanMoveReadCursorForward)
     {
         CREATE_SERVER_AND_JOINER(Sftp);
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <ssh/sftp_directory_lister.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SecureShell::Test
+{
+    class SftpDirectoryListerTest : public ::testing::Test
+    {
+      protected:
+        struct SentRequest
+        {
+            std::uint8_t type;
+            std::uint32_t id;
+            std::string argument;
+        };
+
+        static void appendUint32(std::string& out, std::uint32_t value)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+                out.push_back(static_cast<char>((value >> shift) & 0xFF));
+        }
+
+        static void appendString(std::string& out, std::string_view value)
+        {
+            appendUint32(out, static_cast<std::uint32_t>(value.size()));
+            out.append(value);
+        }
+
+        static std::uint32_t readUint32(std::string_view data)
+        {
+            std::uint32_t value = 0;
+            for (int i = 0; i < 4; ++i)
+                value = (value << 8) | static_cast<std::uint8_t>(data[i]);
+            return value;
+        }
+
+        static std::string packet(std::uint8_t type, std::string const& payload)
+        {
+            std::string result{};
+            appendUint32(result, static_cast<std::uint32_t>(payload.size() + 1));
+            result.push_back(static_cast<char>(type));
+            result += payload;
+            return result;
+        }
+
+        static std::string version()
+        {
+            std::string payload{};
+            appendUint32(payload, 3);
+            return packet(2, payload);
+        }
+
+        static std::string handle(std::uint32_t id, std::string_view handle)
+        {
+            std::string payload{};
+            appendUint32(payload, id);
+            appendString(payload, handle);
+            return packet(102, payload);
+        }
+
+        static std::string status(std::uint32_t id, std::uint32_t code, std::string_view message = "")
+        {
+            std::string payload{};
+            appendUint32(payload, id);
+            appendUint32(payload, code);
+            appendString(payload, message);
+            appendString(payload, "en");
+            return packet(101, payload);
+        }
+
+        static std::string
+        names(std::uint32_t id, std::vector<std::pair<std::string, std::uint32_t>> const& entries)
+        {
+            std::string payload{};
+            appendUint32(payload, id);
+            appendUint32(payload, static_cast<std::uint32_t>(entries.size()));
+            for (auto const& [name, permissions] : entries)
+            {
+                appendString(payload, name);
+                appendString(payload, "-rw-r--r--    1 alice    staff        42 Jan  1 00:00 " + name);
+                appendUint32(payload, 0x1 | 0x4 | 0x8);
+                appendUint32(payload, 0);
+                appendUint32(payload, 42);
+                appendUint32(payload, permissions);
+                appendUint32(payload, 100);
+                appendUint32(payload, 200);
+            }
+            return packet(104, payload);
+        }
+
+        /**
+         * @brief Decodes what the lister sent since the last call. The init packet has no id and is skipped.
+         */
+        std::vector<SentRequest> takeSent()
+        {
+            std::vector<SentRequest> requests{};
+            std::string_view data{sent_};
+            while (data.size() >= 4)
+            {
+                const auto length = readUint32(data);
+                const auto body = data.substr(4, length);
+                const auto type = static_cast<std::uint8_t>(body[0]);
+                if (type != 1)
+                {
+                    const auto argumentLength = readUint32(body.substr(5));
+                    requests.push_back(SentRequest{
+                        .type = type,
+                        .id = readUint32(body.substr(1)),
+                        .argument = std::string{body.substr(9, argumentLength)},
+                    });
+                }
+                data.remove_prefix(4 + length);
+            }
+            sent_.clear();
+            return requests;
+        }
+
+      protected:
+        std::string sent_{};
+        SftpDirectoryLister lister_{[this](std::string data) {
+            sent_ += data;
+        }};
+    };
+
+    TEST_F(SftpDirectoryListerTest, DirectoriesListedBeforeTheHandshakeAreRequestedAfterIt)
+    {
+        lister_.start();
+        lister_.list(7, "/home");
+        EXPECT_TRUE(takeSent().empty());
+        EXPECT_EQ(lister_.pending(), 1);
+
+        ASSERT_TRUE(lister_.receive(version()));
+        EXPECT_TRUE(lister_.ready());
+        const auto sent = takeSent();
+        ASSERT_EQ(sent.size(), 1);
+        EXPECT_EQ(sent[0].type, 11);
+        EXPECT_EQ(sent[0].argument, "/home");
+    }
+
+    TEST_F(SftpDirectoryListerTest, ListingIsReadUntilEndOfFileAndTheHandleIsClosed)
+    {
+        lister_.start();
+        ASSERT_TRUE(lister_.receive(version()));
+        lister_.list(1, "/dir");
+
+        auto sent = takeSent();
+        ASSERT_EQ(sent.size(), 1);
+        ASSERT_TRUE(lister_.receive(handle(sent[0].id, "h1")));
+
+        sent = takeSent();
+        ASSERT_EQ(sent.size(), 1);
+        EXPECT_EQ(sent[0].type, 12);
+        EXPECT_EQ(sent[0].argument, "h1");
+        ASSERT_TRUE(lister_.receive(names(sent[0].id, {{".", 040755}, {"a.txt", 0100644}})));
+
+        sent = takeSent();
+        ASSERT_EQ(sent.size(), 1);
+        ASSERT_TRUE(lister_.receive(names(sent[0].id, {{"sub", 040755}})));
+        EXPECT_TRUE(lister_.takeListings().empty());
+
+        sent = takeSent();
+        ASSERT_EQ(sent.size(), 1);
+        ASSERT_TRUE(lister_.receive(status(sent[0].id, 1)));
+
+        sent = takeSent();
+        ASSERT_EQ(sent.size(), 1);
+        EXPECT_EQ(sent[0].type, 4);
+        EXPECT_EQ(sent[0].argument, "h1");
+
+        auto listings = lister_.takeListings();
+        ASSERT_EQ(listings.size(), 1);
+        EXPECT_EQ(listings[0].first, 1);
+        ASSERT_TRUE(listings[0].second.has_value());
+        auto const& entries = listings[0].second.value();
+        ASSERT_EQ(entries.size(), 3);
+        EXPECT_EQ(entries[1].path, "a.txt");
+        EXPECT_TRUE(entries[1].isRegularFile());
+        EXPECT_EQ(entries[1].size, 42);
+        EXPECT_EQ(entries[1].mtime, 200);
+        EXPECT_EQ(entries[1].owner, "alice");
+        EXPECT_EQ(entries[1].group, "staff");
+        EXPECT_TRUE(entries[2].isDirectory());
+        EXPECT_EQ(lister_.pending(), 0);
+
+        // The reply to the close is accepted and ignored:
+        ASSERT_TRUE(lister_.receive(status(sent[0].id, 0)));
+        EXPECT_TRUE(lister_.takeListings().empty());
+    }
+
+    TEST_F(SftpDirectoryListerTest, AllDirectoriesAreInFlightAndCompleteInTheOrderOfTheReplies)
+    {
+        lister_.start();
+        ASSERT_TRUE(lister_.receive(version()));
+        lister_.list(1, "/a");
+        lister_.list(2, "/b");
+        lister_.list(3, "/c");
+
+        const auto opens = takeSent();
+        ASSERT_EQ(opens.size(), 3);
+        EXPECT_EQ(lister_.pending(), 3);
+
+        ASSERT_TRUE(lister_.receive(status(opens[1].id, 2, "No such file")));
+        ASSERT_TRUE(lister_.receive(handle(opens[2].id, "h3") + handle(opens[0].id, "h1")));
+        const auto reads = takeSent();
+        ASSERT_EQ(reads.size(), 2);
+        ASSERT_TRUE(lister_.receive(status(reads[1].id, 1) + status(reads[0].id, 1)));
+
+        const auto listings = lister_.takeListings();
+        ASSERT_EQ(listings.size(), 3);
+        EXPECT_EQ(listings[0].first, 2);
+        ASSERT_FALSE(listings[0].second.has_value());
+        EXPECT_EQ(listings[0].second.error().sftpError, 2);
+        EXPECT_EQ(listings[0].second.error().message, "No such file");
+        EXPECT_EQ(listings[1].first, 1);
+        EXPECT_EQ(listings[2].first, 3);
+        EXPECT_EQ(lister_.pending(), 0);
+    }
+
+    TEST_F(SftpDirectoryListerTest, PacketsSplitAcrossReceivesAreReassembled)
+    {
+        lister_.start();
+        lister_.list(1, "/dir");
+
+        const auto data = version();
+        for (char c : data)
+            ASSERT_TRUE(lister_.receive(std::string_view{&c, 1}));
+        const auto open = takeSent();
+        ASSERT_EQ(open.size(), 1);
+
+        const auto reply = handle(open[0].id, "handle");
+        ASSERT_TRUE(lister_.receive(std::string_view{reply}.substr(0, 6)));
+        EXPECT_TRUE(takeSent().empty());
+        ASSERT_TRUE(lister_.receive(std::string_view{reply}.substr(6)));
+        EXPECT_EQ(takeSent().size(), 1);
+    }
+
+    TEST_F(SftpDirectoryListerTest, ReplyToUnknownRequestIsAnError)
+    {
+        lister_.start();
+        ASSERT_TRUE(lister_.receive(version()));
+
+        const auto result = lister_.receive(status(1234, 0));
+        ASSERT_FALSE(result);
+        EXPECT_EQ(result.error().wrapperError, WrapperErrors::MalformedReply);
+    }
+
+    TEST_F(SftpDirectoryListerTest, OutputThatIsNotSftpIsAnError)
+    {
+        lister_.start();
+        const auto result = lister_.receive("Welcome to the server!\n");
+        ASSERT_FALSE(result);
+        EXPECT_EQ(result.error().wrapperError, WrapperErrors::MalformedReply);
+    }
+
+    TEST_F(SftpDirectoryListerTest, NameCountBeyondThePacketIsAnError)
+    {
+        lister_.start();
+        ASSERT_TRUE(lister_.receive(version()));
+        lister_.list(1, "/dir");
+        const auto open = takeSent();
+        ASSERT_TRUE(lister_.receive(handle(open[0].id, "handle")));
+        const auto read = takeSent();
+        ASSERT_EQ(read.size(), 1);
+
+        std::string payload{};
+        appendUint32(payload, read[0].id);
+        appendUint32(payload, 0xFFFFFFF0);
+        const auto result = lister_.receive(packet(104, payload));
+        ASSERT_FALSE(result);
+        EXPECT_EQ(result.error().wrapperError, WrapperErrors::MalformedReply);
+    }
+}
@@ -223,6 +223,7 @@ const server = new Server({
                         if (flags & OPEN_MODE.WRITE) {
                             if (flags & OPEN_MODE.TRUNC) {
                                 result.content = '';
+                                result.stat.size = 0;
                             }
                         }
                     }
@@ -262,6 +263,7 @@ const server = new Server({
                         data,
                         Buffer.from(result.content.slice(offset + data.length))
                     ]).toString('utf8');
+                    result.stat.size = result.content.length;
 
                     sftpStream.status(reqid, STATUS_CODE.OK);
 
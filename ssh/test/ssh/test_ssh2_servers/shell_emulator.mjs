@@ -215,6 +215,13 @@ class Channel {
 
     pushData(data) {
         const dataString = data.toString();
+
+        // Writes can arrive merged, like "exit\r", so commands are split off at the carriage return:
+        if (dataString.length > 1 && dataString.includes('\r')) {
+            dataString.split(/(\r)/).filter(part => part.length > 0).forEach(part => this.pushData(part));
+            return;
+        }
+
         if (dataString === '\r') {
             this.stream.write('\r\n');
             this.executeCommand();
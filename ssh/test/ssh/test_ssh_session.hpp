@@ -6,7 +6,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <future>
+#include <mutex>
 
 extern std::filesystem::path programDirectory;
 
@@ -517,4 +522,113 @@ namespace SecureShell::Test
         channel->close();
         EXPECT_FALSE(channel->close());
     }
+
+    TEST_F(SshSessionTests, LargePastesAreWrittenCompletely)
+    {
+        auto [result, processThread] = createSshServer();
+        ASSERT_TRUE(result);
+        auto joiner = Nui::ScopeExit{[&]() noexcept {
+            result->command("exit");
+            if (processThread.joinable())
+                processThread.join();
+        }};
+
+        auto expectedSession = makePasswordTestSession(result->port);
+
+        ASSERT_TRUE(expectedSession.has_value());
+        auto session = std::move(expectedSession).value();
+        session->start();
+
+        auto expectedChannel = session->createPtyChannel({}).get();
+        ASSERT_TRUE(expectedChannel.has_value());
+        auto channel = expectedChannel.value().lock();
+
+        // More than the window the server offers, in many small writes:
+        constexpr std::size_t writeSize = 1024;
+        constexpr std::size_t writes = 4 * 1024;
+        std::atomic<std::size_t> echoed{0};
+        std::promise<void> allEchoed{};
+        channelStartReading(channel, [&echoed, &allEchoed](std::string const& data) {
+            const auto count = static_cast<std::size_t>(std::count(data.begin(), data.end(), 'x'));
+            if (echoed.fetch_add(count) + count == writeSize * writes)
+                allEchoed.set_value();
+        });
+
+        for (std::size_t i = 0; i != writes; ++i)
+            ASSERT_TRUE(channel->write(std::string(writeSize, 'x')));
+
+        ASSERT_EQ(allEchoed.get_future().wait_for(30s), std::future_status::ready);
+        EXPECT_EQ(channel->queuedBytes(), 0);
+
+        channel->close();
+    }
+
+    TEST_F(SshSessionTests, OutputPausesWhenTheWindowIsUsedUpAndResumesOnAcknowledge)
+    {
+        auto [result, processThread] = createSshServer();
+        ASSERT_TRUE(result);
+        auto joiner = Nui::ScopeExit{[&]() noexcept {
+            result->command("exit");
+            if (processThread.joinable())
+                processThread.join();
+        }};
+
+        auto expectedSession = makePasswordTestSession(result->port);
+
+        ASSERT_TRUE(expectedSession.has_value());
+        auto session = std::move(expectedSession).value();
+        session->start();
+
+        auto expectedChannel = session->createPtyChannel({}).get();
+        ASSERT_TRUE(expectedChannel.has_value());
+        auto channel = expectedChannel.value().lock();
+
+        constexpr std::size_t window = 4 * 1024;
+        constexpr std::size_t echoSize = 64 * 1024;
+        std::mutex mutex{};
+        std::condition_variable changed{};
+        std::size_t received = 0;
+        std::size_t echoed = 0;
+        channel->startReading(
+            [&](std::string const& data) {
+                std::lock_guard lock{mutex};
+                received += data.size();
+                echoed += static_cast<std::size_t>(std::count(data.begin(), data.end(), 'x'));
+                changed.notify_all();
+            },
+            [](std::string const&) {},
+            []() {},
+            {.maxChunkSize = 1024, .window = window});
+
+        ASSERT_TRUE(channel->write(std::string(echoSize, 'x')));
+
+        // The echo is far larger than the window, so reading stops once the window is used up:
+        std::unique_lock lock{mutex};
+        ASSERT_TRUE(changed.wait_for(lock, 5s, [&] {
+            return received >= window;
+        }));
+        changed.wait_for(lock, 200ms);
+        EXPECT_EQ(received, window);
+        EXPECT_LT(echoed, echoSize);
+
+        // Each acknowledge opens the window for that much more output:
+        const auto deadline = std::chrono::steady_clock::now() + 30s;
+        std::size_t acknowledged = 0;
+        while (echoed < echoSize && std::chrono::steady_clock::now() < deadline)
+        {
+            const auto unacknowledged = received - acknowledged;
+            acknowledged = received;
+            lock.unlock();
+            channel->acknowledge(unacknowledged);
+            lock.lock();
+            changed.wait_for(lock, 100ms, [&] {
+                return received > acknowledged;
+            });
+            EXPECT_LE(received - acknowledged, window);
+        }
+        EXPECT_EQ(echoed, echoSize);
+        lock.unlock();
+
+        channel->close();
+    }
 }
@@ -83,11 +83,26 @@ namespace Utility
             if (completed())
                 return false;
 
-            auto result = scanner_(fullPath(entries_[currentIndex_]));
+            auto result = scanner_(nextPath());
             if (!result)
                 return std::unexpected(std::move(result).error());
 
-            moveEntries(std::move(result).value(), currentIndex_);
+            return walk(std::move(result).value());
+        }
+
+        /**
+         * @brief Walk a single iteration with a listing of nextPath() that was obtained without the scanner, for
+         * instance asynchronously.
+         *
+         * @param listing The entries of the directory at nextPath().
+         * @return bool Returns false if there are more entries to process, true if done.
+         */
+        bool walk(std::vector<EntryT>&& listing)
+        {
+            if (completed())
+                return false;
+
+            moveEntries(std::move(listing), currentIndex_);
             ++currentIndex_;
 
             // Move over all files:
@@ -103,6 +118,14 @@ namespace Utility
             return completed();
         }
 
+        /**
+         * @brief The directory the next walk iteration lists. Must not be called when completed.
+         */
+        std::filesystem::path nextPath() const
+        {
+            return fullPath(entries_[currentIndex_]);
+        }
+
         std::filesystem::path fullPath(EntryT const& entry) const
         {
             if (entry.parent)
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace Utility
+{
+    /**
+     * @brief Quotes text as one word for a POSIX shell. Single quotes keep everything literal, a single quote in the
+     * text closes the quoting, is escaped and reopens it.
+     */
+    inline std::string shellQuote(std::string_view text)
+    {
+        std::string quoted{"'"};
+        for (char c : text)
+        {
+            if (c == '\'')
+                quoted += "'\\''";
+            else
+                quoted += c;
+        }
+        quoted += '\'';
+        return quoted;
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <shared_data/directory_entry.hpp>
+#include <shared_data/directory_entry_store.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Utility::Test
+{
+    /**
+     * Compares a scan result held as DirectoryEntry values with the compact store, for a tree of two million files.
+     * Disabled by default, run it with
+     * --gtest_also_run_disabled_tests --gtest_filter=DirectoryEntryStoreBenchmark.*
+     */
+    class DirectoryEntryStoreBenchmark : public ::testing::Test
+    {
+      protected:
+        template <typename FunctionT>
+        static void measure(std::string const& name, FunctionT&& func)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const auto result = func();
+            const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "[ BENCHMARK ] " << name << ": " << seconds * 1000.0 << " ms (" << result << ")\n";
+        }
+
+        // Like an sftp listing: every entry has a long name, an owner and a group.
+        static SharedData::DirectoryEntry makeEntry(std::size_t number, SharedData::FileType type)
+        {
+            const auto name = (type == SharedData::FileType::Directory ? "directory_" : "some_file_name_") +
+                std::to_string(number) + (type == SharedData::FileType::Directory ? "" : ".js");
+            return SharedData::DirectoryEntry{
+                .path = name,
+                .longName = "-rw-r--r--    1 someone  somegroup    12345 Jan  1 12:00 " + name,
+                .type = type,
+                .size = 12345,
+                .uid = 1000,
+                .gid = 1000,
+                .owner = "someone",
+                .group = "somegroup",
+                .permissions = std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+                .mtime = 1'700'000'000,
+            };
+        }
+
+        // Roughly the heap held by strings and paths that outgrew their small buffer.
+        static std::size_t heapBytes(std::string const& text)
+        {
+            return text.capacity() > std::string{}.capacity() ? text.capacity() + 1 : 0;
+        }
+
+        static std::size_t memoryOf(std::vector<SharedData::DirectoryEntry> const& entries)
+        {
+            std::size_t bytes = entries.capacity() * sizeof(SharedData::DirectoryEntry);
+            for (auto const& entry : entries)
+            {
+                bytes += heapBytes(entry.path.native()) + heapBytes(entry.longName.native()) +
+                    heapBytes(entry.owner) + heapBytes(entry.group) + heapBytes(entry.acl);
+            }
+            return bytes;
+        }
+
+        static std::filesystem::path
+        recursiveFullPath(std::vector<SharedData::DirectoryEntry> const& entries, SharedData::DirectoryEntry const& entry)
+        {
+            if (entry.parent)
+                return recursiveFullPath(entries, entries[*entry.parent]) / entry.path;
+            return entry.path;
+        }
+
+        // Ten levels of 4 directories each hold files at the leaves:
+        template <typename AddT>
+        static void buildTree(AddT&& add)
+        {
+            std::size_t number = 0;
+            std::vector<std::size_t> level{0};
+            for (int depth = 0; depth < 9; ++depth)
+            {
+                std::vector<std::size_t> next{};
+                for (auto parent : level)
+                {
+                    for (int i = 0; i < 4 && number < directories; ++i)
+                        next.push_back(add(makeEntry(number++, SharedData::FileType::Directory), parent));
+                }
+                level = std::move(next);
+            }
+            for (std::size_t i = 0; i < files; ++i)
+                add(makeEntry(number++, SharedData::FileType::Regular), level[i % level.size()]);
+        }
+
+        constexpr static std::size_t directories = 100'000;
+        constexpr static std::size_t files = 2'000'000;
+    };
+
+    TEST_F(DirectoryEntryStoreBenchmark, DISABLED_MemoryAndPathTime)
+    {
+        std::vector<SharedData::DirectoryEntry> entries{SharedData::DirectoryEntry{
+            .path = "/home/someone/project",
+            .type = SharedData::FileType::Directory,
+        }};
+        SharedData::DirectoryEntryStore store{"/home/someone/project"};
+
+        measure("build DirectoryEntry vector", [&]() {
+            buildTree([&](SharedData::DirectoryEntry&& entry, std::size_t parent) {
+                entry.parent = parent;
+                entries.push_back(std::move(entry));
+                return entries.size() - 1;
+            });
+            return std::to_string(memoryOf(entries) / (1024 * 1024)) + " MiB";
+        });
+
+        measure("build DirectoryEntryStore", [&]() {
+            buildTree([&](SharedData::DirectoryEntry&& entry, std::size_t parent) {
+                return store.add(entry, parent);
+            });
+            return std::to_string(store.memoryUsage() / (1024 * 1024)) + " MiB";
+        });
+
+        ASSERT_EQ(entries.size(), store.size());
+
+        measure("full paths of DirectoryEntry vector", [&]() {
+            std::size_t length = 0;
+            for (auto const& entry : entries)
+                length += recursiveFullPath(entries, entry).native().size();
+            return std::to_string(length) + " characters";
+        });
+
+        measure("full paths of DirectoryEntryStore", [&]() {
+            std::size_t length = 0;
+            for (std::size_t i = 0; i != store.size(); ++i)
+                length += store.fullPath(i).native().size();
+            return std::to_string(length) + " characters";
+        });
+    }
+}
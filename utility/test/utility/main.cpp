@@ -1,4 +1,8 @@
+#include "test_directory_entry_store.hpp"
 #include "test_directory_traversal.hpp"
+#include "test_shell_quote.hpp"
+#include "test_transfer_filter.hpp"
+#include "benchmark_directory_entry_store.hpp"
 
 #include <gtest/gtest.h>
 
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <shared_data/directory_entry_store.hpp>
+
+#include <gtest/gtest.h>
+
+namespace Utility::Test
+{
+    class DirectoryEntryStoreTests : public ::testing::Test
+    {
+      protected:
+        static SharedData::DirectoryEntry
+        entry(std::string name, SharedData::FileType type, std::uint64_t size = 0, std::string owner = "user")
+        {
+            return SharedData::DirectoryEntry{
+                .path = std::move(name),
+                .type = type,
+                .size = size,
+                .uid = 1000,
+                .gid = 1000,
+                .owner = std::move(owner),
+                .group = "users",
+                .permissions = std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+                .mtime = 1234,
+            };
+        }
+    };
+
+    TEST_F(DirectoryEntryStoreTests, RootIsTheFirstEntry)
+    {
+        SharedData::DirectoryEntryStore store{"/home/user"};
+        ASSERT_EQ(store.size(), 1);
+        EXPECT_TRUE(store.isDirectory(0));
+        EXPECT_FALSE(store.parent(0).has_value());
+        EXPECT_EQ(store.relativePath(0), "");
+        EXPECT_EQ(store.fullPath(0), std::filesystem::path{"/home/user"});
+    }
+
+    TEST_F(DirectoryEntryStoreTests, DefaultStoreIsEmpty)
+    {
+        SharedData::DirectoryEntryStore store{};
+        EXPECT_TRUE(store.empty());
+    }
+
+    TEST_F(DirectoryEntryStoreTests, BuildsPathsOfNestedEntries)
+    {
+        SharedData::DirectoryEntryStore store{"/root"};
+        const auto a = store.add(entry("a", SharedData::FileType::Directory), 0);
+        const auto file = store.add(entry("top.txt", SharedData::FileType::Regular, 10), 0);
+        const auto b = store.add(entry("b", SharedData::FileType::Directory), a);
+        const auto c = store.add(entry("c", SharedData::FileType::Directory), b);
+        const auto deep = store.add(entry("deep.bin", SharedData::FileType::Regular, 20), c);
+
+        EXPECT_EQ(store.relativePath(file), "top.txt");
+        EXPECT_EQ(store.relativePath(c), "a/b/c");
+        EXPECT_EQ(store.relativePath(deep), "a/b/c/deep.bin");
+        EXPECT_EQ(store.fullPath(deep), std::filesystem::path{"/root"} / "a/b/c/deep.bin");
+        EXPECT_EQ(store.parent(deep), c);
+        EXPECT_EQ(store.name(deep), "deep.bin");
+        EXPECT_EQ(store.fileSize(deep), 20);
+    }
+
+    TEST_F(DirectoryEntryStoreTests, KeepsMetadataAndInternsOwners)
+    {
+        SharedData::DirectoryEntryStore store{"/root"};
+        const auto first = store.add(entry("first", SharedData::FileType::Regular, 1, "alice"), 0);
+        const auto second = store.add(entry("second", SharedData::FileType::Symlink, 2, "bob"), 0);
+        const auto third = store.add(entry("third", SharedData::FileType::Regular, 3, "alice"), 0);
+
+        EXPECT_EQ(store.owner(first), "alice");
+        EXPECT_EQ(store.owner(second), "bob");
+        EXPECT_EQ(store.owner(third), "alice");
+        EXPECT_EQ(store.owner(first).data(), store.owner(third).data());
+        EXPECT_EQ(store.group(second), "users");
+        EXPECT_TRUE(store.isSymlink(second));
+
+        const auto rebuilt = store.entry(third);
+        EXPECT_EQ(rebuilt.path, std::filesystem::path{"third"});
+        EXPECT_EQ(rebuilt.size, 3);
+        EXPECT_EQ(rebuilt.uid, 1000);
+        EXPECT_EQ(rebuilt.mtime, 1234);
+        EXPECT_EQ(rebuilt.permissions, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+        EXPECT_EQ(rebuilt.parent, std::optional<std::size_t>{0});
+    }
+
+    TEST_F(DirectoryEntryStoreTests, PrefixesSurviveGrowth)
+    {
+        SharedData::DirectoryEntryStore store{"/root"};
+        std::size_t parent = 0;
+        std::string expected{};
+        for (int i = 0; i < 1000; ++i)
+        {
+            const auto name = "directory" + std::to_string(i);
+            parent = store.add(entry(name, SharedData::FileType::Directory), parent);
+            expected += (i == 0 ? "" : "/") + name;
+        }
+        EXPECT_EQ(store.relativePath(parent), expected);
+    }
+}
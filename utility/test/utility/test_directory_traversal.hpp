@@ -158,6 +158,31 @@ namespace Utility::Test
         EXPECT_TRUE(std::get<4>(result)) << "There should not be any more work";
     }
 
+    TEST_F(DirectoryTraversalTests, WalkAcceptsListingsObtainedWithoutTheScanner)
+    {
+        auto result = withWalkerDo([this](auto& walker) {
+            EXPECT_EQ(walker.nextPath(), isolateDirectory_.path());
+            walker.walk(
+                std::vector<SharedData::DirectoryEntry>{
+                    {.path = "dir", .type = SharedData::FileType::Directory},
+                    {.path = "file", .type = SharedData::FileType::Regular, .size = 10},
+                });
+            EXPECT_EQ(walker.nextPath(), isolateDirectory_.path() / "dir");
+            const auto res = walker.walk(
+                std::vector<SharedData::DirectoryEntry>{
+                    {.path = "nested", .type = SharedData::FileType::Regular, .size = 5},
+                });
+            return std::make_tuple(
+                res, walker.totalEntries(), walker.totalBytes(), walker.currentIndex(), walker.completed());
+        });
+
+        EXPECT_TRUE(std::get<0>(result)) << "Walk should have no more work";
+        EXPECT_EQ(std::get<1>(result), 4) << "Total entries should be 4";
+        EXPECT_EQ(std::get<2>(result), 15) << "Total bytes should be 15";
+        EXPECT_EQ(std::get<3>(result), 4) << "Current index should be 4";
+        EXPECT_TRUE(std::get<4>(result)) << "There should not be any more work";
+    }
+
     TEST_F(DirectoryTraversalTests, DirectoriesAreFound)
     {
         constexpr auto n = 5;
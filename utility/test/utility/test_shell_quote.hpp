@@ -0,0 +1,28 @@
+#pragma once
+
+#include <utility/shell_quote.hpp>
+
+#include <gtest/gtest.h>
+
+namespace Utility::Test
+{
+    class ShellQuoteTests : public ::testing::Test
+    {};
+
+    TEST_F(ShellQuoteTests, EmptyTextIsAnEmptyWord)
+    {
+        EXPECT_EQ(shellQuote(""), "''");
+    }
+
+    TEST_F(ShellQuoteTests, SpecialCharactersStayLiteral)
+    {
+        EXPECT_EQ(shellQuote("/home/a b/$HOME/`x`;*\"\\"), "'/home/a b/$HOME/`x`;*\"\\'");
+    }
+
+    TEST_F(ShellQuoteTests, SingleQuotesAreEscapedOutsideTheQuoting)
+    {
+        EXPECT_EQ(shellQuote("it's"), "'it'\\''s'");
+        EXPECT_EQ(shellQuote("'"), "''\\'''");
+        EXPECT_EQ(shellQuote("a''b"), "'a'\\'''\\''b'");
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <shared_data/transfer_filter.hpp>
+
+#include <gtest/gtest.h>
+
+namespace Utility::Test
+{
+    class TransferFilterTests : public ::testing::Test
+    {
+      protected:
+        static constexpr std::uint64_t now = 1'000'000;
+
+        static SharedData::DirectoryEntry file(std::uint64_t size = 0, std::uint64_t mtime = now)
+        {
+            return SharedData::DirectoryEntry{
+                .type = SharedData::FileType::Regular,
+                .size = size,
+                .mtime = mtime,
+            };
+        }
+
+        static SharedData::DirectoryEntry directory()
+        {
+            return SharedData::DirectoryEntry{.type = SharedData::FileType::Directory};
+        }
+
+        static SharedData::TransferFilter filter(std::string_view text)
+        {
+            const auto options = SharedData::parseTransferFilter(text);
+            EXPECT_TRUE(options.has_value());
+            return SharedData::TransferFilter{options.value_or(SharedData::TransferFilterOptions{}), now};
+        }
+    };
+
+    TEST_F(TransferFilterTests, EmptyFilterExcludesNothing)
+    {
+        const SharedData::TransferFilter filter{};
+        EXPECT_TRUE(filter.empty());
+        EXPECT_FALSE(filter.excludes("a/b.txt", file()));
+        EXPECT_FALSE(filter.excludes(".git", directory()));
+    }
+
+    TEST_F(TransferFilterTests, PatternsWithoutSlashMatchTheNameAtAnyDepth)
+    {
+        const auto filter = this->filter(".git node_modules *.log core.[0-9]*");
+        EXPECT_TRUE(filter.excludes(".git", directory()));
+        EXPECT_TRUE(filter.excludes("app/web/node_modules", directory()));
+        EXPECT_TRUE(filter.excludes("app/logs/server.log", file()));
+        EXPECT_TRUE(filter.excludes("app/core.1234", file()));
+        EXPECT_FALSE(filter.excludes("app/core.txt", file()));
+        EXPECT_FALSE(filter.excludes("app/server.log.gz", file()));
+        EXPECT_FALSE(filter.excludes("app/.gitignore", file()));
+    }
+
+    TEST_F(TransferFilterTests, PatternsWithSlashAreAnchoredAtTheRoot)
+    {
+        const auto filter = this->filter("/build docs/*.pdf src/**/generated");
+        EXPECT_TRUE(filter.excludes("build", directory()));
+        EXPECT_FALSE(filter.excludes("app/build", directory()));
+        EXPECT_TRUE(filter.excludes("docs/manual.pdf", file()));
+        EXPECT_FALSE(filter.excludes("docs/old/manual.pdf", file()));
+        EXPECT_TRUE(filter.excludes("src/generated", directory()));
+        EXPECT_TRUE(filter.excludes("src/a/b/generated", directory()));
+    }
+
+    TEST_F(TransferFilterTests, TrailingSlashOnlyMatchesDirectories)
+    {
+        const auto filter = this->filter("cache/");
+        EXPECT_TRUE(filter.excludes("cache", directory()));
+        EXPECT_FALSE(filter.excludes("cache", file()));
+    }
+
+    TEST_F(TransferFilterTests, LastMatchingPatternDecides)
+    {
+        const auto filter = this->filter("*.log !important.log");
+        EXPECT_TRUE(filter.excludes("debug.log", file()));
+        EXPECT_FALSE(filter.excludes("important.log", file()));
+        EXPECT_TRUE(filter.excludedDirectoryNames().empty());
+    }
+
+    TEST_F(TransferFilterTests, SizeAndAgeOnlyApplyToFiles)
+    {
+        const auto filter = this->filter("size>1k size<1M age<1d");
+        EXPECT_TRUE(filter.excludes("small", file(100)));
+        EXPECT_TRUE(filter.excludes("large", file(2 * 1024 * 1024)));
+        EXPECT_FALSE(filter.excludes("fits", file(4096)));
+        EXPECT_TRUE(filter.excludes("old", file(4096, now - 2 * 24 * 60 * 60)));
+        EXPECT_FALSE(filter.excludes("dir", directory()));
+    }
+
+    TEST_F(TransferFilterTests, SizeAndAgeBoundsAreExclusive)
+    {
+        const auto sizes = this->filter("size>1k size<10M");
+        EXPECT_TRUE(sizes.excludes("min", file(1024)));
+        EXPECT_FALSE(sizes.excludes("aboveMin", file(1025)));
+        EXPECT_TRUE(sizes.excludes("max", file(10 * 1024 * 1024)));
+        EXPECT_FALSE(sizes.excludes("belowMax", file(10 * 1024 * 1024 - 1)));
+
+        const auto ages = this->filter("age>1h age<2h");
+        EXPECT_TRUE(ages.excludes("min", file(0, now - 60 * 60)));
+        EXPECT_FALSE(ages.excludes("aboveMin", file(0, now - 60 * 60 - 1)));
+        EXPECT_TRUE(ages.excludes("max", file(0, now - 2 * 60 * 60)));
+        EXPECT_FALSE(ages.excludes("belowMax", file(0, now - 2 * 60 * 60 + 1)));
+    }
+
+    TEST_F(TransferFilterTests, InvalidConditionIsAnError)
+    {
+        EXPECT_FALSE(SharedData::parseTransferFilter("size<lots").has_value());
+        EXPECT_FALSE(SharedData::parseTransferFilter("age>3y").has_value());
+    }
+
+    TEST_F(TransferFilterTests, QuantityThatOverflowsIsAnError)
+    {
+        EXPECT_FALSE(SharedData::parseTransferFilter("size<99999999T").has_value());
+        EXPECT_FALSE(SharedData::parseTransferFilter("age>999999999999999999d").has_value());
+        EXPECT_TRUE(SharedData::parseTransferFilter("size<16777215T").has_value());
+    }
+
+    TEST_F(TransferFilterTests, UnanchoredPatternsCanBePrunedRemotely)
+    {
+        const auto names = filter(".git *.log /build a/**/b").excludedDirectoryNames();
+        EXPECT_EQ(names, (std::vector<std::string>{".git", "*.log"}));
+    }
+
+    TEST_F(TransferFilterTests, GlobCharacterClassesAndEscapes)
+    {
+        EXPECT_TRUE(SharedData::globMatch("file[0-9].txt", "file7.txt"));
+        EXPECT_FALSE(SharedData::globMatch("file[!0-9].txt", "file7.txt"));
+        EXPECT_TRUE(SharedData::globMatch("\\*literal", "*literal"));
+        EXPECT_FALSE(SharedData::globMatch("\\*literal", "xliteral"));
+        EXPECT_FALSE(SharedData::globMatch("a*c", "a/c"));
+        EXPECT_TRUE(SharedData::globMatch("a/**", "a/b/c"));
+    }
+}